@@ -1906,6 +1906,55 @@ BiosVideoGraphicsOutputQueryMode (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Ask the CPU driver to map the linear frame buffer of a VBE mode write-combining.
+  Frame buffer updates are write-only streams, so letting the processor merge them
+  into burst writes is much cheaper than the uncached access the BIOS leaves behind.
+  Failure is not fatal, the Blt paths work the same on an uncached frame buffer.
+
+
+  @param BiosVideoPrivate - Pointer to BIOS_VIDEO_DEV structure
+  @param ModeData         - The VBE mode just set
+
+  @return None.
+
+**/
+STATIC
+VOID
+BiosVideoMapFrameBufferWc (
+  IN  BIOS_VIDEO_DEV        *BiosVideoPrivate,
+  IN  BIOS_VIDEO_MODE_DATA  *ModeData
+  )
+{
+  EFI_STATUS             Status;
+  EFI_CPU_ARCH_PROTOCOL  *Cpu;
+  EFI_PHYSICAL_ADDRESS   FrameBufferBase;
+
+  FrameBufferBase = (EFI_PHYSICAL_ADDRESS) (UINTN) ModeData->LinearFrameBuffer;
+  if (FrameBufferBase == 0 || ModeData->FrameBufferSize == 0 ||
+      FrameBufferBase == BiosVideoPrivate->FrameBufferWc) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol (&gEfiCpuArchProtocolGuid, NULL, (VOID **) &Cpu);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = Cpu->SetMemoryAttributes (
+                  Cpu,
+                  FrameBufferBase,
+                  ModeData->FrameBufferSize,
+                  EFI_MEMORY_WC
+                  );
+  DBG ("BiosVideo: frame buffer 0x%lx size 0x%lx write-combining: %r\n",
+       FrameBufferBase, (UINT64) ModeData->FrameBufferSize, Status);
+  if (!EFI_ERROR (Status)) {
+    BiosVideoPrivate->FrameBufferWc = FrameBufferBase;
+  }
+}
+
 /**
 
   Graphics Output protocol interface to set video mode
@@ -2027,6 +2076,7 @@ BiosVideoGraphicsOutputSetMode (
       return EFI_DEVICE_ERROR;
     }
     DBG ("BiosVideo: Set VBE Mode succeeded\n");
+    BiosVideoMapFrameBufferWc (BiosVideoPrivate, ModeData);
     //
     // Initialize the state of the VbeFrameBuffer
     //
@@ -2054,15 +2104,17 @@ BiosVideoGraphicsOutputSetMode (
 
 /**
 
-  Update physical frame buffer, copy 4 bytes block, then copy remaining bytes.
+  Update physical frame buffer from the shadow buffer for a rectangle.
+  When the rectangle spans whole scan lines it is copied as a single block,
+  otherwise one row at a time.
 
 
-  @param PciIo           - The pointer of EFI_PCI_IO_PROTOCOL
-  @param VbeBuffer       - The data to transfer to screen
+  @param VbeBuffer       - The shadow buffer base, laid out like the frame buffer
   @param MemAddress      - Physical frame buffer base address
-  @param DestinationX    - The X coordinate of the destination for BltOperation
-  @param DestinationY    - The Y coordinate of the destination for BltOperation
-  @param TotalBytes      - The total bytes of copy
+  @param DestinationX    - The X coordinate of the rectangle
+  @param DestinationY    - The Y coordinate of the rectangle
+  @param TotalBytes      - The bytes of each row of the rectangle
+  @param Height          - The number of rows of the rectangle
   @param VbePixelWidth   - Bytes per pixel
   @param BytesPerScanLine - Bytes per scan line
 
@@ -2071,92 +2123,34 @@ BiosVideoGraphicsOutputSetMode (
 **/
 VOID
 CopyVideoBuffer (
-  IN  EFI_PCI_IO_PROTOCOL   *PciIo,
   IN  UINT8                 *VbeBuffer,
   IN  VOID                  *MemAddress,
   IN  UINTN                 DestinationX,
   IN  UINTN                 DestinationY,
   IN  UINTN                 TotalBytes,
+  IN  UINTN                 Height,
   IN  UINT32                VbePixelWidth,
   IN  UINTN                 BytesPerScanLine
   )
 {
-  UINTN                 FrameBufferAddr;
-  UINTN                 CopyBlockNum;
-  UINTN                 RemainingBytes;
-  UINTN                 UnalignedBytes;
-  EFI_STATUS            Status;
-
-  FrameBufferAddr = (UINTN) MemAddress + (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth;
+  UINTN                 Offset;
+  UINTN                 Index;
 
   //
-  // If TotalBytes is less than 4 bytes, only start byte copy.
+  // The frame buffer is identity mapped memory, so plain stores reach it. CopyMem
+  // moves it with string instructions, which the write-combining mapping turns
+  // into burst writes.
   //
-  if (TotalBytes < 4) {
-    Status = PciIo->Mem.Write (
-                     PciIo,
-                     EfiPciIoWidthUint8,
-                     EFI_PCI_IO_PASS_THROUGH_BAR,
-                     (UINT64) FrameBufferAddr,
-                     TotalBytes,
-                     VbeBuffer
-                     );
-    ASSERT_EFI_ERROR (Status);
-    return;
-  }
-
-  //
-  // If VbeBuffer is not 4-byte aligned, start byte copy.
-  //
-  UnalignedBytes  = (4 - ((UINTN) VbeBuffer & 0x3)) & 0x3;
+  Offset = (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth;
 
-  if (UnalignedBytes != 0) {
-    Status = PciIo->Mem.Write (
-                     PciIo,
-                     EfiPciIoWidthUint8,
-                     EFI_PCI_IO_PASS_THROUGH_BAR,
-                     (UINT64) FrameBufferAddr,
-                     UnalignedBytes,
-                     VbeBuffer
-                     );
-    ASSERT_EFI_ERROR (Status);
-    FrameBufferAddr += UnalignedBytes;
-    VbeBuffer       += UnalignedBytes;
+  if (TotalBytes == BytesPerScanLine) {
+    CopyMem ((UINT8 *) MemAddress + Offset, VbeBuffer + Offset, TotalBytes * Height);
+    return;
   }
 
-  //
-  // Calculate 4-byte block count and remaining bytes.
-  //
-  CopyBlockNum   = (TotalBytes - UnalignedBytes) >> 2;
-  RemainingBytes = (TotalBytes - UnalignedBytes) &  3;
-
-  //
-  // Copy 4-byte block and remaining bytes to physical frame buffer.
-  //
-  if (CopyBlockNum != 0) {
-    Status = PciIo->Mem.Write (
-                    PciIo,
-                    EfiPciIoWidthUint32,
-                    EFI_PCI_IO_PASS_THROUGH_BAR,
-                    (UINT64) FrameBufferAddr,
-                    CopyBlockNum,
-                    VbeBuffer
-                    );
-    ASSERT_EFI_ERROR (Status);
-  }
-
-  if (RemainingBytes != 0) {
-    FrameBufferAddr += (CopyBlockNum << 2);
-    VbeBuffer       += (CopyBlockNum << 2);
-    Status = PciIo->Mem.Write (
-                    PciIo,
-                    EfiPciIoWidthUint8,
-                    EFI_PCI_IO_PASS_THROUGH_BAR,
-                    (UINT64) FrameBufferAddr,
-                    RemainingBytes,
-                    VbeBuffer
-                    );
-    ASSERT_EFI_ERROR (Status);
+  for (Index = 0; Index < Height; Index++) {
+    CopyMem ((UINT8 *) MemAddress + Offset, VbeBuffer + Offset, TotalBytes);
+    Offset += BytesPerScanLine;
   }
 }
 
@@ -2203,7 +2197,6 @@ BiosVideoGraphicsOutputVbeBlt (
 {
   BIOS_VIDEO_DEV                 *BiosVideoPrivate;
   BIOS_VIDEO_MODE_DATA           *Mode;
-  EFI_PCI_IO_PROTOCOL            *PciIo;
   EFI_TPL                        OriginalTPL;
   UINTN                          DstY;
   UINTN                          SrcY;
@@ -2218,7 +2211,9 @@ BiosVideoGraphicsOutputVbeBlt (
   UINT8                          *BltUint8;
   UINT32                         VbePixelWidth;
   UINT32                         Pixel;
+  UINT32                         *VbePixel;
   UINTN                          TotalBytes;
+  BOOLEAN                        NativeLayout;
 
   if (This == NULL || ((UINTN) BltOperation) >= EfiGraphicsOutputBltOperationMax) {
     return EFI_INVALID_PARAMETER;
@@ -2230,7 +2225,6 @@ BiosVideoGraphicsOutputVbeBlt (
 
   BiosVideoPrivate  = BIOS_VIDEO_DEV_FROM_GRAPHICS_OUTPUT_THIS (This);
   Mode              = &BiosVideoPrivate->ModeData[This->Mode->Mode];
-  PciIo             = BiosVideoPrivate->PciIo;
 
   VbeFrameBuffer    = BiosVideoPrivate->VbeFrameBuffer;
   MemAddress        = Mode->LinearFrameBuffer;
@@ -2239,6 +2233,15 @@ BiosVideoGraphicsOutputVbeBlt (
   BltUint8          = (UINT8 *) BltBuffer;
   TotalBytes        = Width * VbePixelWidth;
 
+  //
+  // The usual 32bpp layout matches EFI_GRAPHICS_OUTPUT_BLT_PIXEL byte for byte,
+  // so whole rows move without shuffling the color fields.
+  //
+  NativeLayout      = (BOOLEAN) (VbePixelWidth == 4 &&
+                                 Mode->Red.Position == 16 && Mode->Red.Mask == 0xFF &&
+                                 Mode->Green.Position == 8 && Mode->Green.Mask == 0xFF &&
+                                 Mode->Blue.Position == 0 && Mode->Blue.Mask == 0xFF);
+
   //
   // We need to fill the Virtual Screen buffer with the blt data.
   // The virtual screen is upside down, as the first row is the bootom row of
@@ -2286,10 +2289,17 @@ BiosVideoGraphicsOutputVbeBlt (
   case EfiBltVideoToBltBuffer:
     for (SrcY = SourceY, DstY = DestinationY; DstY < (Height + DestinationY); SrcY++, DstY++) {
       Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (BltUint8 + DstY * Delta + DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      VbeBuffer = ((UINT8 *) VbeFrameBuffer + (SrcY * BytesPerScanLine + SourceX * VbePixelWidth));
+      if (NativeLayout) {
+        VbePixel = (UINT32 *) VbeBuffer;
+        for (Index = 0; Index < Width; Index++) {
+          *(UINT32 *) &Blt[Index] = VbePixel[Index] & 0x00FFFFFF;
+        }
+        continue;
+      }
       //
       // Shuffle the packed bytes in the hardware buffer to match EFI_GRAPHICS_OUTPUT_BLT_PIXEL
       //
-      VbeBuffer = ((UINT8 *) VbeFrameBuffer + (SrcY * BytesPerScanLine + SourceX * VbePixelWidth));
       for (DstX = DestinationX; DstX < (Width + DestinationX); DstX++) {
         Pixel         = *(UINT32 *) (VbeBuffer);
         Blt->Red      = (UINT8) ((Pixel >> Mode->Red.Position) & Mode->Red.Mask);
@@ -2316,25 +2326,7 @@ BiosVideoGraphicsOutputVbeBlt (
       VbeBuffer   = ((UINT8 *) VbeFrameBuffer + DstY * BytesPerScanLine + DestinationX * VbePixelWidth);
       VbeBuffer1  = ((UINT8 *) VbeFrameBuffer + SrcY * BytesPerScanLine + SourceX * VbePixelWidth);
 
-      gBS->CopyMem (
-            VbeBuffer,
-            VbeBuffer1,
-            TotalBytes
-            );
-
-      //
-      // Update physical frame buffer.
-      //
-      CopyVideoBuffer (
-        PciIo,
-        VbeBuffer,
-        MemAddress,
-        DestinationX,
-        DstY,
-        TotalBytes,
-        VbePixelWidth,
-        BytesPerScanLine
-        );
+      CopyMem (VbeBuffer, VbeBuffer1, TotalBytes);
     }
     break;
 
@@ -2351,36 +2343,21 @@ BiosVideoGraphicsOutputVbeBlt (
       ) |
           ((Blt->Blue & Mode->Blue.Mask) << Mode->Blue.Position);
 
-    for (Index = 0; Index < Width; Index++) {
-      gBS->CopyMem (
-            VbeBuffer,
-            &Pixel,
-            VbePixelWidth
-            );
-      VbeBuffer += VbePixelWidth;
+    if (VbePixelWidth == 4) {
+      SetMem32 (VbeBuffer, TotalBytes, Pixel);
+    } else {
+      for (Index = 0; Index < TotalBytes; Index += VbePixelWidth) {
+        VbeBuffer[Index]     = (UINT8) Pixel;
+        VbeBuffer[Index + 1] = (UINT8) (Pixel >> 8);
+        VbeBuffer[Index + 2] = (UINT8) (Pixel >> 16);
+      }
     }
 
-    VbeBuffer = (UINT8 *) ((UINTN) VbeFrameBuffer + (DestinationY * BytesPerScanLine) + DestinationX * VbePixelWidth);
     for (DstY = DestinationY + 1; DstY < (Height + DestinationY); DstY++) {
-      gBS->CopyMem (
-            (VOID *) ((UINTN) VbeFrameBuffer + (DstY * BytesPerScanLine) + DestinationX * VbePixelWidth),
-            VbeBuffer,
-            TotalBytes
-            );
-    }
-    for (DstY = DestinationY; DstY < (Height + DestinationY); DstY++) {
-      //
-      // Update physical frame buffer.
-      //
-      CopyVideoBuffer (
-        PciIo,
+      CopyMem (
+        (VOID *) ((UINTN) VbeFrameBuffer + (DstY * BytesPerScanLine) + DestinationX * VbePixelWidth),
         VbeBuffer,
-        MemAddress,
-        DestinationX,
-        DstY,
-        TotalBytes,
-        VbePixelWidth,
-        BytesPerScanLine
+        TotalBytes
         );
     }
     break;
@@ -2389,43 +2366,49 @@ BiosVideoGraphicsOutputVbeBlt (
     for (SrcY = SourceY, DstY = DestinationY; SrcY < (Height + SourceY); SrcY++, DstY++) {
       Blt       = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (BltUint8 + (SrcY * Delta) + (SourceX) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
       VbeBuffer = ((UINT8 *) VbeFrameBuffer + (DstY * BytesPerScanLine + DestinationX * VbePixelWidth));
-      for (DstX = DestinationX; DstX < (Width + DestinationX); DstX++) {
+      if (NativeLayout) {
+        CopyMem (VbeBuffer, Blt, TotalBytes);
+        continue;
+      }
+      for (Index = 0; Index < TotalBytes; Index += VbePixelWidth) {
         //
         // Shuffle the RGB fields in EFI_GRAPHICS_OUTPUT_BLT_PIXEL to match the hardware buffer
         //
         Pixel = ((Blt->Red & Mode->Red.Mask) << Mode->Red.Position) |
           ((Blt->Green & Mode->Green.Mask) << Mode->Green.Position) |
             ((Blt->Blue & Mode->Blue.Mask) << Mode->Blue.Position);
-        gBS->CopyMem (
-              VbeBuffer,
-              &Pixel,
-              VbePixelWidth
-              );
+        if (VbePixelWidth == 4) {
+          *(UINT32 *) (VbeBuffer + Index) = Pixel;
+        } else {
+          VbeBuffer[Index]     = (UINT8) Pixel;
+          VbeBuffer[Index + 1] = (UINT8) (Pixel >> 8);
+          VbeBuffer[Index + 2] = (UINT8) (Pixel >> 16);
+        }
         Blt++;
-        VbeBuffer += VbePixelWidth;
       }
-
-      VbeBuffer = ((UINT8 *) VbeFrameBuffer + (DstY * BytesPerScanLine + DestinationX * VbePixelWidth));
-
-      //
-      // Update physical frame buffer.
-      //
-      CopyVideoBuffer (
-        PciIo,
-        VbeBuffer,
-        MemAddress,
-        DestinationX,
-        DstY,
-        TotalBytes,
-        VbePixelWidth,
-        BytesPerScanLine
-        );
     }
     break;
   default:
     break;
   }
 
+  //
+  // Only the destination rectangle of the shadow buffer changed, flush just that
+  // to the physical frame buffer.
+  //
+  if (BltOperation != EfiBltVideoToBltBuffer) {
+    CopyVideoBuffer (
+      (UINT8 *) VbeFrameBuffer,
+      MemAddress,
+      DestinationX,
+      DestinationY,
+      TotalBytes,
+      Height,
+      VbePixelWidth,
+      BytesPerScanLine
+      );
+  }
+
   gBS->RestoreTPL (OriginalTPL);
 
   return EFI_SUCCESS;
@@ -30,6 +30,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/EdidDiscovered.h>
 #include <Protocol/DevicePath.h>
 #include <Protocol/LegacyRegion2.h>
+#include <Protocol/Cpu.h>
 
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
@@ -109,6 +110,7 @@ typedef struct {
   UINT8                                       *LineBuffer;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL               *VbeFrameBuffer;
   UINT8                                       *VgaFrameBuffer;
+  EFI_PHYSICAL_ADDRESS                        FrameBufferWc;            // Linear frame buffer already mapped write-combining
 
   //
   // VESA Bios Extensions related fields
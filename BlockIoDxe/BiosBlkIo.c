@@ -623,6 +623,21 @@ BiosBlockIoDriverBindingStop (
           ChildHandleBuffer[Index]
           );
 
+    DBG ("BiosBlockIo: DL=%02x %ld thunks for %ld KB read, %ld read-ahead hits\n",
+        BiosBlockIoPrivate->Bios.Number,
+        BiosBlockIoPrivate->ReadThunks,
+        RShiftU64 (BiosBlockIoPrivate->ReadBytes, 10),
+        BiosBlockIoPrivate->ReadAheadHits);
+    if (BiosBlockIoPrivate->ReadBytes != 0) {
+      DBG ("BiosBlockIo: DL=%02x %ld thunks per MB\n",
+          BiosBlockIoPrivate->Bios.Number,
+          DivU64x64Remainder (LShiftU64 (BiosBlockIoPrivate->ReadThunks, 20), BiosBlockIoPrivate->ReadBytes, NULL));
+    }
+
+    if (BiosBlockIoPrivate->ReadAheadBuffer != NULL) {
+      FreePool (BiosBlockIoPrivate->ReadAheadBuffer);
+    }
+
     gBS->FreePool (BiosBlockIoPrivate);
   }
 
@@ -58,6 +58,21 @@ extern EFI_COMPONENT_NAME2_PROTOCOL  gBiosBlockIoComponentName2;
 #define BLOCK_IO_BUFFER_PAGE_SIZE (((sizeof (EDD_DEVICE_ADDRESS_PACKET) + sizeof (BIOS_LEGACY_DRIVE) + MAX_EDD11_XFER) / EFI_PAGE_SIZE) + 1 \
         )
 
+//
+// Largest transfer probed for EDD 3.0 drives with 64-bit flat buffers
+//
+#define BIOS_MAX_XFER             0x80000
+
+//
+// Size of the per-drive read-ahead buffer
+//
+#define BIOS_READ_AHEAD_SIZE      0x10000
+
+//
+// Fill pattern used when probing the BIOS transfer limit
+//
+#define BIOS_PROBE_PATTERN        0xa5
+
 //
 // Driver Binding Protocol functions
 //
@@ -416,6 +431,154 @@ GetDriveParameters (
   IN  BIOS_LEGACY_DRIVE   *Drive
   );
 
+/**
+  Read BufferSize bytes from Lba into Buffer with INT 13h.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+typedef
+EFI_STATUS
+(*BIOS_READ_SECTORS) (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  );
+
+/**
+  Read BufferSize bytes from Lba into Buffer through the 64-bit flat address
+  packet, MaxTransferBlocks blocks per INT 13h call.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+Edd30BiosReadSectors (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  );
+
+/**
+  Read BufferSize bytes from Lba into Buffer, bouncing every transfer through
+  the EDD 1.1 buffer under 1 MB.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+Edd11BiosReadSectors (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  );
+
+/**
+  Read BufferSize bytes from Lba into Buffer through the read-ahead window.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  ReadSectors    Routine doing the actual INT 13h transfers.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+BiosReadAhead (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  BIOS_READ_SECTORS     ReadSectors,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  );
+
+/**
+  Fill the shared address packet for a transfer to or from a 64-bit flat
+  buffer.
+
+  @param  AddressPacket  Address packet under 1 MB.
+  @param  Lba            The starting Logical Block Address.
+  @param  NumberOfBlocks Number of blocks to transfer.
+  @param  TransferBuffer Flat address of the data buffer.
+
+**/
+VOID
+Edd30FillAddressPacket (
+  IN  EDD_DEVICE_ADDRESS_PACKET *AddressPacket,
+  IN  EFI_LBA                   Lba,
+  IN  UINTN                     NumberOfBlocks,
+  IN  UINT64                    TransferBuffer
+  );
+
+/**
+  Check whether the BIOS reads NumberOfBlocks blocks in one call.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  NumberOfBlocks Number of blocks to read from LBA 0.
+
+  @retval TRUE   The BIOS handled the transfer.
+  @retval FALSE  The transfer failed or moved the wrong amount of data.
+
+**/
+BOOLEAN
+Edd30ProbeTransfer (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  UINTN                 NumberOfBlocks
+  );
+
+/**
+  Check whether a drive is worth probing for larger transfers.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+
+  @retval TRUE   The drive looks bootable.
+  @retval FALSE  The drive is removable, unreadable or has no boot signature.
+
+**/
+BOOLEAN
+Edd30IsBootDrive (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev
+  );
+
+/**
+  Find the largest read the BIOS handles for an EDD 3.0 drive.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+
+**/
+VOID
+Edd30DetectMaxTransfer (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev
+  );
+
 /**
   Build device path for device.
 
@@ -105,6 +105,7 @@ BiosInitBlockIo (
       //
       BlockIo->ReadBlocks   = Edd30BiosReadBlocks;
       BlockIo->WriteBlocks  = Edd30BiosWriteBlocks;
+      Edd30DetectMaxTransfer (Dev);
     } else {
       //
       // Assume EDD 1.1 - Read and Write functions.
@@ -114,6 +115,7 @@ BiosInitBlockIo (
       //
       BlockIo->ReadBlocks   = Edd11BiosReadBlocks;
       BlockIo->WriteBlocks  = Edd11BiosWriteBlocks;
+      Dev->MaxTransferBlocks = MAX_EDD11_XFER / BlockMedia->BlockSize;
     }
 
     BlockMedia->LogicalPartition  = FALSE;
@@ -394,10 +396,305 @@ GetDriveParameters (
 
   return TRUE;
 }
+
+/**
+  Fill the shared address packet for a transfer to or from a 64-bit flat
+  buffer. Counts that do not fit below EDD_EXTENDED_BLOCK_COUNT go in
+  ExtendedBlockCount, smaller ones are passed as before.
+
+  @param  AddressPacket  Address packet under 1 MB.
+  @param  Lba            The starting Logical Block Address.
+  @param  NumberOfBlocks Number of blocks to transfer.
+  @param  TransferBuffer Flat address of the data buffer.
+
+**/
+VOID
+Edd30FillAddressPacket (
+  IN  EDD_DEVICE_ADDRESS_PACKET *AddressPacket,
+  IN  EFI_LBA                   Lba,
+  IN  UINTN                     NumberOfBlocks,
+  IN  UINT64                    TransferBuffer
+  )
+{
+  AddressPacket->PacketSizeInBytes  = (UINT8) sizeof (EDD_DEVICE_ADDRESS_PACKET);
+  AddressPacket->Zero               = 0;
+  AddressPacket->Zero2              = 0;
+  AddressPacket->SegOffset          = 0xffffffff;
+  AddressPacket->Lba                = (UINT64) Lba;
+  AddressPacket->TransferBuffer     = TransferBuffer;
+  AddressPacket->Zero3              = 0;
+
+  if (NumberOfBlocks >= EDD_EXTENDED_BLOCK_COUNT) {
+    AddressPacket->NumberOfBlocks     = EDD_EXTENDED_BLOCK_COUNT;
+    AddressPacket->ExtendedBlockCount = (UINT32) NumberOfBlocks;
+  } else {
+    AddressPacket->NumberOfBlocks     = (UINT8) NumberOfBlocks;
+    AddressPacket->ExtendedBlockCount = 0;
+  }
+}
+
+/**
+  Check whether the BIOS reads NumberOfBlocks blocks in one call.
+
+  The probe buffer is filled with BIOS_PROBE_PATTERN and has one guard block
+  past the end. The BIOS must overwrite the last requested block and leave the
+  guard block alone. A BIOS that ignores the extended block count moves at most
+  0xff blocks, so it fails the first test.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  NumberOfBlocks Number of blocks to read from LBA 0.
+
+  @retval TRUE   The BIOS handled the transfer.
+  @retval FALSE  The transfer failed or moved the wrong amount of data.
+
+**/
+BOOLEAN
+Edd30ProbeTransfer (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  UINTN                 NumberOfBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IA32_REGISTER_SET     Regs;
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINTN                 Pages;
+  UINTN                 BlockSize;
+  UINTN                 CarryFlag;
+  UINTN                 Index;
+  UINT8                 *Block;
+  BOOLEAN               Accepted;
+
+  BlockSize = BiosBlockIoDev->BlockMedia.BlockSize;
+  Pages     = EFI_SIZE_TO_PAGES ((NumberOfBlocks + 1) * BlockSize);
+
+  //
+  // Keep the buffer below 4 GB, the BIOS may not reach above it
+  //
+  Address   = 0xFFFFFFFF;
+  Status    = gBS->AllocatePages (AllocateMaxAddress, EfiBootServicesData, Pages, &Address);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  SetMem ((VOID *) (UINTN) Address, (NumberOfBlocks + 1) * BlockSize, BIOS_PROBE_PATTERN);
+  Edd30FillAddressPacket (mEddBufferUnder1Mb, 0, NumberOfBlocks, Address);
+
+  ZeroMem (&Regs, sizeof (IA32_REGISTER_SET));
+  Regs.H.AH = 0x42;
+  Regs.H.DL = BiosBlockIoDev->Bios.Number;
+  Regs.X.SI = EFI_OFFSET (mEddBufferUnder1Mb);
+  Regs.E.DS = EFI_SEGMENT (mEddBufferUnder1Mb);
+
+  CarryFlag = LegacyBiosInt86 (BiosBlockIoDev->Legacy8259, BiosBlockIoDev->ThunkContext, 0x13, &Regs);
+
+  Accepted = FALSE;
+  if (CarryFlag == 0) {
+    Block = (UINT8 *) (UINTN) Address + (NumberOfBlocks - 1) * BlockSize;
+    for (Index = 0; Index < BlockSize; Index++) {
+      if (Block[Index] != BIOS_PROBE_PATTERN) {
+        Accepted = TRUE;
+        break;
+      }
+    }
+
+    Block += BlockSize;
+    for (Index = 0; Accepted && Index < BlockSize; Index++) {
+      if (Block[Index] != BIOS_PROBE_PATTERN) {
+        Accepted = FALSE;
+      }
+    }
+  }
+
+  gBS->FreePages (Address, Pages);
+  return Accepted;
+}
+
+/**
+  Check whether a drive is worth probing: a fixed disk whose first block
+  carries the 0xAA55 boot signature, as MBR and GPT disks do.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+
+  @retval TRUE   The drive looks bootable.
+  @retval FALSE  The drive is removable, unreadable or has no boot signature.
+
+**/
+BOOLEAN
+Edd30IsBootDrive (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev
+  )
+{
+  EFI_STATUS            Status;
+  UINTN                 BlockSize;
+  UINT8                 *Block;
+  BOOLEAN               Bootable;
+
+  BlockSize = BiosBlockIoDev->BlockMedia.BlockSize;
+  if (BiosBlockIoDev->BlockMedia.RemovableMedia || BlockSize < 512) {
+    return FALSE;
+  }
+
+  Block = AllocatePool (BlockSize);
+  if (Block == NULL) {
+    return FALSE;
+  }
+
+  Bootable = FALSE;
+  Status = Edd30BiosReadSectors (BiosBlockIoDev, 0, BlockSize, Block);
+  if (!EFI_ERROR (Status)) {
+    Bootable = (BOOLEAN) (Block[510] == 0x55 && Block[511] == 0xaa);
+  }
+
+  FreePool (Block);
+  return Bootable;
+}
+
+/**
+  Find the largest read the BIOS handles for an EDD 3.0 drive.
+
+  Transfers start at MAX_EDD11_XFER bytes per call, as they always did.
+  Larger transfers need the extended block count, which only some BIOSes
+  honour. They are probed from BIOS_MAX_XFER downwards on bootable drives
+  only, and used only once a probe has passed.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+
+**/
+VOID
+Edd30DetectMaxTransfer (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev
+  )
+{
+  UINTN                 BlockSize;
+  UINTN                 XferSize;
+  UINTN                 NumberOfBlocks;
+
+  BlockSize = BiosBlockIoDev->BlockMedia.BlockSize;
+  if (BlockSize == 0) {
+    return;
+  }
+
+  BiosBlockIoDev->MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
+
+  if (!Edd30IsBootDrive (BiosBlockIoDev)) {
+    return;
+  }
+
+  //
+  // Counts up to 0xff could be mistaken for the extended block count marker
+  //
+  for (XferSize = BIOS_MAX_XFER; XferSize / BlockSize > EDD_EXTENDED_BLOCK_COUNT; XferSize >>= 1) {
+    NumberOfBlocks = XferSize / BlockSize;
+    if (NumberOfBlocks - 1 > BiosBlockIoDev->BlockMedia.LastBlock) {
+      continue;
+    }
+
+    if (Edd30ProbeTransfer (BiosBlockIoDev, NumberOfBlocks)) {
+      BiosBlockIoDev->MaxTransferBlocks = NumberOfBlocks;
+      break;
+    }
+  }
+
+  DBG ("Edd30DetectMaxTransfer: DL=%02x MaxTransferBlocks = %ld\n",
+      BiosBlockIoDev->Bios.Number, (UINT64) BiosBlockIoDev->MaxTransferBlocks);
+}
+
 //
 // Block IO Routines
 //
 
+/**
+  Read BufferSize bytes from Lba into Buffer through the read-ahead window.
+
+  Short reads fetch a whole window of adjacent blocks in one INT 13h call and
+  later reads inside the window are copied from memory. Reads at least as
+  large as the window go straight to Buffer.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  ReadSectors    Routine doing the actual INT 13h transfers.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+BiosReadAhead (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  BIOS_READ_SECTORS     ReadSectors,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  EFI_STATUS                Status;
+  EFI_BLOCK_IO_MEDIA        *Media;
+  UINTN                     BlockSize;
+  UINTN                     NumberOfBlocks;
+  UINTN                     WindowBlocks;
+
+  Media           = BiosBlockIoDev->BlockIo.Media;
+  BlockSize       = Media->BlockSize;
+  NumberOfBlocks  = BufferSize / BlockSize;
+
+  if ((BiosBlockIoDev->ReadAheadBlocks != 0) &&
+      (BiosBlockIoDev->ReadAheadMediaId == Media->MediaId) &&
+      (Lba >= BiosBlockIoDev->ReadAheadLba) &&
+      (Lba + NumberOfBlocks <= BiosBlockIoDev->ReadAheadLba + BiosBlockIoDev->ReadAheadBlocks)) {
+    CopyMem (
+      Buffer,
+      BiosBlockIoDev->ReadAheadBuffer + (UINTN) (Lba - BiosBlockIoDev->ReadAheadLba) * BlockSize,
+      BufferSize
+      );
+    BiosBlockIoDev->ReadAheadHits++;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The window is filled by a single INT 13h call and stops at the last block
+  //
+  WindowBlocks = BIOS_READ_AHEAD_SIZE / BlockSize;
+  if (WindowBlocks > BiosBlockIoDev->MaxTransferBlocks) {
+    WindowBlocks = BiosBlockIoDev->MaxTransferBlocks;
+  }
+  if (Media->LastBlock - Lba + 1 < WindowBlocks) {
+    WindowBlocks = (UINTN) (Media->LastBlock - Lba + 1);
+  }
+
+  if (NumberOfBlocks >= WindowBlocks) {
+    return ReadSectors (BiosBlockIoDev, Lba, BufferSize, Buffer);
+  }
+
+  if (BiosBlockIoDev->ReadAheadBuffer == NULL) {
+    BiosBlockIoDev->ReadAheadBuffer = AllocatePool (BIOS_READ_AHEAD_SIZE);
+    if (BiosBlockIoDev->ReadAheadBuffer == NULL) {
+      return ReadSectors (BiosBlockIoDev, Lba, BufferSize, Buffer);
+    }
+  }
+
+  BiosBlockIoDev->ReadAheadBlocks = 0;
+  Status = ReadSectors (BiosBlockIoDev, Lba, WindowBlocks * BlockSize, BiosBlockIoDev->ReadAheadBuffer);
+  if (EFI_ERROR (Status)) {
+    //
+    // A bad block past the request must not fail the request itself
+    //
+    if (Status == EFI_MEDIA_CHANGED) {
+      return Status;
+    }
+    return ReadSectors (BiosBlockIoDev, Lba, BufferSize, Buffer);
+  }
+
+  BiosBlockIoDev->ReadAheadLba      = Lba;
+  BiosBlockIoDev->ReadAheadBlocks   = WindowBlocks;
+  BiosBlockIoDev->ReadAheadMediaId  = Media->MediaId;
+
+  CopyMem (Buffer, BiosBlockIoDev->ReadAheadBuffer, BufferSize);
+  return EFI_SUCCESS;
+}
+
 /**
   Read BufferSize bytes from Lba into Buffer.
 
@@ -429,25 +726,11 @@ Edd30BiosReadBlocks (
 {
   EFI_BLOCK_IO_MEDIA        *Media;
   BIOS_BLOCK_IO_DEV         *BiosBlockIoDev;
-  EDD_DEVICE_ADDRESS_PACKET *AddressPacket;
-  //
-  // I exist only for readability
-  //
-  IA32_REGISTER_SET     Regs;
-  UINT64                    TransferBuffer;
-  UINTN                     NumberOfBlocks;
-  UINTN                     TransferByteSize;
   UINTN                     BlockSize;
-  BIOS_LEGACY_DRIVE         *Bios;
-  UINTN                     CarryFlag;
-  UINTN                     MaxTransferBlocks;
-  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
 
   Media     = This->Media;
   BlockSize = Media->BlockSize;
 
-  ZeroMem (&Regs, sizeof (IA32_REGISTER_SET));
-
   if (MediaId != Media->MediaId) {
     return EFI_MEDIA_CHANGED;
   }
@@ -477,32 +760,65 @@ Edd30BiosReadBlocks (
     return EFI_DEVICE_ERROR;
   }
 
-  AddressPacket     = mEddBufferUnder1Mb;
+  return BiosReadAhead (BiosBlockIoDev, Edd30BiosReadSectors, Lba, BufferSize, Buffer);
+}
 
-  MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
+/**
+  Read BufferSize bytes from Lba into Buffer through the 64-bit flat address
+  packet, MaxTransferBlocks blocks per INT 13h call.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+Edd30BiosReadSectors (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  EFI_BLOCK_IO_MEDIA        *Media;
+  EDD_DEVICE_ADDRESS_PACKET *AddressPacket;
+  //
+  // I exist only for readability
+  //
+  IA32_REGISTER_SET     Regs;
+  UINT64                    TransferBuffer;
+  UINTN                     NumberOfBlocks;
+  UINTN                     TransferByteSize;
+  UINTN                     BlockSize;
+  BIOS_LEGACY_DRIVE         *Bios;
+  UINTN                     CarryFlag;
+  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
+
+  Media     = BiosBlockIoDev->BlockIo.Media;
+  BlockSize = Media->BlockSize;
+
+  ZeroMem (&Regs, sizeof (IA32_REGISTER_SET));
+
+  AddressPacket     = mEddBufferUnder1Mb;
 
   TransferBuffer    = (UINT64)(UINTN) Buffer;
   for (; BufferSize > 0;) {
     NumberOfBlocks  = BufferSize / BlockSize;
-    NumberOfBlocks  = NumberOfBlocks > MaxTransferBlocks ? MaxTransferBlocks : NumberOfBlocks;
-    //
-    // Max transfer MaxTransferBlocks
-    //
-    AddressPacket->PacketSizeInBytes  = (UINT8) sizeof (EDD_DEVICE_ADDRESS_PACKET);
-    AddressPacket->Zero               = 0;
-    AddressPacket->NumberOfBlocks     = (UINT8) NumberOfBlocks;
-    AddressPacket->Zero2              = 0;
-    AddressPacket->SegOffset          = 0xffffffff;
-    AddressPacket->Lba                = (UINT64) Lba;
-    AddressPacket->TransferBuffer     = TransferBuffer;
+    NumberOfBlocks  = NumberOfBlocks > BiosBlockIoDev->MaxTransferBlocks ? BiosBlockIoDev->MaxTransferBlocks : NumberOfBlocks;
+    Edd30FillAddressPacket (AddressPacket, Lba, NumberOfBlocks, TransferBuffer);
 
     Regs.H.AH                         = 0x42;
     Regs.H.DL                         = BiosBlockIoDev->Bios.Number;
     Regs.X.SI                         = EFI_OFFSET (AddressPacket);
     Regs.E.DS                         = EFI_SEGMENT (AddressPacket);
 
-//    CarryFlag = BiosBlockIoDev->LegacyBios->Int86 (BiosBlockIoDev->LegacyBios, 0x13, &Regs);
     CarryFlag = LegacyBiosInt86 (BiosBlockIoDev->Legacy8259, BiosBlockIoDev->ThunkContext, 0x13, &Regs);
+    BiosBlockIoDev->ReadThunks++;
 //    DBG( "Edd30BiosReadBlocks: INT 13 42 DL=%02x : CF=%d AH=%02x\n",
 //        BiosBlockIoDev->Bios.Number, CarryFlag, Regs.H.AH);
 
@@ -524,6 +840,10 @@ Edd30BiosReadBlocks (
             ASSERT (FALSE);
           } */
 
+          //
+          // New media, the probed transfer size no longer applies
+          //
+          BiosBlockIoDev->MaxTransferBlocks = MAX_EDD11_XFER / Media->BlockSize;
           Media->ReadOnly = FALSE;
           gBS->HandleProtocol (BiosBlockIoDev->Handle, &gEfiBlockIoProtocolGuid, (VOID **) &BlockIo);
           gBS->ReinstallProtocolInterface (BiosBlockIoDev->Handle, &gEfiBlockIoProtocolGuid, BlockIo, BlockIo);
@@ -531,6 +851,15 @@ Edd30BiosReadBlocks (
         }
       }
 
+      if (NumberOfBlocks > MAX_EDD11_XFER / BlockSize) {
+        //
+        // The BIOS took the larger count at probe time but refuses it now.
+        // Fall back to the MAX_EDD11_XFER transfers used before probing.
+        //
+        BiosBlockIoDev->MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
+        continue;
+      }
+
       if (Media->RemovableMedia) {
         Media->MediaPresent = FALSE;
       }
@@ -542,6 +871,7 @@ Edd30BiosReadBlocks (
     BufferSize        = BufferSize - TransferByteSize;
     TransferBuffer += TransferByteSize;
     Lba += NumberOfBlocks;
+    BiosBlockIoDev->ReadBytes += TransferByteSize;
   }
 
   return EFI_SUCCESS;
@@ -627,24 +957,24 @@ Edd30BiosWriteBlocks (
     return EFI_DEVICE_ERROR;
   }
 
+  //
+  // Drop the read-ahead window, it may cover the blocks being written
+  //
+  BiosBlockIoDev->ReadAheadBlocks = 0;
+
   AddressPacket     = mEddBufferUnder1Mb;
 
+  //
+  // Only reads are probed for larger transfers, writes keep the
+  // MAX_EDD11_XFER limit.
+  //
   MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
 
   TransferBuffer    = (UINT64)(UINTN) Buffer;
   for (; BufferSize > 0;) {
     NumberOfBlocks  = BufferSize / BlockSize;
     NumberOfBlocks  = NumberOfBlocks > MaxTransferBlocks ? MaxTransferBlocks : NumberOfBlocks;
-    //
-    // Max transfer MaxTransferBlocks
-    //
-    AddressPacket->PacketSizeInBytes  = (UINT8) sizeof (EDD_DEVICE_ADDRESS_PACKET);
-    AddressPacket->Zero               = 0;
-    AddressPacket->NumberOfBlocks     = (UINT8) NumberOfBlocks;
-    AddressPacket->Zero2              = 0;
-    AddressPacket->SegOffset          = 0xffffffff;
-    AddressPacket->Lba                = (UINT64) Lba;
-    AddressPacket->TransferBuffer     = TransferBuffer;
+    Edd30FillAddressPacket (AddressPacket, Lba, NumberOfBlocks, TransferBuffer);
 
     Regs.H.AH                         = 0x43;
     Regs.H.AL                         = 0x00;
@@ -808,25 +1138,11 @@ Edd11BiosReadBlocks (
 {
   EFI_BLOCK_IO_MEDIA        *Media;
   BIOS_BLOCK_IO_DEV         *BiosBlockIoDev;
-  EDD_DEVICE_ADDRESS_PACKET *AddressPacket;
-  //
-  // I exist only for readability
-  //
-  IA32_REGISTER_SET     Regs;
-  UINT64                    TransferBuffer;
-  UINTN                     NumberOfBlocks;
-  UINTN                     TransferByteSize;
   UINTN                     BlockSize;
-  BIOS_LEGACY_DRIVE         *Bios;
-  UINTN                     CarryFlag;
-  UINTN                     MaxTransferBlocks;
-  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
 
   Media     = This->Media;
   BlockSize = Media->BlockSize;
 
-  ZeroMem (&Regs, sizeof (IA32_REGISTER_SET));
-
   if (MediaId != Media->MediaId) {
     return EFI_MEDIA_CHANGED;
   }
@@ -856,6 +1172,51 @@ Edd11BiosReadBlocks (
     return EFI_DEVICE_ERROR;
   }
 
+  return BiosReadAhead (BiosBlockIoDev, Edd11BiosReadSectors, Lba, BufferSize, Buffer);
+}
+
+/**
+  Read BufferSize bytes from Lba into Buffer, bouncing every transfer through
+  the EDD 1.1 buffer under 1 MB.
+
+  @param  BiosBlockIoDev Instance of block I/O device.
+  @param  Lba            The starting Logical Block Address to read from.
+  @param  BufferSize     Size of Buffer, a multiple of the device block size.
+  @param  Buffer         A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS           The data was read correctly from the device.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the read.
+  @retval EFI_MEDIA_CHANGED     The media was replaced.
+
+**/
+EFI_STATUS
+Edd11BiosReadSectors (
+  IN  BIOS_BLOCK_IO_DEV     *BiosBlockIoDev,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  EFI_BLOCK_IO_MEDIA        *Media;
+  EDD_DEVICE_ADDRESS_PACKET *AddressPacket;
+  //
+  // I exist only for readability
+  //
+  IA32_REGISTER_SET     Regs;
+  UINT64                    TransferBuffer;
+  UINTN                     NumberOfBlocks;
+  UINTN                     TransferByteSize;
+  UINTN                     BlockSize;
+  BIOS_LEGACY_DRIVE         *Bios;
+  UINTN                     CarryFlag;
+  UINTN                     MaxTransferBlocks;
+  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
+
+  Media     = BiosBlockIoDev->BlockIo.Media;
+  BlockSize = Media->BlockSize;
+
+  ZeroMem (&Regs, sizeof (IA32_REGISTER_SET));
+
   AddressPacket     = mEddBufferUnder1Mb;
 
   MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
@@ -887,6 +1248,7 @@ Edd11BiosReadBlocks (
 
  //   CarryFlag = BiosBlockIoDev->LegacyBios->Int86 (BiosBlockIoDev->LegacyBios, 0x13, &Regs);
     CarryFlag = LegacyBiosInt86 (BiosBlockIoDev->Legacy8259, BiosBlockIoDev->ThunkContext, 0x13, &Regs);
+    BiosBlockIoDev->ReadThunks++;
  //   DBG("Edd11BiosReadBlocks: INT 13 42 DL=%02x : CF=%d AH=%02x : LBA 0x%lx  Block(s) %0d \n",
  //     BiosBlockIoDev->Bios.Number, CarryFlag, Regs.H.AH, Lba, NumberOfBlocks);
     Media->MediaPresent = TRUE;
@@ -926,6 +1288,7 @@ Edd11BiosReadBlocks (
     BufferSize  = BufferSize - TransferByteSize;
     Buffer      = (VOID *) ((UINT8 *) Buffer + TransferByteSize);
     Lba += NumberOfBlocks;
+    BiosBlockIoDev->ReadBytes += TransferByteSize;
   }
 
   return EFI_SUCCESS;
@@ -1011,6 +1374,11 @@ Edd11BiosWriteBlocks (
     return EFI_DEVICE_ERROR;
   }
 
+  //
+  // Drop the read-ahead window, it may cover the blocks being written
+  //
+  BiosBlockIoDev->ReadAheadBlocks = 0;
+
   AddressPacket     = mEddBufferUnder1Mb;
 
   MaxTransferBlocks = MAX_EDD11_XFER / BlockSize;
@@ -137,6 +137,12 @@ typedef struct {
 
 #define EDD_VERSION_30  0x30
 
+//
+// NumberOfBlocks value telling an EDD 3.0 BIOS to take the block count from
+// ExtendedBlockCount instead.  Without it a packet moves at most 0x7f blocks.
+//
+#define EDD_EXTENDED_BLOCK_COUNT    0xff
+
 //
 // Int 13 BIOS Errors
 //
@@ -202,7 +208,26 @@ typedef struct {
   EFI_LEGACY_8259_PROTOCOL  *Legacy8259;
   BIOS_LEGACY_DRIVE         Bios;
   THUNK_CONTEXT             *ThunkContext;
-  
+
+  //
+  // Largest transfer the BIOS handles for this drive in one INT 13h call
+  //
+  UINTN                     MaxTransferBlocks;
+
+  //
+  // Read-ahead window of adjacent blocks kept after a short read
+  //
+  UINT8                     *ReadAheadBuffer;
+  EFI_LBA                   ReadAheadLba;
+  UINTN                     ReadAheadBlocks;
+  UINT32                    ReadAheadMediaId;
+
+  //
+  // Read statistics
+  //
+  UINT64                    ReadThunks;
+  UINT64                    ReadBytes;
+  UINT64                    ReadAheadHits;
 } BIOS_BLOCK_IO_DEV;
 
 #define BIOS_BLOCK_IO_FROM_THIS(a)  CR (a, BIOS_BLOCK_IO_DEV, BlockIo, BIOS_CONSOLE_BLOCK_IO_DEV_SIGNATURE)
@@ -71,6 +71,13 @@ typedef struct _USB2_HC_DEV  USB2_HC_DEV;
 #define EHC_SYNC_POLL_INTERVAL       (1 * EHC_1_MILLISECOND)
 #define EHC_ASYNC_POLL_INTERVAL      (50 * 10000U)
 
+//
+// Polling interval while waiting for the async advance doorbell. The
+// controller answers within a few microframes, so poll much finer than
+// EHC_SYNC_POLL_INTERVAL which would add a millisecond to every transfer.
+//
+#define EHC_DOORBELL_POLL_INTERVAL   (10 * EHC_1_MICROSECOND)
+
 //
 // EHCI debug port control status register bit definition
 //
@@ -311,10 +311,20 @@ EhcSetAndWaitDoorBell (
 {
   EFI_STATUS              Status;
   UINT32                  Data;
+  UINT32                  Index;
 
   EhcSetOpRegBit (Ehc, EHC_USBCMD_OFFSET, USBCMD_IAAD);
 
-  Status = EhcWaitOpRegBit (Ehc, EHC_USBSTS_OFFSET, USBSTS_IAA, TRUE, Timeout);
+  Status = EFI_TIMEOUT;
+
+  for (Index = 0; Index < Timeout / EHC_DOORBELL_POLL_INTERVAL + 1; Index++) {
+    if (EHC_REG_BIT_IS_SET (Ehc, EHC_USBSTS_OFFSET, USBSTS_IAA)) {
+      Status = EFI_SUCCESS;
+      break;
+    }
+
+    gBS->Stall (EHC_DOORBELL_POLL_INTERVAL);
+  }
 
   //
   // ACK the IAA bit in USBSTS register. Make sure other
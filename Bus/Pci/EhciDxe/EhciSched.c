@@ -573,8 +573,18 @@ EhcCheckUrbResult (
 
   ASSERT ((Ehc != NULL) && (Urb != NULL) && (Urb->Qh != NULL));
 
+  //
+  // QTDs retire in order, so resume the scan at the first QTD that
+  // wasn't retired by the previous check instead of walking the whole
+  // chain again. NextQtd is reset when the QTDs are rearmed.
+  //
+  if (Urb->NextQtd == NULL) {
+    Urb->NextQtd    = Urb->Qh->Qtds.ForwardLink;
+    Urb->RetiredLen = 0;
+  }
+
   Finished        = TRUE;
-  Urb->Completed  = 0;
+  Urb->Completed  = Urb->RetiredLen;
 
   Urb->Result     = EFI_USB_NOERROR;
 
@@ -583,7 +593,7 @@ EhcCheckUrbResult (
     goto ON_EXIT;
   }
 
-  EFI_LIST_FOR_EACH (Entry, &Urb->Qh->Qtds) {
+  for (Entry = Urb->NextQtd; Entry != &Urb->Qh->Qtds; Entry = Entry->ForwardLink) {
     Qtd   = EFI_LIST_CONTAINER (Entry, EHC_QTD, QtdList);
     QtdHw = &Qtd->QtdHw;
     State = (UINT8) QtdHw->Status;
@@ -643,12 +653,18 @@ EhcCheckUrbResult (
         if (QtdHw->AltNext == QTD_LINK (PciAddr, FALSE)) {
           DEBUG ((EFI_D_VERBOSE, "EhcCheckUrbResult: Short packet read, break\n"));
 
+          //
+          // Leave NextQtd on this QTD, so checking again gives the same result.
+          //
           Finished = TRUE;
           goto ON_EXIT;
         }
 
         DEBUG ((EFI_D_VERBOSE, "EhcCheckUrbResult: Short packet read, continue\n"));
       }
+
+      Urb->NextQtd    = Entry->ForwardLink;
+      Urb->RetiredLen = Urb->Completed;
     }
   }
 
@@ -947,6 +963,11 @@ EhcUpdateAsyncRequest (
 
     PciAddr = UsbHcGetPciAddressForHostMem (Ehc->MemPool, FirstQtd, sizeof (EHC_QTD));
     QhHw->NextQtd = QTD_LINK (PciAddr, FALSE);
+
+    //
+    // The QTDs are active again, the next check starts from the first one.
+    //
+    Urb->NextQtd  = NULL;
   }
 
   return ;
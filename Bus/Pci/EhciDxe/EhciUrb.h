@@ -227,6 +227,8 @@ struct _URB {
   // Schedule data
   //
   EHC_QH                          *Qh;
+  LIST_ENTRY                      *NextQtd;     // first QTD not seen retired, NULL to rescan
+  UINTN                           RetiredLen;   // data length of the QTDs before NextQtd
 
   //
   // Transaction result
@@ -66,6 +66,14 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 //
 #define XHC_POLL_DELAY               (1000)
 //
+// XHC back-off bounds while waiting for a transfer to complete.
+// The interval between two polls doubles from 1us up to a ceiling derived
+// from the expected transfer time, clamped to this range.
+// The unit is microsecond.
+//
+#define XHC_POLL_MIN_INTERVAL        (16)
+#define XHC_POLL_MAX_INTERVAL        (128)
+//
 // XHC async transfer timer interval, set by experience.
 // The unit is 100us, takes 50ms as interval.
 //
@@ -142,6 +150,18 @@ typedef struct {
 } EFI_USB_HUB_DESCRIPTOR;
 #pragma pack()
 
+//
+// Counters of the synchronous transfers done on one endpoint.
+// Time is the time spent waiting for completion, in microsecond.
+//
+typedef struct {
+  UINT32                    Transfers;
+  UINT32                    Errors;
+  UINT64                    Bytes;
+  UINT64                    Time;
+  UINT32                    MaxTime;
+} XHC_EP_STATS;
+
 struct _USB_DEV_CONTEXT {
   //
   // Whether this entry in UsbDevContext array is used or not.
@@ -204,6 +224,10 @@ struct _USB_DEV_CONTEXT {
   // Every interface has an active AlternateSetting.
   //
   UINT8                     *ActiveAlternateSetting;
+  //
+  // Transfer counters for every endpoint, indexed by Dci - 1.
+  //
+  XHC_EP_STATS              EpStats[31];
 };
 
 struct _USB_XHCI_INSTANCE {
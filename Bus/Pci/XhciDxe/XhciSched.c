@@ -1193,9 +1193,128 @@ EXIT:
 }
 
 
+/**
+  Check whether the controller has posted events that are not handled yet.
+
+  This only reads the event ring in memory, no register is touched.
+
+  @param  EvtRing           The event ring to check.
+
+  @retval TRUE              There are new events on the ring.
+  @retval FALSE             The ring holds no new event.
+
+**/
+BOOLEAN
+XhcEventPending (
+  IN  EVENT_RING          *EvtRing
+  )
+{
+  volatile TRB_TEMPLATE   *EvtTrb;
+
+  //
+  // Events left over by the previous check, whose walk stopped early.
+  //
+  if (EvtRing->EventRingDequeue != EvtRing->EventRingEnqueue) {
+    return TRUE;
+  }
+
+  EvtTrb = EvtRing->EventRingDequeue;
+  return (BOOLEAN) (EvtTrb->CycleBit == EvtRing->EventRingCCS);
+}
+
+/**
+  Get the longest interval between two polls of the URB.
+
+  The interval is an eighth of the time the data needs on the wire at the
+  device speed, clamped to [XHC_POLL_MIN_INTERVAL, XHC_POLL_MAX_INTERVAL].
+
+  @param  Urb               The URB to execute.
+
+  @return The interval in microsecond.
+
+**/
+UINTN
+XhcPollInterval (
+  IN  URB                 *Urb
+  )
+{
+  UINTN                   Expected;
+  UINTN                   Interval;
+
+  //
+  // Rough payload rate of each speed, in bytes per microsecond.
+  //
+  switch (Urb->Ep.DevSpeed) {
+  case EFI_USB_SPEED_SUPER:
+    Expected = Urb->DataLen / 400;
+    break;
+
+  case EFI_USB_SPEED_HIGH:
+    Expected = Urb->DataLen / 40;
+    break;
+
+  case EFI_USB_SPEED_FULL:
+    Expected = Urb->DataLen;
+    break;
+
+  default:
+    Expected = Urb->DataLen * 8;
+    break;
+  }
+
+  Interval = Expected / 8;
+  if (Interval < XHC_POLL_MIN_INTERVAL) {
+    Interval = XHC_POLL_MIN_INTERVAL;
+  } else if (Interval > XHC_POLL_MAX_INTERVAL) {
+    Interval = XHC_POLL_MAX_INTERVAL;
+  }
+
+  return Interval;
+}
+
+/**
+  Report the transfer counters of every used endpoint of the slot.
+
+  @param  Xhc               The XHCI Instance.
+  @param  SlotId            The slot id of the device.
+
+**/
+VOID
+XhcDumpEndpointStats (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  UINT8               SlotId
+  )
+{
+  XHC_EP_STATS            *Stats;
+  UINTN                   Index;
+
+  for (Index = 0; Index < 31; Index++) {
+    Stats = &Xhc->UsbDevContext[SlotId].EpStats[Index];
+    if (Stats->Transfers == 0) {
+      continue;
+    }
+
+    DEBUG ((
+      EFI_D_INFO,
+      "XhcDumpEndpointStats: Slot %d Dci %d: %d transfers, %d errors, %ld bytes in %ld us (max %d us), %ld KB/s\n",
+      SlotId,
+      (UINT32) (Index + 1),
+      Stats->Transfers,
+      Stats->Errors,
+      Stats->Bytes,
+      Stats->Time,
+      Stats->MaxTime,
+      (Stats->Time == 0) ? 0 : DivU64x64Remainder (MultU64x32 (Stats->Bytes, 1000), Stats->Time, NULL) / 1024
+      ));
+  }
+}
+
 /**
   Execute the transfer by polling the URB. This is a synchronous operation.
 
+  The event ring is walked only when the controller has posted events, in
+  between the wait backs off exponentially up to XhcPollInterval ().
+
   @param  Xhc               The XHCI Instance.
   @param  CmdTransfer       The executed URB is for cmd transfer or not.
   @param  Urb               The URB to execute.
@@ -1215,10 +1334,12 @@ XhcExecTransfer (
   )
 {
   EFI_STATUS              Status;
-  UINTN                   Index;
-  UINTN                   Loop;
+  UINTN                   Elapsed;
+  UINTN                   Interval;
+  UINTN                   MaxInterval;
   UINT8                   SlotId;
   UINT8                   Dci;
+  XHC_EP_STATS            *Stats;
 
   if (CmdTransfer) {
     SlotId = 0;
@@ -1232,24 +1353,52 @@ XhcExecTransfer (
     ASSERT (Dci < 32);
   }
 
-  Status = EFI_SUCCESS;
-  Loop   = Timeout * XHC_1_MILLISECOND;
-  if (Timeout == 0) {
-    Loop = 0xFFFFFFFF;
-  }
+  Status      = EFI_SUCCESS;
+  Elapsed     = 0;
+  Interval    = XHC_1_MICROSECOND;
+  MaxInterval = XhcPollInterval (Urb);
 
   XhcRingDoorBell (Xhc, SlotId, Dci);
 
-  for (Index = 0; Index < Loop; Index++) {
-    Status = XhcCheckUrbResult (Xhc, Urb);
-    if (Urb->Finished) {
+  while (TRUE) {
+    //
+    // Handle the events in one batch once some are posted. Also check
+    // at every longest interval, to notice a halted controller.
+    //
+    if ((Interval >= MaxInterval) || XhcEventPending (&Xhc->EventRing)) {
+      Status = XhcCheckUrbResult (Xhc, Urb);
+      if (Urb->Finished) {
+        break;
+      }
+    }
+
+    if ((Timeout != 0) && (Elapsed >= Timeout * XHC_1_MILLISECOND)) {
+      Status = XhcCheckUrbResult (Xhc, Urb);
+      if (!Urb->Finished) {
+        Urb->Result = EFI_USB_ERR_TIMEOUT;
+      }
       break;
     }
-    gBS->Stall (XHC_1_MICROSECOND);
+
+    gBS->Stall (Interval);
+    Elapsed += Interval;
+
+    if (Interval < MaxInterval) {
+      Interval = MIN (Interval * 2, MaxInterval);
+    }
   }
 
-  if (Index == Loop) {
-    Urb->Result = EFI_USB_ERR_TIMEOUT;
+  if (!CmdTransfer) {
+    Stats = &Xhc->UsbDevContext[SlotId].EpStats[Dci - 1];
+    Stats->Transfers++;
+    Stats->Bytes += Urb->Completed;
+    Stats->Time  += Elapsed;
+    if (Elapsed > Stats->MaxTime) {
+      Stats->MaxTime = (UINT32) Elapsed;
+    }
+    if (Urb->Result != EFI_USB_NOERROR) {
+      Stats->Errors++;
+    }
   }
 
   return Status;
@@ -2367,6 +2516,8 @@ XhcDisableSlotCmd (
   //
   Xhc->DCBAA[SlotId] = 0;
 
+  XhcDumpEndpointStats (Xhc, SlotId);
+
   //
   // Free the slot related data structure
   //
@@ -2474,6 +2625,8 @@ XhcDisableSlotCmd64 (
   //
   Xhc->DCBAA[SlotId] = 0;
 
+  XhcDumpEndpointStats (Xhc, SlotId);
+
   //
   // Free the slot related data structure
   //
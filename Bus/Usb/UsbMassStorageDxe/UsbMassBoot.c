@@ -386,6 +386,67 @@ UsbBootInquiry (
   return Status;
 }
 
+/**
+  Read the Block Limits VPD page to learn the largest transfer the device takes.
+
+  Only devices that claim SPC-3 or later are asked, many older flash disks
+  stall or hang on EVPD requests. The result is kept in MaxTransferBlocks,
+  which stays zero if the page is missing or reports no limit.
+
+  @param  UsbMass                The device to inquire.
+
+  @retval EFI_SUCCESS            The page was read.
+  @retval EFI_UNSUPPORTED        The device is too old to have the page.
+  @retval Others                 The INQUIRY command failed.
+
+**/
+EFI_STATUS
+UsbBootGetBlockLimits (
+  IN USB_MASS_DEVICE            *UsbMass
+  )
+{
+  USB_BOOT_INQUIRY_CMD           InquiryCmd;
+  USB_BOOT_BLOCK_LIMITS_VPD_DATA LimitsData;
+  EFI_STATUS                     Status;
+
+  UsbMass->MaxTransferBlocks = 0;
+
+  if (UsbMass->InquiryData.Version < USB_BOOT_VERSION_SPC3) {
+    return EFI_UNSUPPORTED;
+  }
+
+  ZeroMem (&InquiryCmd, sizeof (USB_BOOT_INQUIRY_CMD));
+  ZeroMem (&LimitsData, sizeof (USB_BOOT_BLOCK_LIMITS_VPD_DATA));
+
+  InquiryCmd.OpCode   = USB_BOOT_INQUIRY_OPCODE;
+  InquiryCmd.Lun      = (UINT8) (USB_BOOT_LUN (UsbMass->Lun) | USB_BOOT_INQUIRY_EVPD);
+  InquiryCmd.PageCode = USB_BOOT_VPD_BLOCK_LIMITS;
+  InquiryCmd.AllocLen = (UINT8) sizeof (USB_BOOT_BLOCK_LIMITS_VPD_DATA);
+
+  //
+  // No retries, an unsupported page is an expected answer.
+  //
+  Status = UsbBootExecCmd (
+             UsbMass,
+             &InquiryCmd,
+             (UINT8) sizeof (USB_BOOT_INQUIRY_CMD),
+             EfiUsbDataIn,
+             &LimitsData,
+             sizeof (USB_BOOT_BLOCK_LIMITS_VPD_DATA),
+             USB_BOOT_GENERAL_CMD_TIMEOUT
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (LimitsData.PageCode == USB_BOOT_VPD_BLOCK_LIMITS) {
+    UsbMass->MaxTransferBlocks = SwapBytes32 (ReadUnaligned32 ((CONST UINT32 *) LimitsData.MaxTransferLen));
+  }
+
+  DEBUG ((EFI_D_INFO, "UsbBootGetBlockLimits: max transfer 0x%x blocks\n", UsbMass->MaxTransferBlocks));
+  return Status;
+}
+
 /**
   Execute READ CAPACITY 16 bytes command to request information regarding
   the capacity of the installed medium of the device.
@@ -653,6 +714,8 @@ UsbBootGetParams (
     // Default value 2048 Bytes, in case no media present at first time
     //
     Media->BlockSize        = 0x0800;
+  } else {
+    UsbBootGetBlockLimits (UsbMass);
   }
 
   Status = UsbBootDetectMedia (UsbMass);
@@ -765,6 +828,78 @@ ON_ERROR:
 }
 
 
+/**
+  Get the number of blocks the next READ/WRITE command should carry.
+
+  @param  UsbMass                The USB mass storage device.
+  @param  TotalBlock             Number of blocks still to transfer, not zero.
+  @param  CmdLimit               The largest count the command block can hold.
+
+  @return The number of blocks, at least one.
+
+**/
+UINT32
+UsbBootIoBlocks (
+  IN  USB_MASS_DEVICE       *UsbMass,
+  IN  UINTN                 TotalBlock,
+  IN  UINT32                CmdLimit
+  )
+{
+  UINT32                    Count;
+
+  Count = UsbMass->MaxTransferBytes / UsbMass->BlockIoMedia.BlockSize;
+  if ((UsbMass->MaxTransferBlocks != 0) && (Count > UsbMass->MaxTransferBlocks)) {
+    Count = UsbMass->MaxTransferBlocks;
+  }
+  if (Count > CmdLimit) {
+    Count = CmdLimit;
+  }
+  if (Count > TotalBlock) {
+    Count = (UINT32) TotalBlock;
+  }
+
+  return (Count == 0) ? 1 : Count;
+}
+
+
+/**
+  Lower the transfer size after a large READ/WRITE command failed.
+
+  Some bridges accept large commands and then choke on the data phase.
+  Halve the cap, reset the transport and let the caller resend the piece,
+  until USB_BOOT_MIN_IO_BYTES is reached.
+
+  @param  UsbMass                The USB mass storage device.
+  @param  ByteSize               The size of the command that failed.
+  @param  Status                 Why the command failed.
+
+  @retval TRUE                   The cap is lowered, resend the command.
+  @retval FALSE                  The failure is not about the transfer size.
+
+**/
+BOOLEAN
+UsbBootShrinkTransfer (
+  IN  USB_MASS_DEVICE       *UsbMass,
+  IN  UINT32                ByteSize,
+  IN  EFI_STATUS            Status
+  )
+{
+  if ((ByteSize <= USB_BOOT_MIN_IO_BYTES) ||
+      (Status == EFI_MEDIA_CHANGED) ||
+      (Status == EFI_NO_MEDIA) ||
+      (Status == EFI_WRITE_PROTECTED)) {
+    return FALSE;
+  }
+
+  UsbMass->MaxTransferBytes = MAX (ByteSize / 2, USB_BOOT_MIN_IO_BYTES);
+  DEBUG ((EFI_D_ERROR, "UsbBootShrinkTransfer: %r at 0x%x bytes, retry with 0x%x\n",
+    Status, ByteSize, UsbMass->MaxTransferBytes));
+
+  UsbMass->Transport->Reset (UsbMass->Context, TRUE);
+  return TRUE;
+}
+
+
 /**
   Read some blocks from the device.
 
@@ -787,7 +922,7 @@ UsbBootReadBlocks (
 {
   USB_BOOT_READ10_CMD       ReadCmd;
   EFI_STATUS                Status;
-  UINT16                    Count;
+  UINT32                    Count;
   UINT32                    BlockSize;
   UINT32                    ByteSize;
   UINT32                    Timeout;
@@ -797,17 +932,17 @@ UsbBootReadBlocks (
 
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces to ease the pressure
-    // on the device. We must split the total block because the READ10
-    // command only has 16 bit transfer length (in the unit of block).
+    // Split the total blocks into pieces the device takes in one command.
+    // The READ10 command only has 16 bit transfer length (in the unit of block).
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
+    Count     = UsbBootIoBlocks (UsbMass, TotalBlock, 0xFFFF);
+    ByteSize  = Count * BlockSize;
 
     //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+    // USB command's upper limit timeout is 5s [USB2.0-9.2.6.1], plus
+    // the time to move the data.
     //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+    Timeout = (UINT32) USB_BOOT_IO_TIMEOUT (ByteSize);
 
     //
     // Fill in the command then execute
@@ -817,7 +952,7 @@ UsbBootReadBlocks (
     ReadCmd.OpCode  = USB_BOOT_READ10_OPCODE;
     ReadCmd.Lun     = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
     WriteUnaligned32 ((UINT32 *) ReadCmd.Lba, SwapBytes32 (Lba));
-    WriteUnaligned16 ((UINT16 *) ReadCmd.TransferLen, SwapBytes16 (Count));
+    WriteUnaligned16 ((UINT16 *) ReadCmd.TransferLen, SwapBytes16 ((UINT16) Count));
 
     Status = UsbBootExecCmdWithRetry (
                UsbMass,
@@ -829,6 +964,9 @@ UsbBootReadBlocks (
                Timeout
                );
     if (EFI_ERROR (Status)) {
+      if (UsbBootShrinkTransfer (UsbMass, ByteSize, Status)) {
+        continue;
+      }
       return Status;
     }
     DEBUG ((EFI_D_BLKIO, "UsbBootReadBlocks: LBA (0x%x), Blk (0x%x)\n", Lba, Count));
@@ -863,7 +1001,7 @@ UsbBootWriteBlocks (
 {
   USB_BOOT_WRITE10_CMD  WriteCmd;
   EFI_STATUS            Status;
-  UINT16                Count;
+  UINT32                Count;
   UINT32                BlockSize;
   UINT32                ByteSize;
   UINT32                Timeout;
@@ -873,17 +1011,17 @@ UsbBootWriteBlocks (
 
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces to ease the pressure
-    // on the device. We must split the total block because the WRITE10
-    // command only has 16 bit transfer length (in the unit of block).
+    // Split the total blocks into pieces the device takes in one command.
+    // The WRITE10 command only has 16 bit transfer length (in the unit of block).
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
+    Count     = UsbBootIoBlocks (UsbMass, TotalBlock, 0xFFFF);
+    ByteSize  = Count * BlockSize;
 
     //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+    // USB command's upper limit timeout is 5s [USB2.0-9.2.6.1], plus
+    // the time to move the data.
     //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+    Timeout = (UINT32) USB_BOOT_IO_TIMEOUT (ByteSize);
 
     //
     // Fill in the write10 command block
@@ -893,7 +1031,7 @@ UsbBootWriteBlocks (
     WriteCmd.OpCode = USB_BOOT_WRITE10_OPCODE;
     WriteCmd.Lun    = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
     WriteUnaligned32 ((UINT32 *) WriteCmd.Lba, SwapBytes32 (Lba));
-    WriteUnaligned16 ((UINT16 *) WriteCmd.TransferLen, SwapBytes16 (Count));
+    WriteUnaligned16 ((UINT16 *) WriteCmd.TransferLen, SwapBytes16 ((UINT16) Count));
 
     Status = UsbBootExecCmdWithRetry (
                UsbMass,
@@ -905,6 +1043,9 @@ UsbBootWriteBlocks (
                Timeout
                );
     if (EFI_ERROR (Status)) {
+      if (UsbBootShrinkTransfer (UsbMass, ByteSize, Status)) {
+        continue;
+      }
       return Status;
     }
     DEBUG ((EFI_D_BLKIO, "UsbBootWriteBlocks: LBA (0x%x), Blk (0x%x)\n", Lba, Count));
@@ -939,7 +1080,7 @@ UsbBootReadBlocks16 (
 {
   UINT8                     ReadCmd[16];
   EFI_STATUS                Status;
-  UINT16                    Count;
+  UINT32                    Count;
   UINT32                    BlockSize;
   UINT32                    ByteSize;
   UINT32                    Timeout;
@@ -949,15 +1090,16 @@ UsbBootReadBlocks16 (
 
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces.
+    // Split the total blocks into pieces the device takes in one command.
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
+    Count     = UsbBootIoBlocks (UsbMass, TotalBlock, 0xFFFFFFFF);
+    ByteSize  = Count * BlockSize;
 
     //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+    // USB command's upper limit timeout is 5s [USB2.0-9.2.6.1], plus
+    // the time to move the data.
     //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+    Timeout = (UINT32) USB_BOOT_IO_TIMEOUT (ByteSize);
 
     //
     // Fill in the command then execute
@@ -979,6 +1121,9 @@ UsbBootReadBlocks16 (
                Timeout
                );
     if (EFI_ERROR (Status)) {
+      if (UsbBootShrinkTransfer (UsbMass, ByteSize, Status)) {
+        continue;
+      }
       return Status;
     }
     DEBUG ((EFI_D_BLKIO, "UsbBootReadBlocks16: LBA (0x%lx), Blk (0x%x)\n", Lba, Count));
@@ -1013,7 +1158,7 @@ UsbBootWriteBlocks16 (
 {
   UINT8                 WriteCmd[16];
   EFI_STATUS            Status;
-  UINT16                Count;
+  UINT32                Count;
   UINT32                BlockSize;
   UINT32                ByteSize;
   UINT32                Timeout;
@@ -1023,15 +1168,16 @@ UsbBootWriteBlocks16 (
 
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces.
+    // Split the total blocks into pieces the device takes in one command.
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
+    Count     = UsbBootIoBlocks (UsbMass, TotalBlock, 0xFFFFFFFF);
+    ByteSize  = Count * BlockSize;
 
     //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+    // USB command's upper limit timeout is 5s [USB2.0-9.2.6.1], plus
+    // the time to move the data.
     //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+    Timeout = (UINT32) USB_BOOT_IO_TIMEOUT (ByteSize);
 
     //
     // Fill in the write16 command block
@@ -1053,6 +1199,9 @@ UsbBootWriteBlocks16 (
                Timeout
                );
     if (EFI_ERROR (Status)) {
+      if (UsbBootShrinkTransfer (UsbMass, ByteSize, Status)) {
+        continue;
+      }
       return Status;
     }
     DEBUG ((EFI_D_BLKIO, "UsbBootWriteBlocks: LBA (0x%lx), Blk (0x%x)\n", Lba, Count));
@@ -64,9 +64,21 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define USB_PDT_SIMPLE_DIRECT           0x0E       ///< Simplified direct access device
 
 //
-// Other parameters, Max carried size is 512B * 128 = 64KB
+// Other parameters. A single READ/WRITE command carries at most
+// USB_BOOT_MAX_IO_BYTES; the Block Limits VPD page may lower that. When a
+// large command fails the cap is halved, down to the 512B * 128 = 64KB that
+// every device copes with.
 //
 #define USB_BOOT_IO_BLOCKS              128
+#define USB_BOOT_MIN_IO_BYTES           (512 * USB_BOOT_IO_BLOCKS)
+#define USB_BOOT_MAX_IO_BYTES           SIZE_1MB
+
+//
+// Vital product data pages, and the SPC version that introduced the Block Limits page.
+//
+#define USB_BOOT_INQUIRY_EVPD           BIT0
+#define USB_BOOT_VPD_BLOCK_LIMITS       0xB0
+#define USB_BOOT_VERSION_SPC3           0x05
 
 //
 // Retry mass command times, set by experience
@@ -87,6 +99,13 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 // 
 #define USB_BOOT_GENERAL_CMD_TIMEOUT    (5 * USB_MASS_1_SECOND)
 
+//
+// READ/WRITE commands get one more second for every 64KB they carry,
+// so a full sized command on a full speed link still fits.
+//
+#define USB_BOOT_IO_TIMEOUT(ByteSize)   (USB_BOOT_GENERAL_CMD_TIMEOUT + \
+                                         ((ByteSize) / USB_BOOT_MIN_IO_BYTES) * USB_MASS_1_SECOND)
+
 //
 // The required commands are INQUIRY, READ CAPACITY, TEST UNIT READY,
 // READ10, WRITE10, and REQUEST SENSE. The BLOCK_IO protocol uses LBA
@@ -96,8 +115,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #pragma pack(1)
 typedef struct {
   UINT8             OpCode;
-  UINT8             Lun;            ///< Lun (high 3 bits)
-  UINT8             Reserved0[2];
+  UINT8             Lun;            ///< Lun (high 3 bits), EVPD (bit 0)
+  UINT8             PageCode;       ///< VPD page, only with EVPD set
+  UINT8             Reserved0;
   UINT8             AllocLen;
   UINT8             Reserved1;
   UINT8             Pad[6];
@@ -106,7 +126,8 @@ typedef struct {
 typedef struct {
   UINT8             Pdt;            ///< Peripheral Device Type (low 5 bits)
   UINT8             Removable;      ///< Removable Media (highest bit)
-  UINT8             Reserved0[2];
+  UINT8             Version;        ///< SPC version the device claims
+  UINT8             Reserved0;
   UINT8             AddLen;         ///< Additional length
   UINT8             Reserved1[3];
   UINT8             VendorID[8];
@@ -114,6 +135,15 @@ typedef struct {
   UINT8             ProductRevision[4];
 } USB_BOOT_INQUIRY_DATA;
 
+typedef struct {
+  UINT8             Pdt;
+  UINT8             PageCode;       ///< USB_BOOT_VPD_BLOCK_LIMITS
+  UINT8             PageLen[2];
+  UINT8             Reserved0[4];
+  UINT8             MaxTransferLen[4]; ///< In blocks, zero if not reported
+  UINT8             OptTransferLen[4];
+} USB_BOOT_BLOCK_LIMITS_VPD_DATA;
+
 typedef struct {
   UINT8             OpCode;
   UINT8             Lun;
@@ -317,7 +317,54 @@ Returns:
 
 --*/
 {
-  return EFI_UNSUPPORTED;
+  MTRR_MEMORY_CACHE_TYPE  CacheType;
+  RETURN_STATUS           Status;
+
+  if (Length == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!IsMtrrSupported ()) {
+    return EFI_UNSUPPORTED;
+  }
+
+  switch (Attributes) {
+  case EFI_MEMORY_UC:
+    CacheType = CacheUncacheable;
+    break;
+
+  case EFI_MEMORY_WC:
+    CacheType = CacheWriteCombining;
+    break;
+
+  case EFI_MEMORY_WT:
+    CacheType = CacheWriteThrough;
+    break;
+
+  case EFI_MEMORY_WP:
+    CacheType = CacheWriteProtected;
+    break;
+
+  case EFI_MEMORY_WB:
+    CacheType = CacheWriteBack;
+    break;
+
+  default:
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // MtrrLib rewrites the variable MTRRs on this processor only; bareBoot
+  // does not start the APs before the OS takes over.
+  //
+  Status = MtrrSetMemoryAttribute (BaseAddress, Length, CacheType);
+  if (RETURN_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "CpuSetMemoryAttributes: %lx-%lx type %d: %r\n",
+            BaseAddress, BaseAddress + Length - 1, CacheType, Status));
+    return Status == RETURN_OUT_OF_RESOURCES ? EFI_UNSUPPORTED : Status;
+  }
+
+  return EFI_SUCCESS;
 }
 
 STATIC
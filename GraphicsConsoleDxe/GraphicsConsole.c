@@ -42,7 +42,9 @@ GRAPHICS_CONSOLE_DEV    mGraphicsConsoleDevTemplate = {
     TRUE
   },
   (GRAPHICS_CONSOLE_MODE_DATA *) NULL,
-  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL,
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL,
+  (UINT8 *) NULL
 };
 
 GRAPHICS_CONSOLE_MODE_DATA mGraphicsConsoleModeData[] = {
@@ -93,6 +95,13 @@ EFI_NARROW_GLYPH     mCursorGlyph = {
 
 CHAR16       SpaceStr[] = { NARROW_CHAR, ' ', 0 };
 
+//
+// Character to glyph index of gUsStdNarrowGlyphData, stored as index + 1 so
+// that zero marks an empty slot.
+//
+UINT16       mGlyphIndex[GLYPH_INDEX_SIZE];
+UINTN        mNarrowGlyphCount;
+
 EFI_DRIVER_BINDING_PROTOCOL gGraphicsConsoleDriverBinding = {
   GraphicsConsoleControllerDriverSupported,
   GraphicsConsoleControllerDriverStart,
@@ -628,6 +637,11 @@ Error:
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->GlyphCache != NULL) {
+      FreePool (Private->GlyphCache);
+      FreePool (Private->GlyphCacheAttribute);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -716,6 +730,11 @@ GraphicsConsoleControllerDriverStop (
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->GlyphCache != NULL) {
+      FreePool (Private->GlyphCache);
+      FreePool (Private->GlyphCacheAttribute);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -1365,6 +1384,27 @@ GraphicsConsoleConOutSetMode (
   //
   Private->LineBuffer = NewLineBuffer;
 
+  //
+  // The glyph cells do not depend on the mode, so the cache is allocated once
+  // and kept across mode changes. Without it text is drawn through HII Font.
+  //
+  if (Private->GlyphCache == NULL && mNarrowGlyphCount != 0) {
+    Private->GlyphCacheAttribute = AllocatePool (mNarrowGlyphCount);
+    Private->GlyphCache = AllocatePool (sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) * GLYPH_CELL_PIXELS * mNarrowGlyphCount);
+    if (Private->GlyphCache == NULL || Private->GlyphCacheAttribute == NULL) {
+      if (Private->GlyphCache != NULL) {
+        FreePool (Private->GlyphCache);
+        Private->GlyphCache = NULL;
+      }
+      if (Private->GlyphCacheAttribute != NULL) {
+        FreePool (Private->GlyphCacheAttribute);
+        Private->GlyphCacheAttribute = NULL;
+      }
+    } else {
+      SetMem (Private->GlyphCacheAttribute, mNarrowGlyphCount, GLYPH_CACHE_INVALID);
+    }
+  }
+
   if (GraphicsOutput != NULL) {
     if (ModeData->GopModeNumber != GraphicsOutput->Mode->Mode) {
       //
@@ -1732,6 +1772,196 @@ GetTextColors (
   return EFI_SUCCESS;
 }
 
+/**
+  Build the character to glyph index of the built-in narrow font.
+
+**/
+VOID
+BuildGlyphIndex (
+  VOID
+  )
+{
+  UINTN   Index;
+  UINTN   Slot;
+  CHAR16  Char;
+
+  ZeroMem (mGlyphIndex, sizeof (mGlyphIndex));
+
+  mNarrowGlyphCount = mNarrowFontSize / sizeof (EFI_NARROW_GLYPH);
+  ASSERT (mNarrowGlyphCount < GLYPH_INDEX_SIZE);
+
+  for (Index = 0; Index < mNarrowGlyphCount; Index++) {
+    Char = gUsStdNarrowGlyphData[Index].UnicodeWeight;
+    if (Char == 0) {
+      continue;
+    }
+    Slot = Char & (GLYPH_INDEX_SIZE - 1);
+    while (mGlyphIndex[Slot] != 0) {
+      Slot = (Slot + 1) & (GLYPH_INDEX_SIZE - 1);
+    }
+    mGlyphIndex[Slot] = (UINT16) (Index + 1);
+  }
+}
+
+/**
+  Find the glyph of a character in the built-in narrow font.
+
+  @param  Char                  The Unicode character.
+  @param  GlyphIndex            Returned index into gUsStdNarrowGlyphData.
+
+  @retval EFI_SUCCESS           The character has a glyph.
+  @retval EFI_NOT_FOUND         The built-in font has no glyph for the character.
+
+**/
+EFI_STATUS
+LookupGlyph (
+  IN  CHAR16                           Char,
+  OUT UINTN                            *GlyphIndex
+  )
+{
+  UINTN   Slot;
+
+  Slot = Char & (GLYPH_INDEX_SIZE - 1);
+  while (mGlyphIndex[Slot] != 0) {
+    if (gUsStdNarrowGlyphData[mGlyphIndex[Slot] - 1].UnicodeWeight == Char) {
+      *GlyphIndex = mGlyphIndex[Slot] - 1;
+      return EFI_SUCCESS;
+    }
+    Slot = (Slot + 1) & (GLYPH_INDEX_SIZE - 1);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Draw a run of narrow characters from the glyph cache with a single Blt.
+
+  @param  This                  Protocol instance pointer.
+  @param  UnicodeWeight         The characters to be displayed.
+  @param  Count                 The count of characters.
+
+  @retval EFI_NOT_FOUND         A character has no cached glyph, nothing was drawn.
+  @retval EFI_UNSUPPORTED       If no Graphics Output protocol and UGA Draw
+                                protocol exist.
+  @retval EFI_SUCCESS           The characters were drawn.
+
+**/
+EFI_STATUS
+DrawCachedGlyphsAtCursorN (
+  IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+  IN  CHAR16                           *UnicodeWeight,
+  IN  UINTN                            Count
+  )
+{
+  EFI_STATUS                        Status;
+  GRAPHICS_CONSOLE_DEV              *Private;
+  GRAPHICS_CONSOLE_MODE_DATA        *ModeData;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     Foreground;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     Background;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Cell;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Line;
+  EFI_NARROW_GLYPH                  *Glyph;
+  UINTN                             GlyphIndex;
+  UINTN                             Index;
+  UINTN                             PosX;
+  UINTN                             PosY;
+  UINTN                             Delta;
+  UINTN                             DestX;
+  UINTN                             DestY;
+  UINT8                             Attribute;
+
+  Private  = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
+  ModeData = &Private->ModeData[This->Mode->Mode];
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (Count > ModeData->Columns) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Check the whole run first, so a missing glyph leaves the screen untouched
+  // for the HII Font path.
+  //
+  for (Index = 0; Index < Count; Index++) {
+    Status = LookupGlyph (UnicodeWeight[Index], &GlyphIndex);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Attribute = (UINT8) (This->Mode->Attribute & 0x7F);
+  GetTextColors (This, &Foreground, &Background);
+
+  //
+  // Assemble the run into the line buffer, re-rendering only the cells last
+  // drawn in another attribute.
+  //
+  Delta = Count * EFI_GLYPH_WIDTH;
+  for (Index = 0; Index < Count; Index++) {
+    LookupGlyph (UnicodeWeight[Index], &GlyphIndex);
+    Cell = Private->GlyphCache + GlyphIndex * GLYPH_CELL_PIXELS;
+
+    if (Private->GlyphCacheAttribute[GlyphIndex] != Attribute) {
+      Glyph = &gUsStdNarrowGlyphData[GlyphIndex];
+      for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+        for (PosX = 0; PosX < EFI_GLYPH_WIDTH; PosX++) {
+          if ((Glyph->GlyphCol1[PosY] & (BIT7 >> PosX)) != 0) {
+            Cell[PosY * EFI_GLYPH_WIDTH + PosX] = Foreground;
+          } else {
+            Cell[PosY * EFI_GLYPH_WIDTH + PosX] = Background;
+          }
+        }
+      }
+      Private->GlyphCacheAttribute[GlyphIndex] = Attribute;
+    }
+
+    Line = Private->LineBuffer + Index * EFI_GLYPH_WIDTH;
+    for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+      CopyMem (Line, Cell, EFI_GLYPH_WIDTH * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      Line += Delta;
+      Cell += EFI_GLYPH_WIDTH;
+    }
+  }
+
+  DestX = This->Mode->CursorColumn * EFI_GLYPH_WIDTH + ModeData->DeltaX;
+  DestY = This->Mode->CursorRow * EFI_GLYPH_HEIGHT + ModeData->DeltaY;
+
+  if (Private->GraphicsOutput != NULL) {
+    Status = Private->GraphicsOutput->Blt (
+                                        Private->GraphicsOutput,
+                                        Private->LineBuffer,
+                                        EfiBltBufferToVideo,
+                                        0,
+                                        0,
+                                        DestX,
+                                        DestY,
+                                        Delta,
+                                        EFI_GLYPH_HEIGHT,
+                                        Delta * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                                        );
+  } else if (FeaturePcdGet (PcdUgaConsumeSupport)) {
+    Status = Private->UgaDraw->Blt (
+                                 Private->UgaDraw,
+                                 (EFI_UGA_PIXEL *) Private->LineBuffer,
+                                 EfiUgaBltBufferToVideo,
+                                 0,
+                                 0,
+                                 DestX,
+                                 DestY,
+                                 Delta,
+                                 EFI_GLYPH_HEIGHT,
+                                 Delta * sizeof (EFI_UGA_PIXEL)
+                                 );
+  } else {
+    Status = EFI_UNSUPPORTED;
+  }
+
+  return Status;
+}
+
 /**
   Draw Unicode string on the Graphics Console device's screen.
 
@@ -1762,6 +1992,18 @@ DrawUnicodeWeightAtCursorN (
   UINTN                             RowInfoArraySize;
 
   Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
+
+  //
+  // Narrow text in the built-in font is drawn from the glyph cache; wide text
+  // and characters the font lacks still go through HII Font.
+  //
+  if (Private->GlyphCache != NULL && (This->Mode->Attribute & EFI_WIDE_ATTRIBUTE) == 0) {
+    Status = DrawCachedGlyphsAtCursorN (This, UnicodeWeight, Count);
+    if (Status != EFI_NOT_FOUND) {
+      return Status;
+    }
+  }
+
   Blt = (EFI_IMAGE_OUTPUT *) AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
   if (Blt == NULL) {
     return EFI_OUT_OF_RESOURCES;
@@ -2099,6 +2341,8 @@ InitializeGraphicsConsole (
 {
   EFI_STATUS              Status;
 
+  BuildGlyphIndex ();
+
   //
   // Register notify function on HII Database Protocol to add font package.
   //
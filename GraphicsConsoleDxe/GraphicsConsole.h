@@ -43,6 +43,15 @@ extern EFI_NARROW_GLYPH              gUsStdNarrowGlyphData[];
 
 extern UINT32 mNarrowFontSize;
 
+//
+// Glyph cache: each narrow glyph of the built-in font is kept pre-rendered
+// in the colors of the attribute it was last drawn with. Characters are
+// mapped to glyphs through an open-addressed index of GLYPH_INDEX_SIZE slots.
+//
+#define GLYPH_INDEX_SIZE      512
+#define GLYPH_CELL_PIXELS     (EFI_GLYPH_WIDTH * EFI_GLYPH_HEIGHT)
+#define GLYPH_CACHE_INVALID   0xFF
+
 typedef union {
   EFI_NARROW_GLYPH  NarrowGlyph;
   EFI_WIDE_GLYPH    WideGlyph;
@@ -71,6 +80,8 @@ typedef struct {
   EFI_SIMPLE_TEXT_OUTPUT_MODE      SimpleTextOutputMode;
   GRAPHICS_CONSOLE_MODE_DATA       *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *LineBuffer;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *GlyphCache;
+  UINT8                            *GlyphCacheAttribute;
 } GRAPHICS_CONSOLE_DEV;
 
 #define GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS(a) \
@@ -552,6 +563,51 @@ DrawUnicodeWeightAtCursorN (
   IN  UINTN                            Count
   );
 
+/**
+  Build the character to glyph index of the built-in narrow font.
+
+**/
+VOID
+BuildGlyphIndex (
+  VOID
+  );
+
+/**
+  Find the glyph of a character in the built-in narrow font.
+
+  @param  Char                  The Unicode character.
+  @param  GlyphIndex            Returned index into gUsStdNarrowGlyphData.
+
+  @retval EFI_SUCCESS           The character has a glyph.
+  @retval EFI_NOT_FOUND         The built-in font has no glyph for the character.
+
+**/
+EFI_STATUS
+LookupGlyph (
+  IN  CHAR16                           Char,
+  OUT UINTN                            *GlyphIndex
+  );
+
+/**
+  Draw a run of narrow characters from the glyph cache with a single Blt.
+
+  @param  This                  Protocol instance pointer.
+  @param  UnicodeWeight         The characters to be displayed.
+  @param  Count                 The count of characters.
+
+  @retval EFI_NOT_FOUND         A character has no cached glyph, nothing was drawn.
+  @retval EFI_UNSUPPORTED       If no Graphics Output protocol and UGA Draw
+                                protocol exist.
+  @retval EFI_SUCCESS           The characters were drawn.
+
+**/
+EFI_STATUS
+DrawCachedGlyphsAtCursorN (
+  IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+  IN  CHAR16                           *UnicodeWeight,
+  IN  UINTN                            Count
+  );
+
 /**
   Flush the cursor on the screen.
   
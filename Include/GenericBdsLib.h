@@ -188,6 +188,33 @@ BdsLibEnumerateAllBootOption (
   IN OUT LIST_ENTRY          *BdsBootOptionList
   );
 
+/**
+  Free every option of a boot option list built by
+  BdsLibEnumerateAllBootOption () and leave the list empty.
+
+  @param  BdsBootOptionList      The header of the linked list to free.
+
+**/
+VOID
+EFIAPI
+BdsLibFreeBootOptionList (
+  IN OUT LIST_ENTRY          *BdsBootOptionList
+  );
+
+/**
+  Look for config.plist on the volumes connected so far and read its
+  SystemParameters/LazyConnect key. Boot options are not touched.
+
+  @retval TRUE   A config was found and asks for a lazy connect.
+  @retval FALSE  No config yet, or LazyConnect is off.
+
+**/
+BOOLEAN
+EFIAPI
+BdsLibLazyConnectRequested (
+  VOID
+  );
+
 /**
   Build the boot option with the handle parsed in.
 
@@ -390,6 +417,30 @@ BdsLibConnectAll (
   VOID
   );
 
+/**
+  This function connects the PCI mass storage controllers only and
+  leaves the other controllers for BdsLibConnectDeferred ().
+
+**/
+VOID
+EFIAPI
+BdsLibConnectBootDevices (
+  VOID
+  );
+
+/**
+  This function connects the controllers skipped by BdsLibConnectBootDevices ().
+
+  @retval TRUE   New controllers were connected.
+  @retval FALSE  Nothing was deferred.
+
+**/
+BOOLEAN
+EFIAPI
+BdsLibConnectDeferred (
+  VOID
+  );
+
 /**
   This function creates all handles associated with the given device
   path node. If the handle associated with one device path node cannot
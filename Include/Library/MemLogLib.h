@@ -89,4 +89,37 @@ EFIAPI
 GetMemLogTscTicksPerSecond (VOID);
 
 
+/**
+  Opens a traced boot phase. Phases nest; each one is closed by MemLogTraceEnd().
+  The name is formatted like MemLog(); only its last 39 chars are kept.
+ **/
+VOID
+EFIAPI
+MemLogTraceBegin (
+  IN  CONST CHAR8   *Format,
+  ...
+  );
+
+
+/**
+  Closes the innermost phase opened by MemLogTraceBegin().
+ **/
+VOID
+EFIAPI
+MemLogTraceEnd (
+  VOID
+  );
+
+
+/**
+  Writes the trace as Chrome trace JSON (chrome://tracing).
+  Returns the size the trace needs; Buffer is filled only if it is big enough.
+ **/
+UINTN
+EFIAPI
+MemLogTraceExport (
+  OUT CHAR8         *Buffer,
+  IN  UINTN         BufferSize
+  );
+
 #endif // __MEMLOG_LIB_H__
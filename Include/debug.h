@@ -26,9 +26,14 @@
 
 #ifndef BOOT_DEBUG
 #define DBG(...)
+#define TRACE_BEGIN(...)
+#define TRACE_END()
 #else
 #define BOOT_LOG L"EFI\\bareboot\\boot.log"
+#define BOOT_TRACE L"EFI\\bareboot\\boot_trace.json"
 #define DBG(...) MemLog(TRUE, 0, __VA_ARGS__)
+#define TRACE_BEGIN(...) MemLogTraceBegin(__VA_ARGS__)
+#define TRACE_END() MemLogTraceEnd()
 #endif
 
 #endif
@@ -207,6 +207,7 @@ typedef struct {
   BOOLEAN SaveVideoRom;
   BOOLEAN NvRam;
   BOOLEAN YoBlack;
+  BOOLEAN ImageCache;
   //ACPI
   UINT64  ResetAddr;
   UINT8   ResetVal;
@@ -344,6 +345,21 @@ struct _oper_region {
 };
 typedef struct _oper_region OPER_REGION;
 
+#define VOLUME_PN_CONFIG        BIT0  // <ProductNameDir>config.plist
+#define VOLUME_PN_CONFIG2       BIT1  // <ProductNameDir2>config.plist
+#define VOLUME_CONFIG           BIT2  // \EFI\bareboot\config.plist
+#define VOLUME_NVRAM            BIT3  // nvram.plist, see NvramTime
+
+typedef struct {
+  EFI_HANDLE                    Handle;
+  EFI_FILE_HANDLE               Root;         // NULL if the volume did not open
+  CHAR16                        *VolumeName;
+  UINT32                        Flags;
+  UINT64                        LoaderMask;   // bit N: mLoaderPath[N] exists
+  EFI_TIME                      NvramTime;
+  UINT32                        MediaId;      // BlockIo MediaId at probe time
+} BDS_VOLUME;
+
 MEM_STRUCTURE                   *gRAM;
 EFI_RUNTIME_SERVICES            *gRS;
 EFI_FILE_HANDLE                 gRootFHandle;
@@ -369,6 +385,8 @@ BOOLEAN                         gFronPage;
 OPER_REGION                     *gRegions;
 
 extern CHAR8                    *gDevProp;
+extern UINT8                    *gDevPropData;
+extern UINT32                   gDevPropDataLen;
 extern CHAR8                    *cDevProp;
 extern EFI_GUID                 gEfiAppleNvramGuid;
 extern EFI_GUID                 gEfiAppleBootGuid;
@@ -446,11 +464,23 @@ SaveBooterLog (
   IN CHAR16 *FileName
 );
 
+EFI_STATUS
+SaveBooterTrace (
+  IN EFI_FILE_HANDLE BaseDir,
+  IN CHAR16 *FileName
+);
+
 EFI_STATUS
 GetBootDefault(
   IN EFI_FILE *RootFileHandle
 );
 
+BOOLEAN
+GetLazyConnect (
+  IN EFI_FILE *RootFileHandle,
+  IN CHAR16 *XmlPlistPath
+);
+
 VOID
 GetDefaultSettings (
   VOID
@@ -503,6 +533,11 @@ EventsInitialize (
   VOID
   );
 
+VOID
+KernelAndKextPatchesCompile (
+  VOID
+);
+
 EFI_STATUS
 GetOSVersion(
   IN EFI_FILE *FileHandle
@@ -526,6 +561,25 @@ LoadPListFile (
   IN CHAR16* XmlPlistPath
 );
 
+VOID*
+LoadConfigPlist (
+  IN EFI_FILE *RootFileHandle,
+  IN CHAR16* XmlPlistPath
+);
+
+UINTN
+EFIAPI
+BdsScanVolumes (
+  OUT BDS_VOLUME **Volumes
+);
+
+BOOLEAN
+EFIAPI
+BdsVolumeFileExists (
+  IN BDS_VOLUME *Vol,
+  IN CHAR16 *Path
+);
+
 BOOLEAN
 GetUnicodeProperty (
   VOID* dict,
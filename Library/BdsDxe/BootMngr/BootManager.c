@@ -833,14 +833,9 @@ ShowProgress (
   UINTN                          PosY;
   INTN                          DestX;
   INTN                          DestY;
-  UINT8                         *ImageData;
-  UINTN                         ImageSize;
-  UINTN                         BltSize;
-  UINTN                         Height;
-  UINTN                         Width;
+  IMAGE_SURFACE                 *Logo;
   UINTN                         FontHeight;
   UINTN                         FontWidth;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt;
   
   GraphicsOutput = NULL;
   Pixel = NULL;
@@ -870,9 +865,6 @@ ShowProgress (
     BlockHeight = 5;
     PosY        = GraphicsOutput->Mode->Info->VerticalResolution -  10;
 
-    Blt = NULL;
-    ImageData = NULL;
-    ImageSize = 0;
     FontHeight = 16;
     FontWidth = 10;
 
@@ -881,47 +873,22 @@ ShowProgress (
     //
 
     if (!gSettings.YoBlack) {
-      Status = GetSectionFromAnyFv (
-                 PcdGetPtr(PcdBBLogoFile),
-                 EFI_SECTION_RAW,
-                 0,
-                 (VOID **) &ImageData,
-                 &ImageSize
-               );
-      if (EFI_ERROR (Status)) {
-        goto Down;
-      }
-      
-      Status = ConvertBmpToGopBlt (
-                 ImageData,
-                 ImageSize,
-                 (VOID **) &Blt,
-                 &BltSize,
-                 &Height,
-                 &Width
-               );
-      
-      if (EFI_ERROR (Status)) {
-        goto Down;
-      }
-
-      DestX = (GraphicsOutput->Mode->Info->HorizontalResolution - Width) / 2;
-      DestY = (GraphicsOutput->Mode->Info->VerticalResolution - Height) / 2;
-
-      if ((DestX >= 0) && (DestY >= 0)) {
-        Status = BltWithAlpha (
-                   GraphicsOutput,
-                   Blt,
-                   EfiBltBufferToVideo,
-                   0,
-                   0,
-                   (UINTN) DestX,
-                   (UINTN) DestY,
-                   Width,
-                   Height,
-                   Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL),
-                   FALSE
-                 );
+      Status = LoadImageSurface (NULL, PcdGetPtr(PcdBBLogoFile), &Logo);
+      if (!EFI_ERROR (Status)) {
+        DestX = (GraphicsOutput->Mode->Info->HorizontalResolution - Logo->Width) / 2;
+        DestY = (GraphicsOutput->Mode->Info->VerticalResolution - Logo->Height) / 2;
+
+        if ((DestX >= 0) && (DestY >= 0)) {
+          Status = BltPremultiplied (
+                     GraphicsOutput,
+                     Logo->Blt,
+                     (UINTN) DestX,
+                     (UINTN) DestY,
+                     Logo->Width,
+                     Logo->Height,
+                     FALSE
+                   );
+        }
       }
       
       DestX = GraphicsOutput->Mode->Info->HorizontalResolution -  AsciiStrLen (mAVersion) * FontWidth - 40;
@@ -951,14 +918,6 @@ ShowProgress (
 #if 0
     ShowPngFile (GraphicsOutput, L"\\EFI\\bareboot\\banner.png", DestX, DestY, TRUE);
 #endif
-
-Down:
-    if (ImageData != NULL) {
-      FreePool (ImageData);
-    }
-    if (Blt != NULL) {
-      FreePool (Blt);
-    }
   } else {
     Print(L".");
   }
@@ -1042,6 +1001,14 @@ PlatformBdsEnterFrontPage (
     if (EFI_ERROR (Status)) goto Exit;
   }
   
+  //
+  // The menu lists every device, so finish a lazy connect first.
+  //
+  if (BdsLibConnectDeferred ()) {
+    BdsLibFreeBootOptionList (&gBootOptionList);
+    BdsLibEnumerateAllBootOption (&gBootOptionList);
+  }
+
   Status = EFI_SUCCESS;
   gFronPage = TRUE;
   ClearScreen (0x00, NULL);
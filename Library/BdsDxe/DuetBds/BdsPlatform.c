@@ -1259,6 +1259,10 @@ Returns:
   CHAR16                            *TmpString1;
   CHAR16                            *TmpString2;
   UINT8                             StrIndex;
+  LIST_ENTRY                        *Link;
+  BDS_COMMON_OPTION                 *Option;
+  BOOLEAN                           DefaultFound;
+  BOOLEAN                           LazyConnect;
 
   gPNDirExists = FALSE;
   gPNConfigPlist = NULL;
@@ -1273,13 +1277,21 @@ Returns:
   ASSERT (BootMode == BOOT_WITH_FULL_CONFIGURATION);
   // very long function:
   DBG ("BdsPlatorm: Starting PlatformBdsConnectConsole\n"); // 5.2 sec
+  TRACE_BEGIN ("ConnectConsole");
   PlatformBdsConnectConsole (gPlatformConsole);
+  TRACE_END ();
   ClearScreen (0x030000, NULL);
 #if 0
   EnableSmbus ();
 #endif
-  DBG ("BdsPlatorm: Starting BdsLibConnectAllDriversToAllControllers\n");  // 2.3 sec
-  BdsLibConnectAllDriversToAllControllers ();
+  //
+  // Storage only; the rest is connected below unless LazyConnect is set,
+  // in which case it waits until the boot menu is shown.
+  //
+  DBG ("BdsPlatorm: Starting BdsLibConnectBootDevices\n");
+  TRACE_BEGIN ("ConnectBootDevices");
+  BdsLibConnectBootDevices ();
+  TRACE_END ();
 
   Status = gBS->LocateProtocol (
                   &gEfiSmbiosProtocolGuid,
@@ -1315,8 +1327,38 @@ Returns:
   gProductNameDir2 = MakeProductNameDir (TmpString2);
   DBG ("BdsPlatorm: ProductNameDir2 = '%s'\n", gProductNameDir2);
 
+  //
+  // Only a config that asks for LazyConnect may skip the full connect;
+  // otherwise connect everything first and enumerate once, as before.
+  //
+  LazyConnect = BdsLibLazyConnectRequested ();
+  if (!LazyConnect) {
+    DBG ("BdsPlatorm: Starting BdsLibConnectDeferred\n");
+    TRACE_BEGIN ("ConnectDeferred");
+    BdsLibConnectDeferred ();
+    TRACE_END ();
+  }
+
   DBG ("BdsPlatorm: Starting BdsLibEnumerateAllBootOption\n");
+  TRACE_BEGIN ("EnumerateAllBootOption");
   BdsLibEnumerateAllBootOption (&gBootOptionList);
+  TRACE_END ();
+
+  DefaultFound = FALSE;
+  for (Link = GetFirstNode (&gBootOptionList); !IsNull (&gBootOptionList, Link); Link = GetNextNode (&gBootOptionList, Link)) {
+    Option = CR (Link, BDS_COMMON_OPTION, Link, BDS_LOAD_OPTION_SIGNATURE);
+    if (StrCmp (gSettings.DefaultBoot, Option->Description) == 0) {
+      DefaultFound = TRUE;
+      break;
+    }
+  }
+  if (LazyConnect && ((gRootFHandle == NULL) || !DefaultFound)) {
+    DBG ("BdsPlatorm: Starting BdsLibConnectDeferred\n");
+    if (BdsLibConnectDeferred ()) {
+      BdsLibFreeBootOptionList (&gBootOptionList);
+      BdsLibEnumerateAllBootOption (&gBootOptionList);
+    }
+  }
 
   if (gSettings.SaveVideoRom) {
     UINT8                             *vrom;
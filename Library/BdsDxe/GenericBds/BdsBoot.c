@@ -56,6 +56,8 @@ CHAR16* mLoaderPath[] = {
 
 #define MAX_LOADER_PATHS  (sizeof (mLoaderPath) / sizeof (CHAR16*))
 
+UINTN mLoaderPathCount = MAX_LOADER_PATHS;
+
 VOID
 DumpEfiMemoryMap (
   VOID
@@ -243,6 +245,8 @@ MacOS:
   SetPrivateVarProto ();
   DBG ("%a: launching SetupDataForOSX.\n",__FUNCTION__);
   SetupDataForOSX ();
+  DBG ("%a: launching KernelAndKextPatchesCompile.\n",__FUNCTION__);
+  KernelAndKextPatchesCompile ();
   DBG ("%a: launching EventsInitialize.\n",__FUNCTION__);
   EventsInitialize ();
   if (gSettings.NvRam) {
@@ -312,7 +316,9 @@ MacOS:
     }
   }
 
+  TRACE_BEGIN ("LoadKexts");
   WithKexts = LoadKexts ();
+  TRACE_END ();
 
 #if 0
   gBS->CalculateCrc32 ((VOID *)gST, sizeof(EFI_SYSTEM_TABLE), &gST->Hdr.CRC32);
@@ -326,12 +332,18 @@ Next:
   DBG ("%a: launching StartImage.\n",__FUNCTION__);
   SaveBooterLog (gRootFHandle, BOOT_LOG);
 #endif
+  //
+  // Closed by OnExitBootServices (); boot.efi loads the kernel meanwhile
+  //
+  TRACE_BEGIN ("StartImage");
   Status = gBS->StartImage (ImageHandle, ExitDataSize, ExitData);
+  TRACE_END ();
 
 Done:
 #ifdef BOOT_DEBUG
   DBG ("%a: something wrong. we can not launch StartImage.\n",__FUNCTION__);
   SaveBooterLog (gRootFHandle, BOOT_LOG);
+  SaveBooterTrace (gRootFHandle, BOOT_TRACE);
 #endif
   gRT->SetVariable (
         L"BootCurrent",
@@ -368,28 +380,126 @@ BdsLibGetVolumeName (
   return EfiStrDuplicate (wbuff);
 }
 
+//
+// Path is known to exist, BdsScanVolumes() has probed it
+//
 VOID
 EFIAPI
 BdsLibBuildOneOptionFromHandle (
-  IN EFI_FILE_HANDLE RFHandle,
-  IN OUT EFI_FILE_HANDLE FHandle,
-  IN OUT CHAR16* Path,
+  IN EFI_HANDLE Handle,
+  IN CHAR16* Path,
   IN CHAR16* OSName,
   IN CHAR16* VolName,
-  IN OUT LIST_ENTRY          *BdsBootOptionList,
-  IN OUT BOOLEAN Flag
+  IN OUT LIST_ENTRY          *BdsBootOptionList
   )
 {
   CHAR16 Buffer[255];
 
-  if (FileExists(RFHandle, Path)) {
-    if (OSName != NULL) {
-      UnicodeSPrint (Buffer, sizeof (Buffer), L"%s (%s)", VolName, OSName);
-    } else {
-      UnicodeSPrint (Buffer, sizeof (Buffer), L"%s", VolName);
+  if (OSName != NULL) {
+    UnicodeSPrint (Buffer, sizeof (Buffer), L"%s (%s)", VolName, OSName);
+  } else {
+    UnicodeSPrint (Buffer, sizeof (Buffer), L"%s", VolName);
+  }
+  BdsLibBuildOptionFromHandle (Handle, Path, BdsBootOptionList, Buffer, TRUE);
+}
+
+STATIC
+CHAR16 *
+BdsConfigPlistPath (
+  IN CHAR16 *Dir
+  )
+{
+  CHAR16 *Path;
+
+  if (Dir == NULL) {
+    return NULL;
+  }
+  Path = AllocateZeroPool (StrSize (Dir) + StrSize (L"config.plist"));
+  if (Path != NULL) {
+    StrCpy (Path, Dir);
+    StrCat (Path, L"config.plist");
+  }
+  return Path;
+}
+
+//
+// The first volume, in handle order, with a config.plist. On one volume
+// <ProductNameDir> wins over <ProductNameDir2>, which wins over
+// \EFI\bareboot\. ConfigPath returns the matching path.
+//
+STATIC
+BDS_VOLUME *
+BdsFindConfigVolume (
+  IN  BDS_VOLUME  *Volumes,
+  IN  UINTN       NumberVolumes,
+  IN  CHAR16      *PNConfigPlist,
+  IN  CHAR16      *PNConfigPlist2,
+  OUT CHAR16      **ConfigPath
+  )
+{
+  UINTN       Index;
+  BDS_VOLUME  *Vol;
+
+  for (Index = 0; Index < NumberVolumes; Index++) {
+    Vol = &Volumes[Index];
+    if (Vol->Root == NULL) {
+      continue;
+    }
+    if ((PNConfigPlist != NULL) && BdsVolumeFileExists (Vol, PNConfigPlist)) {
+      *ConfigPath = PNConfigPlist;
+      return Vol;
+    }
+    if ((PNConfigPlist2 != NULL) && BdsVolumeFileExists (Vol, PNConfigPlist2)) {
+      *ConfigPath = PNConfigPlist2;
+      return Vol;
+    }
+    if (BdsVolumeFileExists (Vol, L"\\EFI\\bareboot\\config.plist")) {
+      *ConfigPath = L"\\EFI\\bareboot\\config.plist";
+      return Vol;
     }
-    BdsLibBuildOptionFromHandle (FHandle, Path, BdsBootOptionList, Buffer, TRUE);
   }
+  return NULL;
+}
+
+/**
+  Look for config.plist on the volumes connected so far and read its
+  SystemParameters/LazyConnect key. Boot options are not touched.
+
+  @retval TRUE   A config was found and asks for a lazy connect.
+  @retval FALSE  No config yet, or LazyConnect is off.
+**/
+BOOLEAN
+EFIAPI
+BdsLibLazyConnectRequested (
+  VOID
+  )
+{
+  BDS_VOLUME  *Volumes;
+  BDS_VOLUME  *Vol;
+  UINTN       NumberVolumes;
+  CHAR16      *PNConfigPlist;
+  CHAR16      *PNConfigPlist2;
+  CHAR16      *ConfigPath;
+  BOOLEAN     LazyConnect;
+
+  PNConfigPlist  = BdsConfigPlistPath (gProductNameDir);
+  PNConfigPlist2 = BdsConfigPlistPath (gProductNameDir2);
+
+  LazyConnect   = FALSE;
+  NumberVolumes = BdsScanVolumes (&Volumes);
+  Vol = BdsFindConfigVolume (Volumes, NumberVolumes, PNConfigPlist, PNConfigPlist2, &ConfigPath);
+  if (Vol != NULL) {
+    LazyConnect = GetLazyConnect (Vol->Root, ConfigPath);
+  }
+
+  if (PNConfigPlist != NULL) {
+    FreePool (PNConfigPlist);
+  }
+  if (PNConfigPlist2 != NULL) {
+    FreePool (PNConfigPlist2);
+  }
+  DBG ("BdsBoot: LazyConnect = %d\n", LazyConnect);
+  return LazyConnect;
 }
 
 /**
@@ -443,14 +553,12 @@ BdsLibEnumerateAllBootOption (
   )
 {
   EFI_STATUS                    Status;
-  BOOLEAN                       ConfigNotFound;
   UINTN                         Index, Index2;
   EFI_DEVICE_PATH_PROTOCOL      *DevicePath;
   CHAR16                        Buffer[255];
-  EFI_HANDLE                    *FileSystemHandles;
-  UINTN                         NumberFileSystemHandles;
-  EFI_FILE_HANDLE               FHandle;
-  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume;
+  BDS_VOLUME                    *Volumes;
+  BDS_VOLUME                    *Vol;
+  UINTN                         NumberVolumes;
   CHAR16                        *VolumeName;
   EFI_FILE_SYSTEM_INFO          *FileSystemInfo;
   UINTN                         NumberBlockIoHandles;
@@ -458,34 +566,34 @@ BdsLibEnumerateAllBootOption (
   EFI_BLOCK_IO_PROTOCOL         *BlkIo;
   UINTN                         DevicePathType;
   UINT16                        CdromNumber;
-  UINT16                        *PNConfigPlist2;
-  
+  CHAR16                        *PNConfigPlist2;
+  CHAR16                        *ConfigPath;
+
   gRootFHandle    = NULL;
+  gPNDirExists    = FALSE;
   FileSystemInfo  = NULL;
-  FileSystemHandles = NULL;
-  FHandle         = NULL;
-  ConfigNotFound  = TRUE;
-
-  NumberFileSystemHandles = 0;
 
   ZeroMem (Buffer, sizeof (Buffer));
   CdromNumber     = 0;
   DevicePathType  = 0;
   BlkIo           = NULL;
 
-  if (gProductNameDir != NULL) {
-    gPNConfigPlist = AllocateZeroPool (StrSize (gProductNameDir) + StrSize (L"config.plist"));
-    StrCpy (gPNConfigPlist, gProductNameDir);
-    StrCat (gPNConfigPlist, L"config.plist");
+  //
+  // This runs again after a deferred connect; drop what the previous
+  // enumeration allocated.
+  //
+  if (gPNConfigPlist != NULL) {
+    FreePool (gPNConfigPlist);
   }
-
-  PNConfigPlist2 = NULL;
-  if (gProductNameDir2 != NULL) {
-    PNConfigPlist2 = AllocateZeroPool (StrSize (gProductNameDir2) + StrSize (L"config.plist"));
-    StrCpy (PNConfigPlist2, gProductNameDir2);
-    StrCat (PNConfigPlist2, L"config.plist");
+  if (gPNAcpiDir != NULL) {
+    FreePool (gPNAcpiDir);
+    gPNAcpiDir = NULL;
   }
-  
+  gPNConfigPlist = BdsConfigPlistPath (gProductNameDir);
+  PNConfigPlist2 = BdsConfigPlistPath (gProductNameDir2);
+
+  NumberBlockIoHandles = 0;
+  BlockIoHandles = NULL;
   gBS->LocateHandleBuffer (
                            ByProtocol,
                            &gEfiBlockIoProtocolGuid,
@@ -529,70 +637,63 @@ BdsLibEnumerateAllBootOption (
         break;
     }
   }
+  if (BlockIoHandles != NULL) {
+    FreePool (BlockIoHandles);
+  }
 
-  gBS->LocateHandleBuffer (
-         ByProtocol,
-         &gEfiSimpleFileSystemProtocolGuid,
-         NULL,
-         &NumberFileSystemHandles,
-         &FileSystemHandles
-       );
-  
-  for (Index = 0; Index < NumberFileSystemHandles; Index++) {
-    DevicePath  = DevicePathFromHandle (FileSystemHandles[Index]);
-    Status = gBS->HandleProtocol (
-                    FileSystemHandles[Index],
-                    &gEfiSimpleFileSystemProtocolGuid,
-                    (VOID *) &Volume
-                  );
-    if (!EFI_ERROR (Status)) {
-      Status = Volume->OpenVolume (
-                         Volume,
-                         &FHandle
-                       );
-    }
-    
-    if ((gPNConfigPlist != NULL) && (FileExists (FHandle, gPNConfigPlist)) && (ConfigNotFound)) {
-      gPNDirExists = TRUE;
-      gRootFHandle = FHandle;
-      ConfigNotFound  = FALSE;
-      DBG ("BdsBoot: config's dir: %s\n", gProductNameDir);
-    }
+  NumberVolumes = BdsScanVolumes (&Volumes);
 
-    if ((PNConfigPlist2 != NULL) && (FileExists (FHandle, PNConfigPlist2)) && (ConfigNotFound)) {
-      FreePool (gPNConfigPlist);
+  Vol = BdsFindConfigVolume (Volumes, NumberVolumes, gPNConfigPlist, PNConfigPlist2, &ConfigPath);
+  if (Vol != NULL) {
+    gRootFHandle = Vol->Root;
+    if (ConfigPath == PNConfigPlist2) {
+      if (gPNConfigPlist != NULL) {
+        FreePool (gPNConfigPlist);
+      }
       gPNConfigPlist = PNConfigPlist2;
-      FreePool (gProductNameDir);
+      PNConfigPlist2 = NULL;
+      //
+      // After a first swap both names share one string.
+      //
+      if ((gProductNameDir != NULL) && (gProductNameDir != gProductNameDir2)) {
+        FreePool (gProductNameDir);
+      }
       gProductNameDir = gProductNameDir2;
-
+    }
+    if (ConfigPath == gPNConfigPlist) {
       gPNDirExists = TRUE;
-      gRootFHandle = FHandle;
-      ConfigNotFound  = FALSE;
       DBG ("BdsBoot: config's dir: %s\n", gProductNameDir);
-    }
-    
-    if ((FileExists (FHandle, L"\\EFI\\bareboot\\config.plist")) && (ConfigNotFound)) {
-      gRootFHandle = FHandle;
-      ConfigNotFound  = FALSE;
+    } else {
       DBG ("BdsBoot: config's dir: \\EFI\\bareboot\\ \n");
     }
+  }
+  if (PNConfigPlist2 != NULL) {
+    FreePool (PNConfigPlist2);
+  }
+
+  for (Index = 0; Index < NumberVolumes; Index++) {
+    Vol = &Volumes[Index];
+    if (Vol->Root == NULL) {
+      continue;
+    }
 
-    VolumeName = BdsLibGetVolumeName (FHandle, Index);
+    VolumeName = Vol->VolumeName;
     DBG ("BdsBoot: %d VolumeName: %s\n", Index, VolumeName);
 
     for (Index2 =  0; Index2 < MAX_LOADER_PATHS; Index2++) {
+      if ((Vol->LoaderMask & LShiftU64 (1, Index2)) == 0) {
+        continue;
+      }
       if ((StrCmp (mLoaderPath[Index2], MACOSX_LOADER_PATH) == 0)||
          ((StrCmp (mLoaderPath[Index2], MACOSX_RECOVERY_LOADER_PATH) == 0) &&
           (StrCmp (VolumeName, L"Recovery HD") == 0))) {
-        BdsLibBuildOneOptionFromHandle (FHandle, FileSystemHandles[Index], mLoaderPath[Index2], NULL, VolumeName, BdsBootOptionList, TRUE);
+        BdsLibBuildOneOptionFromHandle (Vol->Handle, mLoaderPath[Index2], NULL, VolumeName, BdsBootOptionList);
       } else if (StrCmp (mLoaderPath[Index2], MACOSX_RECOVERY_LOADER_PATH) == 0) {
-        BdsLibBuildOneOptionFromHandle (FHandle, FileSystemHandles[Index], mLoaderPath[Index2], L"Recovery HD", VolumeName, BdsBootOptionList, TRUE);
+        BdsLibBuildOneOptionFromHandle (Vol->Handle, mLoaderPath[Index2], L"Recovery HD", VolumeName, BdsBootOptionList);
       } else {
-        BdsLibBuildOneOptionFromHandle (FHandle, FileSystemHandles[Index], mLoaderPath[Index2], mLoaderPath[Index2], VolumeName, BdsBootOptionList, TRUE);
+        BdsLibBuildOneOptionFromHandle (Vol->Handle, mLoaderPath[Index2], mLoaderPath[Index2], VolumeName, BdsBootOptionList);
       }
     }
-
-    FreePool (VolumeName);
   }
 
   if (gPNDirExists) {
@@ -27,6 +27,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define EFI_HANDLE_TYPE_CONTROLLER_HANDLE           0x200
 #define EFI_HANDLE_TYPE_CHILD_HANDLE                0x400
 
+BOOLEAN  mConnectDeferred = FALSE;
+
 EFI_STATUS
 ScanDeviceHandles (
   EFI_HANDLE ControllerHandle,
@@ -448,6 +450,49 @@ BdsLibDisconnectAllEfi (
   return EFI_SUCCESS;
 }
 
+/**
+  Connect drivers to one controller and log how long it took, so the
+  MemLog shows which controllers dominate the connect phase.
+
+  @param  Handle                The controller to connect.
+  @param  RemainingDevicePath   Optional child device path to create.
+  @param  Recursive             Connect the whole tree below Handle.
+
+  @return The status of gBS->ConnectController ().
+
+**/
+EFI_STATUS
+ConnectControllerTimed (
+  IN EFI_HANDLE                Handle,
+  IN EFI_DEVICE_PATH_PROTOCOL  *RemainingDevicePath,
+  IN BOOLEAN                   Recursive
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Start;
+  UINT64      Ticks;
+  UINT64      Ms;
+  CHAR16      *DPString;
+
+  DPString = ConvertDevicePathToText (DevicePathFromHandle (Handle), FALSE, FALSE);
+
+  TRACE_BEGIN ("%s", DPString != NULL ? DPString : L"?");
+  Start  = AsmReadTsc ();
+  Status = gBS->ConnectController (Handle, NULL, RemainingDevicePath, Recursive);
+  Ticks  = GetMemLogTscTicksPerSecond ();
+  TRACE_END ();
+  Ms     = 0;
+  if (Ticks != 0) {
+    Ms = DivU64x64Remainder (MultU64x32 (AsmReadTsc () - Start, 1000), Ticks, NULL);
+  }
+
+  DBG ("    BdsConnect: %4ld ms %r %s\n", Ms, Status, DPString != NULL ? DPString : L"?");
+  if (DPString != NULL) {
+    FreePool (DPString);
+  }
+  return Status;
+}
+
 EFI_STATUS
 ConnectEFIDevices (
   VOID
@@ -485,8 +530,7 @@ ConnectEFIDevices (
 
       if (!Parent) {
         if (HandleType[Index] & EFI_HANDLE_TYPE_DEVICE_HANDLE) {
-          Status = gBS->ConnectController(AllHandleBuffer[Index],NULL,NULL,TRUE);
-          DBG ("    BdsConnect: %d. ConnectEFIDevices->ConnectController HandleType = 0x%x\n", Index + 1, HandleType[Index]);
+          Status = ConnectControllerTimed (AllHandleBuffer[Index], NULL, TRUE);
         }
       }
     }
@@ -528,10 +572,96 @@ BdsLibConnectAllDriversToAllControllers (
     // If anything is Dispatched Status == EFI_SUCCESS and we will try
     // the connect again.
     //
+    TRACE_BEGIN ("Dispatch");
     Status = gDS->Dispatch ();
+    TRACE_END ();
+
+  } while (!EFI_ERROR (Status));
+
+}
+
+
+/**
+  Connect only what is needed to find config.plist and the default boot
+  volume: every PCI mass storage controller and the tree below it.
+  USB, network and the rest are left for BdsLibConnectDeferred ().
+  The PCI root bridge and the consoles must already be connected.
+
+**/
+VOID
+EFIAPI
+BdsLibConnectBootDevices (
+  VOID
+  )
+{
+  EFI_STATUS           Status;
+  UINTN                HandleCount;
+  EFI_HANDLE           *HandleBuffer;
+  UINTN                Index;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  UINT8                ClassCode[3];
+
+  do {
+    Status = gBS->LocateHandleBuffer (
+                    ByProtocol,
+                    &gEfiPciIoProtocolGuid,
+                    NULL,
+                    &HandleCount,
+                    &HandleBuffer
+                    );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    for (Index = 0; Index < HandleCount; Index++) {
+      Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiPciIoProtocolGuid, (VOID **) &PciIo);
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+      Status = PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, PCI_CLASSCODE_OFFSET, sizeof (ClassCode), ClassCode);
+      if (EFI_ERROR (Status) || (ClassCode[2] != PCI_CLASS_MASS_STORAGE)) {
+        continue;
+      }
+      ConnectControllerTimed (HandleBuffer[Index], NULL, TRUE);
+    }
 
+    FreePool (HandleBuffer);
+
+    //
+    // A storage driver may only now have been dispatched.
+    //
+    TRACE_BEGIN ("Dispatch");
+    Status = gDS->Dispatch ();
+    TRACE_END ();
   } while (!EFI_ERROR (Status));
 
+  mConnectDeferred = TRUE;
+}
+
+/**
+  Finish a connect started by BdsLibConnectBootDevices ().
+
+  @retval TRUE   Controllers were connected; boot options should be
+                 enumerated again.
+  @retval FALSE  Everything was already connected.
+
+**/
+BOOLEAN
+EFIAPI
+BdsLibConnectDeferred (
+  VOID
+  )
+{
+  if (!mConnectDeferred) {
+    return FALSE;
+  }
+
+  DBG ("BdsConnect: connecting deferred controllers\n");
+  mConnectDeferred = FALSE;
+  TRACE_BEGIN ("ConnectDeferred");
+  BdsLibConnectAllDriversToAllControllers ();
+  TRACE_END ();
+  return TRUE;
 }
 
 
@@ -724,6 +724,43 @@ BdsLibBuildOptionFromVar (
   return EFI_SUCCESS;
 }
 
+/**
+  Free every option in a boot option list built by BdsLibBuildOptionFromVar ()
+  or BdsLibEnumerateAllBootOption () and leave the list empty.
+
+  @param  BdsBootOptionList     The header of the option list to release
+
+**/
+VOID
+EFIAPI
+BdsLibFreeBootOptionList (
+  IN OUT LIST_ENTRY                   *BdsBootOptionList
+  )
+{
+  LIST_ENTRY        *Link;
+  BDS_COMMON_OPTION *Option;
+
+  while (!IsListEmpty (BdsBootOptionList)) {
+    Link   = GetFirstNode (BdsBootOptionList);
+    Option = CR (Link, BDS_COMMON_OPTION, Link, BDS_LOAD_OPTION_SIGNATURE);
+    RemoveEntryList (Link);
+
+    if (Option->DevicePath != NULL) {
+      FreePool (Option->DevicePath);
+    }
+    if (Option->Description != NULL) {
+      FreePool (Option->Description);
+    }
+    if (Option->LoadOptions != NULL) {
+      FreePool (Option->LoadOptions);
+    }
+    if (Option->StatusString != NULL) {
+      FreePool (Option->StatusString);
+    }
+    FreePool (Option);
+  }
+}
+
 /**
   Get boot mode by looking up configuration table and parsing HOB list
 
@@ -0,0 +1,386 @@
+/** @file
+  Volume scan service.
+
+  Every SimpleFileSystem volume is opened and probed once: volume label,
+  bareBoot config.plist locations, nvram.plist and its modification time,
+  and which of the known loader paths exist. Results are cached for boot
+  option enumeration and nvram.plist lookup. Later scans only probe the
+  volumes that appeared since, and drop the ones that are gone.
+
+  Before probing, the first block of every new volume is read through
+  BlockIo2 where the driver supports it. These reads are queued together,
+  so slow USB and optical media spin up in parallel instead of one after
+  another during the file probes.
+
+  A cached entry is only reused while its handle still reports the same
+  BlockIo MediaId; a media change on the same handle gets a fresh probe.
+
+**/
+
+#include "InternalBdsLib.h"
+#include <Protocol/BlockIo2.h>
+
+#define VOLUME_WAKE_TIMEOUT_US  3000000
+#define VOLUME_WAKE_POLL_US     1000
+
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN   Token;
+  VOID                  *Buffer;
+  UINTN                 Pages;
+} VOLUME_WAKE_TASK;
+
+extern CHAR16           *mLoaderPath[];
+extern UINTN            mLoaderPathCount;
+
+STATIC BDS_VOLUME       *mVolumes = NULL;
+STATIC UINTN            mVolumeCount = 0;
+STATIC CHAR16           *mPNConfigPlist[2] = { NULL, NULL };
+
+STATIC
+CHAR16 *
+VolumeConfigPath (
+  IN CHAR16 *Dir
+  )
+{
+  CHAR16 *Path;
+
+  if (Dir == NULL) {
+    return NULL;
+  }
+  Path = AllocateZeroPool (StrSize (Dir) + StrSize (L"config.plist"));
+  if (Path != NULL) {
+    StrCpy (Path, Dir);
+    StrCat (Path, L"config.plist");
+  }
+  return Path;
+}
+
+/**
+  Queues a one block read on every handle that has BlockIo2 with media.
+
+  @param  Handles       SimpleFileSystem handles to wake up.
+  @param  Count         Number of handles.
+
+  @return Array of Count tasks, entries with NULL Token.Event were not queued.
+**/
+STATIC
+VOLUME_WAKE_TASK *
+VolumeWakeStart (
+  IN EFI_HANDLE  *Handles,
+  IN UINTN       Count
+  )
+{
+  EFI_STATUS                Status;
+  EFI_BLOCK_IO2_PROTOCOL    *BlkIo2;
+  VOLUME_WAKE_TASK          *Tasks;
+  UINTN                     Index;
+
+  Tasks = AllocateZeroPool (Count * sizeof (VOLUME_WAKE_TASK));
+  if (Tasks == NULL) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiBlockIo2ProtocolGuid, (VOID **) &BlkIo2);
+    if (EFI_ERROR (Status) || !BlkIo2->Media->MediaPresent || BlkIo2->Media->BlockSize == 0) {
+      continue;
+    }
+    Tasks[Index].Pages = EFI_SIZE_TO_PAGES (BlkIo2->Media->BlockSize);
+    Tasks[Index].Buffer = AllocatePages (Tasks[Index].Pages);
+    if (Tasks[Index].Buffer == NULL) {
+      continue;
+    }
+    Status = gBS->CreateEvent (0, 0, NULL, NULL, &Tasks[Index].Token.Event);
+    if (!EFI_ERROR (Status)) {
+      Status = BlkIo2->ReadBlocksEx (
+                         BlkIo2,
+                         BlkIo2->Media->MediaId,
+                         0,
+                         &Tasks[Index].Token,
+                         BlkIo2->Media->BlockSize,
+                         Tasks[Index].Buffer
+                         );
+      if (EFI_ERROR (Status)) {
+        gBS->CloseEvent (Tasks[Index].Token.Event);
+        Tasks[Index].Token.Event = NULL;
+      }
+    }
+    if (Tasks[Index].Token.Event == NULL) {
+      FreePages (Tasks[Index].Buffer, Tasks[Index].Pages);
+      Tasks[Index].Buffer = NULL;
+    }
+  }
+  return Tasks;
+}
+
+/**
+  Waits for the queued reads, at most VOLUME_WAKE_TIMEOUT_US in total.
+  A read still pending after that keeps its buffer and event, the driver
+  may complete it later.
+**/
+STATIC
+VOID
+VolumeWakeFinish (
+  IN VOLUME_WAKE_TASK  *Tasks,
+  IN UINTN             Count
+  )
+{
+  UINTN   Index;
+  UINTN   Pending;
+  UINTN   Waited;
+
+  if (Tasks == NULL) {
+    return;
+  }
+
+  for (Waited = 0; ; Waited += VOLUME_WAKE_POLL_US) {
+    Pending = 0;
+    for (Index = 0; Index < Count; Index++) {
+      if (Tasks[Index].Token.Event == NULL) {
+        continue;
+      }
+      if (gBS->CheckEvent (Tasks[Index].Token.Event) == EFI_NOT_READY) {
+        Pending++;
+        continue;
+      }
+      gBS->CloseEvent (Tasks[Index].Token.Event);
+      Tasks[Index].Token.Event = NULL;
+      FreePages (Tasks[Index].Buffer, Tasks[Index].Pages);
+    }
+    if (Pending == 0 || Waited >= VOLUME_WAKE_TIMEOUT_US) {
+      break;
+    }
+    gBS->Stall (VOLUME_WAKE_POLL_US);
+  }
+  if (Pending != 0) {
+    DBG ("BdsVolume: %d volumes did not answer in time\n", Pending);
+    return;
+  }
+  FreePool (Tasks);
+}
+
+STATIC
+UINT32
+VolumeMediaId (
+  IN EFI_HANDLE  Handle
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlkIo;
+
+  Status = gBS->HandleProtocol (Handle, &gEfiBlockIoProtocolGuid, (VOID **) &BlkIo);
+  if (EFI_ERROR (Status)) {
+    return 0;
+  }
+  return BlkIo->Media->MediaId;
+}
+
+STATIC
+VOID
+VolumeProbe (
+  IN     EFI_HANDLE  Handle,
+  IN     UINTN       Index,
+  IN OUT BDS_VOLUME  *Vol
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume;
+  EFI_FILE_HANDLE                 File;
+  EFI_FILE_INFO                   *FileInfo;
+  UINTN                           Index2;
+
+  ZeroMem (Vol, sizeof (BDS_VOLUME));
+  Vol->Handle = Handle;
+  Vol->MediaId = VolumeMediaId (Handle);
+
+  Status = gBS->HandleProtocol (Handle, &gEfiSimpleFileSystemProtocolGuid, (VOID *) &Volume);
+  if (!EFI_ERROR (Status)) {
+    Status = Volume->OpenVolume (Volume, &Vol->Root);
+  }
+  if (EFI_ERROR (Status)) {
+    Vol->Root = NULL;
+    return;
+  }
+
+  Vol->VolumeName = BdsLibGetVolumeName (Vol->Root, Index);
+
+  if (mPNConfigPlist[0] != NULL && FileExists (Vol->Root, mPNConfigPlist[0])) {
+    Vol->Flags |= VOLUME_PN_CONFIG;
+  }
+  if (mPNConfigPlist[1] != NULL && FileExists (Vol->Root, mPNConfigPlist[1])) {
+    Vol->Flags |= VOLUME_PN_CONFIG2;
+  }
+  if (FileExists (Vol->Root, L"\\EFI\\bareboot\\config.plist")) {
+    Vol->Flags |= VOLUME_CONFIG;
+  }
+
+  Status = Vol->Root->Open (Vol->Root, &File, L"nvram.plist", EFI_FILE_MODE_READ, 0);
+  if (!EFI_ERROR (Status)) {
+    FileInfo = EfiLibFileInfo (File);
+    File->Close (File);
+    if (FileInfo != NULL) {
+      Vol->Flags |= VOLUME_NVRAM;
+      CopyMem (&Vol->NvramTime, &FileInfo->ModificationTime, sizeof (EFI_TIME));
+      FreePool (FileInfo);
+    }
+  }
+
+  for (Index2 = 0; Index2 < mLoaderPathCount; Index2++) {
+    if (FileExists (Vol->Root, mLoaderPath[Index2])) {
+      Vol->LoaderMask |= LShiftU64 (1, Index2);
+    }
+  }
+
+  DBG ("BdsVolume: %d '%s' flags 0x%x loaders 0x%lx\n", Index, Vol->VolumeName, Vol->Flags, Vol->LoaderMask);
+}
+
+/**
+  Scans all SimpleFileSystem volumes, probing only those not seen before.
+
+  @param  Volumes       Receives the cached volume array, owned by this
+                        module and valid until the next scan.
+
+  @return Number of volumes.
+**/
+UINTN
+EFIAPI
+BdsScanVolumes (
+  OUT BDS_VOLUME  **Volumes
+  )
+{
+  EFI_HANDLE        *Handles;
+  EFI_HANDLE        *NewHandles;
+  UINTN             HandleCount;
+  UINTN             NewCount;
+  UINTN             Index;
+  UINTN             Index2;
+  BDS_VOLUME        *NewVolumes;
+  VOLUME_WAKE_TASK  *Tasks;
+
+  if (mPNConfigPlist[0] == NULL && mPNConfigPlist[1] == NULL) {
+    mPNConfigPlist[0] = VolumeConfigPath (gProductNameDir);
+    mPNConfigPlist[1] = VolumeConfigPath (gProductNameDir2);
+  }
+
+  Handles = NULL;
+  HandleCount = 0;
+  gBS->LocateHandleBuffer (
+         ByProtocol,
+         &gEfiSimpleFileSystemProtocolGuid,
+         NULL,
+         &HandleCount,
+         &Handles
+         );
+
+  NewVolumes = (HandleCount > 0) ? AllocateZeroPool (HandleCount * sizeof (BDS_VOLUME)) : NULL;
+  NewHandles = (HandleCount > 0) ? AllocatePool (HandleCount * sizeof (EFI_HANDLE)) : NULL;
+  if (HandleCount > 0 && (NewVolumes == NULL || NewHandles == NULL)) {
+    if (NewVolumes != NULL) {
+      FreePool (NewVolumes);
+    }
+    if (NewHandles != NULL) {
+      FreePool (NewHandles);
+    }
+    FreePool (Handles);
+    *Volumes = mVolumes;
+    return mVolumeCount;
+  }
+
+  //
+  // Keep what is still there, collect handles to probe
+  //
+  NewCount = 0;
+  for (Index = 0; Index < HandleCount; Index++) {
+    for (Index2 = 0; Index2 < mVolumeCount; Index2++) {
+      if (mVolumes[Index2].Handle == Handles[Index] &&
+          mVolumes[Index2].MediaId == VolumeMediaId (Handles[Index])) {
+        break;
+      }
+    }
+    if (Index2 < mVolumeCount) {
+      CopyMem (&NewVolumes[Index], &mVolumes[Index2], sizeof (BDS_VOLUME));
+      mVolumes[Index2].Handle = NULL;
+    } else {
+      NewHandles[NewCount++] = Handles[Index];
+    }
+  }
+
+  for (Index2 = 0; Index2 < mVolumeCount; Index2++) {
+    if (mVolumes[Index2].Handle != NULL) {
+      if (mVolumes[Index2].Root != NULL) {
+        //
+        // gRootFHandle aliases the root of the config volume; do not leave
+        // it pointing at a closed file.
+        //
+        if (gRootFHandle == mVolumes[Index2].Root) {
+          DBG ("BdsVolume: config volume is gone\n");
+          gRootFHandle = NULL;
+        }
+        mVolumes[Index2].Root->Close (mVolumes[Index2].Root);
+      }
+      if (mVolumes[Index2].VolumeName != NULL) {
+        FreePool (mVolumes[Index2].VolumeName);
+      }
+    }
+  }
+  if (mVolumes != NULL) {
+    FreePool (mVolumes);
+  }
+
+  if (NewCount > 0) {
+    Tasks = VolumeWakeStart (NewHandles, NewCount);
+    VolumeWakeFinish (Tasks, NewCount);
+    for (Index = 0; Index < HandleCount; Index++) {
+      if (NewVolumes[Index].Handle == NULL) {
+        VolumeProbe (Handles[Index], Index, &NewVolumes[Index]);
+      }
+    }
+  }
+
+  if (NewHandles != NULL) {
+    FreePool (NewHandles);
+  }
+  if (Handles != NULL) {
+    FreePool (Handles);
+  }
+  mVolumes = NewVolumes;
+  mVolumeCount = HandleCount;
+  *Volumes = mVolumes;
+  return mVolumeCount;
+}
+
+/**
+  Tells whether a file exists on a scanned volume. Paths probed by the
+  scan are answered from the cache, others are looked up on the volume.
+**/
+BOOLEAN
+EFIAPI
+BdsVolumeFileExists (
+  IN BDS_VOLUME  *Vol,
+  IN CHAR16      *Path
+  )
+{
+  UINTN   Index;
+
+  if (Vol->Root == NULL || Path == NULL) {
+    return FALSE;
+  }
+  if (mPNConfigPlist[0] != NULL && StrCmp (Path, mPNConfigPlist[0]) == 0) {
+    return (Vol->Flags & VOLUME_PN_CONFIG) != 0;
+  }
+  if (mPNConfigPlist[1] != NULL && StrCmp (Path, mPNConfigPlist[1]) == 0) {
+    return (Vol->Flags & VOLUME_PN_CONFIG2) != 0;
+  }
+  if (StrCmp (Path, L"\\EFI\\bareboot\\config.plist") == 0) {
+    return (Vol->Flags & VOLUME_CONFIG) != 0;
+  }
+  if (StrCmp (Path, L"nvram.plist") == 0) {
+    return (Vol->Flags & VOLUME_NVRAM) != 0;
+  }
+  for (Index = 0; Index < mLoaderPathCount; Index++) {
+    if (StrCmp (Path, mLoaderPath[Index]) == 0) {
+      return (Vol->LoaderMask & LShiftU64 (1, Index)) != 0;
+    }
+  }
+  return FileExists (Vol->Root, Path);
+}
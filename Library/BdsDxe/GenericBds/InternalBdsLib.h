@@ -132,4 +132,11 @@ DisableUsbLegacySupport (
   VOID
   );
 
+CHAR16*
+EFIAPI
+BdsLibGetVolumeName (
+  IN EFI_FILE_HANDLE FHandle,
+  IN UINTN Index
+  );
+
 #endif // _BDS_LIB_H_
@@ -288,13 +288,21 @@ OnExitBootServices (
   IN VOID *Context
 )
 {
+  //
+  // Close StartImage, opened in BdsLibBootViaBootOption ()
+  //
+  TRACE_END ();
+  TRACE_BEGIN ("ExitBootServices");
 #ifdef USB_FIXUP
   USBOwnerFix ();
 #endif
   //
   // Patch kernel and kexts if needed
   //
+  TRACE_BEGIN ("KernelAndKextsPatcher");
   KernelAndKextsPatcherStart ();
+  TRACE_END ();
+  TRACE_END ();
   
 #ifdef BOOT_DEBUG
   EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
@@ -350,6 +358,7 @@ OnExitBootServices (
   DBG ("%a: Finished.\n", __FUNCTION__);
   if (FHandle != NULL) {
     Status = SaveBooterLog (FHandle, L"EFI\\bareboot\\ext_boot.log");
+    Status = SaveBooterTrace (FHandle, BOOT_TRACE);
     FHandle->Close (FHandle);
   }
 #endif
@@ -40,6 +40,8 @@ struct _APPLE_GETVAR_PROTOCOL {
 };
 
 CHAR8                           *gDevProp = NULL;
+UINT8                           *gDevPropData = NULL;
+UINT32                          gDevPropDataLen = 0;
 CHAR8                           *cDevProp = NULL;
 
 
@@ -62,15 +64,10 @@ GetDeviceProps (
       CopyMem (Buffer, binStr,  cnt);
       return EFI_SUCCESS;
     }
-  } else if ((gDevProp != NULL) && AsciiStrLen (gDevProp) > 3) {
-    cnt = (UINT32) AsciiStrLen (gDevProp) / 2;
-    binStr = AllocateZeroPool (cnt);
-
-    if (hex2bin (gDevProp, binStr, cnt)) {
-      *BufferSize = cnt;
-      CopyMem (Buffer, binStr,  cnt);
-      return EFI_SUCCESS;
-    }
+  } else if (gDevPropData != NULL) {
+    *BufferSize = gDevPropDataLen;
+    CopyMem (Buffer, gDevPropData, gDevPropDataLen);
+    return EFI_SUCCESS;
   }
 
   *BufferSize = 0;
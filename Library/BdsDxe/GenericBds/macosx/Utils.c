@@ -658,6 +658,32 @@ SaveBooterLog (
   return egSaveFile (BaseDir, FileName, (UINT8 *) MemLogBuffer, MemLogLen);
 }
 
+EFI_STATUS
+SaveBooterTrace (
+  IN EFI_FILE_HANDLE BaseDir,
+  IN CHAR16 *FileName
+)
+{
+  CHAR8 *Trace;
+  UINTN TraceLen;
+  EFI_STATUS Status;
+
+  TraceLen = MemLogTraceExport (NULL, 0);
+  if (TraceLen == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  Trace = AllocatePool (TraceLen + 1);
+  if (Trace == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  TraceLen = MemLogTraceExport (Trace, TraceLen + 1);
+  Status = egSaveFile (BaseDir, FileName, (UINT8 *) Trace, TraceLen);
+  FreePool (Trace);
+  return Status;
+}
+
 EFI_STATUS
 InitializeUnicodeCollationProtocol (
   VOID
@@ -1236,6 +1262,116 @@ LoadPListFile (
   return plist;
 }
 
+//
+// config.plist has a binary cache next to it (config.plist.cache), stamped
+// with size and modification time of the plist. While the stamp matches,
+// the cache is loaded instead of parsing XML; otherwise the plist is parsed
+// and the cache is written again. Host tool: Library/PListLib/plcache.c.
+//
+VOID *
+LoadConfigPlist (
+  IN EFI_FILE * RootFileHandle,
+  IN CHAR16 *XmlPlistPath
+)
+{
+  EFI_STATUS Status;
+  EFI_FILE_HANDLE FileHandle;
+  EFI_FILE_INFO *FileInfo;
+  CHAR16 *CachePath;
+  UINT32 SrcLen;
+  INT64 SrcTime;
+  UINTN Size;
+  plbuf_t cbuf;
+  VOID *plist;
+
+  if (RootFileHandle == NULL) {
+    return NULL;
+  }
+
+  Status =
+    RootFileHandle->Open (RootFileHandle, &FileHandle, XmlPlistPath,
+                          EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+  FileInfo = EfiLibFileInfo (FileHandle);
+  FileHandle->Close (FileHandle);
+  if (FileInfo == NULL) {
+    return NULL;
+  }
+  SrcLen = (UINT32) FileInfo->FileSize;
+  SrcTime = PL_BIN_TIME (FileInfo->ModificationTime.Year,
+                         FileInfo->ModificationTime.Month,
+                         FileInfo->ModificationTime.Day,
+                         FileInfo->ModificationTime.Hour,
+                         FileInfo->ModificationTime.Minute,
+                         FileInfo->ModificationTime.Second);
+  FreePool (FileInfo);
+
+  CachePath = AllocateZeroPool (StrSize (XmlPlistPath) + StrSize (L".cache"));
+  if (CachePath == NULL) {
+    return LoadPListFile (RootFileHandle, XmlPlistPath);
+  }
+  StrCpy (CachePath, XmlPlistPath);
+  StrCat (CachePath, L".cache");
+
+  Status = egLoadFile (RootFileHandle, CachePath, (UINT8 **) &cbuf.dat, &Size);
+  if (!EFI_ERROR (Status)) {
+    cbuf.len = (unsigned int) Size;
+    cbuf.pos = 0;
+    plist = plBinToNode (&cbuf, SrcLen, SrcTime);
+    FreeAlignedPages (cbuf.dat, EFI_SIZE_TO_PAGES (Size));
+    if (plist != NULL) {
+      DBG ("%a: %s loaded\n", __FUNCTION__, CachePath);
+      FreePool (CachePath);
+      return plist;
+    }
+  }
+
+  plist = LoadPListFile (RootFileHandle, XmlPlistPath);
+  if (plist != NULL) {
+    cbuf.dat = NULL;
+    cbuf.len = 0;
+    cbuf.pos = 0;
+    plNodeToBin (plist, SrcLen, SrcTime, &cbuf);
+    cbuf.len = cbuf.pos;
+    cbuf.pos = 0;
+    cbuf.dat = AllocatePool (cbuf.len);
+    if (cbuf.dat != NULL) {
+      if (plNodeToBin (plist, SrcLen, SrcTime, &cbuf)) {
+        Status = egSaveFile (RootFileHandle, CachePath, (UINT8 *) cbuf.dat, cbuf.pos);
+        DBG ("%a: %s saved, %r\n", __FUNCTION__, CachePath, Status);
+      }
+      FreePool (cbuf.dat);
+    }
+  }
+  FreePool (CachePath);
+  return plist;
+}
+
+// ----============================----
+BOOLEAN
+GetLazyConnect (
+  IN EFI_FILE * RootFileHandle,
+  IN CHAR16 *XmlPlistPath
+)
+{
+  VOID *plist;
+  BOOLEAN LazyConnect;
+
+  plist = LoadConfigPlist (RootFileHandle, XmlPlistPath);
+  if (plist == NULL) {
+    return FALSE;
+  }
+  LazyConnect = GetBoolProperty (
+                  plDictFind (plist, "SystemParameters", 16, plKindDict),
+                  "LazyConnect",
+                  FALSE
+                  );
+  plNodeDelete (plist);
+  return LazyConnect;
+}
+
 // ----============================----
 EFI_STATUS
 GetBootDefault (
@@ -1246,13 +1382,20 @@ GetBootDefault (
 
   ZeroMem (gSettings.DefaultBoot, sizeof (gSettings.DefaultBoot));
 
+  if (gConfigPlist != NULL) {
+    plNodeDelete (gConfigPlist);
+    gConfigPlist = NULL;
+  }
+
+  TRACE_BEGIN ("LoadConfigPlist");
   if (gPNDirExists) {
-    gConfigPlist = LoadPListFile (RootFileHandle, gPNConfigPlist);
+    gConfigPlist = LoadConfigPlist (RootFileHandle, gPNConfigPlist);
   }
   else {
     gConfigPlist =
-      LoadPListFile (RootFileHandle, L"\\EFI\\bareboot\\config.plist");
+      LoadConfigPlist (RootFileHandle, L"\\EFI\\bareboot\\config.plist");
   }
+  TRACE_END ();
 
   if (gConfigPlist == NULL) {
     Print (L"Error loading bootdefault plist!\r\n");
@@ -1269,6 +1412,7 @@ GetBootDefault (
   gSettings.ScreenMode = (UINT32) GetNumProperty (spdict, "ScreenMode", 0xffff);
   gSettings.BootTimeout = (UINT16) GetNumProperty (spdict, "Timeout", 0);
   gSettings.YoBlack = GetBoolProperty (spdict, "YoBlack", FALSE);
+  gSettings.ImageCache = GetBoolProperty (spdict, "ImageCache", FALSE);
 
   if (!GetUnicodeProperty (spdict, "DefaultBootVolume", gSettings.DefaultBoot)) {
     gSettings.BootTimeout = 0xFFFF;
@@ -1754,6 +1898,7 @@ GetUserSettings (
   }
 
   plNodeDelete (gConfigPlist);
+  gConfigPlist = NULL;
 
   return Status;
 }
@@ -17,8 +17,6 @@
 UINT32 devices_number = 1;
 UINT32 builtin_set = 0;
 DevPropString *string = NULL;
-UINT8 *stringdata = NULL;
-UINT32 stringlength = 0;
 
 #if 0
 EFI_EDID_DISCOVERED_PROTOCOL *EdidDiscovered;
@@ -219,12 +217,10 @@ devprop_add_value (
 )
 {
   UINT32 offset;
-  UINT32 off;
   UINT32 length;
+  UINT32 capacity;
   UINT8 *data;
   UINTN i, l;
-  UINT32 *datalength;
-  UINT8 *newdata;
 
   if (device == NULL || nm == NULL || vl == NULL || len == 0) {
     return FALSE;
@@ -232,118 +228,138 @@ devprop_add_value (
 
   l = AsciiStrLen (nm);
   length = (UINT32) (((l * 2) + len + (2 * sizeof (UINT32)) + 2));
-  data = (UINT8 *) AllocateZeroPool (length);
-
-  if (data == NULL) {
-    return FALSE;
-  }
-
-  off = 0;
-  data[off + 1] = (UINT8) (((l * 2) + 6) >> 8);
-  data[off] = ((l * 2) + 6) & 0x00FF;
-  off += 4;
-
-  for (i = 0; i < l; i++, off += 2) {
-    data[off] = *nm++;
-  }
-
-  off += 2;
-  l = len;
-  datalength = (UINT32 *) &data[off];
-  *datalength = (UINT32) (l + 4);
-  off += 4;
+  offset = device->length - (24 + (6 * device->num_pci_devpaths));
 
-  for (i = 0; i < l; i++, off++) {
-    data[off] = *vl++;
+  //
+  // Grow the property data by doubling, so adding n values copies
+  // O(n) bytes in total
+  //
+  if (offset + length > device->capacity) {
+    capacity = device->capacity == 0 ? 256 : device->capacity;
+    while (offset + length > capacity) {
+      capacity *= 2;
+    }
+    data = (UINT8 *) ReallocatePool (device->capacity, capacity, device->data);
+    if (data == NULL) {
+      return FALSE;
+    }
+    device->data = data;
+    device->capacity = capacity;
   }
 
-  offset = device->length - (24 + (6 * device->num_pci_devpaths));
-  newdata = (UINT8 *) AllocateZeroPool ((length + offset));
+  //
+  // name: UINT32 size, UTF-16 name with terminator; value: UINT32 size, bytes
+  //
+  data = device->data + offset;
+  ZeroMem (data, length);
+  WriteUnaligned32 ((UINT32 *) data, (UINT32) ((l * 2) + 6));
+  data += 4;
 
-  if (newdata == NULL) {
-    return FALSE;
+  for (i = 0; i < l; i++, data += 2) {
+    *data = *nm++;
   }
 
-  if ((device->data) && (offset > 1)) {
-    CopyMem ((VOID *) newdata, (VOID *) device->data, offset);
-  }
+  data += 2;
+  WriteUnaligned32 ((UINT32 *) data, len + 4);
+  data += 4;
+  CopyMem (data, vl, len);
 
-  CopyMem ((VOID *) (newdata + offset), (VOID *) data, length);
   device->length += length;
   device->string->length += length;
   device->numentries++;
-  device->data = newdata;
-  FreePool (data);
   return TRUE;
 }
 
+/**
+  Store the device-properties blob in pstring->length bytes at buffer,
+  in the layout AppleEFI hands to the kernel.
+**/
+VOID
+devprop_generate_binary (
+  DevPropString * pstring,
+  UINT8 *buffer
+)
+{
+  DevPropDevice *device;
+  INT32 i, x;
+  UINT32 datalen;
+
+  WriteUnaligned32 ((UINT32 *) buffer, pstring->length);
+  WriteUnaligned32 ((UINT32 *) (buffer + 4), SwapBytes32 (pstring->WHAT2));
+  WriteUnaligned16 ((UINT16 *) (buffer + 8), pstring->numentries);
+  WriteUnaligned16 ((UINT16 *) (buffer + 10), SwapBytes16 (pstring->WHAT3));
+  buffer += 12;
+
+  for (i = 0; i < pstring->numentries; i++) {
+    device = pstring->entries[i];
+
+    WriteUnaligned32 ((UINT32 *) buffer, device->length);
+    WriteUnaligned16 ((UINT16 *) (buffer + 4), device->numentries);
+    WriteUnaligned16 ((UINT16 *) (buffer + 6), SwapBytes16 (device->WHAT2));
+    buffer += 8;
+
+    buffer[0] = device->acpi_dev_path.type;
+    buffer[1] = device->acpi_dev_path.subtype;
+    WriteUnaligned16 ((UINT16 *) (buffer + 2), device->acpi_dev_path.length);
+    WriteUnaligned32 ((UINT32 *) (buffer + 4), SwapBytes32 (device->acpi_dev_path._HID));
+    WriteUnaligned32 ((UINT32 *) (buffer + 8), device->acpi_dev_path._UID);
+    buffer += 12;
+
+    for (x = 0; x < device->num_pci_devpaths; x++) {
+      buffer[0] = device->pci_dev_path[x].type;
+      buffer[1] = device->pci_dev_path[x].subtype;
+      WriteUnaligned16 ((UINT16 *) (buffer + 2), device->pci_dev_path[x].length);
+      buffer[4] = device->pci_dev_path[x].function;
+      buffer[5] = device->pci_dev_path[x].device;
+      buffer += 6;
+    }
+
+    buffer[0] = device->path_end.type;
+    buffer[1] = device->path_end.subtype;
+    WriteUnaligned16 ((UINT16 *) (buffer + 2), device->path_end.length);
+    buffer += 4;
+
+    datalen = device->length - (24 + (6 * device->num_pci_devpaths));
+    if (datalen != 0) {
+      CopyMem (buffer, device->data, datalen);
+      buffer += datalen;
+    }
+  }
+}
+
 CHAR8 *
 devprop_generate_string (
   DevPropString * pstring
 )
 {
-  UINTN len;
-  INT32 i, x;
+  STATIC CONST CHAR8 hex[] = "0123456789abcdef";
+  UINT8 *bin;
   CHAR8 *buffer;
-  CHAR8 *ptr;
+  UINT32 i;
 
-  len = pstring->length * 2;
-  i = 0;
-  x = 0;
-  buffer = (CHAR8 *) AllocatePool (len + 1);
-  ptr = buffer;
+  buffer = (CHAR8 *) AllocatePool (pstring->length * 2 + 1);
+  bin = (UINT8 *) AllocatePool (pstring->length);
 
-  if (buffer == NULL) {
+  if (buffer == NULL || bin == NULL) {
+    if (buffer != NULL) {
+      FreePool (buffer);
+    }
+    if (bin != NULL) {
+      FreePool (bin);
+    }
     return NULL;
   }
 
-  AsciiSPrint (buffer, len, "%08x%08x%04x%04x", SwapBytes32 (pstring->length),
-               pstring->WHAT2, SwapBytes16 (pstring->numentries),
-               pstring->WHAT3);
-  buffer += 24;
-
-  while (i < pstring->numentries) {
-    UINT8 *dataptr;
-
-    AsciiSPrint (buffer, len, "%08x%04x%04x", SwapBytes32 (pstring->entries[i]->length), SwapBytes16 (pstring->entries[i]->numentries), pstring->entries[i]->WHAT2);  //FIXME: wrong buffer sizes!
-    buffer += 16;
-    AsciiSPrint (buffer, len, "%02x%02x%04x%08x%08x",
-                 pstring->entries[i]->acpi_dev_path.type,
-                 pstring->entries[i]->acpi_dev_path.subtype,
-                 SwapBytes16 (pstring->entries[i]->acpi_dev_path.length),
-                 pstring->entries[i]->acpi_dev_path._HID,
-                 SwapBytes32 (pstring->entries[i]->acpi_dev_path._UID));
-    buffer += 24;
-
-    for (x = 0; x < pstring->entries[i]->num_pci_devpaths; x++) {
-      AsciiSPrint (buffer, len, "%02x%02x%04x%02x%02x",
-                   pstring->entries[i]->pci_dev_path[x].type,
-                   pstring->entries[i]->pci_dev_path[x].subtype,
-                   SwapBytes16 (pstring->entries[i]->pci_dev_path[x].length),
-                   pstring->entries[i]->pci_dev_path[x].function,
-                   pstring->entries[i]->pci_dev_path[x].device);
-      buffer += 12;
-    }
+  devprop_generate_binary (pstring, bin);
 
-    AsciiSPrint (buffer, len, "%02x%02x%04x",
-                 pstring->entries[i]->path_end.type,
-                 pstring->entries[i]->path_end.subtype,
-                 SwapBytes16 (pstring->entries[i]->path_end.length));
-    buffer += 8;
-    dataptr = pstring->entries[i]->data;
-
-    for (x = 0;
-         x <
-         (INT32) ((pstring->entries[i]->length) -
-                  (24 + (6 * pstring->entries[i]->num_pci_devpaths))); x++) {
-      AsciiSPrint (buffer, len, "%02x", *dataptr++);
-      buffer += 2;
-    }
-
-    i++;
+  for (i = 0; i < pstring->length; i++) {
+    buffer[i * 2] = hex[bin[i] >> 4];
+    buffer[i * 2 + 1] = hex[bin[i] & 0x0f];
   }
+  buffer[pstring->length * 2] = '\0';
 
-  return ptr;
+  FreePool (bin);
+  return buffer;
 }
 
 VOID
@@ -2378,10 +2394,12 @@ SetDevices (
   }
 
   if (StringDirty) {
-    stringlength = string->length * 2;
-    gDevProp = AllocateAlignedPages (EFI_SIZE_TO_PAGES (stringlength + 1), 64);
-    CopyMem (gDevProp, (VOID *) devprop_generate_string (string), stringlength);
-    gDevProp[stringlength] = 0;
+    gDevPropDataLen = string->length;
+    gDevPropData = AllocatePool (gDevPropDataLen);
+    if (gDevPropData != NULL) {
+      devprop_generate_binary (string, gDevPropData);
+    }
+    gDevProp = devprop_generate_string (string);
     StringDirty = FALSE;
     DBG ("Device Inject: gDevProp = <%a>\n", gDevProp);
   }
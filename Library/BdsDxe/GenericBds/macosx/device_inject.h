@@ -123,6 +123,7 @@ struct DevPropDevice {
   struct PCIDevPath pci_dev_path[MAX_PCI_DEV_PATHS];  // = 0x01010600 func dev
   struct DevicePathEnd path_end;  // = 0x7fff0400
   UINT8 *data;
+  UINT32 capacity;              // allocated size of data
 
   UINT8 num_pci_devpaths;
   struct DevPropString *string;
@@ -159,6 +160,12 @@ BOOLEAN
   UINT32 len
 );
 
+VOID
+  devprop_generate_binary (
+  DevPropString * string,
+  UINT8 *buffer
+);
+
 CHAR8 *devprop_generate_string (
   DevPropString * string
 );
@@ -28,6 +28,7 @@ UINT32                  KernelSlide     = 0;
 BOOLEAN                 isKernelcache   = FALSE;
 BOOLEAN                 is64BitKernel   = FALSE;
 BOOLEAN                 PatcherInited   = FALSE;
+UINT32                  KernelSize      = 0;
 BOOLEAN                 SSSE3;
 
 // notes:
@@ -220,6 +221,83 @@ GetSection (
   return;
 }
 
+//
+// Size of the loaded kernel image: from the start of __TEXT (the Mach-O
+// header at KernelData) to the end of the last segment, including the
+// prelinked kexts of a kernelcache. Capped at KERNEL_MAX_SIZE, which is
+// also returned when the load commands give nothing usable.
+//
+UINT32
+GetKernelImageSize (
+  VOID
+)
+{
+  UINT32  ncmds;
+  UINT32  cmdsize;
+  UINT32  binaryIndex;
+  UINTN   cnt;
+  UINT8   *binary;
+  UINT64  Base;
+  UINT64  End;
+  UINT64  SegStart;
+  UINT64  SegSize;
+
+  struct load_command         *loadCommand;
+  struct segment_command      *segCmd;
+  struct segment_command_64   *segCmd64;
+
+  binary = (UINT8 *) KernelData;
+
+  if (is64BitKernel) {
+    binaryIndex = sizeof (struct mach_header_64);
+  } else {
+    binaryIndex = sizeof (struct mach_header);
+  }
+
+  ncmds = MACH_GET_NCMDS (binary);
+  Base  = 0;
+  End   = 0;
+
+  for (cnt = 0; cnt < ncmds; cnt++) {
+    loadCommand = (struct load_command *) (binary + binaryIndex);
+    cmdsize = loadCommand->cmdsize;
+    SegStart = 0;
+    SegSize  = 0;
+
+    switch (loadCommand->cmd) {
+      case LC_SEGMENT_64:
+        segCmd64 = (struct segment_command_64 *) loadCommand;
+        if (AsciiStrCmp (segCmd64->segname, "__TEXT") == 0) {
+          Base = segCmd64->vmaddr;
+        }
+        SegStart = segCmd64->vmaddr;
+        SegSize  = segCmd64->vmsize;
+        break;
+
+      case LC_SEGMENT:
+        segCmd = (struct segment_command *) loadCommand;
+        if (AsciiStrCmp (segCmd->segname, "__TEXT") == 0) {
+          Base = segCmd->vmaddr;
+        }
+        SegStart = segCmd->vmaddr;
+        SegSize  = segCmd->vmsize;
+        break;
+
+      default:
+        break;
+    }
+    if (SegStart != 0 && SegStart + SegSize > End) {
+      End = SegStart + SegSize;
+    }
+    binaryIndex += cmdsize;
+  }
+
+  if (Base == 0 || End <= Base || End - Base > KERNEL_MAX_SIZE) {
+    return KERNEL_MAX_SIZE;
+  }
+  return (UINT32) (End - Base);
+}
+
 CHAR8*
 GetKernelVersion (
   VOID
@@ -1336,6 +1414,8 @@ KernelAndKextPatcherInit (
 #endif
 
   isKernelcache = PrelinkTextSize > 0 && PrelinkInfoSize > 0;
+  KernelSize = GetKernelImageSize ();
+  DBG ("%a: KernelSize = 0x%x\n", __FUNCTION__, KernelSize);
 
   DBG ("%a: OSVersion = %a\n", __FUNCTION__, OSVersion);
   KernVersion = GetKernelVersion ();
@@ -1356,11 +1436,25 @@ AnyKernelPatch (
 {
   UINTN   Num = 0, i;
 
-  for (i = 0; i < gSettings.NrKernel; i++) {
+  //
+  // The matcher only exists when no two kernel patches overlap, so one
+  // pass over the loaded image gives the sequential result.
+  //
+  if (gKernelPatchMatcher != NULL) {
+    Num = PatchMatcherApply (gKernelPatchMatcher, Kernel, KernelSize, NULL);
+    for (i = 0; i < gKernelPatchMatcher->PatternCount; i++) {
+      if (gKernelPatchMatcher->Length[i] > 0) {
+        DBG ("%a: patch #%ld applied %ld times\n", __FUNCTION__, (UINT64) (i + 1), (UINT64) gKernelPatchMatcher->Hits[i]);
+      }
+    }
+    return;
+  }
+
+  for (i = 0; i < gSettings.NrKernel && i < PATCH_TABLE_MAX; i++) {
     if (gSettings.AnyKernelData[i] > 0) {
       Num = SearchAndReplace (
               Kernel,
-              KERNEL_MAX_SIZE,
+              KernelSize,
               gSettings.AnyKernelData[i],
               gSettings.AnyKernelDataLen[i],
               gSettings.AnyKernelPatch[i],
@@ -1424,10 +1518,15 @@ KernelAndKextsPatcherStart (
   }
 
   if (gSettings.CheckFakeSMC && PrelinkInfoAddr != 0) {
-    if (SearchMemory ((CHAR8 *) (UINTN) PrelinkInfoAddr, PrelinkInfoSize,
-                        "<string>org.netkas.driver.FakeSMC</string>", 42) != NULL ||
-        SearchMemory ((CHAR8 *) (UINTN) PrelinkInfoAddr, PrelinkInfoSize,
-                        "<string>org.netkas.FakeSMC</string>", 35) != NULL) {
+    if (PrelinkedKextsIndex () == EFI_SUCCESS) {
+      if (PrelinkedKextFind ("org.netkas.driver.FakeSMC") != NULL ||
+          PrelinkedKextFind ("org.netkas.FakeSMC") != NULL) {
+        WithKexts = FALSE;
+      }
+    } else if (SearchMemory ((CHAR8 *) (UINTN) PrelinkInfoAddr, PrelinkInfoSize,
+                             "<string>org.netkas.driver.FakeSMC</string>", 42) != NULL ||
+               SearchMemory ((CHAR8 *) (UINTN) PrelinkInfoAddr, PrelinkInfoSize,
+                             "<string>org.netkas.FakeSMC</string>", 35) != NULL) {
       WithKexts = FALSE;
     }
   }
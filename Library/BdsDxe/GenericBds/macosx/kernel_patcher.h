@@ -80,6 +80,7 @@ extern VOID         *KernelData;
 extern UINT32       KernelSlide;
 extern BOOLEAN      isKernelcache;
 extern BOOLEAN      is64BitKernel;
+extern BOOLEAN      PatcherInited;
 
 // notes:
 // - 64bit segCmd64->vmaddr is 0xffffff80xxxxxxxx and we are taking
@@ -179,4 +180,145 @@ SearchAndReplace (
   INTN    MaxReplaces
 );
 
+//
+// Entries in the KernelPatches and KextPatches tables of SETTINGS_DATA.
+//
+#define PATCH_TABLE_MAX 100
+
+//
+// Multi-pattern matcher for a patch table, see PatchMatcherCreate().
+// Next is the full transition table, StateCount rows of 256 entries.
+// Output holds pattern index + 1 of a pattern ending in a state, further
+// ones are chained through PatternNext. OutputLink points to the nearest
+// suffix state that has an output. Conflict is a PatternCount square
+// matrix, non zero for two patches whose bytes can overlap.
+//
+typedef struct {
+  UINTN   PatternCount;
+  UINTN   StateCount;
+  UINTN   MaxReplaces;
+  UINTN   *Length;
+  UINTN   *Hits;
+  UINTN   *SkipTo;
+  UINT8   **Find;
+  UINT8   **Replace;
+  UINT16  *PatternNext;
+  UINT16  *Next;
+  UINT16  *Output;
+  UINT16  *OutputLink;
+  UINT8   *Conflict;
+} PATCH_MATCHER;
+
+extern PATCH_MATCHER  *gKernelPatchMatcher;
+extern PATCH_MATCHER  *gKextPatchMatcher;
+extern PATCH_MATCHER  *gKextPlistPatchMatcher;
+
+//
+// Builds a matcher for Count patches, NULL if nothing can be matched.
+//
+PATCH_MATCHER *
+PatchMatcherCreate (
+  CHAR8   **Find,
+  CHAR8   **Replace,
+  UINTN   *Length,
+  UINTN   Count,
+  INTN    MaxReplaces
+);
+
+VOID
+PatchMatcherFree (
+  PATCH_MATCHER   *Matcher
+);
+
+//
+// TRUE if two enabled patches conflict, PatchMatcherApply() would then
+// differ from applying them one by one.
+//
+BOOLEAN
+PatchMatcherConflicts (
+  PATCH_MATCHER   *Matcher,
+  BOOLEAN         *Enabled
+);
+
+//
+// Applies all enabled patches to Source in one pass.
+// Returns number of replaces done, per patch counts are in Matcher->Hits.
+//
+UINTN
+PatchMatcherApply (
+  PATCH_MATCHER   *Matcher,
+  UINT8           *Source,
+  UINT32          SourceSize,
+  BOOLEAN         *Enabled
+);
+
+//
+// Kext from PrelinkInfo, offsets are relative to PrelinkInfoAddr.
+// InfoPlist spans from <dict> to </dict> of kext Info.plist.
+//
+typedef struct {
+  UINT32  InfoPlistOffset;
+  UINT32  InfoPlistSize;
+  UINT32  BundleIdOffset;
+  UINT32  BundleIdLength;
+  UINT64  ExecutableSourceAddr;
+  UINT64  ExecutableSize;
+} PRELINKED_KEXT;
+
+#define PRELINKED_KEXTS_MAX        1024
+#define PRELINK_IDREFS_PER_KEXT    3
+
+#define PRELINK_FIELD_NONE         0
+#define PRELINK_FIELD_BUNDLE_ID    1
+#define PRELINK_FIELD_SOURCE_ADDR  2
+#define PRELINK_FIELD_SIZE         3
+
+//
+// Value of PRELINKED_KEXT Field given as <... IDREF="Id"/>
+//
+typedef struct {
+  UINT32  Id;
+  UINT32  Kext;
+  UINT32  Field;
+} PRELINK_IDREF;
+
+extern PRELINKED_KEXT *gPrelinkedKexts;
+extern UINTN          gPrelinkedKextCount;
+
+//
+// Reserves storage for the index, must be called before ExitBootServices().
+//
+VOID
+PrelinkedKextsReserve (
+  VOID
+);
+
+//
+// Drops the index of the previous kernel, called for every boot.
+//
+VOID
+PrelinkedKextsReset (
+  VOID
+);
+
+//
+// Builds index of kexts in PrelinkInfo on first call after reset.
+// Returns EFI_NOT_READY if there is no storage or PrelinkInfo,
+// EFI_BUFFER_TOO_SMALL if only first PRELINKED_KEXTS_MAX kexts are indexed.
+// Callers must not rely on an incomplete index, PatchPrelinkedKexts()
+// then indexes and patches the rest PRELINKED_KEXTS_MAX kexts at a time.
+//
+EFI_STATUS
+PrelinkedKextsIndex (
+  VOID
+);
+
+//
+// Returns indexed kext with given BundleId or NULL.
+//
+PRELINKED_KEXT *
+PrelinkedKextFind (
+  CHAR8   *BundleId
+);
+
 #endif /* !__LIBSAIO_KERNEL_PATCHER_H */
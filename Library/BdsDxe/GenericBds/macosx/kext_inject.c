@@ -75,108 +75,186 @@ ThinFatFile (
   return EFI_SUCCESS;
 }
 
+//
+// Finds thin slice for archCpuType in executable FileName.
+// Only the fat header is read, the slice is read later by LoadKextsArena().
+//
+EFI_STATUS
+  EFIAPI
+GetKextExecutableSlice (
+  IN CHAR16 *FileName,
+  IN cpu_type_t archCpuType,
+  OUT UINT32 *Offset,
+  OUT UINT32 *Length
+)
+{
+  EFI_STATUS Status;
+  EFI_FILE_HANDLE FileHandle;
+  EFI_FILE_INFO *FileInfo;
+  UINT64 FileSize;
+  UINT8 Header[1024];
+  UINTN HeaderLength;
+  UINT8 *Binary;
+  UINTN BinaryLength;
+  UINT32 nfat;
+
+  Status = gRootFHandle->Open (gRootFHandle, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  FileInfo = EfiLibFileInfo (FileHandle);
+  if (FileInfo == NULL) {
+    FileHandle->Close (FileHandle);
+    return EFI_NOT_FOUND;
+  }
+  FileSize = FileInfo->FileSize;
+  FreePool (FileInfo);
+
+  ZeroMem (Header, sizeof (Header));
+  HeaderLength = (UINTN) MIN (FileSize, sizeof (Header));
+  Status = FileHandle->Read (FileHandle, &HeaderLength, Header);
+  FileHandle->Close (FileHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  nfat = 0;
+  if (((FAT_HEADER *) Header)->magic == FAT_MAGIC) {
+    nfat = ((FAT_HEADER *) Header)->nfat_arch;
+  }
+  else if (((FAT_HEADER *) Header)->magic == FAT_CIGAM) {
+    nfat = SwapBytes32 (((FAT_HEADER *) Header)->nfat_arch);
+  }
+  if (nfat > (HeaderLength - sizeof (FAT_HEADER)) / sizeof (FAT_ARCH)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Binary = Header;
+  BinaryLength = (UINTN) FileSize;
+  Status = ThinFatFile (&Binary, &BinaryLength, archCpuType);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if ((UINT64) (Binary - Header) + BinaryLength > FileSize) {
+    return EFI_LOAD_ERROR;
+  }
+
+  *Offset = (UINT32) (Binary - Header);
+  *Length = (UINT32) BinaryLength;
+  return EFI_SUCCESS;
+}
+
+//
+// Reads Length bytes from Offset of FileName into Buffer.
+//
+EFI_STATUS
+  EFIAPI
+ReadKextFile (
+  IN CHAR16 *FileName,
+  IN UINT32 Offset,
+  IN UINT32 Length,
+  OUT VOID *Buffer
+)
+{
+  EFI_STATUS Status;
+  EFI_FILE_HANDLE FileHandle;
+  UINTN ReadLength;
+
+  Status = gRootFHandle->Open (gRootFHandle, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ReadLength = Length;
+  Status = FileHandle->SetPosition (FileHandle, Offset);
+  if (!EFI_ERROR (Status)) {
+    Status = FileHandle->Read (FileHandle, &ReadLength, Buffer);
+  }
+  FileHandle->Close (FileHandle);
+
+  if (!EFI_ERROR (Status) && ReadLength != Length) {
+    Status = EFI_END_OF_FILE;
+  }
+  return Status;
+}
+
+//
+// Reads kext Info.plist and locates its executable slice.
+// Info.plist is read and parsed once, the executable is not read here,
+// LoadKextsArena() reads it directly into its final place.
+//
 EFI_STATUS
   EFIAPI
 LoadKext (
   IN CHAR16 *FileName,
   IN cpu_type_t archCpuType,
-  IN OUT _DeviceTreeBuffer * kext
+  IN OUT KEXT_ENTRY *KextEntry
 )
 {
   EFI_STATUS Status;
-  UINT8 *executableFatBuffer = NULL;
-  UINTN executableFatBufferLength = 0;
-  UINT8 *executableBuffer = NULL;
-  UINTN executableBufferLength = 0;
-  CHAR8 *bundlePathBuffer = NULL;
-  UINTN bundlePathBufferLength = 0;
   CHAR16 TempName[256];
   CHAR16 Executable[256];
   VOID *plist;
+  plbuf_t pbuf;
   BOOLEAN NoContents = FALSE;
-  _BooterKextFileInfo *infoAddr = NULL;
 
-  UINT8 *infoDictBuffer = NULL;
-  UINTN infoDictBufferLength = 0;
+  KextEntry->InfoPlist = NULL;
+  KextEntry->InfoPlistLength = 0;
+  KextEntry->Executable[0] = L'\0';
+  KextEntry->ExecutableOffset = 0;
+  KextEntry->ExecutableLength = 0;
 
   UnicodeSPrint (TempName, sizeof (TempName), L"%s\\%s", FileName, L"Contents\\Info.plist");
-  plist = LoadPListFile (gRootFHandle, TempName);
+  Status = egLoadFile (gRootFHandle, TempName, &KextEntry->InfoPlist, &KextEntry->InfoPlistLength);
 
-  if (plist == NULL) {
+  if (EFI_ERROR (Status)) {
     UnicodeSPrint (TempName, sizeof (TempName), L"%s\\%s", FileName, L"Info.plist");
-    plist = LoadPListFile (gRootFHandle, TempName);
+    Status = egLoadFile (gRootFHandle, TempName, &KextEntry->InfoPlist, &KextEntry->InfoPlistLength);
 
-    if (plist == NULL) {
+    if (EFI_ERROR (Status)) {
       DBG ("%a: Error loading kext %s plist!\n", __FUNCTION__, FileName);
       return EFI_NOT_FOUND;
     }
     NoContents = TRUE;
   }
 
-  Status =
-    egLoadFile (gRootFHandle, TempName, &infoDictBuffer, &infoDictBufferLength);
-  if (EFI_ERROR (Status)) {
-    DBG ("%a: Error loading kext %s plist!\n", __FUNCTION__, FileName);
+  pbuf.dat = (char *) KextEntry->InfoPlist;
+  pbuf.len = (unsigned int) KextEntry->InfoPlistLength;
+  pbuf.pos = 0;
+  plist = plXmlToNode (&pbuf);
+  if (plist == NULL) {
+    DBG ("%a: Error parsing kext %s plist!\n", __FUNCTION__, FileName);
+    FreeAlignedPages (KextEntry->InfoPlist, EFI_SIZE_TO_PAGES (KextEntry->InfoPlistLength));
     return EFI_NOT_FOUND;
   }
 
   if (GetUnicodeProperty (plist, "CFBundleExecutable", Executable)) {
     if (NoContents) {
-      UnicodeSPrint (TempName, sizeof (TempName), L"%s\\%s", FileName, Executable);
+      UnicodeSPrint (KextEntry->Executable, sizeof (KextEntry->Executable), L"%s\\%s", FileName, Executable);
     }
     else {
-      UnicodeSPrint (TempName, sizeof (TempName), L"%s\\%s\\%s", FileName, L"Contents\\MacOS",
+      UnicodeSPrint (KextEntry->Executable, sizeof (KextEntry->Executable), L"%s\\%s\\%s", FileName, L"Contents\\MacOS",
                      Executable);
     }
     Status =
-      egLoadFile (gRootFHandle, TempName, &executableFatBuffer,
-                  &executableFatBufferLength);
+      GetKextExecutableSlice (KextEntry->Executable, archCpuType,
+                              &KextEntry->ExecutableOffset, &KextEntry->ExecutableLength);
     if (EFI_ERROR (Status)) {
-      DBG ("%a: Failed to load extra kext: %s\n", __FUNCTION__, FileName);
-      FreeAlignedPages (infoDictBuffer, EFI_SIZE_TO_PAGES (infoDictBufferLength));
-      return EFI_NOT_FOUND;
-    }
-    executableBuffer = executableFatBuffer;
-    executableBufferLength = executableFatBufferLength;
-    if (ThinFatFile (&executableBuffer, &executableBufferLength, archCpuType)) {
-      FreeAlignedPages (infoDictBuffer, EFI_SIZE_TO_PAGES (infoDictBufferLength));
-      FreeAlignedPages (executableFatBuffer, EFI_SIZE_TO_PAGES (executableFatBufferLength));
-      DBG ("%a: Thinning failed %s\n", __FUNCTION__, FileName);
+      DBG ("%a: Failed to load extra kext: %s (%r)\n", __FUNCTION__, FileName, Status);
+      FreeAlignedPages (KextEntry->InfoPlist, EFI_SIZE_TO_PAGES (KextEntry->InfoPlistLength));
+      plNodeDelete (plist);
       return EFI_NOT_FOUND;
     }
   }
   plNodeDelete (plist);
 
-  bundlePathBufferLength = StrLen (FileName) + 1;
-  bundlePathBuffer = AllocateZeroPool (bundlePathBufferLength);
-  UnicodeStrToAsciiStr (FileName, bundlePathBuffer);
-
-  kext->length =
-    (UINT32) (sizeof (_BooterKextFileInfo) + infoDictBufferLength +
-              executableBufferLength + bundlePathBufferLength);
-  infoAddr = (_BooterKextFileInfo *) AllocatePool (kext->length);
-  infoAddr->infoDictPhysAddr = sizeof (_BooterKextFileInfo);
-  infoAddr->infoDictLength = (UINT32) infoDictBufferLength;
-  infoAddr->executablePhysAddr =
-    (UINT32) (sizeof (_BooterKextFileInfo) + infoDictBufferLength);
-  infoAddr->executableLength = (UINT32) executableBufferLength;
-  infoAddr->bundlePathPhysAddr =
-    (UINT32) (sizeof (_BooterKextFileInfo) + infoDictBufferLength +
-              executableBufferLength);
-  infoAddr->bundlePathLength = (UINT32) bundlePathBufferLength;
-  kext->paddr = (UINT32) (UINTN) infoAddr;
-
-  CopyMem ((CHAR8 *) infoAddr + sizeof (_BooterKextFileInfo), infoDictBuffer,
-           infoDictBufferLength);
-  CopyMem ((CHAR8 *) infoAddr + sizeof (_BooterKextFileInfo) +
-           infoDictBufferLength, executableBuffer, executableBufferLength);
-  CopyMem ((CHAR8 *) infoAddr + sizeof (_BooterKextFileInfo) +
-           infoDictBufferLength + executableBufferLength, bundlePathBuffer,
-           bundlePathBufferLength);
-
-  FreeAlignedPages (infoDictBuffer, EFI_SIZE_TO_PAGES (infoDictBufferLength));
-  FreeAlignedPages (executableFatBuffer, EFI_SIZE_TO_PAGES (executableFatBufferLength));
-  FreePool (bundlePathBuffer);
+  UnicodeStrToAsciiStr (FileName, KextEntry->BundlePath);
+
+  KextEntry->kext.paddr = 0;
+  KextEntry->kext.length =
+    (UINT32) (sizeof (_BooterKextFileInfo) + KextEntry->InfoPlistLength +
+              KextEntry->ExecutableLength + AsciiStrSize (KextEntry->BundlePath));
 
   return EFI_SUCCESS;
 }
@@ -193,7 +271,7 @@ AddKext (
 
   KextEntry = AllocatePool (sizeof (KEXT_ENTRY));
   KextEntry->Signature = KEXT_SIGNATURE;
-  Status = LoadKext (FileName, archCpuType, &KextEntry->kext);
+  Status = LoadKext (FileName, archCpuType, KextEntry);
   if (EFI_ERROR (Status)) {
     DBG ("%a: load kext %s failed\n", __FUNCTION__, FileName);
     FreePool (KextEntry);
@@ -257,6 +335,75 @@ GetKextsSize (
   return kextsSize;
 }
 
+//
+// Lays out all kexts in one arena sized by GetKextsSize(), each one
+// page aligned as _BooterKextFileInfo, Info.plist, executable, bundle path.
+// Executables are read straight into their slots. Kexts which can not be
+// read are dropped from gKextList.
+//
+VOID
+  EFIAPI
+LoadKextsArena (
+  VOID
+)
+{
+  EFI_STATUS Status;
+  LIST_ENTRY *Link;
+  LIST_ENTRY *NextLink;
+  KEXT_ENTRY *KextEntry;
+  UINT8 *Arena;
+  UINTN ArenaSize;
+  UINT8 *Slot;
+  _BooterKextFileInfo *infoAddr;
+
+  ArenaSize = GetKextsSize ();
+  Arena = NULL;
+  if (ArenaSize > 0) {
+    Arena = AllocatePages (EFI_SIZE_TO_PAGES (ArenaSize));
+  }
+  DBG ("%a: %d bytes at 0x%p\n", __FUNCTION__, ArenaSize, Arena);
+
+  Slot = Arena;
+  for (Link = gKextList.ForwardLink; Link != &gKextList; Link = NextLink) {
+    NextLink = Link->ForwardLink;
+    KextEntry = CR (Link, KEXT_ENTRY, Link, KEXT_SIGNATURE);
+
+    Status = EFI_OUT_OF_RESOURCES;
+    if (Arena != NULL) {
+      infoAddr = (_BooterKextFileInfo *) Slot;
+      infoAddr->infoDictPhysAddr = sizeof (_BooterKextFileInfo);
+      infoAddr->infoDictLength = (UINT32) KextEntry->InfoPlistLength;
+      infoAddr->executablePhysAddr =
+        (UINT32) (sizeof (_BooterKextFileInfo) + KextEntry->InfoPlistLength);
+      infoAddr->executableLength = KextEntry->ExecutableLength;
+      infoAddr->bundlePathPhysAddr =
+        (UINT32) (sizeof (_BooterKextFileInfo) + KextEntry->InfoPlistLength +
+                  KextEntry->ExecutableLength);
+      infoAddr->bundlePathLength = (UINT32) AsciiStrSize (KextEntry->BundlePath);
+
+      CopyMem (Slot + infoAddr->infoDictPhysAddr, KextEntry->InfoPlist, KextEntry->InfoPlistLength);
+      AsciiStrCpy ((CHAR8 *) Slot + infoAddr->bundlePathPhysAddr, KextEntry->BundlePath);
+      Status = EFI_SUCCESS;
+      if (KextEntry->ExecutableLength > 0) {
+        Status =
+          ReadKextFile (KextEntry->Executable, KextEntry->ExecutableOffset,
+                        KextEntry->ExecutableLength, Slot + infoAddr->executablePhysAddr);
+      }
+      KextEntry->kext.paddr = (UINT32) (UINTN) Slot;
+      Slot += RoundPage (KextEntry->kext.length);
+    }
+
+    FreeAlignedPages (KextEntry->InfoPlist, EFI_SIZE_TO_PAGES (KextEntry->InfoPlistLength));
+    KextEntry->InfoPlist = NULL;
+
+    if (EFI_ERROR (Status)) {
+      DBG ("%a: load kext %a failed (%r)\n", __FUNCTION__, KextEntry->BundlePath, Status);
+      RemoveEntryList (Link);
+      FreePool (KextEntry);
+    }
+  }
+}
+
 CHAR16 *
 GetExtraKextsDir (
   VOID
@@ -428,6 +575,10 @@ LoadKexts (
     }
   }
 
+  if (!IsListEmpty (&gKextList)) {
+    LoadKextsArena ();
+  }
+
   KextCount = GetKextCount ();
   DBG ("%a:  KextCount = %d\n", __FUNCTION__, KextCount);
   if (KextCount > 0) {
@@ -87,6 +87,12 @@ typedef struct {
   UINT32 Signature;
   LIST_ENTRY Link;
   _DeviceTreeBuffer kext;
+  UINT8 *InfoPlist;             /* until LoadKextsArena() */
+  UINTN InfoPlistLength;
+  CHAR16 Executable[256];       /* path, empty if there is no executable */
+  UINT32 ExecutableOffset;      /* thin slice in executable file */
+  UINT32 ExecutableLength;
+  CHAR8 BundlePath[256];
 } KEXT_ENTRY;
 
 #endif
@@ -110,6 +110,380 @@ SearchAndReplace (
   return NumReplaces;
 }
 
+//
+// Multi-pattern patch matcher.
+//
+// All Find patterns of one patch table are compiled into an Aho-Corasick
+// automaton with a full transition table, so a single pass over a buffer
+// finds every pattern at every position. The automaton is built before
+// ExitBootServices() and PatchMatcherApply() does not allocate, so it can
+// run from the ExitBootServices() notification like the patchers do.
+//
+// Pattern K of the matcher is entry K of the patch table. Entries with no
+// Find/Replace data or zero length are kept but never match.
+//
+// The single pass gives the same result as SearchAndReplace() run for each
+// patch in table order only if no two patches can touch the same bytes:
+// their Find patterns must not overlap, and neither Replace may overlap the
+// other's Find. Otherwise the table order decides which patch wins and a
+// later patch may match the output of an earlier one, which one pass can
+// not reproduce. Such pairs are recorded in Matcher->Conflict and callers
+// use the sequential path when PatchMatcherConflicts() says so.
+//
+
+PATCH_MATCHER   *gKernelPatchMatcher    = NULL;
+PATCH_MATCHER   *gKextPatchMatcher      = NULL;
+PATCH_MATCHER   *gKextPlistPatchMatcher = NULL;
+
+VOID
+PatchMatcherFree (
+  PATCH_MATCHER   *Matcher
+)
+{
+  if (Matcher == NULL) {
+    return;
+  }
+  if (Matcher->Length != NULL) {
+    FreePool (Matcher->Length);
+  }
+  if (Matcher->Next != NULL) {
+    FreePool (Matcher->Next);
+  }
+  if (Matcher->Conflict != NULL) {
+    FreePool (Matcher->Conflict);
+  }
+  FreePool (Matcher);
+}
+
+//
+// TRUE if A and B agree on every byte of some overlap of at least one
+// byte, i.e. an occurrence of one can share bytes with one of the other.
+//
+STATIC
+BOOLEAN
+PatchBytesOverlap (
+  UINT8   *A,
+  UINTN   LengthA,
+  UINT8   *B,
+  UINTN   LengthB
+)
+{
+  UINTN   Shift;
+
+  for (Shift = 0; Shift < LengthA; Shift++) {
+    if (CompareMem (A + Shift, B, MIN (LengthA - Shift, LengthB)) == 0) {
+      return TRUE;
+    }
+  }
+  for (Shift = 1; Shift < LengthB; Shift++) {
+    if (CompareMem (B + Shift, A, MIN (LengthB - Shift, LengthA)) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+//
+// Builds a matcher for Count patches. Find[K] and Replace[K] are Length[K]
+// bytes long. Every patch is applied at most MaxReplaces times per buffer,
+// or without limit if MaxReplaces <= 0.
+// Returns NULL if there is nothing to match, the automaton does not fit
+// 16-bit state numbers or memory runs out.
+//
+PATCH_MATCHER *
+PatchMatcherCreate (
+  CHAR8   **Find,
+  CHAR8   **Replace,
+  UINTN   *Length,
+  UINTN   Count,
+  INTN    MaxReplaces
+)
+{
+  PATCH_MATCHER   *Matcher;
+  UINTN           MaxStates;
+  UINTN           K;
+  UINTN           Pos;
+  UINTN           C;
+  UINT16          State;
+  UINT16          Child;
+  UINT16          *Fail;
+  UINT16          *Queue;
+  UINTN           Head;
+  UINTN           Tail;
+
+  MaxStates = 1;
+  for (K = 0; K < Count; K++) {
+    if (Find[K] != NULL && Replace[K] != NULL) {
+      MaxStates += Length[K];
+    }
+  }
+  if (MaxStates == 1 || MaxStates > 0xFFFF || Count >= 0xFFFF) {
+    return NULL;
+  }
+
+  Matcher = AllocateZeroPool (sizeof (PATCH_MATCHER));
+  if (Matcher == NULL) {
+    return NULL;
+  }
+
+  //
+  // Per-pattern arrays share one allocation, so do per-state arrays.
+  //
+  Matcher->PatternCount = Count;
+  Matcher->Length = AllocateZeroPool (Count * (3 * sizeof (UINTN) + 2 * sizeof (UINT8 *) + sizeof (UINT16)));
+  Matcher->Next = AllocateZeroPool (MaxStates * (256 + 2) * sizeof (UINT16));
+  Matcher->Conflict = AllocateZeroPool (Count * Count);
+  Fail = AllocatePool (MaxStates * 2 * sizeof (UINT16));
+  if (Matcher->Length == NULL || Matcher->Next == NULL || Matcher->Conflict == NULL || Fail == NULL) {
+    if (Fail != NULL) {
+      FreePool (Fail);
+    }
+    PatchMatcherFree (Matcher);
+    return NULL;
+  }
+  Matcher->Hits        = Matcher->Length + Count;
+  Matcher->SkipTo      = Matcher->Hits + Count;
+  Matcher->Find        = (UINT8 **) (Matcher->SkipTo + Count);
+  Matcher->Replace     = Matcher->Find + Count;
+  Matcher->PatternNext = (UINT16 *) (Matcher->Replace + Count);
+  Matcher->Output      = Matcher->Next + MaxStates * 256;
+  Matcher->OutputLink  = Matcher->Output + MaxStates;
+  Matcher->MaxReplaces = MaxReplaces <= 0 ? 0 : (UINTN) MaxReplaces;
+  Queue                = Fail + MaxStates;
+
+  //
+  // Trie of all patterns. Transitions to state 0 do not exist in the trie,
+  // so 0 marks a missing edge until the failure links fill it in.
+  //
+  Matcher->StateCount = 1;
+  for (K = 0; K < Count; K++) {
+    if (Find[K] == NULL || Replace[K] == NULL || Length[K] == 0) {
+      continue;
+    }
+    Matcher->Find[K]    = (UINT8 *) Find[K];
+    Matcher->Replace[K] = (UINT8 *) Replace[K];
+    Matcher->Length[K]  = Length[K];
+
+    State = 0;
+    for (Pos = 0; Pos < Length[K]; Pos++) {
+      C = Matcher->Find[K][Pos];
+      if (Matcher->Next[State * 256 + C] == 0) {
+        Matcher->Next[State * 256 + C] = (UINT16) Matcher->StateCount++;
+      }
+      State = Matcher->Next[State * 256 + C];
+    }
+    Matcher->PatternNext[K] = Matcher->Output[State];
+    Matcher->Output[State]  = (UINT16) (K + 1);
+  }
+
+  for (K = 0; K < Count; K++) {
+    if (Matcher->Length[K] == 0) {
+      continue;
+    }
+    for (Pos = K + 1; Pos < Count; Pos++) {
+      if (Matcher->Length[Pos] == 0) {
+        continue;
+      }
+      if (PatchBytesOverlap (Matcher->Find[K], Matcher->Length[K], Matcher->Find[Pos], Matcher->Length[Pos]) ||
+          PatchBytesOverlap (Matcher->Replace[K], Matcher->Length[K], Matcher->Find[Pos], Matcher->Length[Pos]) ||
+          PatchBytesOverlap (Matcher->Replace[Pos], Matcher->Length[Pos], Matcher->Find[K], Matcher->Length[K])) {
+        Matcher->Conflict[K * Count + Pos] = 1;
+        Matcher->Conflict[Pos * Count + K] = 1;
+      }
+    }
+  }
+
+  //
+  // Breadth-first pass: failure links, dictionary suffix links and the
+  // missing transitions borrowed from the failure state.
+  //
+  Head = 0;
+  Tail = 0;
+  Fail[0] = 0;
+  for (C = 0; C < 256; C++) {
+    Child = Matcher->Next[C];
+    if (Child != 0) {
+      Fail[Child] = 0;
+      Queue[Tail++] = Child;
+    }
+  }
+  while (Head < Tail) {
+    State = Queue[Head++];
+    for (C = 0; C < 256; C++) {
+      Child = Matcher->Next[State * 256 + C];
+      if (Child == 0) {
+        Matcher->Next[State * 256 + C] = Matcher->Next[Fail[State] * 256 + C];
+        continue;
+      }
+      Fail[Child] = Matcher->Next[Fail[State] * 256 + C];
+      Matcher->OutputLink[Child] = Matcher->Output[Fail[Child]] != 0 ?
+                                   Fail[Child] : Matcher->OutputLink[Fail[Child]];
+      Queue[Tail++] = Child;
+    }
+  }
+
+  FreePool (Fail);
+  return Matcher;
+}
+
+//
+// Returns TRUE if any two patches enabled in Enabled (all if NULL)
+// conflict, see the matcher description above.
+//
+BOOLEAN
+PatchMatcherConflicts (
+  PATCH_MATCHER   *Matcher,
+  BOOLEAN         *Enabled
+)
+{
+  UINTN   I;
+  UINTN   J;
+
+  for (I = 0; I < Matcher->PatternCount; I++) {
+    if (Enabled != NULL && !Enabled[I]) {
+      continue;
+    }
+    for (J = I + 1; J < Matcher->PatternCount; J++) {
+      if (Enabled != NULL && !Enabled[J]) {
+        continue;
+      }
+      if (Matcher->Conflict[I * Matcher->PatternCount + J] != 0) {
+        return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+//
+// Applies all patches of Matcher enabled in Enabled (all if NULL) to Source
+// in one pass. Like SearchAndReplace() a patch does not match over its own
+// previous replacement. The result equals the sequential one only when
+// PatchMatcherConflicts() is FALSE for the same Enabled; the CompareMem()
+// below just keeps a conflicting pair from corrupting each other's bytes.
+// Per-patch counts of this call are left in Matcher->Hits.
+// Returns the total number of replaces done.
+//
+UINTN
+PatchMatcherApply (
+  PATCH_MATCHER   *Matcher,
+  UINT8           *Source,
+  UINT32          SourceSize,
+  BOOLEAN         *Enabled
+)
+{
+  UINTN     Pos;
+  UINTN     Start;
+  UINTN     K;
+  UINTN     Total;
+  UINT16    State;
+  UINT16    Out;
+  UINT16    Pattern;
+
+  ZeroMem (Matcher->Hits, Matcher->PatternCount * sizeof (UINTN));
+  ZeroMem (Matcher->SkipTo, Matcher->PatternCount * sizeof (UINTN));
+
+  Total = 0;
+  State = 0;
+  for (Pos = 0; Pos < SourceSize; Pos++) {
+    State = Matcher->Next[State * 256 + Source[Pos]];
+    Out = Matcher->Output[State] != 0 ? State : Matcher->OutputLink[State];
+    for (; Out != 0; Out = Matcher->OutputLink[Out]) {
+      for (Pattern = Matcher->Output[Out]; Pattern != 0; Pattern = Matcher->PatternNext[K]) {
+        K = Pattern - 1;
+        Start = Pos + 1 - Matcher->Length[K];
+        if ((Enabled != NULL && !Enabled[K]) ||
+            (Matcher->MaxReplaces != 0 && Matcher->Hits[K] >= Matcher->MaxReplaces) ||
+            Start < Matcher->SkipTo[K] ||
+            CompareMem (Source + Start, Matcher->Find[K], Matcher->Length[K]) != 0) {
+          continue;
+        }
+#ifdef KERNEL_PATCH_DEBUG
+        Print (L"%a: patch #%d found at 0x%x.\n", __FUNCTION__, K + 1, Source + Start);
+#endif
+        CopyMem (Source + Start, Matcher->Replace[K], Matcher->Length[K]);
+        Matcher->Hits[K]++;
+        Matcher->SkipTo[K] = Pos + 1;
+        Total++;
+      }
+    }
+  }
+  return Total;
+}
+
+//
+// Compiles KernelPatches and KextPatches from config into matchers.
+// Patches that fail to compile keep using SearchAndReplace().
+// Also reserves the prelinked kexts index, both are used during
+// ExitBootServices() when we can not allocate memory.
+//
+VOID
+KernelAndKextPatchesCompile (
+  VOID
+)
+{
+  UINTN   Length[PATCH_TABLE_MAX];
+  UINT32  i;
+
+  PatchMatcherFree (gKernelPatchMatcher);
+  PatchMatcherFree (gKextPatchMatcher);
+  PatchMatcherFree (gKextPlistPatchMatcher);
+  gKernelPatchMatcher    = NULL;
+  gKextPatchMatcher      = NULL;
+  gKextPlistPatchMatcher = NULL;
+
+  PrelinkedKextsReserve ();
+  PrelinkedKextsReset ();
+  PatcherInited = FALSE;
+
+  if (gSettings.KPKernelPatchesNeeded && gSettings.NrKernel <= PATCH_TABLE_MAX) {
+    gKernelPatchMatcher = PatchMatcherCreate (
+                            gSettings.AnyKernelData,
+                            gSettings.AnyKernelPatch,
+                            gSettings.AnyKernelDataLen,
+                            gSettings.NrKernel,
+                            1
+                            );
+    //
+    // All kernel patches are applied together, so any conflict means
+    // the table has to go patch by patch.
+    //
+    if (gKernelPatchMatcher != NULL && PatchMatcherConflicts (gKernelPatchMatcher, NULL)) {
+      DBG ("%a: kernel patches overlap, applying them one by one\n", __FUNCTION__);
+      PatchMatcherFree (gKernelPatchMatcher);
+      gKernelPatchMatcher = NULL;
+    }
+  }
+
+  if (gSettings.KPKextPatchesNeeded && gSettings.NrKexts <= PATCH_TABLE_MAX) {
+    for (i = 0; i < gSettings.NrKexts; i++) {
+      Length[i] = gSettings.AnyKextInfoPlistPatch[i] ? 0 : gSettings.AnyKextDataLen[i];
+    }
+    gKextPatchMatcher = PatchMatcherCreate (
+                          gSettings.AnyKextData,
+                          gSettings.AnyKextPatch,
+                          Length,
+                          gSettings.NrKexts,
+                          -1
+                          );
+    for (i = 0; i < gSettings.NrKexts; i++) {
+      Length[i] = gSettings.AnyKextInfoPlistPatch[i] ? gSettings.AnyKextDataLen[i] : 0;
+    }
+    gKextPlistPatchMatcher = PatchMatcherCreate (
+                               gSettings.AnyKextData,
+                               gSettings.AnyKextPatch,
+                               Length,
+                               gSettings.NrKexts,
+                               -1
+                               );
+  }
+
+  DBG ("%a: kernel %ld states, kext %ld states, kext plist %ld states\n", __FUNCTION__,
+       (UINT64) (gKernelPatchMatcher == NULL ? 0 : gKernelPatchMatcher->StateCount),
+       (UINT64) (gKextPatchMatcher == NULL ? 0 : gKextPatchMatcher->StateCount),
+       (UINT64) (gKextPlistPatchMatcher == NULL ? 0 : gKextPlistPatchMatcher->StateCount));
+}
+
 /** Global for storing KextBundleIdentifier */
 
 CHAR8 gKextBundleIdentifier[256];
@@ -488,6 +862,28 @@ KextPatcherRegisterKexts (
 // PatchKext is called for every kext from prelinked kernel (kernelcache) or from DevTree (booting with drivers).
 // Add kext detection code here and call kext speciffic patch function.
 //
+//
+// Logs per-patch counts of the last PatchMatcherApply() on a kext.
+//
+VOID
+PatchKextReportHits (
+  PATCH_MATCHER   *Matcher,
+  BOOLEAN         *Enabled
+)
+{
+  UINT32 i;
+
+  for (i = 0; i < Matcher->PatternCount; i++) {
+    if (!Enabled[i] || Matcher->Length[i] == 0) {
+      continue;
+    }
+    DBG ("%a: patch #%d (%a) applied %ld times\n", __FUNCTION__, i + 1, gSettings.AnyKext[i], (UINT64) Matcher->Hits[i]);
+#ifdef KEXT_PATCH_DEBUG
+    Print (L"%a: patch #%d (%a) applied %ld times\n", __FUNCTION__, i + 1, gSettings.AnyKext[i], (UINT64) Matcher->Hits[i]);
+#endif
+  }
+}
+
 VOID
 PatchKext (
   UINT8   *Driver,
@@ -496,7 +892,11 @@ PatchKext (
   UINT32  InfoPlistSize
 )
 {
-  UINT32 i;
+  UINT32  i;
+  UINT32  Count;
+  BOOLEAN Enabled[PATCH_TABLE_MAX];
+  BOOLEAN BinaryPatches;
+  BOOLEAN PlistPatches;
 
 #if 0
   if (gSettings.KPATIConnectorsController != NULL) {
@@ -535,7 +935,15 @@ PatchKext (
   ExtractKextBundleIdentifier (InfoPlist, InfoPlistSize);
   DBG ("%a: kext (%a)\n", __FUNCTION__, gKextBundleIdentifier);
 
-  for (i = 0; i < gSettings.NrKexts; i++) {
+  //
+  // Settings only fill the patch table when it has at most
+  // PATCH_TABLE_MAX entries.
+  //
+  Count = MIN (gSettings.NrKexts, PATCH_TABLE_MAX);
+  ZeroMem (Enabled, sizeof (Enabled));
+  BinaryPatches = FALSE;
+  PlistPatches = FALSE;
+  for (i = 0; i < Count; i++) {
     UINT32 namLen;
 
     if (gSettings.AnyKextDataLen[i] < 1) {
@@ -547,104 +955,533 @@ PatchKext (
       continue;
     }
 
+    //
+    // Compiled patches are collected and applied below in one pass
+    //
+    if (gSettings.AnyKextInfoPlistPatch[i] && gKextPlistPatchMatcher != NULL) {
+      Enabled[i] = TRUE;
+      PlistPatches = TRUE;
+      continue;
+    }
+    if (!gSettings.AnyKextInfoPlistPatch[i] && gKextPatchMatcher != NULL) {
+      Enabled[i] = TRUE;
+      BinaryPatches = TRUE;
+      continue;
+    }
+
     AnyKextPatch (Driver, DriverSize, InfoPlist, InfoPlistSize, i);
-  }    
+  }
+
+  //
+  // Patches of this kext that touch each other's bytes go one by one,
+  // in table order, as they did before the matchers.
+  //
+  if (PlistPatches && PatchMatcherConflicts (gKextPlistPatchMatcher, Enabled)) {
+    DBG ("%a: plist patches overlap, applying them one by one\n", __FUNCTION__);
+    for (i = 0; i < Count; i++) {
+      if (Enabled[i] && gSettings.AnyKextInfoPlistPatch[i]) {
+        AnyKextPatch (Driver, DriverSize, InfoPlist, InfoPlistSize, i);
+      }
+    }
+    PlistPatches = FALSE;
+  }
+  if (BinaryPatches && PatchMatcherConflicts (gKextPatchMatcher, Enabled)) {
+    DBG ("%a: binary patches overlap, applying them one by one\n", __FUNCTION__);
+    for (i = 0; i < Count; i++) {
+      if (Enabled[i] && !gSettings.AnyKextInfoPlistPatch[i]) {
+        AnyKextPatch (Driver, DriverSize, InfoPlist, InfoPlistSize, i);
+      }
+    }
+    BinaryPatches = FALSE;
+  }
+
+  if (PlistPatches) {
+    if (InfoPlist == NULL || InfoPlistSize == 0) {
+      DEBUG ((DEBUG_INFO, "%a: kext plist is not good (0x%p, %d)\n", __FUNCTION__, InfoPlist, InfoPlistSize));
+    } else {
+      PatchMatcherApply (gKextPlistPatchMatcher, (UINT8 *) InfoPlist, InfoPlistSize, Enabled);
+      PatchKextReportHits (gKextPlistPatchMatcher, Enabled);
+    }
+  }
+
+  if (BinaryPatches) {
+    if (Driver == NULL || DriverSize == 0) {
+      DEBUG ((DEBUG_INFO, "%a: kext binary is not good (0x%p, %d)\n", __FUNCTION__, Driver, DriverSize));
+    } else {
+      PatchMatcherApply (gKextPatchMatcher, Driver, DriverSize, Enabled);
+      PatchKextReportHits (gKextPatchMatcher, Enabled);
+    }
+  }
 }
 
 //
-// Returns parsed hex integer key.
-// Plist - kext pist
-// Key - key to find
-// WholePlist - _PrelinkInfoDictionary, used to find referenced values
+// Index of kexts in PrelinkInfo, see PrelinkedKextsIndex().
+// Storage is reserved by KernelAndKextPatchesCompile() since the index
+// is built during ExitBootServices() when we can not allocate memory.
 //
-// Searches for Key in Plist and it's value:
-// a) <integer ID="26" size="64">0x2b000</integer>
-//    returns 0x2b000
-// b) <integer IDREF="26"/>
-//    searches for <integer ID="26"... from WholePlist
-//    and returns value from that referenced field
+PRELINKED_KEXT  *gPrelinkedKexts     = NULL;
+UINTN           gPrelinkedKextCount  = 0;
+
+STATIC PRELINK_IDREF  *mPrelinkIdRefs       = NULL;
+STATIC UINTN          mPrelinkIdRefCount    = 0;
+STATIC BOOLEAN        mPrelinkedKextsIndexed = FALSE;
+STATIC EFI_STATUS     mPrelinkedKextsStatus  = EFI_NOT_READY;
+STATIC EFI_STATUS     mPrelinkedKextsWindow  = EFI_NOT_READY;
+STATIC UINT32         mPrelinkedKextsStart   = 0;
+STATIC UINT32         mPrelinkedKextsResume  = 0;
+
+VOID
+PrelinkedKextsReserve (
+  VOID
+)
+{
+  if (gPrelinkedKexts != NULL) {
+    return;
+  }
+  gPrelinkedKexts = AllocatePool (PRELINKED_KEXTS_MAX * (sizeof (PRELINKED_KEXT) + PRELINK_IDREFS_PER_KEXT * sizeof (PRELINK_IDREF)));
+  if (gPrelinkedKexts != NULL) {
+    mPrelinkIdRefs = (PRELINK_IDREF *) (gPrelinkedKexts + PRELINKED_KEXTS_MAX);
+  }
+}
+
+//
+// Forgets the index of the previous kernel, the next PrelinkedKextsIndex()
+// builds it again from the current PrelinkInfo.
+//
+VOID
+PrelinkedKextsReset (
+  VOID
+)
+{
+  mPrelinkedKextsIndexed = FALSE;
+  mPrelinkedKextsStatus  = EFI_NOT_READY;
+  mPrelinkedKextsWindow  = EFI_NOT_READY;
+  mPrelinkedKextsStart   = 0;
+  mPrelinkedKextsResume  = 0;
+  gPrelinkedKextCount    = 0;
+  mPrelinkIdRefCount     = 0;
+}
+
 //
-// Whole function is here since we should avoid ParseXML() and it's
-// memory allocations during ExitBootServices(). And it seems that 
-// ParseXML() does not support IDREF.
-// This func is hard to read and debug and probably not reliable,
-// but it seems it works.
+// Parses integer value at Ptr: 0x prefixed hex or decimal.
 //
+STATIC
 UINT64
-GetPlistHexValue (
-  CHAR8  *Plist,
-  UINT32 PlistSize,
-  CHAR8  *Key,
-  CHAR8  *WholePlist,
-  UINT32 WholeSize
-)
-{
-  CHAR8     *Value;
-  CHAR8     *IntTag;
-  UINT64    NumValue;
-  CHAR8     *IDStart;
-  CHAR8     *IDEnd;
-  UINTN     IDLen;
-  CHAR8     Buffer[48];
-
-  NumValue = 0;
-
-  // search for Key
-  Value = SearchMemory (Plist, PlistSize, Key, AsciiStrLen(Key));
-  if (Value == NULL) {
-    return 0;
-  }
-  // search for <integer
-  IntTag = SearchMemory (Value, (UINT32) (Value - Plist), "<integer", 8);
-  if (IntTag == NULL) {
-    return 0;
-  }
-  // find <integer end
-  Value = SearchMemory (IntTag, (UINT32) (IntTag - Plist),  ">", 1);
-  if (Value == NULL) {
-    return 0;
-  }
-  // normal case: value is here
-  if (Value[-1] != '/') {
-    NumValue = AsciiStrHexToUint64 (Value + 1);
-    return NumValue;
-  }
-  // it might be a reference: IDREF="173"/>
-  Value = SearchMemory (IntTag, (UINT32) (IntTag - Plist), "<integer IDREF=\"", 16);
-  if (Value != IntTag) {
-    return 0;
-  }
-  // compose <integer ID="xxx" in the Buffer
-  IDStart = SearchMemory (IntTag, (UINT32) (IntTag - Plist),  "\"", 1) + 1;
-  IDEnd = SearchMemory (IDStart, (UINT32) (IDStart - Plist),  "\"", 1);
-  IDLen = IDEnd - IDStart;
-  if (IDLen > 8) {
-    return 0;
-  }
-  AsciiStrCpy (Buffer, "<integer ID=\"");
-  AsciiStrnCat (Buffer, IDStart, IDLen);
-  AsciiStrCat (Buffer, "\"");
-  // and search whole plist for ID
-  IntTag = SearchMemory (WholePlist, WholeSize, Buffer, AsciiStrLen (Buffer));
-  if (IntTag == NULL) {
-    return 0;
-  }
-  // got it. find closing >
-  Value = SearchMemory (IntTag, (UINT32) (WholeSize - (IntTag - WholePlist)), ">", 1);
-  if (Value == NULL) {
-    return 0;
-  }
-  if (Value[-1] == '/') {
-    return 0;
-  }
-  // ...Str..() functions like to call StrLen() with safety belts.
-  // Our datum is huge sometimes so reduce the risk.
-  CopyMem (Buffer, Value + 1, 20);
-  Buffer[20] = '\0';
-  // we should have value now
-  NumValue = AsciiStrHexToUint64 (Buffer);
-  
-  return NumValue;
+PrelinkParseInteger (
+  CHAR8   *Ptr,
+  CHAR8   *End
+)
+{
+  UINT64  Value;
+  UINTN   Digit;
+  BOOLEAN Hex;
+
+  Value = 0;
+  Hex = FALSE;
+  if (End - Ptr > 2 && Ptr[0] == '0' && (Ptr[1] == 'x' || Ptr[1] == 'X')) {
+    Hex = TRUE;
+    Ptr += 2;
+  }
+  for (; Ptr < End; Ptr++) {
+    if (*Ptr >= '0' && *Ptr <= '9') {
+      Digit = *Ptr - '0';
+    } else if (Hex && *Ptr >= 'a' && *Ptr <= 'f') {
+      Digit = *Ptr - 'a' + 10;
+    } else if (Hex && *Ptr >= 'A' && *Ptr <= 'F') {
+      Digit = *Ptr - 'A' + 10;
+    } else {
+      break;
+    }
+    Value = (Hex ? LShiftU64 (Value, 4) : MultU64x32 (Value, 10)) + Digit;
+  }
+  return Value;
+}
+
+//
+// Returns pointer to the value of attribute Attr (given with =" part)
+// inside of tag Tag..TagEnd or NULL.
+//
+STATIC
+CHAR8 *
+PrelinkFindAttr (
+  CHAR8   *Tag,
+  CHAR8   *TagEnd,
+  CHAR8   *Attr,
+  UINTN   AttrLen
+)
+{
+  CHAR8   *Found;
+
+  Found = (CHAR8 *) SearchMemory ((UINT8 *) Tag, (UINT32) (TagEnd - Tag), Attr, AttrLen);
+  return Found == NULL ? NULL : Found + AttrLen;
+}
+
+STATIC
+BOOLEAN
+PrelinkTagIs (
+  CHAR8   *Name,
+  UINTN   NameLen,
+  CHAR8   *Tag,
+  UINTN   TagLen
+)
+{
+  return NameLen == TagLen && CompareMem (Name, Tag, TagLen) == 0;
+}
+
+//
+// Returns index of the first IDREF with Id, or mPrelinkIdRefCount.
+//
+STATIC
+UINTN
+PrelinkFindIdRef (
+  UINT32  Id
+)
+{
+  UINTN   Low;
+  UINTN   High;
+  UINTN   Mid;
+
+  Low = 0;
+  High = mPrelinkIdRefCount;
+  while (Low < High) {
+    Mid = (Low + High) / 2;
+    if (mPrelinkIdRefs[Mid].Id < Id) {
+      Low = Mid + 1;
+    } else {
+      High = Mid;
+    }
+  }
+  return Low;
+}
+
+//
+// Remembers reference to be resolved by second pass, sorted by Id.
+//
+STATIC
+VOID
+PrelinkAddIdRef (
+  UINT32  Id,
+  UINT32  Kext,
+  UINT32  Field
+)
+{
+  UINTN   Index;
+
+  if (mPrelinkIdRefCount >= PRELINKED_KEXTS_MAX * PRELINK_IDREFS_PER_KEXT) {
+    return;
+  }
+  Index = PrelinkFindIdRef (Id + 1);
+  CopyMem (&mPrelinkIdRefs[Index + 1], &mPrelinkIdRefs[Index], (mPrelinkIdRefCount - Index) * sizeof (PRELINK_IDREF));
+  mPrelinkIdRefs[Index].Id = Id;
+  mPrelinkIdRefs[Index].Kext = Kext;
+  mPrelinkIdRefs[Index].Field = Field;
+  mPrelinkIdRefCount++;
+}
+
+//
+// Stores value of the current element (Tag..TagEnd, Name) into Field of Kext.
+//
+STATIC
+VOID
+PrelinkSetField (
+  PRELINKED_KEXT  *Kext,
+  UINT32          Field,
+  CHAR8           *Info,
+  CHAR8           *End,
+  CHAR8           *Name,
+  UINTN           NameLen,
+  CHAR8           *TagEnd
+)
+{
+  CHAR8   *TextEnd;
+
+  if (TagEnd[-1] == '/') {
+    return;
+  }
+  if (Field == PRELINK_FIELD_BUNDLE_ID) {
+    if (!PrelinkTagIs (Name, NameLen, "string", 6)) {
+      return;
+    }
+    TextEnd = ScanMem8 (TagEnd + 1, End - TagEnd - 1, '<');
+    if (TextEnd != NULL) {
+      Kext->BundleIdOffset = (UINT32) (TagEnd + 1 - Info);
+      Kext->BundleIdLength = (UINT32) (TextEnd - TagEnd - 1);
+    }
+  } else if (PrelinkTagIs (Name, NameLen, "integer", 7)) {
+    if (Field == PRELINK_FIELD_SOURCE_ADDR) {
+      Kext->ExecutableSourceAddr = PrelinkParseInteger (TagEnd + 1, End);
+    } else {
+      Kext->ExecutableSize = PrelinkParseInteger (TagEnd + 1, End);
+    }
+  }
+}
+
+//
+// Builds index of the kexts in PrelinkInfo that start at offset Start,
+// where the plist is DictLevel dicts deep.
+//
+// First pass walks tags of the plist and for every kext Info.plist
+// (dict on level 2) records its span, CFBundleIdentifier,
+// _PrelinkExecutableSourceAddr and _PrelinkExecutableSize.
+// It stops at the kext that does not fit, which is where the next window
+// starts.
+// Values given as <integer IDREF="26"/> are collected sorted by ID and
+// resolved by second pass, which is done only if there are such values
+// and looks up every <... ID="26" ...> definition by binary search.
+// So the cost is linear in PrelinkInfoSize for each PRELINKED_KEXTS_MAX
+// kexts instead of searching the whole plist for every referenced value.
+//
+STATIC
+EFI_STATUS
+PrelinkedKextsIndexFrom (
+  UINT32  Start,
+  INTN    DictLevel
+)
+{
+  CHAR8           *Info;
+  CHAR8           *End;
+  CHAR8           *Ptr;
+  CHAR8           *Tag;
+  CHAR8           *TagEnd;
+  CHAR8           *TextEnd;
+  CHAR8           *Name;
+  CHAR8           *Attr;
+  UINTN           NameLen;
+  UINTN           Index;
+  UINT32          Id;
+  UINT32          Field;
+  EFI_STATUS      Status;
+  PRELINKED_KEXT  *Kext;
+
+  gPrelinkedKextCount = 0;
+  mPrelinkIdRefCount = 0;
+  mPrelinkedKextsStart = Start;
+
+  if (gPrelinkedKexts == NULL || PrelinkInfoAddr == 0 || PrelinkInfoSize == 0) {
+    return EFI_NOT_READY;
+  }
+
+  Info = (CHAR8 *) (UINTN) PrelinkInfoAddr;
+  End = Info + PrelinkInfoSize;
+  Kext = NULL;
+  Field = PRELINK_FIELD_NONE;
+  Status = EFI_SUCCESS;
+
+  for (Ptr = Info + Start; Ptr < End; Ptr = TagEnd + 1) {
+    Tag = ScanMem8 (Ptr, End - Ptr, '<');
+    if (Tag == NULL) {
+      break;
+    }
+    TagEnd = ScanMem8 (Tag, End - Tag, '>');
+    if (TagEnd == NULL) {
+      break;
+    }
+    if (Tag[1] == '/') {
+      if (PrelinkTagIs (Tag + 2, TagEnd - Tag - 2, "dict", 4)) {
+        // closing dict
+        if (DictLevel == 2 && Kext != NULL) {
+          // kext end
+          Kext->InfoPlistSize = (UINT32) (TagEnd + 1 - Info) - Kext->InfoPlistOffset;
+          gPrelinkedKextCount++;
+          Kext = NULL;
+        }
+        DictLevel--;
+      }
+      continue;
+    }
+
+    Name = Tag + 1;
+    for (NameLen = 0; Name + NameLen < TagEnd && Name[NameLen] >= 'a' && Name[NameLen] <= 'z'; NameLen++);
+
+    if (PrelinkTagIs (Name, NameLen, "dict", 4)) {
+      if (TagEnd[-1] != '/') {
+        // opening dict
+        DictLevel++;
+        if (DictLevel == 2) {
+          // kext start
+          if (gPrelinkedKextCount == PRELINKED_KEXTS_MAX) {
+            mPrelinkedKextsResume = (UINT32) (Tag - Info);
+            Status = EFI_BUFFER_TOO_SMALL;
+            break;
+          }
+          Kext = &gPrelinkedKexts[gPrelinkedKextCount];
+          ZeroMem (Kext, sizeof (PRELINKED_KEXT));
+          Kext->InfoPlistOffset = (UINT32) (Tag - Info);
+        }
+      }
+      Field = PRELINK_FIELD_NONE;
+      continue;
+    }
+
+    if (DictLevel != 2 || Kext == NULL) {
+      continue;
+    }
+
+    if (PrelinkTagIs (Name, NameLen, "key", 3)) {
+      TextEnd = ScanMem8 (TagEnd + 1, End - TagEnd - 1, '<');
+      if (TextEnd == NULL) {
+        break;
+      }
+      Field = PRELINK_FIELD_NONE;
+      if (PrelinkTagIs (TagEnd + 1, TextEnd - TagEnd - 1, "CFBundleIdentifier", 18)) {
+        Field = PRELINK_FIELD_BUNDLE_ID;
+      } else if (PrelinkTagIs (TagEnd + 1, TextEnd - TagEnd - 1, kPrelinkExecutableSourceKey, sizeof (kPrelinkExecutableSourceKey) - 1)) {
+        Field = PRELINK_FIELD_SOURCE_ADDR;
+      } else if (PrelinkTagIs (TagEnd + 1, TextEnd - TagEnd - 1, kPrelinkExecutableSizeKey, sizeof (kPrelinkExecutableSizeKey) - 1)) {
+        Field = PRELINK_FIELD_SIZE;
+      }
+      // continue from </key>
+      TagEnd = TextEnd - 1;
+      continue;
+    }
+
+    // value of the last key
+    if (Field != PRELINK_FIELD_NONE) {
+      Attr = PrelinkFindAttr (Tag, TagEnd, "IDREF=\"", 7);
+      if (Attr != NULL) {
+        PrelinkAddIdRef ((UINT32) PrelinkParseInteger (Attr, TagEnd), (UINT32) gPrelinkedKextCount, Field);
+      } else {
+        PrelinkSetField (Kext, Field, Info, End, Name, NameLen, TagEnd);
+      }
+      Field = PRELINK_FIELD_NONE;
+    }
+  }
+
+  if (mPrelinkIdRefCount > 0) {
+    for (Ptr = Info; Ptr < End; Ptr = TagEnd + 1) {
+      Tag = ScanMem8 (Ptr, End - Ptr, '<');
+      if (Tag == NULL) {
+        break;
+      }
+      TagEnd = ScanMem8 (Tag, End - Tag, '>');
+      if (TagEnd == NULL) {
+        break;
+      }
+      Attr = PrelinkFindAttr (Tag, TagEnd, " ID=\"", 5);
+      if (Attr == NULL) {
+        continue;
+      }
+      Id = (UINT32) PrelinkParseInteger (Attr, TagEnd);
+      Name = Tag + 1;
+      for (NameLen = 0; Name + NameLen < TagEnd && Name[NameLen] >= 'a' && Name[NameLen] <= 'z'; NameLen++);
+      for (Index = PrelinkFindIdRef (Id); Index < mPrelinkIdRefCount && mPrelinkIdRefs[Index].Id == Id; Index++) {
+        if (mPrelinkIdRefs[Index].Kext < gPrelinkedKextCount) {
+          PrelinkSetField (&gPrelinkedKexts[mPrelinkIdRefs[Index].Kext], mPrelinkIdRefs[Index].Field, Info, End, Name, NameLen, TagEnd);
+        }
+      }
+    }
+  }
+
+  DBG ("%a: %d kexts from 0x%x, %d references, status %r\n", __FUNCTION__,
+       gPrelinkedKextCount, Start, mPrelinkIdRefCount, Status);
+  return Status;
+}
+
+//
+// Builds index of kexts in PrelinkInfo, once per PrelinkedKextsReset().
+// Holds the first PRELINKED_KEXTS_MAX kexts, see PrelinkedKextsIndexNext()
+// for the rest.
+//
+EFI_STATUS
+PrelinkedKextsIndex (
+  VOID
+)
+{
+  if (!mPrelinkedKextsIndexed) {
+    mPrelinkedKextsIndexed = TRUE;
+    mPrelinkedKextsStatus = PrelinkedKextsIndexFrom (0, 0);
+    mPrelinkedKextsWindow = mPrelinkedKextsStatus;
+  }
+  return mPrelinkedKextsStatus;
+}
+
+//
+// Replaces the index with the next PRELINKED_KEXTS_MAX kexts after an
+// EFI_BUFFER_TOO_SMALL window. Returns EFI_NOT_FOUND when there are no
+// more kexts. PrelinkedKextsIndex() keeps returning EFI_BUFFER_TOO_SMALL,
+// so lookups by bundle id do not trust a partial index.
+//
+STATIC
+EFI_STATUS
+PrelinkedKextsIndexNext (
+  VOID
+)
+{
+  if (mPrelinkedKextsWindow != EFI_BUFFER_TOO_SMALL) {
+    return EFI_NOT_FOUND;
+  }
+  // every kext starts on level 2, inside the _PrelinkInfoDictionary array
+  mPrelinkedKextsWindow = PrelinkedKextsIndexFrom (mPrelinkedKextsResume, 1);
+  return mPrelinkedKextsWindow;
+}
+
+//
+// Returns indexed kext with given BundleId or NULL.
+//
+PRELINKED_KEXT *
+PrelinkedKextFind (
+  CHAR8   *BundleId
+)
+{
+  UINTN   Index;
+  UINTN   Length;
+  CHAR8   *Info;
+
+  Info = (CHAR8 *) (UINTN) PrelinkInfoAddr;
+  Length = AsciiStrLen (BundleId);
+  for (Index = 0; Index < gPrelinkedKextCount; Index++) {
+    if (gPrelinkedKexts[Index].BundleIdLength == Length &&
+        CompareMem (Info + gPrelinkedKexts[Index].BundleIdOffset, BundleId, Length) == 0) {
+      return &gPrelinkedKexts[Index];
+    }
+  }
+  return NULL;
+}
+
+//
+// Calls PatchKext() for each kext now in the index.
+//
+STATIC
+VOID
+PatchIndexedKexts (
+  VOID
+)
+{
+  CHAR8           *InfoPlistStart;
+  CHAR8           *InfoPlistEnd;
+  CHAR8           SavedValue;
+  UINT32          KextAddr;
+  UINTN           Index;
+  PRELINKED_KEXT  *Kext;
+
+  for (Index = 0; Index < gPrelinkedKextCount; Index++) {
+    Kext = &gPrelinkedKexts[Index];
+    InfoPlistStart = (CHAR8 *) (UINTN) PrelinkInfoAddr + Kext->InfoPlistOffset;
+    InfoPlistEnd = InfoPlistStart + Kext->InfoPlistSize;
+
+    // terminate Info.plist with 0
+    SavedValue = *InfoPlistEnd;
+    *InfoPlistEnd = '\0';
+
+    // truncate kext address to 32 bit to get physical addr
+    KextAddr = (UINT32) Kext->ExecutableSourceAddr;
+    // KextAddr is always relative to 0x200000
+    // and if KernelSlide is != 0 then KextAddr must be adjusted
+    KextAddr += KernelSlide;
+    // and adjust for AptioFixDrv's KernelRelocBase
+    KextAddr += (UINT32) KernelRelocBase;
+
+    // patch it
+    PatchKext (
+      (UINT8 *) (UINTN) KextAddr,
+      (UINT32) Kext->ExecutableSize,
+      InfoPlistStart,
+      Kext->InfoPlistSize
+    );
+
+    // restore saved char
+    *InfoPlistEnd = SavedValue;
+  }
 }
 
 //
@@ -674,79 +1511,28 @@ GetPlistHexValue (
 //       ...
 //     </dict>
 //       ...
+//
+// Kexts are taken from the index built by PrelinkedKextsIndex(). With more
+// than PRELINKED_KEXTS_MAX kexts, they are indexed and patched that many
+// at a time.
+//
 VOID
 PatchPrelinkedKexts (
   VOID
 )
 {
-  CHAR8     *WholePlist;
-  CHAR8     *DictPtr;
-  CHAR8     *InfoPlistStart;
-  CHAR8     *InfoPlistEnd;
-  UINT32    InfoPlistSize;
-  INTN      DictLevel;
-  CHAR8     SavedValue;
-  UINT32    KextAddr;
-  UINT32    KextSize;
-  UINT32    range;
-  
-  InfoPlistStart = NULL;
-  InfoPlistEnd = NULL;
-  DictLevel = 0;
-
-  WholePlist = (CHAR8 *) (UINTN) PrelinkInfoAddr;
-  DictPtr = WholePlist;
-  range = PrelinkInfoSize;
-  
-  while ((DictPtr = SearchMemory (DictPtr, range, "dict>", 5)) != NULL) {
-    
-    if (DictPtr[-1] == '<') {
-      // opening dict
-      DictLevel++;
-      if (DictLevel == 2) {
-        // kext start
-        InfoPlistStart = DictPtr - 1;
-      }
-      
-    } else if (DictPtr[-2] == '<' && DictPtr[-1] == '/') {
-      
-      // closing dict
-      if (DictLevel == 2 && InfoPlistStart != NULL) {
-        // kext end
-        InfoPlistEnd = DictPtr + 5 /* "dict>" */;
-        
-        // terminate Info.plist with 0
-        SavedValue = *InfoPlistEnd;
-        *InfoPlistEnd = '\0';
-        InfoPlistSize = (UINT32) (InfoPlistEnd - InfoPlistStart);
-        
-        // get kext address from _PrelinkExecutableSourceAddr
-        // truncate to 32 bit to get physical addr
-        KextAddr = (UINT32) GetPlistHexValue (InfoPlistStart, InfoPlistSize, kPrelinkExecutableSourceKey, WholePlist, PrelinkInfoSize);
-        // KextAddr is always relative to 0x200000
-        // and if KernelSlide is != 0 then KextAddr must be adjusted
-        KextAddr += KernelSlide;
-        // and adjust for AptioFixDrv's KernelRelocBase
-        KextAddr += (UINT32) KernelRelocBase;
-        
-        KextSize = (UINT32) GetPlistHexValue (InfoPlistStart, InfoPlistSize, kPrelinkExecutableSizeKey, WholePlist, PrelinkInfoSize);
-
-        // patch it
-        PatchKext (
-          (UINT8 *) (UINTN) KextAddr,
-          KextSize,
-          InfoPlistStart,
-          InfoPlistSize
-        );
-
-        // restore saved char
-        *InfoPlistEnd = SavedValue;
-      }
-      DictLevel--;
-    }
-    DictPtr += 5;
-    range = (UINT32) (PrelinkInfoSize - (DictPtr - WholePlist));
+  if (PrelinkedKextsIndex () == EFI_NOT_READY) {
+    DBG ("%a: no prelinked kexts index\n", __FUNCTION__);
+    return;
   }
+  if (mPrelinkedKextsStart != 0) {
+    // a previous call moved on to later kexts
+    mPrelinkedKextsWindow = PrelinkedKextsIndexFrom (0, 0);
+  }
+
+  do {
+    PatchIndexedKexts ();
+  } while (PrelinkedKextsIndexNext () != EFI_NOT_FOUND);
 }
 
 #if 0
@@ -34,31 +34,25 @@ GetEfiTimeInMs (
   return TimeMs;
 }
 
-/** Searches all volumes for the most recent nvram.plist and loads it into gNvramDict. */
+/** Searches all volumes for the most recent nvram.plist and loads it into gNvramDict.
+ *  Uses the volume scan, so nvram.plist presence and dates come from its cache.
+ */
 EFI_STATUS
 LoadLatestNvramPlist (
   VOID
 )
 {
-#if 0
-  EFI_GUID                        *Guid;
-#endif
   CHAR16                          *DPString;
-  EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
-  EFI_FILE_HANDLE                 FHandle;
-  EFI_FILE_HANDLE                 FileHandle;
-  EFI_FILE_HANDLE                 File;
-  EFI_FILE_INFO                   *FileInfo;
+  BDS_VOLUME                      *Volumes;
+  BDS_VOLUME                      *Vol;
+  BDS_VOLUME                      *Latest;
   UINT64                          LastModifTimeMs;
   UINT64                          ModifTimeMs;
-  UINTN                           NumberFileSystemHandles;
-  EFI_HANDLE                      *FileSystemHandles;
+  UINTN                           NumberVolumes;
   UINTN                           Index;
-  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume;
   EFI_STATUS                      Status;
   
-  DPString = NULL;
-  FHandle = NULL;
+  Latest = NULL;
   LastModifTimeMs = 0;
   
   DBG ("Searching volumes for latest nvram.plist ...");
@@ -73,85 +67,39 @@ LoadLatestNvramPlist (
   
   // find latest nvram.plist
   // search all volumes
-  gBS->LocateHandleBuffer (
-         ByProtocol,
-         &gEfiSimpleFileSystemProtocolGuid,
-         NULL,
-         &NumberFileSystemHandles,
-         &FileSystemHandles
-         );
+  NumberVolumes = BdsScanVolumes (&Volumes);
   
-  for (Index = 0; Index < NumberFileSystemHandles; Index++) {
-    DevicePath  = DevicePathFromHandle (FileSystemHandles[Index]);
-#if 0
-    Guid = FindGPTPartitionGuidInDevicePath (DevicePath);
-    DBG (" %2d. Volume '%s', GUID = %g", Index, Volume->VolName, Guid);
-    if (Guid == NULL) {
-      // not a GUID partition
-      DBG(" - not GPT");
-    }
-    Print (L"%a: Device = %s\n",__FUNCTION__, ConvertDevicePathToText (DevicePath, FALSE, FALSE));
-    Print (L"%a: DevicePath->Type = 0x%x, DevicePath->SubType = 0x%x\n",
-           __FUNCTION__, DevicePath->Type, DevicePath->SubType);
-#endif
-    Status = gBS->HandleProtocol (
-                    FileSystemHandles[Index],
-                    &gEfiSimpleFileSystemProtocolGuid,
-                    (VOID *) &Volume
-                    );
-    if (EFI_ERROR (Status)) {
+  for (Index = 0; Index < NumberVolumes; Index++) {
+    Vol = &Volumes[Index];
+    if (Vol->Root == NULL || (Vol->Flags & VOLUME_NVRAM) == 0) {
       continue;
     }
-    Status = Volume->OpenVolume (Volume, &FileHandle);
-    if (EFI_ERROR (Status)) {
-      continue;
-    }
-    Status = FileHandle->Open (
-                           FileHandle,
-                           &File,
-                           L"nvram.plist",
-                           EFI_FILE_MODE_READ,
-                           0
-                           );
-    if (!EFI_ERROR(Status)) {
-      // get nvram.plist modification date
-      FileInfo = EfiLibFileInfo (File);
-      File->Close (File);
-      if (FileInfo == NULL) {
-        DBG (" - no nvram.plist file info - skipping!\n");
-        FileHandle->Close (FileHandle);
-        continue;
-      }
-      DBG(" Modified = ");
-      ModifTimeMs = GetEfiTimeInMs (&FileInfo->ModificationTime);
-      DBG ("%d-%d-%d %d:%d:%d (%ld ms)",
-           FileInfo->ModificationTime.Year, FileInfo->ModificationTime.Month, FileInfo->ModificationTime.Day,
-           FileInfo->ModificationTime.Hour, FileInfo->ModificationTime.Minute, FileInfo->ModificationTime.Second,
-           ModifTimeMs);
-      FreePool (FileInfo);
-      // check if newer
-      if (LastModifTimeMs < ModifTimeMs) {
-        DBG (" - newer - will use this one\n");
-        DPString = ConvertDevicePathToText (DevicePath, FALSE, FALSE);
-        FHandle = FileHandle;
-        LastModifTimeMs = ModifTimeMs;
-      } else {
-        DBG (" - older - skipping!\n");
-        FileHandle->Close (FileHandle);
-        continue;
-      }
+    DBG(" %d. Modified = ", Index);
+    ModifTimeMs = GetEfiTimeInMs (&Vol->NvramTime);
+    DBG ("%d-%d-%d %d:%d:%d (%ld ms)",
+         Vol->NvramTime.Year, Vol->NvramTime.Month, Vol->NvramTime.Day,
+         Vol->NvramTime.Hour, Vol->NvramTime.Minute, Vol->NvramTime.Second,
+         ModifTimeMs);
+    // check if newer
+    if (LastModifTimeMs < ModifTimeMs) {
+      DBG (" - newer - will use this one\n");
+      Latest = Vol;
+      LastModifTimeMs = ModifTimeMs;
     } else {
-      FileHandle->Close (FileHandle);
+      DBG (" - older - skipping!\n");
     }
   }
   
   //
   // if we have nvram.plist - load it
   //
-  if (FHandle != NULL) {
+  if (Latest != NULL) {
+    DPString = ConvertDevicePathToText (DevicePathFromHandle (Latest->Handle), FALSE, FALSE);
     DBG (" loading nvram.plist from Vol '%s'\n", DPString);
-    gNvramDict = LoadPListFile (FHandle, L"nvram.plist");
-    FHandle->Close (FHandle);
+    if (DPString != NULL) {
+      FreePool (DPString);
+    }
+    gNvramDict = LoadPListFile (Latest->Root, L"nvram.plist");
     Status = EFI_SUCCESS;
   } else {
     DBG (" nvram.plist not found!\n");
@@ -171,7 +119,7 @@ PutNvramPlistToRtVars (
 )
 {
   EFI_STATUS      Status;
-  UINTN           i, DictSize;
+  pliter_t        Iter;
   VOID            *prop;
   VOID            *val;
   CHAR8           *akey;
@@ -191,9 +139,8 @@ PutNvramPlistToRtVars (
   
   DBG ("PutNvramPlistToRtVars ...\n");
   // iterate over dict elements
-  DictSize = plNodeGetSize (gNvramDict);
-  for (i = 0; i < DictSize; i++) {
-    prop = plNodeGetItem (gNvramDict, (unsigned int) i);
+  plIterInit (&Iter, gNvramDict);
+  while ((prop = plIterNext (&Iter)) != NULL) {
     len = plNodeGetSize(prop);
     akey = plNodeGetBytes (prop);
     
@@ -0,0 +1,259 @@
+/** @file
+ * macosx.h
+ * POSIX user space stand-in for the firmware environment of smbios.c.
+ * Only what smbios.c touches is declared here.
+ */
+#ifndef _MACOSX_H_
+#define _MACOSX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t   UINT8;
+typedef uint16_t  UINT16;
+typedef uint32_t  UINT32;
+typedef uint64_t  UINT64;
+typedef int8_t    INT8;
+typedef int16_t   INT16;
+typedef int32_t   INT32;
+typedef int64_t   INT64;
+typedef uintptr_t UINTN;
+typedef intptr_t  INTN;
+typedef char      CHAR8;
+typedef uint16_t  CHAR16;
+typedef uint8_t   BOOLEAN;
+typedef void      VOID;
+typedef UINTN     EFI_STATUS;
+typedef UINT64    EFI_PHYSICAL_ADDRESS;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST const
+#define STATIC static
+#define EFIAPI
+#define TRUE  ((BOOLEAN) 1)
+#define FALSE ((BOOLEAN) 0)
+
+#define EFI_SUCCESS           0
+#define EFI_NOT_FOUND         (((UINTN) 1 << (sizeof (UINTN) * 8 - 1)) | 14)
+#define EFI_OUT_OF_RESOURCES  (((UINTN) 1 << (sizeof (UINTN) * 8 - 1)) | 9)
+#define EFI_ERROR(a)          (((INTN) (a)) < 0)
+
+#define EFI_PAGE_SIZE         0x1000
+#define EFI_SIZE_TO_PAGES(a)  (((a) >> 12) + (((a) & 0xFFF) ? 1 : 0))
+#define SIGNATURE_16(A, B)    ((A) | (B << 8))
+#define SIGNATURE_32(A, B, C, D) (SIGNATURE_16 (A, B) | (SIGNATURE_16 (C, D) << 16))
+
+#define EFI_SYSTEM_TABLE_MAX_ADDRESS 0xFFFFFFFF
+#define ROUND_PAGE(x)  ((((unsigned)(x)) + EFI_PAGE_SIZE - 1) & ~(EFI_PAGE_SIZE - 1))
+
+#define MAX_RAM_SLOTS   8
+#define MAX_CACHE_COUNT 4
+
+#define DBG(...)
+
+typedef struct {
+  UINT32  Data1;
+  UINT16  Data2;
+  UINT16  Data3;
+  UINT8   Data4[8];
+} GUID;
+
+typedef GUID EFI_GUID;
+
+//
+// Protocol/Smbios.h
+//
+typedef UINT8  EFI_SMBIOS_TYPE;
+typedef UINT16 EFI_SMBIOS_HANDLE;
+
+typedef struct {
+  EFI_SMBIOS_TYPE   Type;
+  UINT8             Length;
+  EFI_SMBIOS_HANDLE Handle;
+} EFI_SMBIOS_TABLE_HEADER;
+
+#define EFI_SMBIOS_TYPE_BIOS_INFORMATION                  0
+#define EFI_SMBIOS_TYPE_SYSTEM_INFORMATION                1
+#define EFI_SMBIOS_TYPE_BASEBOARD_INFORMATION             2
+#define EFI_SMBIOS_TYPE_SYSTEM_ENCLOSURE                  3
+#define EFI_SMBIOS_TYPE_PROCESSOR_INFORMATION             4
+#define EFI_SMBIOS_TYPE_CACHE_INFORMATION                 7
+#define EFI_SMBIOS_TYPE_PHYSICAL_MEMORY_ARRAY             16
+#define EFI_SMBIOS_TYPE_MEMORY_DEVICE                     17
+#define EFI_SMBIOS_TYPE_MEMORY_ARRAY_MAPPED_ADDRESS       19
+#define EFI_SMBIOS_TYPE_MEMORY_DEVICE_MAPPED_ADDRESS      20
+
+//
+// Boot services, system table and HOBs
+//
+typedef enum {
+  AllocateAnyPages,
+  AllocateMaxAddress,
+  AllocateAddress
+} EFI_ALLOCATE_TYPE;
+
+typedef enum {
+  EfiACPIReclaimMemory = 9,
+  EfiACPIMemoryNVS = 10
+} EFI_MEMORY_TYPE;
+
+typedef struct {
+  EFI_STATUS (*AllocatePages) (EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType,
+                               UINTN Pages, EFI_PHYSICAL_ADDRESS *Memory);
+  EFI_STATUS (*InstallConfigurationTable) (EFI_GUID *Guid, VOID *Table);
+  EFI_STATUS (*CalculateCrc32) (VOID *Data, UINTN DataSize, UINT32 *Crc32);
+} EFI_BOOT_SERVICES;
+
+typedef struct {
+  UINT64  Signature;
+  UINT32  Revision;
+  UINT32  HeaderSize;
+  UINT32  CRC32;
+  UINT32  Reserved;
+} EFI_TABLE_HEADER;
+
+typedef struct {
+  EFI_TABLE_HEADER  Hdr;
+} EFI_SYSTEM_TABLE;
+
+typedef struct {
+  UINT16    HobType;
+  UINT16    HobLength;
+  UINT32    Reserved;
+} EFI_HOB_GENERIC_HEADER;
+
+typedef struct {
+  EFI_HOB_GENERIC_HEADER  Header;
+  EFI_GUID                Name;
+} EFI_HOB_GUID_TYPE;
+
+typedef union {
+  EFI_HOB_GENERIC_HEADER  *Header;
+  EFI_HOB_GUID_TYPE       *Guid;
+  UINT8                   *Raw;
+} EFI_PEI_HOB_POINTERS;
+
+#define GET_GUID_HOB_DATA(HobStart)      ((VOID *) ((UINT8 *) (HobStart) + sizeof (EFI_HOB_GUID_TYPE)))
+#define GET_GUID_HOB_DATA_SIZE(HobStart) ((UINT16) ((HobStart).Header->HobLength - sizeof (EFI_HOB_GUID_TYPE)))
+
+extern EFI_BOOT_SERVICES  *gBS;
+extern EFI_SYSTEM_TABLE   *gST;
+extern EFI_GUID           gEfiSmbiosTableGuid;
+
+VOID  *GetHobList (VOID);
+VOID  *GetFirstGuidHob (CONST EFI_GUID *Guid);
+VOID  *GetNextGuidHob (CONST EFI_GUID *Guid, CONST VOID *HobStart);
+
+//
+// BaseLib, BaseMemoryLib, MemoryAllocationLib, PrintLib
+//
+VOID   *AllocatePool (UINTN AllocationSize);
+VOID   *AllocateZeroPool (UINTN AllocationSize);
+VOID   FreePool (VOID *Buffer);
+VOID   *CopyMem (VOID *DestinationBuffer, CONST VOID *SourceBuffer, UINTN Length);
+VOID   *ZeroMem (VOID *Buffer, UINTN Length);
+VOID   *SetMem16 (VOID *Buffer, UINTN Length, UINT16 Value);
+UINTN  AsciiStrLen (CONST CHAR8 *String);
+UINTN  AsciiStrSize (CONST CHAR8 *String);
+UINTN  AsciiSPrint (CHAR8 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, ...);
+UINT64 DivU64x32 (UINT64 Dividend, UINT32 Divisor);
+UINT8  CalculateSum8 (CONST UINT8 *Buffer, UINTN Length);
+
+//
+// Platform data
+//
+typedef struct {
+  UINT8   Type;
+  UINT32  ModuleSize;
+  UINT32  Frequency;
+  CHAR8*  Vendor;
+  CHAR8*  PartNo;
+  CHAR8*  SerialNo;
+  UINT8   *spd;
+  BOOLEAN InUse;
+  UINT16  SpdSize;
+} RAM_SLOT_INFO;
+
+typedef struct {
+  BOOLEAN   SpdDetected;
+  UINT8     MaxMemorySlots;
+  UINT16    MemoryModules;
+  UINT16    Map[MAX_RAM_SLOTS];
+  RAM_SLOT_INFO DIMM[MAX_RAM_SLOTS];
+} MEM_STRUCTURE;
+
+typedef struct {
+  BOOLEAN      InUse;
+  UINT8        MemoryType;
+  UINT16       Speed;
+  UINT16       Size;
+  CHAR8*       DeviceLocator;
+  CHAR8*       BankLocator;
+  CHAR8*       Manufacturer;
+  CHAR8*       SerialNumber;
+  CHAR8*       PartNumber;
+} CUSTOM_SMBIOS_TYPE17;
+
+typedef struct {
+  CHAR8   VendorName[64];
+  CHAR8   RomVersion[64];
+  CHAR8   ReleaseDate[64];
+  CHAR8   ManufactureName[64];
+  CHAR8   ProductName[64];
+  CHAR8   VersionNr[64];
+  CHAR8   SerialNr[64];
+  CHAR8   FamilyName[64];
+  CHAR8   OEMProduct[64];
+  CHAR8   OEMVendor[64];
+  CHAR8   OEMBoard[64];
+  CHAR8   BoardManufactureName[64];
+  CHAR8   BoardSerialNumber[64];
+  CHAR8   BoardNumber[64];
+  CHAR8   LocationInChassis[64];
+  CHAR8   BoardVersion[64];
+  CHAR8   ChassisManufacturer[64];
+  CHAR8   ChassisAssetTag[64];
+  UINT16  CpuType;
+  UINT32  ProcessorInterconnectSpeed;
+  UINTN   MacAddrLen;
+  UINT8   *EthMacAddr;
+  BOOLEAN SPDScan;
+  CUSTOM_SMBIOS_TYPE17 cMemDevice[MAX_RAM_SLOTS];
+} SETTINGS_DATA;
+
+typedef struct {
+  CHAR8   BrandString[48];
+  UINT32  Model;
+  UINT64  Features;
+  UINT64  ExtFeatures;
+  UINT8   Cores;
+  UINT8   Threads;
+  UINT64  FSBFrequency;
+  UINT64  CPUFrequency;
+  UINT64  ProcessorInterconnectSpeed;
+} CPU_STRUCTURE;
+
+extern MEM_STRUCTURE  *gRAM;
+extern SETTINGS_DATA  gSettings;
+extern CPU_STRUCTURE  gCPUStructure;
+extern EFI_GUID       gUuid;
+extern EFI_GUID       gSystemID;
+extern EFI_GUID       gPlatformUuid;
+extern EFI_STATUS     SystemIDStatus;
+extern EFI_STATUS     PlatformUuidStatus;
+
+UINT32
+hex2bin (
+  IN CHAR8 *hex,
+  OUT UINT8 *bin,
+  INT32 len
+);
+
+VOID
+ScanSPD (
+  VOID
+);
+
+#endif
@@ -0,0 +1,515 @@
+/** @file
+ * tstsmbios.c
+ * Golden test for PatchSmbios () in the POSIX user space environment.
+ *
+ * Every seed builds a different SMBIOS table and set of user settings,
+ * runs PatchSmbios () over it and writes the entry point followed by the
+ * emitted tables. smbios.golden holds that output as produced by smbios.c
+ * before the tables were indexed; see the Makefile.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+
+#include <macosx.h>
+
+#include "../cpu.h"
+#include "../SmBios.h"
+
+VOID PatchSmbios (VOID);
+
+#ifndef SEEDS
+#define SEEDS 64
+#endif
+
+//
+// PatchSmbios () keeps 32-bit table addresses, so the firmware memory sits
+// at a fixed address below 4GB
+//
+#define FW_MEMORY_BASE    0x10000000
+#define FW_MEMORY_SIZE    0x200000
+#define FW_TABLE_OFFSET   0x100
+#define FW_PAGES_OFFSET   0x100000
+
+MEM_STRUCTURE         *gRAM;
+SETTINGS_DATA         gSettings;
+CPU_STRUCTURE         gCPUStructure;
+EFI_GUID              gUuid;
+EFI_GUID              gSystemID;
+EFI_GUID              gPlatformUuid;
+EFI_STATUS            SystemIDStatus;
+EFI_STATUS            PlatformUuidStatus;
+EFI_GUID              gEfiSmbiosTableGuid = {0xeb9d2d31, 0x2d88, 0x11d3, {0x9a, 0x16, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d}};
+
+STATIC EFI_BOOT_SERVICES  mBootServices;
+STATIC EFI_SYSTEM_TABLE   mSystemTable;
+EFI_BOOT_SERVICES         *gBS = &mBootServices;
+EFI_SYSTEM_TABLE          *gST = &mSystemTable;
+
+STATIC struct {
+  EFI_HOB_GUID_TYPE     Hob;
+  EFI_PHYSICAL_ADDRESS  Table;
+} mSmbiosHob;
+
+STATIC UINT8   *mFwMemory;
+STATIC UINT32  mRandom;
+STATIC UINT16  mHandle;
+STATIC CHAR8   mStrings[64][24];
+STATIC UINTN   mStringCount;
+
+//
+// Host versions of the library functions smbios.c uses
+//
+
+VOID *AllocatePool (UINTN AllocationSize) { return malloc (AllocationSize); }
+VOID *AllocateZeroPool (UINTN AllocationSize) { return calloc (1, AllocationSize); }
+VOID FreePool (VOID *Buffer) { free (Buffer); }
+VOID *CopyMem (VOID *Dst, CONST VOID *Src, UINTN Length) { return memmove (Dst, Src, Length); }
+VOID *ZeroMem (VOID *Buffer, UINTN Length) { return memset (Buffer, 0, Length); }
+UINTN AsciiStrLen (CONST CHAR8 *String) { return strlen (String); }
+UINTN AsciiStrSize (CONST CHAR8 *String) { return strlen (String) + 1; }
+UINT64 DivU64x32 (UINT64 Dividend, UINT32 Divisor) { return Dividend / Divisor; }
+
+VOID *
+SetMem16 (
+  VOID *Buffer,
+  UINTN Length,
+  UINT16 Value
+)
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Length / 2; Index++) {
+    ((UINT16 *) Buffer)[Index] = Value;
+  }
+  return Buffer;
+}
+
+UINTN
+AsciiSPrint (
+  CHAR8 *StartOfBuffer,
+  UINTN BufferSize,
+  CONST CHAR8 *FormatString,
+  ...
+)
+{
+  va_list Marker;
+  int     Length;
+
+  va_start (Marker, FormatString);
+  Length = vsnprintf (StartOfBuffer, BufferSize, FormatString, Marker);
+  va_end (Marker);
+  return (UINTN) Length;
+}
+
+UINT8
+CalculateSum8 (
+  CONST UINT8 *Buffer,
+  UINTN Length
+)
+{
+  UINT8 Sum;
+
+  for (Sum = 0; Length > 0; Length--) {
+    Sum = (UINT8) (Sum + *Buffer++);
+  }
+  return Sum;
+}
+
+UINT32
+hex2bin (
+  IN CHAR8 *hex,
+  OUT UINT8 *bin,
+  INT32 len
+)
+{
+  INT32   Index;
+  UINT32  Byte;
+
+  for (Index = 0; Index < len; Index++) {
+    if (sscanf (hex + Index * 2, "%2x", &Byte) != 1) {
+      return 0;
+    }
+    bin[Index] = (UINT8) Byte;
+  }
+  return (UINT32) len;
+}
+
+VOID
+ScanSPD (
+  VOID
+)
+{
+}
+
+VOID *GetHobList (VOID) { return &mSmbiosHob; }
+VOID *GetFirstGuidHob (CONST EFI_GUID *Guid) { return &mSmbiosHob; }
+VOID *GetNextGuidHob (CONST EFI_GUID *Guid, CONST VOID *HobStart) { return &mSmbiosHob; }
+
+STATIC
+EFI_STATUS
+TstAllocatePages (
+  EFI_ALLOCATE_TYPE Type,
+  EFI_MEMORY_TYPE MemoryType,
+  UINTN Pages,
+  EFI_PHYSICAL_ADDRESS *Memory
+)
+{
+  if (Pages * EFI_PAGE_SIZE > FW_MEMORY_SIZE - FW_PAGES_OFFSET) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *Memory = FW_MEMORY_BASE + FW_PAGES_OFFSET;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+TstInstallConfigurationTable (
+  EFI_GUID *Guid,
+  VOID *Table
+)
+{
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+TstCalculateCrc32 (
+  VOID *Data,
+  UINTN DataSize,
+  UINT32 *Crc32
+)
+{
+  *Crc32 = 0;
+  return EFI_SUCCESS;
+}
+
+//
+// Table and settings generator
+//
+
+STATIC
+UINT32
+Random (
+  UINT32 Range
+)
+{
+  mRandom = mRandom * 1103515245 + 12345;
+  return ((mRandom >> 16) & 0x7FFF) % Range;
+}
+
+STATIC
+VOID
+RandomString (
+  CHAR8 *String,
+  UINTN MaxLength
+)
+{
+  UINTN Length;
+  UINTN Index;
+
+  Length = Random ((UINT32) MaxLength + 1);
+  for (Index = 0; Index < Length; Index++) {
+    String[Index] = (CHAR8) ('A' + Random (26));
+  }
+  //
+  // Trailing blanks are cut by iStrLen () and must survive untouched
+  //
+  if (Length > 1 && Random (4) == 0) {
+    String[Length - 1] = ' ';
+  }
+  String[Length] = 0;
+}
+
+STATIC
+CHAR8 *
+RandomSetting (
+  VOID
+)
+{
+  if (Random (3) == 0) {
+    return NULL;
+  }
+  RandomString (mStrings[mStringCount], 20);
+  return mStrings[mStringCount++];
+}
+
+STATIC
+VOID
+RandomSettingArray (
+  CHAR8 *Setting
+)
+{
+  if (Random (2) == 0) {
+    Setting[0] = 0;
+  } else {
+    RandomString (Setting, 20);
+  }
+}
+
+/**
+ Append one structure of LType at Current with a formatted area of Length
+ random bytes and up to six strings. Returns the byte after the structure.
+**/
+STATIC
+UINT8 *
+AddStructure (
+  UINT8 *Current,
+  UINT8 LType,
+  UINT8 Length
+)
+{
+  SMBIOS_STRUCTURE_POINTER Table;
+  UINTN                    Index;
+  UINTN                    StringCount;
+  CHAR8                    String[20];
+
+  Table.Raw = Current;
+  for (Index = 0; Index < Length; Index++) {
+    Current[Index] = (UINT8) Random (256);
+  }
+  Table.Hdr->Type = LType;
+  Table.Hdr->Length = Length;
+  Table.Hdr->Handle = mHandle++;
+
+  //
+  // Keep the fields smbios.c uses as array indexes in range
+  //
+  switch (LType) {
+    case EFI_SMBIOS_TYPE_CACHE_INFORMATION:
+      Table.Type7->CacheConfiguration = (UINT16) ((Table.Type7->CacheConfiguration & ~7) | Random (4));
+      if (Random (2) == 0) {
+        Table.Type7->SocketDesignation = 0;
+      }
+      break;
+    case EFI_SMBIOS_TYPE_PHYSICAL_MEMORY_ARRAY:
+      Table.Type16->NumberOfMemoryDevices = (UINT16) Random (MAX_RAM_SLOTS + 1);
+      break;
+    case EFI_SMBIOS_TYPE_PROCESSOR_INFORMATION:
+      if (Random (2) == 0) {
+        Table.Type4->ProcessorVersion = 0;
+      }
+      break;
+  }
+
+  Current += Length;
+  StringCount = Random (7);
+  if (StringCount == 0) {
+    *Current++ = 0;
+  }
+  for (Index = 0; Index < StringCount; Index++) {
+    do {
+      RandomString (String, 16);
+    } while (String[0] == 0);
+    strcpy ((char *) Current, String);
+    Current += strlen (String) + 1;
+  }
+  *Current++ = 0;
+  return Current;
+}
+
+STATIC
+UINT8
+RandomLength (
+  UINT8 MinLength,
+  UINT8 MaxLength
+)
+{
+  return (UINT8) (MinLength + Random (MaxLength - MinLength + 1));
+}
+
+STATIC
+VOID
+BuildSmbios (
+  VOID
+)
+{
+  //
+  // Types PatchSmbios () looks up, the smallest formatted area it reads and
+  // the largest formatted area to generate
+  //
+  STATIC CONST UINT8 Known[][3] = {
+    {0,   0x12, 0x18},
+    {1,   0x08, 0x1B},
+    {2,   0x0F, 0x11},
+    {3,   0x0D, 0x15},
+    {4,   0x1A, 0x2A},
+    {6,   0x0C, 0x0C},
+    {7,   0x0F, 0x13},
+    {8,   0x09, 0x09},
+    {9,   0x0D, 0x11},
+    {10,  0x06, 0x08},
+    {11,  0x05, 0x05},
+    {16,  0x0F, 0x0F},
+    {17,  0x15, 0x1B},
+    {18,  0x17, 0x17},
+    {19,  0x0F, 0x0F},
+    {20,  0x13, 0x13},
+    {21,  0x07, 0x07},
+    {22,  0x1A, 0x1A},
+    {27,  0x0C, 0x0F},
+    {28,  0x16, 0x16},
+    {32,  0x0B, 0x0B},
+    {33,  0x1F, 0x1F},
+    {132, 0x06, 0x06},
+    {5,   0x04, 0x18},
+    {13,  0x04, 0x16},
+    {126, 0x04, 0x10},
+    {200, 0x04, 0x20}
+  };
+  SMBIOS_TABLE_ENTRY_POINT *Eps;
+  UINT8                    *Current;
+  UINT8                    *Start;
+  UINTN                    Index;
+  UINTN                    Count;
+  UINTN                    Pick;
+  UINTN                    Structures;
+
+  memset (mFwMemory, 0, FW_MEMORY_SIZE);
+  mHandle = 0;
+  Eps = (SMBIOS_TABLE_ENTRY_POINT *) mFwMemory;
+  memcpy (Eps->AnchorString, "_SM_", 4);
+  Eps->EntryPointLength = 0x1F;
+  Eps->MajorVersion = 2;
+  Eps->MinorVersion = (UINT8) Random (8);
+  memcpy (Eps->IntermediateAnchorString, "_DMI_", 5);
+
+  Start = mFwMemory + FW_TABLE_OFFSET;
+  Current = Start;
+
+  //
+  // Most tables have one of each main type, in firmware order; then a
+  // random mix of every type follows
+  //
+  for (Index = 0; Index < 23; Index++) {
+    Count = (Random (8) == 0) ? 0 : 1;
+    if (Known[Index][0] == 4 || Known[Index][0] == 7 || Known[Index][0] == 17 ||
+        Known[Index][0] == 19 || Known[Index][0] == 20) {
+      Count = Random (5);
+    }
+    for (; Count > 0; Count--) {
+      Current = AddStructure (Current, Known[Index][0],
+                              RandomLength (Known[Index][1], Known[Index][2]));
+    }
+  }
+  Structures = Random (24);
+  for (Index = 0; Index < Structures; Index++) {
+    Pick = Random (sizeof (Known) / sizeof (Known[0]));
+    Current = AddStructure (Current, Known[Pick][0],
+                            RandomLength (Known[Pick][1], Known[Pick][2]));
+  }
+
+  ((SMBIOS_STRUCTURE *) Current)->Type = SMBIOS_TYPE_END_OF_TABLE;
+  ((SMBIOS_STRUCTURE *) Current)->Length = sizeof (SMBIOS_STRUCTURE);
+  ((SMBIOS_STRUCTURE *) Current)->Handle = mHandle++;
+  Current += sizeof (SMBIOS_STRUCTURE) + 2;
+
+  Eps->TableLength = (UINT16) (Current - Start);
+  Eps->TableAddress = (UINT32) (UINTN) Start;
+  Eps->NumberOfSmbiosStructures = mHandle;
+  mSmbiosHob.Hob.Header.HobLength = sizeof (mSmbiosHob);
+  mSmbiosHob.Table = (UINTN) Eps;
+}
+
+STATIC
+VOID
+BuildSettings (
+  VOID
+)
+{
+  UINTN Index;
+  CHAR8 *Setting;
+
+  memset (&gSettings, 0, sizeof (gSettings));
+  memset (&gCPUStructure, 0, sizeof (gCPUStructure));
+  mStringCount = 0;
+
+  RandomSettingArray (gSettings.VendorName);
+  RandomSettingArray (gSettings.RomVersion);
+  RandomSettingArray (gSettings.ReleaseDate);
+  RandomSettingArray (gSettings.ManufactureName);
+  RandomSettingArray (gSettings.ProductName);
+  RandomSettingArray (gSettings.VersionNr);
+  RandomSettingArray (gSettings.SerialNr);
+  RandomSettingArray (gSettings.FamilyName);
+  RandomSettingArray (gSettings.BoardManufactureName);
+  RandomSettingArray (gSettings.BoardSerialNumber);
+  RandomSettingArray (gSettings.BoardNumber);
+  RandomSettingArray (gSettings.LocationInChassis);
+  RandomSettingArray (gSettings.BoardVersion);
+  RandomSettingArray (gSettings.ChassisManufacturer);
+  RandomSettingArray (gSettings.ChassisAssetTag);
+  gSettings.CpuType = (UINT16) Random (0x10000);
+  gSettings.ProcessorInterconnectSpeed = (Random (2) == 0) ? 0 : Random (6400);
+
+  for (Index = 0; Index < MAX_RAM_SLOTS; Index++) {
+    gSettings.cMemDevice[Index].InUse = (BOOLEAN) (Random (2) == 0);
+    gSettings.cMemDevice[Index].MemoryType = (UINT8) (Random (2) == 0 ? 0x02 : Random (0x20));
+    gSettings.cMemDevice[Index].Speed = (UINT16) (Random (2) == 0 ? 0 : Random (2000));
+    gSettings.cMemDevice[Index].Size = (UINT16) (Random (2) == 0 ? 0xFFFF : Random (0x10000));
+    gSettings.cMemDevice[Index].DeviceLocator = RandomSetting ();
+    gSettings.cMemDevice[Index].BankLocator = RandomSetting ();
+    gSettings.cMemDevice[Index].Manufacturer = RandomSetting ();
+    gSettings.cMemDevice[Index].SerialNumber = RandomSetting ();
+    gSettings.cMemDevice[Index].PartNumber = RandomSetting ();
+  }
+
+  Setting = RandomSetting ();
+  if (Setting != NULL) {
+    strcpy (gCPUStructure.BrandString, Setting);
+  }
+  gCPUStructure.Model = (Random (2) == 0) ? CPU_MODEL_NEHALEM : Random (0x40);
+  gCPUStructure.Features = Random (0x8000) | ((UINT64) Random (0x8000) << 15);
+  gCPUStructure.ExtFeatures = Random (0x8000) | ((UINT64) Random (0x8000) << 15);
+  gCPUStructure.Cores = (UINT8) (1 + Random (4));
+  gCPUStructure.Threads = (UINT8) (gCPUStructure.Cores * (1 + Random (2)));
+  gCPUStructure.FSBFrequency = 100000000ULL + Random (0x8000) * 1000ULL;
+  gCPUStructure.CPUFrequency = 2000000000ULL + Random (0x8000) * 100000ULL;
+  gCPUStructure.ProcessorInterconnectSpeed = (Random (2) == 0) ? 0 : Random (6400);
+
+  SystemIDStatus = (Random (2) == 0) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  PlatformUuidStatus = (Random (2) == 0) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  memset (&gSystemID, 0x11, sizeof (gSystemID));
+  memset (&gPlatformUuid, 0x22, sizeof (gPlatformUuid));
+}
+
+int
+main (
+  int argc,
+  char **argv
+)
+{
+  SMBIOS_TABLE_ENTRY_POINT *Eps;
+  UINT32                   Seed;
+
+  mFwMemory = mmap ((VOID *) FW_MEMORY_BASE, FW_MEMORY_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if (mFwMemory != (UINT8 *) FW_MEMORY_BASE) {
+    fprintf (stderr, "can not map firmware memory at 0x%x\n", FW_MEMORY_BASE);
+    return 1;
+  }
+
+  mBootServices.AllocatePages = TstAllocatePages;
+  mBootServices.InstallConfigurationTable = TstInstallConfigurationTable;
+  mBootServices.CalculateCrc32 = TstCalculateCrc32;
+  mSystemTable.Hdr.HeaderSize = sizeof (mSystemTable);
+
+  for (Seed = 1; Seed <= SEEDS; Seed++) {
+    mRandom = Seed;
+    BuildSmbios ();
+    BuildSettings ();
+    PatchSmbios ();
+
+    Eps = (SMBIOS_TABLE_ENTRY_POINT *) (UINTN) mSmbiosHob.Table;
+    if (Eps != (SMBIOS_TABLE_ENTRY_POINT *) (mFwMemory + FW_PAGES_OFFSET)) {
+      fprintf (stderr, "seed %u: no new entry point\n", Seed);
+      return 1;
+    }
+    fwrite (Eps, 1, Eps->EntryPointLength, stdout);
+    fwrite ((VOID *) (UINTN) Eps->TableAddress, 1, Eps->TableLength, stdout);
+  }
+  return 0;
+}
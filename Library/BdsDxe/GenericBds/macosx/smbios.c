@@ -27,6 +27,7 @@
 #define MAX_HANDLE        0xFEFF
 #define SMBIOS_PTR        SIGNATURE_32('_','S','M','_')
 #define MAX_TABLE_SIZE    512
+#define SMBIOS_INDEX_NONE 0xFFFF
 
 static EFI_GUID             *gTableGuidArray[] = {&gEfiSmbiosTableGuid};
 
@@ -50,6 +51,19 @@ UINTN       Index, Size, NewSize, MaxSize;
 UINTN       stringNumber;
 UINTN       TableSize;
 
+//
+// Index of the original tables, built in one walk: every structure in
+// table order, chained by type so (type, instance) lookups skip the rest.
+//
+typedef struct {
+  UINT8     *Raw;
+  UINT16    Next;       // next structure of the same type
+} SMBIOS_INDEX_ENTRY;
+
+SMBIOS_INDEX_ENTRY          *mSmbiosIndex = NULL;
+UINT8                       *mSmbiosIndexTable = NULL;
+UINT16                      mSmbiosIndexFirst[256];
+
 UINTN
 iStrLen (
   CHAR8* String,
@@ -149,6 +163,61 @@ LogSmbiosTable (
   return LSmbiosTable.Hdr->Handle;
 }
 
+/**
+ Walk the tables at LSmbios->TableAddress once and record where each
+ structure starts. Stops at the end-of-table structure or TableLength.
+**/
+VOID
+SmbiosIndexTables (
+  SMBIOS_TABLE_ENTRY_POINT *LSmbios
+)
+{
+  SMBIOS_STRUCTURE_POINTER LSmbiosTable;
+  UINT8                    *TableEnd;
+  UINT16                   Last[256];
+  UINTN                    Count;
+  UINTN                    MaxCount;
+
+  if (mSmbiosIndex != NULL) {
+    FreePool (mSmbiosIndex);
+  }
+
+  SetMem16 (mSmbiosIndexFirst, sizeof (mSmbiosIndexFirst), SMBIOS_INDEX_NONE);
+  SetMem16 (Last, sizeof (Last), SMBIOS_INDEX_NONE);
+  mSmbiosIndexTable = (UINT8 *) (UINTN) LSmbios->TableAddress;
+  MaxCount = LSmbios->TableLength / sizeof (SMBIOS_STRUCTURE) + 1;
+  if (MaxCount > SMBIOS_INDEX_NONE) {
+    MaxCount = SMBIOS_INDEX_NONE;
+  }
+  mSmbiosIndex = AllocatePool (MaxCount * sizeof (SMBIOS_INDEX_ENTRY));
+  if (mSmbiosIndex == NULL || mSmbiosIndexTable == NULL) {
+    return;
+  }
+
+  LSmbiosTable.Raw = mSmbiosIndexTable;
+  TableEnd = mSmbiosIndexTable + LSmbios->TableLength;
+  Count = 0;
+
+  while ((Count < MaxCount) && (LSmbiosTable.Raw + sizeof (SMBIOS_STRUCTURE) <= TableEnd)) {
+    mSmbiosIndex[Count].Raw = LSmbiosTable.Raw;
+    mSmbiosIndex[Count].Next = SMBIOS_INDEX_NONE;
+    if (mSmbiosIndexFirst[LSmbiosTable.Hdr->Type] == SMBIOS_INDEX_NONE) {
+      mSmbiosIndexFirst[LSmbiosTable.Hdr->Type] = (UINT16) Count;
+    } else {
+      mSmbiosIndex[Last[LSmbiosTable.Hdr->Type]].Next = (UINT16) Count;
+    }
+    Last[LSmbiosTable.Hdr->Type] = (UINT16) Count;
+    Count++;
+
+    if (LSmbiosTable.Hdr->Type == SMBIOS_TYPE_END_OF_TABLE) {
+      break;
+    }
+    LSmbiosTable.Raw = (UINT8 *) (LSmbiosTable.Raw + SmbiosTableLength (LSmbiosTable));
+  }
+
+  DBG ("Smbios: indexed %d structures\n", Count);
+}
+
 EFI_STATUS
 UpdateSmbiosString (
   SMBIOS_STRUCTURE_POINTER LSmbiosTable,
@@ -227,8 +296,6 @@ UpdateSmbiosString (
 
   CopyMem (AString, Buffer, BLength);
   *(AString + BLength) = 0; // not sure there is 0
-  Length = SmbiosTableLength (SmbiosTable);
-  C1 = (CHAR8*) (LSmbiosTable.Raw + LSmbiosTable.Hdr->Length);
   return EFI_SUCCESS;
 }
 
@@ -240,28 +307,26 @@ GetSmbiosTableFromType (
 )
 {
   SMBIOS_STRUCTURE_POINTER LSmbiosTable;
-  UINTN                    SmbiosTypeIndex;
+  UINT16                   Entry;
 
-  SmbiosTypeIndex = 0;
-  LSmbiosTable.Raw = (UINT8 *) (UINTN) LSmbios->TableAddress;
+  LSmbiosTable.Raw = NULL;
 
-  if (LSmbiosTable.Raw == NULL) {
+  if (mSmbiosIndexTable != (UINT8 *) (UINTN) LSmbios->TableAddress) {
+    SmbiosIndexTables (LSmbios);
+  }
+  if (mSmbiosIndex == NULL) {
     return LSmbiosTable;
   }
 
-  while ((SmbiosTypeIndex != LIndex) || (LSmbiosTable.Hdr->Type != LType)) {
-    if (LSmbiosTable.Hdr->Type == SMBIOS_TYPE_END_OF_TABLE) {
-      LSmbiosTable.Raw = NULL;
-      return LSmbiosTable;
-    }
-
-    if (LSmbiosTable.Hdr->Type == LType) {
-      SmbiosTypeIndex++;
-    }
-
-    LSmbiosTable.Raw = (UINT8 *) (LSmbiosTable.Raw + SmbiosTableLength (LSmbiosTable));
+  Entry = mSmbiosIndexFirst[LType];
+  while ((Entry != SMBIOS_INDEX_NONE) && (LIndex != 0)) {
+    Entry = mSmbiosIndex[Entry].Next;
+    LIndex--;
   }
 
+  if (Entry != SMBIOS_INDEX_NONE) {
+    LSmbiosTable.Raw = mSmbiosIndex[Entry].Raw;
+  }
   return LSmbiosTable;
 }
 
@@ -687,7 +752,7 @@ PatchTableTypeSome (
       SmbiosTable = GetSmbiosTableFromType (EntryPoint, tableTypes[IndexType], Index);
 
       if (SmbiosTable.Raw == NULL) {
-        continue;
+        break;
       }
       
       switch (tableTypes[IndexType]) {
@@ -1151,6 +1216,7 @@ PatchSmbios (
   //
   // original EPS and tables
   EntryPoint = (SMBIOS_TABLE_ENTRY_POINT*) Smbios; //yes, it is old SmbiosEPS
+  SmbiosIndexTables (EntryPoint);
   //
   // how many we need to add for tables 128, 130, 131, 132 and for strings?
   BufferLen = 0x20 + EntryPoint->TableLength + 64 * 10;
@@ -1233,6 +1299,11 @@ PatchSmbios (
   // there is no need to keep all tables in numeric order. It is not needed
   // neither by specs nor by AppleSmbios.kext
   FreePool ((VOID*) newSmbiosTable.Raw);
+  if (mSmbiosIndex != NULL) {
+    FreePool (mSmbiosIndex);
+    mSmbiosIndex = NULL;
+  }
+  mSmbiosIndexTable = NULL;
   //
   // Get Hob List
   HobStart.Raw = GetHobList ();
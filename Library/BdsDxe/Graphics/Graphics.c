@@ -17,47 +17,24 @@ ConvertPngToGopBlt (
   OUT UINTN *PixelWidth
 )
 {
-  UINT32 InX;
-  UINT32 InY;
-  UINT64 BltBufferSize;
-  PNG_info_t *PngInfo;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *RawImage;
-
-  RawImage = NULL;
-
-  PngInfo = PNG_decode ((UINT8 *) PngImage, (UINT32) PngImageSize);
-
-  if (PNG_error == 0) {
-    BltBufferSize = MultU64x32 (PngInfo->width, PngInfo->height);
-    BltBufferSize =
-      MultU64x32 (BltBufferSize, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-    *GopBltSize = (UINTN) BltBufferSize;
-
-    *GopBlt = AllocateZeroPool ((UINTN) BltBufferSize);
-    Buffer = *GopBlt;
-
-    *PixelHeight = PngInfo->height;
-    *PixelWidth = PngInfo->width;
-
-    RawImage = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) PngInfo->image->data;
-
-    for (InY = 0; InY < PngInfo->height; InY++) {
-      for (InX = 0; InX < PngInfo->width; InX++) {
-        Buffer->Red = RawImage->Blue;
-        Buffer->Blue = RawImage->Red;
-        Buffer->Green = RawImage->Green;
-        Buffer->Reserved = RawImage->Reserved;
+  PNG_info_t PngInfo;
+  UINT8 *Image;
 
-        Buffer++;
-        RawImage++;
-      }
-    }
+  Image = PNG_decode (&PngInfo, (UINT8 *) PngImage, (UINT32) PngImageSize);
+  if (Image == NULL) {
+    DBG ("%a: PNG_decode error %d\n", __FUNCTION__, PNG_error);
+    return EFI_UNSUPPORTED;
+  }
 
-    png_alloc_free_all ();
+  //
+  // The decoder writes EFI_GRAPHICS_OUTPUT_BLT_PIXEL order, so its buffer is the blt buffer
+  //
+  *GopBlt = Image;
+  *GopBltSize = PngInfo.width * PngInfo.height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  *PixelHeight = PngInfo.height;
+  *PixelWidth = PngInfo.width;
 
-  }
-  return (EFI_STATUS) PNG_error;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -322,12 +299,7 @@ ClearScreen (
   EFI_STATUS Status;
   EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixel;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt;
-  UINT8                         *ImageData;
-  UINTN                         ImageSize;
-  UINTN                         BltSize;
-  UINTN                         Height;
-  UINTN                         Width;
+  IMAGE_SURFACE                 *Logo;
   INTN                          DestX;
   INTN                          DestY;
   
@@ -335,9 +307,6 @@ ClearScreen (
   Status = EFI_SUCCESS;
   GraphicsOutput = NULL;
   Pixel = NULL;
-  Blt = NULL;
-  ImageData = NULL;
-  ImageSize = 0;
 
   Status =
     gBS->HandleProtocol (gST->ConsoleOutHandle, &gEfiGraphicsOutputProtocolGuid,
@@ -361,51 +330,23 @@ ClearScreen (
                        GraphicsOutput->Mode->Info->VerticalResolution, 0);
 
   if (NameGuid != NULL) {
-    Status = GetSectionFromAnyFv (
-               NameGuid,
-               EFI_SECTION_RAW,
-               0,
-               (VOID **) &ImageData,
-               &ImageSize
-               );
-    
+    Status = LoadImageSurface (NULL, NameGuid, &Logo);
     if (EFI_ERROR (Status)) {
-      DBG ("%a: GetSectionFromAnyFv  fail with status: %r", __FUNCTION__, Status);
-      goto Down;
-    }
-    
-    Status =
-    ConvertPngToGopBlt (ImageData, ImageSize, (VOID **) &Blt, &BltSize, &Height,
-                        &Width);
-    
-    if (EFI_ERROR (Status)) {
-      DBG ("%a: ConvertPngToGopBlt  fail with status: %r", __FUNCTION__, Status);
-      goto Down;
+      DBG ("%a: LoadImageSurface  fail with status: %r", __FUNCTION__, Status);
+      return;
     }
 
-    DestX = (GraphicsOutput->Mode->Info->HorizontalResolution - Width) / 2;
-    DestY = (GraphicsOutput->Mode->Info->VerticalResolution - Height) / 2;
+    DestX = (GraphicsOutput->Mode->Info->HorizontalResolution - Logo->Width) / 2;
+    DestY = (GraphicsOutput->Mode->Info->VerticalResolution - Logo->Height) / 2;
 
     if ((DestX >= 0) && (DestY >= 0)) {
       Status =
-      BltWithAlpha (GraphicsOutput, Blt, EfiBltBufferToVideo, 0, 0,
-                    (UINTN) DestX, (UINTN) DestY, Width, Height,
-                    Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), TRUE);
+      BltPremultiplied (GraphicsOutput, Logo->Blt, (UINTN) DestX, (UINTN) DestY,
+                        Logo->Width, Logo->Height, (BOOLEAN) !Logo->Opaque);
       if (EFI_ERROR (Status)) {
-        DBG ("%a: BltWithAlpha  fail with status: %r", __FUNCTION__, Status);
+        DBG ("%a: BltPremultiplied  fail with status: %r", __FUNCTION__, Status);
       }
     }
-
-  Down:
-    if (Pixel != NULL) {
-      FreePool (Pixel);
-    }
-    if (ImageData != NULL) {
-      FreePool (ImageData);
-    }
-    if (Blt != NULL) {
-      FreePool (Blt);
-    }
   }
 }
 
@@ -448,110 +389,490 @@ SetModeScreen (
   }
 }
 
-VOID
-UseAlpha (
-  EFI_GRAPHICS_OUTPUT_PROTOCOL * GraphicsOutput,
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL * Foreground,
-  UINT32 DestX,
-  UINT32 DestY,
-  UINT32 Width,
-  UINT32 Height
+//
+// Decoded images live for the rest of the boot in mImageCache, keyed by boot
+// volume and file path or by FV section name. File entries also keep the
+// size and modification time of the file and are decoded again when either
+// changes. An entry whose load failed stays empty and is tried again. With
+// ImageCache set in config.plist, file images are saved next to the file as
+// raw premultiplied pixels (banner.png.blt) and read back from there while
+// the stamp matches, so later boots skip the decoder too.
+//
+#define IMAGE_CACHE_SIGNATURE  SIGNATURE_32 ('B', 'L', 'T', 'C')
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Width;
+  UINT32  Height;
+  UINT32  Opaque;
+  UINT64  SrcSize;
+  UINT64  SrcTime;
+} IMAGE_CACHE_HEADER;
+
+typedef struct _IMAGE_CACHE_ENTRY {
+  struct _IMAGE_CACHE_ENTRY     *Next;
+  EFI_FILE_HANDLE               Root;
+  CHAR16                        *FileName;
+  EFI_GUID                      NameGuid;
+  UINT64                        SrcSize;
+  UINT64                        SrcTime;
+  IMAGE_SURFACE                 Surface;
+} IMAGE_CACHE_ENTRY;
+
+STATIC IMAGE_CACHE_ENTRY              *mImageCache = NULL;
+STATIC EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *mBlendBuffer = NULL;
+STATIC UINTN                          mBlendBufferSize = 0;
+
+//
+// x / 255 rounded, for x up to 255 * 255
+//
+#define DIV_255(x)  ((((x) + 0x80) + (((x) + 0x80) >> 8)) >> 8)
+
+STATIC
+EFI_STATUS
+ImageFileStamp (
+  IN  CHAR16 *FileName,
+  OUT UINT64 *SrcSize,
+  OUT UINT64 *SrcTime
 )
 {
-  EFI_STATUS Status = EFI_SUCCESS;
-  UINT32 InX;
-  UINT32 InY;
-  UINTN Temp;
-  UINT8 *Buffer;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Background;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *FrgnPixel;
+  EFI_STATUS Status;
+  EFI_FILE_HANDLE FileHandle;
+  EFI_FILE_INFO *FileInfo;
 
-  if (GraphicsOutput == NULL) {
-    return;
+  if (gRootFHandle == NULL) {
+    return EFI_NOT_FOUND;
   }
+  Status =
+    gRootFHandle->Open (gRootFHandle, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  FileInfo = EfiLibFileInfo (FileHandle);
+  FileHandle->Close (FileHandle);
+  if (FileInfo == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  *SrcSize = FileInfo->FileSize;
+  *SrcTime = LShiftU64 (FileInfo->ModificationTime.Year, 40) |
+             LShiftU64 (FileInfo->ModificationTime.Month, 32) |
+             LShiftU64 (FileInfo->ModificationTime.Day, 24) |
+             LShiftU64 (FileInfo->ModificationTime.Hour, 16) |
+             LShiftU64 (FileInfo->ModificationTime.Minute, 8) |
+             FileInfo->ModificationTime.Second;
+  FreePool (FileInfo);
+  return EFI_SUCCESS;
+}
 
-  Buffer =
-    AllocatePool (Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+STATIC
+EFI_STATUS
+DecodeImage (
+  IN  UINT8 *ImageData,
+  IN  UINTN ImageSize,
+  OUT IMAGE_SURFACE *Surface
+)
+{
+  EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixel;
+  UINTN BltSize;
+  UINTN Count;
+  UINT8 Alpha;
 
-  Status =
-    GraphicsOutput->Blt (GraphicsOutput,
-                         (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Buffer,
-                         EfiBltVideoToBltBuffer, DestX, DestY, 0, 0, Width,
-                         Height, Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
-    );
+  Surface->Blt = NULL;
+  if (ImageSize > 2 && ImageData[0] == 'B' && ImageData[1] == 'M') {
+    Status =
+      ConvertBmpToGopBlt (ImageData, ImageSize, (VOID **) &Surface->Blt, &BltSize,
+                          &Surface->Height, &Surface->Width);
+    if (!EFI_ERROR (Status)) {
+      for (Count = Surface->Width * Surface->Height, Pixel = Surface->Blt; Count > 0;
+           Count--, Pixel++) {
+        Pixel->Reserved = 0xFF;
+      }
+    }
+  }
+  else {
+    Status =
+      ConvertPngToGopBlt (ImageData, ImageSize, (VOID **) &Surface->Blt, &BltSize,
+                          &Surface->Height, &Surface->Width);
+  }
   if (EFI_ERROR (Status)) {
-    goto Down;
+    return Status;
+  }
+
+  Surface->Opaque = TRUE;
+  for (Count = Surface->Width * Surface->Height, Pixel = Surface->Blt; Count > 0;
+       Count--, Pixel++) {
+    Alpha = Pixel->Reserved;
+    if (Alpha != 0xFF) {
+      Surface->Opaque = FALSE;
+      Pixel->Blue = (UINT8) DIV_255 (Pixel->Blue * Alpha);
+      Pixel->Green = (UINT8) DIV_255 (Pixel->Green * Alpha);
+      Pixel->Red = (UINT8) DIV_255 (Pixel->Red * Alpha);
+    }
   }
+  return EFI_SUCCESS;
+}
 
-  FrgnPixel = Foreground;
-
-  for (InY = 0; InY < Height; InY++) {
-    for (InX = 0; InX < Width; InX++) {
-      Background =
-        (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (Buffer + (InY * Width * 4) +
-                                           (InX * 4));
-
-      Temp =
-        Background->Blue * (255 - FrgnPixel->Reserved) +
-        FrgnPixel->Blue * FrgnPixel->Reserved + 0x80;
-      FrgnPixel->Blue = (UINT8) ((Temp + (Temp >> 8)) >> 8);
-      Temp =
-        Background->Green * (255 - FrgnPixel->Reserved) +
-        FrgnPixel->Green * FrgnPixel->Reserved + 0x80;
-      FrgnPixel->Green = (UINT8) ((Temp + (Temp >> 8)) >> 8);
-      Temp =
-        Background->Red * (255 - FrgnPixel->Reserved) +
-        FrgnPixel->Red * FrgnPixel->Reserved + 0x80;
-      FrgnPixel->Red = (UINT8) ((Temp + (Temp >> 8)) >> 8);
-
-      FrgnPixel++;
+STATIC
+CHAR16 *
+ImageCachePath (
+  IN CHAR16 *FileName
+)
+{
+  CHAR16 *CachePath;
+
+  CachePath = AllocateZeroPool (StrSize (FileName) + StrSize (L".blt"));
+  if (CachePath != NULL) {
+    StrCpy (CachePath, FileName);
+    StrCat (CachePath, L".blt");
+  }
+  return CachePath;
+}
+
+STATIC
+EFI_STATUS
+LoadImageCacheFile (
+  IN  CHAR16 *FileName,
+  IN  UINT64 SrcSize,
+  IN  UINT64 SrcTime,
+  OUT IMAGE_SURFACE *Surface
+)
+{
+  EFI_STATUS Status;
+  CHAR16 *CachePath;
+  UINT8 *Data;
+  UINTN Size;
+  IMAGE_CACHE_HEADER *Header;
+  UINTN BltSize;
+
+  CachePath = ImageCachePath (FileName);
+  if (CachePath == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = egLoadFile (gRootFHandle, CachePath, &Data, &Size);
+  FreePool (CachePath);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = EFI_NOT_FOUND;
+  Header = (IMAGE_CACHE_HEADER *) Data;
+  BltSize = Size - sizeof (IMAGE_CACHE_HEADER);
+  if (Size >= sizeof (IMAGE_CACHE_HEADER) &&
+      Header->Signature == IMAGE_CACHE_SIGNATURE &&
+      Header->SrcSize == SrcSize && Header->SrcTime == SrcTime &&
+      Header->Height != 0 && Header->Width <= MAX_UINT32 / 4 / Header->Height &&
+      BltSize == Header->Width * Header->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) {
+    Surface->Blt = AllocateCopyPool (BltSize, Header + 1);
+    if (Surface->Blt != NULL) {
+      Surface->Width = Header->Width;
+      Surface->Height = Header->Height;
+      Surface->Opaque = (BOOLEAN) (Header->Opaque != 0);
+      Status = EFI_SUCCESS;
     }
   }
+  FreeAlignedPages (Data, EFI_SIZE_TO_PAGES (Size));
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+SaveImageCacheFile (
+  IN CHAR16 *FileName,
+  IN UINT64 SrcSize,
+  IN UINT64 SrcTime,
+  IN IMAGE_SURFACE *Surface
+)
+{
+  EFI_STATUS Status;
+  CHAR16 *CachePath;
+  IMAGE_CACHE_HEADER *Header;
+  UINTN BltSize;
+
+  CachePath = ImageCachePath (FileName);
+  BltSize = Surface->Width * Surface->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  Header = AllocatePool (sizeof (IMAGE_CACHE_HEADER) + BltSize);
+  if (CachePath == NULL || Header == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Down;
+  }
+  Header->Signature = IMAGE_CACHE_SIGNATURE;
+  Header->Width = (UINT32) Surface->Width;
+  Header->Height = (UINT32) Surface->Height;
+  Header->Opaque = Surface->Opaque;
+  Header->SrcSize = SrcSize;
+  Header->SrcTime = SrcTime;
+  CopyMem (Header + 1, Surface->Blt, BltSize);
+  Status =
+    egSaveFile (gRootFHandle, CachePath, (UINT8 *) Header,
+                sizeof (IMAGE_CACHE_HEADER) + BltSize);
+  DBG ("%a: %s saved, %r\n", __FUNCTION__, CachePath, Status);
 
 Down:
-  if (Buffer != NULL) {
-    FreePool (Buffer);
+  if (CachePath != NULL) {
+    FreePool (CachePath);
   }
-  return;
+  if (Header != NULL) {
+    FreePool (Header);
+  }
+  return Status;
 }
 
+/**
+ Return the decoded image for a file on the boot volume or, when FileName is
+ NULL, for a raw FV section. The surface belongs to the cache: callers must
+ neither change nor free it.
+**/
 EFI_STATUS
-BltWithAlpha (
+LoadImageSurface (
+  IN  CHAR16 *FileName,  OPTIONAL
+  IN  EFI_GUID *NameGuid,  OPTIONAL
+  OUT IMAGE_SURFACE **Surface
+)
+{
+  EFI_STATUS Status;
+  IMAGE_CACHE_ENTRY *Entry;
+  UINT8 *ImageData;
+  UINTN ImageSize;
+  UINT64 SrcSize;
+  UINT64 SrcTime;
+
+  SrcSize = 0;
+  SrcTime = 0;
+  if (FileName != NULL) {
+    Status = ImageFileStamp (FileName, &SrcSize, &SrcTime);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  else if (NameGuid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Entry = mImageCache; Entry != NULL; Entry = Entry->Next) {
+    if (FileName != NULL ?
+        (Entry->FileName != NULL && Entry->Root == gRootFHandle &&
+         StrCmp (Entry->FileName, FileName) == 0) :
+        (Entry->FileName == NULL && CompareGuid (&Entry->NameGuid, NameGuid))) {
+      break;
+    }
+  }
+  if (Entry != NULL && Entry->Surface.Blt != NULL &&
+      Entry->SrcSize == SrcSize && Entry->SrcTime == SrcTime) {
+    *Surface = &Entry->Surface;
+    return EFI_SUCCESS;
+  }
+
+  if (Entry == NULL) {
+    Entry = AllocateZeroPool (sizeof (IMAGE_CACHE_ENTRY));
+    if (Entry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    if (FileName != NULL) {
+      Entry->FileName = AllocateCopyPool (StrSize (FileName), FileName);
+      if (Entry->FileName == NULL) {
+        FreePool (Entry);
+        return EFI_OUT_OF_RESOURCES;
+      }
+      Entry->Root = gRootFHandle;
+    }
+    else {
+      CopyGuid (&Entry->NameGuid, NameGuid);
+    }
+    Entry->Next = mImageCache;
+    mImageCache = Entry;
+  }
+  else if (Entry->Surface.Blt != NULL) {
+    FreePool (Entry->Surface.Blt);
+  }
+  //
+  // The entry stays empty until a load succeeds
+  //
+  Entry->Surface.Blt = NULL;
+  Entry->Surface.Width = 0;
+  Entry->Surface.Height = 0;
+  Entry->SrcSize = 0;
+  Entry->SrcTime = 0;
+
+  if (FileName != NULL && gSettings.ImageCache &&
+      !EFI_ERROR (LoadImageCacheFile (FileName, SrcSize, SrcTime, &Entry->Surface))) {
+    Entry->SrcSize = SrcSize;
+    Entry->SrcTime = SrcTime;
+    *Surface = &Entry->Surface;
+    return EFI_SUCCESS;
+  }
+
+  ImageData = NULL;
+  ImageSize = 0;
+  if (FileName != NULL) {
+    Status = egLoadFile (gRootFHandle, FileName, &ImageData, &ImageSize);
+  }
+  else {
+    Status =
+      GetSectionFromAnyFv (NameGuid, EFI_SECTION_RAW, 0, (VOID **) &ImageData,
+                           &ImageSize);
+  }
+  if (EFI_ERROR (Status)) {
+    DBG ("%a: %s %g not loaded, %r\n", __FUNCTION__, FileName, NameGuid, Status);
+    return Status;
+  }
+
+  Status = DecodeImage (ImageData, ImageSize, &Entry->Surface);
+  if (FileName != NULL) {
+    FreeAlignedPages (ImageData, EFI_SIZE_TO_PAGES (ImageSize));
+  }
+  else {
+    FreePool (ImageData);
+  }
+  if (EFI_ERROR (Status)) {
+    Entry->Surface.Blt = NULL;
+    Entry->Surface.Width = 0;
+    Entry->Surface.Height = 0;
+    return Status;
+  }
+
+  Entry->SrcSize = SrcSize;
+  Entry->SrcTime = SrcTime;
+  if (FileName != NULL && gSettings.ImageCache) {
+    SaveImageCacheFile (FileName, SrcSize, SrcTime, &Entry->Surface);
+  }
+  *Surface = &Entry->Surface;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+GrowBlendBuffer (
+  IN UINTN Size
+)
+{
+  //
+  // One blend buffer, grown as needed, serves every draw
+  //
+  if (Size > mBlendBufferSize) {
+    if (mBlendBuffer != NULL) {
+      FreePool (mBlendBuffer);
+    }
+    mBlendBuffer = AllocatePool (Size);
+    mBlendBufferSize = (mBlendBuffer != NULL) ? Size : 0;
+    if (mBlendBuffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+ Draw a premultiplied buffer that has translucent pixels without blending.
+ The colors go back to straight ones first, as the screen got them before
+ the cache kept premultiplied surfaces. Fully transparent pixels come out
+ black, since premultiplying does not keep their color.
+**/
+STATIC
+EFI_STATUS
+BltStraight (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL * GraphicsOutput,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL * BltBuffer,
+  IN UINTN DestinationX,
+  IN UINTN DestinationY,
+  IN UINTN Width,
+  IN UINTN Height
+)
+{
+  EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dst;
+  UINTN Count;
+  UINT32 Alpha;
+
+  if (GraphicsOutput == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = GrowBlendBuffer (Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Count = Width * Height, Src = BltBuffer, Dst = mBlendBuffer; Count > 0;
+       Count--, Src++, Dst++) {
+    Alpha = Src->Reserved;
+    if (Alpha == 0xFF || Alpha == 0) {
+      *Dst = *Src;
+    }
+    else {
+      Dst->Blue = (UINT8) MIN (0xFF, (Src->Blue * 0xFF + Alpha / 2) / Alpha);
+      Dst->Green = (UINT8) MIN (0xFF, (Src->Green * 0xFF + Alpha / 2) / Alpha);
+      Dst->Red = (UINT8) MIN (0xFF, (Src->Red * 0xFF + Alpha / 2) / Alpha);
+      Dst->Reserved = Src->Reserved;
+    }
+  }
+
+  return GraphicsOutput->Blt (GraphicsOutput, mBlendBuffer, EfiBltBufferToVideo,
+                              0, 0, DestinationX, DestinationY, Width, Height,
+                              Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+}
+
+/**
+ Draw a premultiplied buffer of Width by Height pixels. With Alpha, it is
+ blended over the screen contents: dest = src + dest * (255 - alpha) / 255.
+**/
+EFI_STATUS
+BltPremultiplied (
   IN EFI_GRAPHICS_OUTPUT_PROTOCOL * GraphicsOutput,
-  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL * BltBuffer,
-  IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation,
-  IN UINTN SourceX,
-  IN UINTN SourceY,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL * BltBuffer,
   IN UINTN DestinationX,
   IN UINTN DestinationY,
   IN UINTN Width,
   IN UINTN Height,
-  IN UINTN Delta,
   IN BOOLEAN Alpha
 )
 {
   EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Fg;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bg;
+  UINTN Count;
+  UINT32 Inverse;
 
   if (GraphicsOutput == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Alpha) {
-#if 1
-    UseAlpha (GraphicsOutput, BltBuffer, (UINT32) DestinationX,
-              (UINT32) DestinationY, (UINT32) Width, (UINT32) Height);
-#else
-    UseAlpha (GraphicsOutput, BltBuffer, DestinationX, DestinationY, Width,
-              Height);
-#endif
+  if (!Alpha) {
+    return GraphicsOutput->Blt (GraphicsOutput, BltBuffer, EfiBltBufferToVideo,
+                                0, 0, DestinationX, DestinationY, Width, Height,
+                                Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
+
+  Status = GrowBlendBuffer (Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   Status =
-    GraphicsOutput->Blt (GraphicsOutput, BltBuffer, BltOperation, SourceX,
-                         SourceY, DestinationX, DestinationY, Width, Height,
-                         Delta);
+    GraphicsOutput->Blt (GraphicsOutput, mBlendBuffer, EfiBltVideoToBltBuffer,
+                         DestinationX, DestinationY, 0, 0, Width, Height,
+                         Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
 
-  return Status;
+  for (Count = Width * Height, Fg = BltBuffer, Bg = mBlendBuffer; Count > 0;
+       Count--, Fg++, Bg++) {
+    if (Fg->Reserved == 0xFF) {
+      *Bg = *Fg;
+    }
+    else if (Fg->Reserved != 0) {
+      Inverse = 0xFF - Fg->Reserved;
+      Bg->Blue = (UINT8) (Fg->Blue + DIV_255 (Bg->Blue * Inverse));
+      Bg->Green = (UINT8) (Fg->Green + DIV_255 (Bg->Green * Inverse));
+      Bg->Red = (UINT8) (Fg->Red + DIV_255 (Bg->Red * Inverse));
+    }
+  }
+
+  return GraphicsOutput->Blt (GraphicsOutput, mBlendBuffer, EfiBltBufferToVideo,
+                              0, 0, DestinationX, DestinationY, Width, Height,
+                              Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
 }
 
 EFI_STATUS
@@ -564,44 +885,26 @@ ShowPngFile (
 )
 {
   EFI_STATUS Status;
-  UINT8 *ImageData;
-  UINTN ImageSize;
-  UINTN BltSize;
-  UINTN Height;
-  UINTN Width;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt;
-
-  Blt = NULL;
-  ImageData = NULL;
-  ImageSize = 0;
+  IMAGE_SURFACE *Surface;
 
-  Status = egLoadFile (gRootFHandle, FileName, &ImageData, &ImageSize);
+  Status = LoadImageSurface (FileName, NULL, &Surface);
   if (EFI_ERROR (Status)) {
-    goto Down;
-  }
-
-  Status =
-    ConvertPngToGopBlt (ImageData, ImageSize, (VOID **) &Blt, &BltSize, &Height,
-                        &Width);
-
-  if (EFI_ERROR (Status)) {
-    goto Down;
+    return Status;
   }
 
   if ((DestX >= 0) && (DestY >= 0)) {
-    Status =
-      BltWithAlpha (GraphicsOutput, Blt, EfiBltBufferToVideo, 0, 0,
-                    (UINTN) DestX, (UINTN) DestY, Width, Height,
-                    Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), Alpha);
+    if (!Alpha && !Surface->Opaque) {
+      Status =
+        BltStraight (GraphicsOutput, Surface->Blt, (UINTN) DestX, (UINTN) DestY,
+                     Surface->Width, Surface->Height);
+    }
+    else {
+      Status =
+        BltPremultiplied (GraphicsOutput, Surface->Blt, (UINTN) DestX, (UINTN) DestY,
+                          Surface->Width, Surface->Height, (BOOLEAN) !Surface->Opaque);
+    }
   }
 
-Down:
-  if (ImageData != NULL) {
-    FreeAlignedPages (ImageData, EFI_SIZE_TO_PAGES (ImageSize));
-  }
-  if (Blt != NULL) {
-    FreePool (Blt);
-  }
   return Status;
 }
 
@@ -615,9 +918,7 @@ ShowAString (
 )
 {
   EFI_STATUS Status;
-  UINT8 *ImageData;
-  UINTN ImageSize;
-  UINTN BltSize;
+  IMAGE_SURFACE *Font;
   UINTN Height;
   UINTN Width;
   UINTN ImageStringWidth;
@@ -625,46 +926,38 @@ ShowAString (
   UINT32 FontSize;
   UINT32 InX;
   UINT32 InStr;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ImageString;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *InBuffer;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *OutBuffer;
 
-  ImageData = NULL;
   ImageString = NULL;
-  Blt = NULL;
 
   if (AString == NULL) {
     Status = EFI_INVALID_PARAMETER;
     goto Down;
   }
 
-  Status =
-    GetSectionFromAnyFv (PcdGetPtr (PcdFontsFile), EFI_SECTION_RAW, 0,
-                         (VOID **) &ImageData, &ImageSize);
-
-  if (EFI_ERROR (Status)) {
-    goto Down;
-  }
-
-  Status =
-    ConvertPngToGopBlt (ImageData, ImageSize, (VOID **) &Blt, &BltSize, &Height,
-                        &Width);
-
+  Status = LoadImageSurface (NULL, PcdGetPtr (PcdFontsFile), &Font);
   if (EFI_ERROR (Status)) {
     goto Down;
   }
+  Height = Font->Height;
+  Width = Font->Width;
 
   FontWidth = (UINT8) (Width / 95);
   ImageStringWidth = FontWidth * AsciiStrLen (AString);
   ImageString =
     AllocateZeroPool (Height * ImageStringWidth *
                       sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (ImageString == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Down;
+  }
   FontSize = FontWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
 
   for (InStr = 0; InStr < AsciiStrLen (AString); InStr++) {
     InBuffer = ImageString + FontWidth * InStr;
-    OutBuffer = Blt + FontWidth * (AString[InStr] - 0x20);
+    OutBuffer = Font->Blt + FontWidth * (AString[InStr] - 0x20);
     for (InX = 0; InX < Height; InX++) {
       CopyMem ((UINT8 *) (InBuffer), (UINT8 *) (OutBuffer), FontSize);
       InBuffer += ImageStringWidth;
@@ -673,22 +966,21 @@ ShowAString (
   }
 
   if ((DestX >= 0) && (DestY >= 0)) {
-    Status =
-      BltWithAlpha (GraphicsOutput, ImageString, EfiBltBufferToVideo, 0, 0,
-                    (UINTN) DestX, (UINTN) DestY, ImageStringWidth, Height,
-                    ImageStringWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL),
-                    Alpha);
+    if (!Alpha && !Font->Opaque) {
+      Status =
+        BltStraight (GraphicsOutput, ImageString, (UINTN) DestX, (UINTN) DestY,
+                     ImageStringWidth, Height);
+    }
+    else {
+      Status =
+        BltPremultiplied (GraphicsOutput, ImageString, (UINTN) DestX, (UINTN) DestY,
+                          ImageStringWidth, Height, (BOOLEAN) !Font->Opaque);
+    }
   }
 
 Down:
-  if (ImageData != NULL) {
-    FreePool (ImageData);
-  }
   if (ImageString != NULL) {
     FreePool (ImageString);
   }
-  if (Blt != NULL) {
-    FreePool (Blt);
-  }
   return Status;
 }
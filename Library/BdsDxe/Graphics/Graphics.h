@@ -65,6 +65,17 @@
 //#include <Library/DxeServicesLib.h>
 //#include <Library/ReportStatusCodeLib.h>
 
+//
+// A decoded image, owned by the image cache. Colors are premultiplied by
+// alpha, so drawing it over the screen is one multiply per channel.
+//
+typedef struct {
+  UINTN                         Width;
+  UINTN                         Height;
+  BOOLEAN                       Opaque;   // every pixel has alpha 255
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt;
+} IMAGE_SURFACE;
+
 EFI_STATUS
 ConvertPngToGopBlt (
   IN     VOID      *PngImage,
@@ -96,28 +107,21 @@ SetModeScreen (
  UINT32     PrefMode
  );
 
-VOID
-UseAlpha (
-  EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput,
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt,
-  UINT32 DestX,
-  UINT32 DestY,
-  UINT32 Width,
-  UINT32 Height
+EFI_STATUS
+LoadImageSurface (
+  IN     CHAR16         *FileName,  OPTIONAL
+  IN     EFI_GUID       *NameGuid,  OPTIONAL
+     OUT IMAGE_SURFACE  **Surface
   );
 
 EFI_STATUS
-BltWithAlpha (
+BltPremultiplied (
   IN EFI_GRAPHICS_OUTPUT_PROTOCOL *GraphicsOutput,
-  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer,
-  IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation,
-  IN UINTN SourceX,
-  IN UINTN SourceY,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer,
   IN UINTN DestinationX,
   IN UINTN DestinationY,
   IN UINTN Width,
   IN UINTN Height,
-  IN UINTN Delta,
   IN BOOLEAN Alpha
   );
 
@@ -1,34 +1,24 @@
 #ifndef _PICOPNG_H
 #define _PICOPNG_H
 
-typedef struct {
-  UINT32 *data;
-  UINT32 size;
-  UINT32 allocsize;
-} vector32_t;
-
-typedef struct {
-  UINT8 *data;
-  UINT32 size;
-  UINT32 allocsize;
-} vector8_t;
-
 typedef struct {
   UINT32 width, height;
   UINT32 colorType, bitDepth;
   UINT32 compressionMethod, filterMethod, interlaceMethod;
   UINT32 key_r, key_g, key_b;
   BOOLEAN key_defined;          // is a transparent color key given?
-  vector8_t *palette;
-  vector8_t *image;
+  UINT32 palettesize;           // number of palette entries
+  UINT8 palette[4 * 256];       // blue, green, red, alpha per entry
 } PNG_info_t;
 
-PNG_info_t *PNG_decode (
+// Decodes a PNG file into width * height blue, green, red, alpha pixels, the layout of
+// EFI_GRAPHICS_OUTPUT_BLT_PIXEL. The buffer comes from AllocatePool and may be a little larger
+// than the image; the caller frees it. Returns NULL and sets PNG_error on failure.
+UINT8 *PNG_decode (
+  PNG_info_t *info,
   const UINT8 *in,
   UINT32 size
 );
-void png_alloc_free_all (
-);
 
 extern UINT8 PNG_error;
 
@@ -21,6 +21,25 @@
 #define MEM_LOG_MAX_SIZE        (2 * 1024 * 1024)
 #define MEM_LOG_MAX_LINE_SIZE   1024
 
+//
+// Trace ring sizes
+//
+#define MEM_LOG_TRACE_SIZE      2048
+#define MEM_LOG_TRACE_NAME      40
+#define MEM_LOG_TRACE_DEPTH     16
+
+#define MEM_LOG_TRACE_BEGIN     'B'
+#define MEM_LOG_TRACE_END       'E'
+
+//
+// One begin or end of a traced phase.
+//
+typedef struct {
+  UINT64            Tsc;
+  UINT8             Kind;
+  CHAR8             Name[MEM_LOG_TRACE_NAME];
+} MEM_LOG_TRACE;
+
 //
 // Struct for holding mem buffer.
 //
@@ -36,6 +55,14 @@ typedef struct {
   UINT64            TscLast;
   /// TSC ticks per second.
   UINT64            TscFreqSec;
+
+  /// Trace ring, MEM_LOG_TRACE_SIZE entries, oldest overwritten first.
+  MEM_LOG_TRACE     *Trace;
+  /// Number of trace entries ever written.
+  UINT32            TraceCount;
+  /// Number of open phases and their names, innermost last.
+  UINT32            TraceDepth;
+  CHAR8             TraceOpen[MEM_LOG_TRACE_DEPTH][MEM_LOG_TRACE_NAME];
 } MEM_LOG;
 
 
@@ -130,6 +157,7 @@ MemLogInit (
   mMemLog->Buffer = AllocateZeroPool (MEM_LOG_INITIAL_SIZE);
   mMemLog->Cursor = mMemLog->Buffer;
   mMemLog->Callback = NULL;
+  mMemLog->Trace = AllocateZeroPool (MEM_LOG_TRACE_SIZE * sizeof (MEM_LOG_TRACE));
   
   //
   // Calibrate TSC for timings
@@ -356,3 +384,172 @@ GetMemLogTscTicksPerSecond (VOID)
   }
   return mMemLog->TscFreqSec;
 }
+
+/**
+  Adds one entry to the trace ring. Does not allocate, so it is safe
+  to call from ExitBootServices handlers.
+ **/
+VOID
+MemLogTraceAdd (
+  IN  UINT8         Kind,
+  IN  CONST CHAR8   *Name
+  )
+{
+  MEM_LOG_TRACE     *Entry;
+
+  Entry = &mMemLog->Trace[mMemLog->TraceCount % MEM_LOG_TRACE_SIZE];
+  mMemLog->TraceCount++;
+  Entry->Tsc = AsmReadTsc ();
+  Entry->Kind = Kind;
+  AsciiStrnCpy (Entry->Name, Name, MEM_LOG_TRACE_NAME - 1);
+  Entry->Name[MEM_LOG_TRACE_NAME - 1] = '\0';
+}
+
+/**
+  Opens a traced phase. Phases nest; each one is closed by MemLogTraceEnd().
+
+  @param  Format      The format string for the phase name.
+  @param  ...         The variable argument list for Format.
+
+**/
+VOID
+EFIAPI
+MemLogTraceBegin (
+  IN  CONST CHAR8   *Format,
+  ...
+  )
+{
+  EFI_STATUS        Status;
+  VA_LIST           Marker;
+  CHAR8             Line[128];
+  CHAR8             *Name;
+  UINTN             Len;
+  UINTN             Index;
+
+  if (mMemLog == NULL) {
+    Status = MemLogInit ();
+    if (EFI_ERROR (Status)) {
+      return;
+    }
+  }
+  if (mMemLog->Trace == NULL) {
+    return;
+  }
+
+  VA_START (Marker, Format);
+  Len = AsciiVSPrint (Line, sizeof (Line), Format, Marker);
+  VA_END (Marker);
+  //
+  // Keep the tail of long names, it tells device paths apart.
+  // Names go into JSON strings unescaped.
+  //
+  Name = Line;
+  if (Len >= MEM_LOG_TRACE_NAME) {
+    Name = Line + Len - (MEM_LOG_TRACE_NAME - 1);
+  }
+  for (Index = 0; Name[Index] != '\0'; Index++) {
+    if (Name[Index] == '"' || Name[Index] == '\\' || Name[Index] < ' ') {
+      Name[Index] = '/';
+    }
+  }
+
+  MemLogTraceAdd (MEM_LOG_TRACE_BEGIN, Name);
+  if (mMemLog->TraceDepth < MEM_LOG_TRACE_DEPTH) {
+    AsciiStrCpy (mMemLog->TraceOpen[mMemLog->TraceDepth], Name);
+  }
+  mMemLog->TraceDepth++;
+}
+
+/**
+  Closes the innermost phase opened by MemLogTraceBegin().
+ **/
+VOID
+EFIAPI
+MemLogTraceEnd (
+  VOID
+  )
+{
+  if (mMemLog == NULL || mMemLog->Trace == NULL || mMemLog->TraceDepth == 0) {
+    return;
+  }
+
+  mMemLog->TraceDepth--;
+  MemLogTraceAdd (
+    MEM_LOG_TRACE_END,
+    mMemLog->TraceDepth < MEM_LOG_TRACE_DEPTH ? mMemLog->TraceOpen[mMemLog->TraceDepth] : ""
+    );
+}
+
+/**
+  Writes the trace ring as Chrome trace JSON, one event per line,
+  timestamps in microseconds since MemLog was inited.
+
+  @param  Buffer      Output buffer, or NULL to only compute the size.
+  @param  BufferSize  Size of Buffer in bytes.
+
+  @retval Number of chars the whole trace needs, without the terminating zero.
+          Nothing is written to Buffer unless the whole trace fits.
+
+**/
+UINTN
+EFIAPI
+MemLogTraceExport (
+  OUT CHAR8         *Buffer,
+  IN  UINTN         BufferSize
+  )
+{
+  CHAR8             Line[128];
+  UINTN             Len;
+  UINTN             LineLen;
+  UINT32            First;
+  UINT32            Index;
+  MEM_LOG_TRACE     *Entry;
+  UINT64            Us;
+  UINTN             Pass;
+
+  if (mMemLog == NULL || mMemLog->Trace == NULL || mMemLog->TscFreqSec == 0) {
+    return 0;
+  }
+
+  First = 0;
+  if (mMemLog->TraceCount > MEM_LOG_TRACE_SIZE) {
+    First = mMemLog->TraceCount - MEM_LOG_TRACE_SIZE;
+  }
+
+  //
+  // Pass 0 measures, pass 1 writes
+  //
+  Len = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      if (Buffer == NULL || Len >= BufferSize) {
+        return Len;
+      }
+      Len = 0;
+    }
+    for (Index = First; Index <= mMemLog->TraceCount + 1; Index++) {
+      if (Index == First) {
+        LineLen = AsciiSPrint (Line, sizeof (Line), "{\"traceEvents\":[\n");
+      } else if (Index == mMemLog->TraceCount + 1) {
+        LineLen = AsciiSPrint (Line, sizeof (Line), "{}]}\n");
+      } else {
+        Entry = &mMemLog->Trace[(Index - 1) % MEM_LOG_TRACE_SIZE];
+        Us = DivU64x64Remainder (MultU64x32 (Entry->Tsc - mMemLog->TscStart, 1000000), mMemLog->TscFreqSec, NULL);
+        LineLen = AsciiSPrint (
+                    Line,
+                    sizeof (Line),
+                    "{\"ph\":\"%c\",\"ts\":%ld,\"pid\":1,\"tid\":1,\"name\":\"%a\"},\n",
+                    Entry->Kind,
+                    Us,
+                    Entry->Name
+                    );
+      }
+      if (Pass == 1) {
+        CopyMem (Buffer + Len, Line, LineLen);
+      }
+      Len += LineLen;
+    }
+  }
+  Buffer[Len] = '\0';
+  return Len;
+}
@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Summarises EFI/bareboot/boot_trace.json written by bareBoot
+# (MemLogTraceExport). The file also opens in chrome://tracing.
+#
+# Usage:
+#   ./tracesum.sh boot_trace.json [count]   top phases by total time
+#   ./tracesum.sh -c boot_trace.json        all phases as CSV:
+#                                           start_us,dur_us,depth,name
+#
+
+CSV=0
+if [ "$1" = "-c" ]; then
+  CSV=1
+  shift
+fi
+
+if [ $# -lt 1 ] || [ ! -f "$1" ]; then
+  echo "Usage: $0 [-c] boot_trace.json [count]"
+  exit 1
+fi
+
+TOP=${2:-20}
+
+awk -v csv=$CSV '
+BEGIN { sp = 0 }
+/"ph":"[BE]"/ {
+  ph = $0; sub(/.*"ph":"/, "", ph); ph = substr(ph, 1, 1)
+  ts = $0; sub(/.*"ts":/, "", ts); sub(/,.*/, "", ts)
+  name = $0; sub(/.*"name":"/, "", name); sub(/"}.*/, "", name)
+  if (ph == "B") {
+    stack[sp] = ts; names[sp] = name; sp++
+    next
+  }
+  # an end without a begin was cut off by the ring buffer
+  if (sp == 0) {
+    next
+  }
+  sp--
+  dur = ts - stack[sp]
+  if (csv) {
+    printf "%d,%d,%d,%s\n", stack[sp], dur, sp, names[sp]
+  } else {
+    total[names[sp]] += dur
+    count[names[sp]]++
+  }
+}
+END {
+  if (!csv) {
+    for (n in total) {
+      printf "%10.3f ms %5d  %s\n", total[n] / 1000, count[n], n
+    }
+  }
+}' "$1" | if [ $CSV -eq 1 ]; then
+  sort -t, -n -k1,1
+else
+  sort -rn | head -n "$TOP"
+fi
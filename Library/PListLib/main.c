@@ -27,7 +27,6 @@
 #include <stdio.h>
 
 #include "plist.h"
-#include "plist_xml_parser.h"
 
 #define PLBUFSIZE 500000
 
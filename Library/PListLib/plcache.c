@@ -0,0 +1,179 @@
+/*
+ * Host tool for the binary config cache (see plNodeToBin()).
+ * plcache config.plist [cache]        writes cache, config.plist.cache by default
+ * plcache -v cache [config.plist]     checks cache and, if given, that it
+ *                                     matches the plist
+ * The stamp is the plist size and local modification time, the same as
+ * firmware takes from EFI_FILE_INFO. If the clocks disagree, bareBoot
+ * rebuilds the cache on the next boot.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "plist.h"
+
+int
+readFile(const char* name, plbuf_t* buf) {
+	FILE* fp;
+	long sz;
+
+	fp = fopen(name, "rb");
+	if (fp == NULL) { return 0; }
+	fseek(fp, 0, SEEK_END);
+	sz = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	buf->dat = malloc(sz > 0 ? sz : 1);
+	buf->len = (unsigned int) fread(buf->dat, 1, sz, fp);
+	buf->pos = 0;
+	fclose(fp);
+	return buf->len == (unsigned int) sz;
+}
+
+vlong
+fileStamp(const char* name, unsigned int* len) {
+	struct stat st;
+	struct tm* tm;
+
+	if (stat(name, &st) != 0) { return -1; }
+	*len = (unsigned int) st.st_size;
+	tm = localtime(&st.st_mtime);
+	return PL_BIN_TIME(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+	    tm->tm_hour, tm->tm_min, tm->tm_sec);
+}
+
+/* Documents are equal if they render to the same XML */
+
+int
+sameXml(void* pa, void* pb) {
+	plbuf_t xa;
+	plbuf_t xb;
+	int rc;
+
+	xa.len = xb.len = 1 << 24;
+	xa.pos = xb.pos = 0;
+	xa.dat = malloc(xa.len);
+	xb.dat = malloc(xb.len);
+	rc = xa.dat != NULL && xb.dat != NULL &&
+	    plNodeToXml(pa, &xa) && plNodeToXml(pb, &xb) &&
+	    xa.pos == xb.pos && memcmp(xa.dat, xb.dat, xa.pos) == 0;
+	free(xa.dat);
+	free(xb.dat);
+	return rc;
+}
+
+int
+emit(const char* xname, const char* cname) {
+	plbuf_t xbuf;
+	plbuf_t cbuf;
+	unsigned int srclen;
+	vlong srctime;
+	void* pl;
+	FILE* fp;
+
+	srctime = fileStamp(xname, &srclen);
+	if (srctime < 0 || !readFile(xname, &xbuf)) {
+		fprintf(stderr, "%s: cannot read\n", xname);
+		return 1;
+	}
+	pl = plXmlToNode(&xbuf);
+	free(xbuf.dat);
+	if (pl == NULL) {
+		fprintf(stderr, "%s: not a plist\n", xname);
+		return 1;
+	}
+	cbuf.dat = NULL;
+	cbuf.len = cbuf.pos = 0;
+	(void) plNodeToBin(pl, srclen, srctime, &cbuf);
+	cbuf.len = cbuf.pos;
+	cbuf.pos = 0;
+	cbuf.dat = malloc(cbuf.len);
+	if (cbuf.dat == NULL || !plNodeToBin(pl, srclen, srctime, &cbuf)) {
+		fprintf(stderr, "%s: cannot encode\n", xname);
+		return 1;
+	}
+	plNodeDelete(pl);
+	fp = fopen(cname, "wb");
+	if (fp == NULL || fwrite(cbuf.dat, 1, cbuf.pos, fp) != cbuf.pos) {
+		fprintf(stderr, "%s: cannot write\n", cname);
+		return 1;
+	}
+	fclose(fp);
+	free(cbuf.dat);
+	printf("%s: %u bytes from %u bytes of %s\n", cname, cbuf.pos, srclen, xname);
+	return 0;
+}
+
+int
+verify(const char* cname, const char* xname) {
+	plbuf_t cbuf;
+	plbuf_t xbuf;
+	unsigned int clen;
+	unsigned int srclen;
+	vlong ctime;
+	vlong srctime;
+	void* pc;
+	void* px;
+	int rc;
+
+	if (!readFile(cname, &cbuf)) {
+		fprintf(stderr, "%s: cannot read\n", cname);
+		return 1;
+	}
+	pc = NULL;
+	if (plBinStamp(&cbuf, &clen, &ctime)) {
+		pc = plBinToNode(&cbuf, clen, ctime);
+	}
+	free(cbuf.dat);
+	if (pc == NULL) {
+		fprintf(stderr, "%s: damaged\n", cname);
+		return 1;
+	}
+	printf("%s: ok, source %u bytes, time %04d-%02d-%02d %02d:%02d:%02d\n", cname, clen,
+	    (int) (ctime >> 40), (int) (ctime >> 32) & 0xff, (int) (ctime >> 24) & 0xff,
+	    (int) (ctime >> 16) & 0xff, (int) (ctime >> 8) & 0xff, (int) ctime & 0xff);
+	if (xname == NULL) {
+		plNodeDelete(pc);
+		return 0;
+	}
+
+	rc = 0;
+	srctime = fileStamp(xname, &srclen);
+	if (srclen != clen || srctime != ctime) {
+		printf("%s: stamp differs from %s, firmware will rebuild it\n", cname, xname);
+		rc = 2;
+	}
+	px = NULL;
+	if (readFile(xname, &xbuf)) {
+		px = plXmlToNode(&xbuf);
+		free(xbuf.dat);
+	}
+	if (px == NULL || !sameXml(pc, px)) {
+		printf("%s: content differs from %s\n", cname, xname);
+		rc = 1;
+	}
+	plNodeDelete(px);
+	plNodeDelete(pc);
+	return rc;
+}
+
+int
+main(int argc, char* argv[]) {
+	char cname[1024];
+
+	if (argc > 2 && strcmp(argv[1], "-v") == 0) {
+		return verify(argv[2], argc > 3 ? argv[3] : NULL);
+	}
+	if (argc < 2 || argv[1][0] == '-') {
+		fprintf(stderr, "usage: plcache config.plist [cache]\n       plcache -v cache [config.plist]\n");
+		return 1;
+	}
+	if (argc > 2) {
+		return emit(argv[1], argv[2]);
+	}
+	snprintf(cname, sizeof(cname), "%s.cache", argv[1]);
+	return emit(argv[1], cname);
+}
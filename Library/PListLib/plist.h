@@ -50,6 +50,11 @@ typedef struct _plbuf {
   unsigned int pos;
 } plbuf_t;
 
+typedef struct _pliter { /* walks items of array or keys of dict */
+  void* bag;
+  unsigned int pos;
+} pliter_t;
+
 char* plNodeGetBytes(void*);
 
 int plBoolGet(void*);
@@ -75,3 +80,15 @@ void* plKeyNew(char*, unsigned int, void*);
 void* plNodeGetItem(void*, unsigned int);
 void* plStringNew(char*, unsigned int);
 void* plXmlToNode(plbuf_t*);
+
+void plIterInit(pliter_t*, void* bag);
+void* plIterNext(pliter_t*); /* NULL after the last item */
+
+/* Binary cache, stamped with length and time of the XML source */
+#define PL_BIN_TIME(y, mo, d, h, mi, s) \
+  (((vlong)(y) << 40) | ((vlong)(mo) << 32) | ((vlong)(d) << 24) | \
+   ((vlong)(h) << 16) | ((vlong)(mi) << 8) | (vlong)(s))
+
+int plNodeToBin(void*, unsigned int srclen, vlong srctime, plbuf_t*); /* dat NULL: size in pos */
+int plBinStamp(plbuf_t*, unsigned int* srclen, vlong* srctime); /* 0 if damaged */
+void* plBinToNode(plbuf_t*, unsigned int srclen, vlong srctime); /* NULL if stale or damaged */
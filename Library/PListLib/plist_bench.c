@@ -0,0 +1,168 @@
+/*
+ * Host parse-throughput benchmark.
+ * plbench [-n iterations] [file.plist ...]
+ * Without files it parses generated nvram.plist-like and 20 MB
+ * prelink-info-like documents.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "plist.h"
+
+#define PRELINK_SAMPLE_SIZE (20 * 1024 * 1024)
+
+typedef struct {
+	char* dat;
+	unsigned int len;
+	unsigned int size;
+} gbuf_t;
+
+void
+gbufAdd(gbuf_t* gb, const char* str) {
+	unsigned int sl;
+
+	sl = strlen(str);
+	if (gb->len + sl > gb->size) {
+		gb->size = (gb->len + sl) * 2;
+		gb->dat = realloc(gb->dat, gb->size);
+		if (gb->dat == NULL) { exit(3); }
+	}
+	memcpy(gb->dat + gb->len, str, sl);
+	gb->len += sl;
+}
+
+void
+genNvram(gbuf_t* gb) {
+	char line[256];
+	int i;
+
+	gbufAdd(gb, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<plist version=\"1.0\">\n<dict>\n");
+	for (i = 0; i < 64; i++) {
+		snprintf(line, sizeof(line),
+		    "\t<key>7C436110-AB2A-4BBB-A880-FE41995C9F82:var%d</key>\n\t<data>\n\tAQIDBAUGBwgJCgsMDQ4PEBESExQVFhcYGRobHB0eHyAhIiMkJSYnKCkqKywtLi8w\n\t</data>\n", i);
+		gbufAdd(gb, line);
+		snprintf(line, sizeof(line), "\t<key>boot-args%d</key>\n\t<string>-v arch=x86_64 slide=%d</string>\n", i, i);
+		gbufAdd(gb, line);
+	}
+	gbufAdd(gb, "</dict>\n</plist>\n");
+}
+
+void
+genPrelinkInfo(gbuf_t* gb, unsigned int size) {
+	char line[512];
+	int id;
+	int k;
+
+	id = 0;
+	snprintf(line, sizeof(line), "<dict ID=\"%d\"><key>_PrelinkInfoDictionary</key><array ID=\"%d\">", id, id + 1);
+	id += 2;
+	gbufAdd(gb, line);
+	for (k = 0; gb->len < size; k++) {
+		snprintf(line, sizeof(line),
+		    "<dict ID=\"%d\"><key>CFBundleName</key><string ID=\"%d\">Kext%d</string>"
+		    "<key>CFBundleIdentifier</key><string ID=\"%d\">com.example.driver.Kext%d</string>"
+		    "<key>CFBundleVersion</key><string ID=\"%d\">1.%d.0</string>"
+		    "<key>OSBundleRequired</key><string IDREF=\"5\"/>",
+		    id, id + 1, k, id + 2, k, id + 3, k);
+		id += 4;
+		gbufAdd(gb, line);
+		snprintf(line, sizeof(line),
+		    "<key>OSBundleLibraries</key><dict ID=\"%d\"><key>com.apple.kpi.iokit</key><string ID=\"%d\">8.0.0</string>"
+		    "<key>com.apple.kpi.libkern</key><string IDREF=\"%d\"/></dict>"
+		    "<key>IOKitPersonalities</key><dict ID=\"%d\"><key>Kext%d</key><dict ID=\"%d\">"
+		    "<key>IOClass</key><string ID=\"%d\">Kext%d</string><key>IOProbeScore</key><integer size=\"32\" ID=\"%d\">0x%x</integer>"
+		    "<key>IOProviderClass</key><string ID=\"%d\">IOPCIDevice</string></dict></dict>",
+		    id, id + 1, id + 1, id + 2, k, id + 3, id + 4, k, id + 5, k % 1000, id + 6);
+		id += 7;
+		gbufAdd(gb, line);
+		snprintf(line, sizeof(line),
+		    "<key>_PrelinkBundlePath</key><string ID=\"%d\">/System/Library/Extensions/Kext%d.kext</string>"
+		    "<key>_PrelinkExecutableLoadAddr</key><integer size=\"64\" ID=\"%d\">0x%llx</integer>"
+		    "<key>_PrelinkExecutableSourceAddr</key><integer size=\"64\" ID=\"%d\">0x%llx</integer>"
+		    "<key>_PrelinkExecutableSize</key><integer size=\"64\" ID=\"%d\">0x%x</integer>"
+		    "<key>_PrelinkKmodInfo</key><integer size=\"64\" ID=\"%d\">0x%llx</integer></dict>",
+		    id, k, id + 1, 0xffffff7f80000000ULL + k * 0x10000ULL, id + 2, 0xffffff8000a00000ULL + k * 0x10000ULL,
+		    id + 3, 0x3000 + k, id + 4, 0xffffff7f80000100ULL + k * 0x10000ULL);
+		id += 5;
+		gbufAdd(gb, line);
+	}
+	gbufAdd(gb, "</array></dict>");
+}
+
+void
+bench(const char* name, char* dat, unsigned int len, int iters) {
+	plbuf_t ibuf;
+	void* pl;
+	clock_t t0;
+	double secs;
+	int i;
+
+	ibuf.dat = dat;
+	ibuf.len = len;
+	ibuf.pos = 0;
+
+	pl = plXmlToNode(&ibuf);
+	if (pl == NULL) {
+		printf("%-24s %10u bytes: parse failed\n", name, len);
+		return;
+	}
+	plNodeDelete(pl);
+
+	t0 = clock();
+	for (i = 0; i < iters; i++) {
+		pl = plXmlToNode(&ibuf);
+		plNodeDelete(pl);
+	}
+	secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+	printf("%-24s %10u bytes: %9.3f ms/parse %9.1f MB/s\n", name, len,
+	    secs * 1000.0 / iters, secs > 0 ? (double)len * iters / secs / (1024 * 1024) : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+	FILE* ifp;
+	gbuf_t gb;
+	char* dat;
+	long len;
+	int iters;
+	int i;
+
+	iters = 0;
+	i = 1;
+	if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+		iters = atoi(argv[2]);
+		i = 3;
+	}
+
+	for (; i < argc; i++) {
+		ifp = fopen(argv[i], "rb");
+		if (ifp == NULL) {
+			printf("%s: can not open\n", argv[i]);
+			continue;
+		}
+		fseek(ifp, 0, SEEK_END);
+		len = ftell(ifp);
+		fseek(ifp, 0, SEEK_SET);
+		dat = malloc(len + 1);
+		if (dat == NULL || fread(dat, 1, len, ifp) != (size_t)len) {
+			fclose(ifp);
+			free(dat);
+			continue;
+		}
+		fclose(ifp);
+		bench(argv[i], dat, (unsigned int)len, iters > 0 ? iters : 1000);
+		free(dat);
+	}
+
+	memset(&gb, 0, sizeof(gb));
+	genNvram(&gb);
+	bench("nvram.plist (generated)", gb.dat, gb.len, iters > 0 ? iters : 1000);
+
+	gb.len = 0;
+	genPrelinkInfo(&gb, PRELINK_SAMPLE_SIZE);
+	bench("prelink-info (generated)", gb.dat, gb.len, iters > 0 ? iters : 5);
+	free(gb.dat);
+	return 0;
+}
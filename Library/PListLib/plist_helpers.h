@@ -50,3 +50,4 @@ void _plfree(void* ptr);
 
 char* _plb64encode(char* idat, unsigned int ilen, unsigned int* olen);
 char* _plb64decode(char* idat, unsigned int ilen, unsigned int* olen);
+unsigned int _plb64decodeto(char* idat, unsigned int ilen, char* odat); /* odat has ilen bytes */
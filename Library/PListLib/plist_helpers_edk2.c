@@ -213,3 +213,19 @@ _plb64decode (
   }
   return odat;
 }
+
+unsigned int
+_plb64decodeto (
+  char *idat,
+  unsigned int ilen,
+  char *odat
+)
+{
+  base64_decodestate b64state;
+
+  if (idat == NULL || ilen == 0) {
+    return 0;
+  }
+  base64_init_decodestate (&b64state);
+  return base64_decode_block (idat, (const int) ilen, odat, &b64state);
+}
@@ -26,119 +26,182 @@
 #include "plist.h"
 #include "plist_helpers.h"
 
-#include "plist_xml_parser.h"
-
-struct _plchain;
 struct _plnode;
-
-struct _plchain {
-	struct _plchain* next;
-	struct _plchain* prev;
-	struct _plnode* payload;
-};
-
-typedef struct _plchain _plchain_t;
+struct _plarena;
 
 struct _plnode {
-	struct _plchain* children;
+	struct _plnode** items; /* children of array or dict */
+	unsigned int count;
+	unsigned int capacity;
+	unsigned int* index; /* dict only: hash slots with item number + 1 */
+	unsigned int imask;
 	struct _plnode* keyval;
 	char* datval;
 	unsigned int datlen;
+	unsigned int hash; /* of key datval */
 	vlong intval; /* int64 */
 	int refcnt;
 	plkind_t kind;
+	struct _plarena* arena; /* NULL unless node came from plXmlToNode() or plBinToNode() */
 };
 
 typedef struct _plnode _plnode_t;
 
-int _plGrowTree(TagPtr ipl, void* pn);
+/*
+ * Parsed document lives in one arena: nodes, item vectors, strings and data.
+ * Deleting the document root frees all of it at once.
+ */
 
-/* Chain reaction ;-) */
+#define PL_ARENA_CHUNK 0x10000
+#define PL_ARENA_ALIGN(x) (((x) + sizeof(vlong) - 1) & ~(sizeof(vlong) - 1))
+
+struct _plchunk {
+	struct _plchunk* next;
+	unsigned int size;
+	unsigned int used;
+};
 
-_plchain_t*
-_plChainNew(_plnode_t* np) {
-	_plchain_t* cp;
+#define PL_CHUNK_HDR PL_ARENA_ALIGN(sizeof(struct _plchunk))
 
-	cp = (_plchain_t*) _plzalloc(sizeof(_plchain_t));
-	if (cp != NULL) {
-		cp->payload = np;
-		cp->next = cp;
-		cp->prev = cp;
+struct _plarena {
+	struct _plchunk* chunks;
+	struct _plnode* root;
+};
+
+typedef struct _plarena _plarena_t;
+
+void*
+_plArenaAlloc(_plarena_t* ar, unsigned int sz) {
+	struct _plchunk* ck;
+	unsigned int csz;
+
+	sz = PL_ARENA_ALIGN(sz);
+	ck = ar->chunks;
+	if (ck == NULL || ck->size - ck->used < sz) {
+		csz = PL_ARENA_CHUNK;
+		if (ck != NULL && ck->size > csz) { csz = ck->size; }
+		if (sz > csz) { csz = sz; }
+		ck = (struct _plchunk*) _plzalloc(PL_CHUNK_HDR + csz);
+		if (ck == NULL) { return NULL; }
+		ck->size = csz;
+		ck->next = ar->chunks;
+		ar->chunks = ck;
 	}
-	return cp;
+	ck->used += sz;
+	return (char*) ck + PL_CHUNK_HDR + ck->used - sz;
 }
 
-void
-_plChainDelete(_plchain_t* cp) {
-	_plchain_t* wcp;
-
-	if (cp == NULL) { return; }
+_plarena_t*
+_plArenaNew(unsigned int sz) {
+	_plarena_t* ar;
+	struct _plchunk* ck;
+
+	ar = (_plarena_t*) _plzalloc(sizeof(_plarena_t));
+	if (ar == NULL) { return NULL; }
+	/* One chunk of input size is usually enough */
+	sz = PL_ARENA_ALIGN(sz + sz / 2);
+	if (sz < PL_ARENA_CHUNK) { sz = PL_ARENA_CHUNK; }
+	ck = (struct _plchunk*) _plzalloc(PL_CHUNK_HDR + sz);
+	if (ck != NULL) {
+		ck->size = sz;
+		ar->chunks = ck;
+	}
+	return ar;
+}
 
-	wcp = cp;
-	while (wcp->next != cp) {
-		_plchain_t* np;
+void
+_plArenaDelete(_plarena_t* ar) {
+	struct _plchunk* ck;
 
-		np = wcp->next;
-		plNodeDelete(wcp->payload);
-		_plfree(wcp);
-		wcp = np;
+	while (ar->chunks != NULL) {
+		ck = ar->chunks;
+		ar->chunks = ck->next;
+		_plfree(ck);
 	}
-	plNodeDelete(wcp->payload);
-	_plfree(wcp);
+	_plfree(ar);
 }
 
+/*
+ * Bags keep children in a vector, so getting an item is O(1).
+ * Dicts with PL_DICT_INDEX_MIN keys or more also get an open addressing
+ * index on key hash, so plDictFind() does not walk the keys.
+ */
+
+#define PL_DICT_INDEX_MIN 8
+
 unsigned int
-_plChainCount(_plchain_t* cp) {
-	_plchain_t* wcp;
-	unsigned int sz;
+_plHash(char* str, unsigned int len) {
+	unsigned int h;
+	unsigned int i;
 
-	if (cp == NULL) { return 0; }
-	sz = 1;
-	wcp = cp;
-	while (wcp->next != cp) {
-		sz++;
-		wcp = wcp->next;
+	h = 2166136261U; /* FNV-1a */
+	for (i = 0; i < len; i++) {
+		h = (h ^ (unsigned char) str[i]) * 16777619U;
 	}
-	return sz;
+	return h;
 }
 
-int
-_plChainAdd(_plchain_t** cpp, _plnode_t* pn) {
-	_plchain_t* wcp;
+void*
+_plBagAlloc(_plnode_t* bag, unsigned int sz) {
+	return bag->arena != NULL ? _plArenaAlloc(bag->arena, sz) : _plzalloc(sz);
+}
 
-	wcp = _plChainNew(pn);
-	if (wcp == NULL) { return 0; }
-	if (*cpp == NULL) { *cpp = wcp; return 1; }
+void
+_plBagFree(_plnode_t* bag, void* ptr) {
+	if (bag->arena == NULL && ptr != NULL) { _plfree(ptr); }
+}
 
-	wcp->next = *cpp;
-	wcp->prev = (*cpp)->prev;
-	wcp->prev->next = wcp;
-	(*cpp)->prev = wcp;
+void
+_plDictIndexAdd(_plnode_t* dict, unsigned int inum) {
+	unsigned int i;
 
-	return 1;
+	for (i = dict->items[inum]->hash & dict->imask; dict->index[i] != 0; i = (i + 1) & dict->imask)
+		;
+	dict->index[i] = inum + 1;
 }
 
-_plnode_t*
-_plChainGetLoad(_plchain_t* cp, unsigned int lnum) {
-	_plchain_t* wcp;
-	unsigned int lcnt;
+/* (Re)builds dict index with room for capacity keys */
 
-	if (cp == NULL) { return NULL; }
+int
+_plDictIndex(_plnode_t* dict) {
+	unsigned int isz;
+	unsigned int i;
 
-#if 0
-	for (lcnt = 0, wcp = cp; lcnt < lnum && wcp != cp; lcnt++, wcp = wcp->next)
-		;
-	return lcnt == lnum ? wcp->payload : NULL;
-#else
-	lcnt = 0;
-	wcp = cp;
-	do {
-		if (lcnt == lnum) { return wcp->payload; }
-		lcnt++;
-		wcp = wcp->next;
-	} while (wcp != cp);
-	return NULL;
-#endif
+	isz = 16;
+	while (isz < dict->capacity * 2) { isz *= 2; }
+	_plBagFree(dict, dict->index);
+	dict->index = (unsigned int*) _plBagAlloc(dict, isz * sizeof(unsigned int));
+	if (dict->index == NULL) { return 0; }
+	dict->imask = isz - 1;
+	for (i = 0; i < dict->count; i++) {
+		_plDictIndexAdd(dict, i);
+	}
+	return 1;
+}
+
+int
+_plBagPush(_plnode_t* bag, _plnode_t* pn) {
+	_plnode_t** items;
+	unsigned int cap;
+
+	if (bag->count == bag->capacity) {
+		cap = bag->capacity != 0 ? bag->capacity * 2 : 4;
+		items = (_plnode_t**) _plBagAlloc(bag, cap * sizeof(_plnode_t*));
+		if (items == NULL) { return 0; }
+		if (bag->count > 0) { _plmemcpy(items, bag->items, bag->count * sizeof(_plnode_t*)); }
+		_plBagFree(bag, bag->items);
+		bag->items = items;
+		bag->capacity = cap;
+	}
+	bag->items[bag->count++] = pn;
+	if (bag->kind == plKindDict && bag->count >= PL_DICT_INDEX_MIN) {
+		if (bag->index == NULL || bag->count * 2 > bag->imask + 1) {
+			if (!_plDictIndex(bag)) { bag->count--; return 0; }
+		} else {
+			_plDictIndexAdd(bag, bag->count - 1);
+		}
+	}
+	return 1;
 }
 
 /* Property List stuff */
@@ -152,6 +215,28 @@ _plNodeNew(plkind_t nk) {
 	return node;
 }
 
+/* Drops nodes made by plXxxNew() and added into a parsed document */
+
+void
+_plArenaReleaseForeign(_plnode_t* pn) {
+	unsigned int i;
+
+	if (pn->keyval != NULL) {
+		if (pn->keyval->arena == NULL) {
+			plNodeDelete(pn->keyval);
+		} else {
+			_plArenaReleaseForeign(pn->keyval);
+		}
+	}
+	for (i = 0; i < pn->count; i++) {
+		if (pn->items[i]->arena == NULL) {
+			plNodeDelete(pn->items[i]);
+		} else {
+			_plArenaReleaseForeign(pn->items[i]);
+		}
+	}
+}
+
 void
 plNodeDelete(void* node) {
 	_plnode_t* pn;
@@ -162,9 +247,24 @@ plNodeDelete(void* node) {
 	pn->refcnt--;
 	if (pn->refcnt > 0) { return; }
 
+	if (pn->arena != NULL) {
+		/* Memory belongs to the document, all goes with its root */
+		if (pn->arena->root == pn) {
+			_plArenaReleaseForeign(pn);
+			_plArenaDelete(pn->arena);
+		}
+		return;
+	}
+
 	if (pn->datval != NULL) { _plfree(pn->datval); }
 	if (pn->keyval != NULL) { plNodeDelete(pn->keyval); }
-	if (pn->children != NULL) { _plChainDelete(pn->children); }
+	if (pn->items != NULL) {
+		unsigned int i;
+
+		for (i = 0; i < pn->count; i++) { plNodeDelete(pn->items[i]); }
+		_plfree(pn->items);
+	}
+	if (pn->index != NULL) { _plfree(pn->index); }
 
 	_plfree(node);
 }
@@ -189,7 +289,7 @@ plNodeAdd(void* bag, void* node) {
 		if (plDictFind(bag, plNodeGetBytes(node), plNodeGetSize(node), plKindAny) != NULL) { return 0; }
 		/* FALLTHROUGH */
 	case plKindArray:
-		if (_plChainAdd(&bn->children, dn)) { dn->refcnt++; return 1; }
+		if (_plBagPush(bn, dn)) { dn->refcnt++; return 1; }
 		return 0;
 	case plKindKey:
 		if (plNodeGetItem(bag, 0) != NULL) { return 0; }
@@ -241,6 +341,7 @@ plKeyNew(char* key, unsigned int klen, void* datum) {
 	node = plDataNew(key, klen);
 	if (node == NULL) { return NULL; }
 	node->kind = plKindKey;
+	node->hash = _plHash(node->datval, klen);
 	if (datum != NULL) { (void) plNodeAdd(node, datum); }
 	return node;
 }
@@ -273,7 +374,7 @@ plNodeGetSize(void* pn) {
 	switch(plNodeGetKind(pn)) {
 	case plKindArray:
 	case plKindDict:
-		return _plChainCount(wn->children);
+		return wn->count;
 	case plKindKey:
 	case plKindData:
 	case plKindString:
@@ -306,7 +407,7 @@ plNodeGetItem(void* bag, unsigned int inum) {
 	switch (plNodeGetKind(bag)) {
 	case plKindArray:
 	case plKindDict:
-		return _plChainGetLoad(bn->children, inum);
+		return inum < bn->count ? bn->items[inum] : NULL;
 	case plKindKey:
 		return bn->keyval;
 	default:
@@ -360,113 +461,630 @@ plNodeGetKind(void* node) {
 
 void*
 plDictFind(void* dict, char* key, unsigned int klen, plkind_t kind) {
-	unsigned int dsz;
+	_plnode_t* dn;
+	_plnode_t* dent;
+	unsigned int h;
 	unsigned int i;
 
 	if (plNodeGetKind(dict) != plKindDict || key == NULL || klen < 1) { return NULL; }
-	dsz = plNodeGetSize(dict);
-	for (i = 0; i < dsz; i++) {
-		void* dent;
-		void* kval;
-
-		dent = plNodeGetItem(dict, i);
-		if (dent == NULL || plNodeGetKind(dent) != plKindKey || plNodeGetSize(dent) != klen) { continue; }
-		if (_plmemcmp(plNodeGetBytes(dent), key, klen) != 0) { continue; }
-		kval = plNodeGetItem(dent, 0);
-		if (kind == plKindAny || plNodeGetKind(kval) == kind) {
-			return kval;
-		} else {
-			break;
+	dn = (_plnode_t*) dict;
+	h = _plHash(key, klen);
+	dent = NULL;
+	if (dn->index != NULL) {
+		for (i = h & dn->imask; dn->index[i] != 0; i = (i + 1) & dn->imask) {
+			dent = dn->items[dn->index[i] - 1];
+			if (dent->hash == h && dent->datlen == klen && _plmemcmp(dent->datval, key, klen) == 0) { break; }
+			dent = NULL;
 		}
+	} else {
+		for (i = 0; i < dn->count; i++) {
+			dent = dn->items[i];
+			if (dent->hash == h && dent->datlen == klen && _plmemcmp(dent->datval, key, klen) == 0) { break; }
+			dent = NULL;
+		}
+	}
+	if (dent == NULL) { return NULL; }
+	if (kind == plKindAny || plNodeGetKind(dent->keyval) == kind) {
+		return dent->keyval;
 	}
 	return NULL;
 }
 
+void
+plIterInit(pliter_t* it, void* bag) {
+	it->bag = bag;
+	it->pos = 0;
+}
+
+void*
+plIterNext(pliter_t* it) {
+	_plnode_t* bn;
+
+	bn = (_plnode_t*) it->bag;
+	switch (plNodeGetKind(bn)) {
+	case plKindArray:
+	case plKindDict:
+		if (it->pos < bn->count) { return bn->items[it->pos++]; }
+		break;
+	default:
+		break;
+	}
+	return NULL;
+}
+
+/*
+ * XML to plist in one pass.
+ *
+ * Nodes are built straight into the document arena. Keys are interned
+ * through a hash table for the time of parsing, so equal keys share one
+ * string and are compared by pointer in duplicate checks.
+ * Children of open bags are collected on a stack and moved to an exact
+ * size vector in the arena when the bag is closed.
+ * Character entities are not decoded, as before.
+ */
+
+#define PL_MAX_DEPTH 128
+
+typedef struct _plsym {
+	unsigned int hash;
+	unsigned int len;
+	char* str;
+} _plsym_t;
+
+typedef struct _plparser {
+	char* cur;
+	char* end;
+	_plarena_t* arena;
+	_plsym_t* syms;
+	unsigned int symmask;
+	unsigned int symcount;
+	_plnode_t** stack;
+	unsigned int sp;
+	unsigned int scap;
+} _plparser_t;
+
+typedef struct _pltag {
+	char* name;
+	unsigned int nlen;
+	int closing;
+	int empty; /* <name/> */
+} _pltag_t;
+
 int
-_plGrowBag(TagPtr ipl, void* parn, void* bagn) {
-	if (bagn == NULL) { return 0; }
-	if (!_plGrowTree(ipl->tag, bagn) || !plNodeAdd(parn, bagn)) {
-		plNodeDelete(bagn);
-		return 0;
+_plSymGrow(_plparser_t* p) {
+	_plsym_t* nsyms;
+	unsigned int nmask;
+	unsigned int i;
+	unsigned int j;
+
+	nmask = p->symmask * 2 + 1;
+	nsyms = (_plsym_t*) _plzalloc((nmask + 1) * sizeof(_plsym_t));
+	if (nsyms == NULL) { return 0; }
+	for (i = 0; i <= p->symmask; i++) {
+		if (p->syms[i].str == NULL) { continue; }
+		for (j = p->syms[i].hash & nmask; nsyms[j].str != NULL; j = (j + 1) & nmask)
+			;
+		nsyms[j] = p->syms[i];
 	}
+	_plfree(p->syms);
+	p->syms = nsyms;
+	p->symmask = nmask;
 	return 1;
 }
 
+char*
+_plIntern(_plparser_t* p, char* str, unsigned int len, unsigned int* hash) {
+	unsigned int h;
+	unsigned int i;
+	char* istr;
+
+	h = _plHash(str, len);
+	*hash = h;
+	for (i = h & p->symmask; p->syms[i].str != NULL; i = (i + 1) & p->symmask) {
+		if (p->syms[i].hash == h && p->syms[i].len == len &&
+		    _plmemcmp(p->syms[i].str, str, len) == 0) {
+			return p->syms[i].str;
+		}
+	}
+	istr = (char*) _plArenaAlloc(p->arena, len + 1);
+	if (istr == NULL) { return NULL; }
+	if (len > 0) { _plmemcpy(istr, str, len); }
+	p->syms[i].hash = h;
+	p->syms[i].len = len;
+	p->syms[i].str = istr;
+	p->symcount++;
+	if (p->symcount * 4 > p->symmask * 3 && !_plSymGrow(p)) { return NULL; }
+	return istr;
+}
+
+char*
+_plFindByte(char* cur, char* end, char c) {
+	while (cur < end && *cur != c) { cur++; }
+	return cur < end ? cur : NULL;
+}
+
+/* Next tag, skipping text, comments, <?...?> and <!...> */
+
 int
-_plGrowTree(TagPtr ipl, void* pn) {
-	void* wn;
-
-	while(ipl != NULL) {
-		wn = NULL;
-		switch (ipl->type) {
-		case kTagTypeArray:
-			wn = plArrayNew();
-			if (!_plGrowBag(ipl, pn, wn)) { return 0; }
-			break;
-		case kTagTypeDict:
-			wn = plDictNew();
-			if (!_plGrowBag(ipl, pn, wn)) { return 0; }
-			break;
-		case kTagTypeKey:
-			wn = plKeyNew(ipl->string, ipl->dataLen, NULL);
-			if (!_plGrowBag(ipl, pn, wn)) { return 0; }
-			break;
-		case kTagTypeString:
-			wn = plStringNew(ipl->string, ipl->dataLen);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		case kTagTypeData:
-			wn = plDataNew((char*)(ipl->data), ipl->dataLen);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		case kTagTypeTrue:
-			wn = plBoolNew(1);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		case kTagTypeFalse:
-			wn = plBoolNew(0);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		case kTagTypeInteger:
-			wn = plIntegerNew(ipl->intval);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		case kTagTypeDate:
-			wn = plDateNew(ipl->string, ipl->dataLen);
-			if (wn == NULL || !plNodeAdd(pn, wn)) { return 0; }
-			break;
-		default:
-			return 0;
+_plNextTag(_plparser_t* p, _pltag_t* tag) {
+	char* lt;
+	char* gt;
+	char* np;
+
+	for (;;) {
+		lt = _plFindByte(p->cur, p->end, '<');
+		if (lt == NULL || p->end - lt < 2) { return 0; }
+		if (p->end - lt >= 4 && lt[1] == '!' && lt[2] == '-' && lt[3] == '-') {
+			for (gt = lt + 4; gt + 2 < p->end && !(gt[0] == '-' && gt[1] == '-' && gt[2] == '>'); gt++)
+				;
+			if (gt + 2 >= p->end) { return 0; }
+			p->cur = gt + 3;
+			continue;
 		}
-		ipl = ipl->tagNext; /* next sibling */
+		gt = _plFindByte(lt + 1, p->end, '>');
+		if (gt == NULL) { return 0; }
+		p->cur = gt + 1;
+		if (lt[1] == '?' || lt[1] == '!') { continue; }
+		break;
 	}
+	np = lt + 1;
+	tag->closing = (*np == '/');
+	if (tag->closing) { np++; }
+	tag->name = np;
+	while (np < gt && *np != ' ' && *np != '\t' && *np != '\r' && *np != '\n' && *np != '/') { np++; }
+	tag->nlen = (unsigned int)(np - tag->name);
+	tag->empty = !tag->closing && gt[-1] == '/';
+	return 1;
+}
 
+int
+_plTagIs(_pltag_t* tag, char* name, unsigned int nlen) {
+	return tag->nlen == nlen && _plmemcmp(tag->name, name, nlen) == 0;
+}
+
+/* Text of an element up to its closing tag */
+
+int
+_plTagText(_plparser_t* p, _pltag_t* tag, char** text, unsigned int* tlen) {
+	char* lt;
+
+	*text = p->cur;
+	*tlen = 0;
+	if (tag->empty) { return 1; }
+	for (lt = p->cur; (lt = _plFindByte(lt, p->end, '<')) != NULL; lt++) {
+		if (p->end - lt >= (int)(tag->nlen + 3) && lt[1] == '/' &&
+		    _plmemcmp(lt + 2, tag->name, tag->nlen) == 0 && lt[tag->nlen + 2] == '>') {
+			*tlen = (unsigned int)(lt - p->cur);
+			p->cur = lt + tag->nlen + 3;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+_plnode_t*
+_plArenaNodeNew(_plarena_t* ar, plkind_t nk) {
+	_plnode_t* node;
+
+	node = (_plnode_t*) _plArenaAlloc(ar, sizeof(_plnode_t));
+	if (node != NULL) {
+		node->kind = nk;
+		node->arena = ar;
+	}
+	return node;
+}
+
+char*
+_plArenaCopy(_plarena_t* ar, char* str, unsigned int len) {
+	char* dst;
+
+	dst = (char*) _plArenaAlloc(ar, len + 1);
+	if (dst != NULL && len > 0) { _plmemcpy(dst, str, len); }
+	return dst;
+}
+
+int
+_plStackPush(_plparser_t* p, _plnode_t* node) {
+	_plnode_t** nstack;
+	unsigned int ncap;
+
+	if (p->sp == p->scap) {
+		ncap = p->scap * 2;
+		nstack = (_plnode_t**) _plzalloc(ncap * sizeof(_plnode_t*));
+		if (nstack == NULL) { return 0; }
+		_plmemcpy(nstack, p->stack, p->sp * sizeof(_plnode_t*));
+		_plfree(p->stack);
+		p->stack = nstack;
+		p->scap = ncap;
+	}
+	p->stack[p->sp++] = node;
+	node->refcnt++;
 	return 1;
 }
 
+/* Moves children from the stack into bag, rejecting duplicate keys */
+
+int
+_plBagClose(_plparser_t* p, _plnode_t* bag, unsigned int base) {
+	unsigned int i;
+	unsigned int j;
+	unsigned int isz;
+
+	bag->count = p->sp - base;
+	p->sp = base;
+	if (bag->count == 0) { return 1; }
+	bag->items = (_plnode_t**) _plArenaAlloc(p->arena, bag->count * sizeof(_plnode_t*));
+	if (bag->items == NULL) { return 0; }
+	_plmemcpy(bag->items, p->stack + base, bag->count * sizeof(_plnode_t*));
+	bag->capacity = bag->count;
+	if (bag->kind != plKindDict) { return 1; }
+
+	/* Keys are interned, so equal keys have equal pointers */
+	if (bag->count < PL_DICT_INDEX_MIN) {
+		for (i = 1; i < bag->count; i++) {
+			for (j = 0; j < i; j++) {
+				if (bag->items[j]->datval == bag->items[i]->datval) { return 0; }
+			}
+		}
+		return 1;
+	}
+	isz = 16;
+	while (isz < bag->count * 2) { isz *= 2; }
+	bag->index = (unsigned int*) _plArenaAlloc(p->arena, isz * sizeof(unsigned int));
+	if (bag->index == NULL) { return 0; }
+	bag->imask = isz - 1;
+	for (i = 0; i < bag->count; i++) {
+		for (j = bag->items[i]->hash & bag->imask; bag->index[j] != 0; j = (j + 1) & bag->imask) {
+			if (bag->items[bag->index[j] - 1]->datval == bag->items[i]->datval) { return 0; }
+		}
+		bag->index[j] = i + 1;
+	}
+	return 1;
+}
+
+_plnode_t* _plParseNode(_plparser_t* p, _pltag_t* tag, unsigned int depth);
+
+int
+_plParseBag(_plparser_t* p, _plnode_t* bag, unsigned int depth) {
+	_pltag_t tag;
+	_plnode_t* node;
+	unsigned int base;
+
+	base = p->sp;
+	for (;;) {
+		if (!_plNextTag(p, &tag)) { return 0; }
+		if (tag.closing) { return _plBagClose(p, bag, base); }
+		node = _plParseNode(p, &tag, depth);
+		if (node == NULL) { return 0; }
+		if (bag->kind == plKindDict && (node->kind != plKindKey || node->keyval == NULL)) { return 0; }
+		if (!_plStackPush(p, node)) { return 0; }
+	}
+}
+
+_plnode_t*
+_plParseNode(_plparser_t* p, _pltag_t* tag, unsigned int depth) {
+	_plnode_t* node;
+	_pltag_t vtag;
+	char* text;
+	unsigned int tlen;
+
+	if (tag->closing || depth > PL_MAX_DEPTH) { return NULL; }
+
+	if (_plTagIs(tag, "dict", 4) || _plTagIs(tag, "array", 5)) {
+		node = _plArenaNodeNew(p->arena, tag->nlen == 4 ? plKindDict : plKindArray);
+		if (node == NULL) { return NULL; }
+		if (!tag->empty && !_plParseBag(p, node, depth + 1)) { return NULL; }
+		return node;
+	}
+
+	if (_plTagIs(tag, "true", 4) || _plTagIs(tag, "false", 5)) {
+		node = _plArenaNodeNew(p->arena, plKindBool);
+		if (node == NULL || !_plTagText(p, tag, &text, &tlen)) { return NULL; }
+		node->intval = (tag->nlen == 4);
+		return node;
+	}
+
+	if (!_plTagText(p, tag, &text, &tlen)) { return NULL; }
+
+	if (_plTagIs(tag, "key", 3)) {
+		node = _plArenaNodeNew(p->arena, plKindKey);
+		if (node == NULL) { return NULL; }
+		node->datval = _plIntern(p, text, tlen, &node->hash);
+		node->datlen = tlen;
+		if (node->datval == NULL || !_plNextTag(p, &vtag)) { return NULL; }
+		node->keyval = _plParseNode(p, &vtag, depth + 1);
+		if (node->keyval == NULL) { return NULL; }
+		node->keyval->refcnt++;
+		return node;
+	}
+
+	if (_plTagIs(tag, "string", 6) || _plTagIs(tag, "date", 4)) {
+		node = _plArenaNodeNew(p->arena, tag->nlen == 6 ? plKindString : plKindDate);
+		if (node == NULL) { return NULL; }
+		node->datval = _plArenaCopy(p->arena, text, tlen);
+		node->datlen = tlen;
+		return node->datval != NULL ? node : NULL;
+	}
+
+	if (_plTagIs(tag, "integer", 7)) {
+		node = _plArenaNodeNew(p->arena, plKindInteger);
+		if (node == NULL) { return NULL; }
+		node->intval = tlen > 0 ? _plstr2vlong(text, tlen) : 0;
+		return node;
+	}
+
+	if (_plTagIs(tag, "data", 4)) {
+		node = _plArenaNodeNew(p->arena, plKindData);
+		if (node == NULL) { return NULL; }
+		/* Decoded data is never longer than its base64 text */
+		node->datval = (char*) _plArenaAlloc(p->arena, tlen + 1);
+		if (node->datval == NULL) { return NULL; }
+		node->datlen = _plb64decodeto(text, tlen, node->datval);
+		return node;
+	}
+
+	return NULL;
+}
+
 void*
 plXmlToNode(plbuf_t* ibuf) {
-	TagPtr plist;
-	void* pn;
-	int rc;
-
-	rc = 0;
-	pn = NULL;
-
-	rc = PListXMLParse(ibuf->dat, ibuf->len, &plist);
-	if(rc == 0) {
-		switch(plist->type) {
-		case kTagTypeDict:
-			pn = plDictNew();
-			rc = _plGrowTree(plist->tag, pn);
-			if (rc == 0) { plNodeDelete(pn); }
-			break;
-		default:
-			rc = 0;
-			break;
+	_plparser_t p;
+	_pltag_t tag;
+	_plnode_t* root;
+
+	root = NULL;
+	if (ibuf == NULL || ibuf->dat == NULL) { return NULL; }
+
+	p.cur = ibuf->dat;
+	p.end = ibuf->dat + ibuf->len;
+	p.symmask = 0xff;
+	p.symcount = 0;
+	p.syms = (_plsym_t*) _plzalloc((p.symmask + 1) * sizeof(_plsym_t));
+	p.sp = 0;
+	p.scap = 256;
+	p.stack = (_plnode_t**) _plzalloc(p.scap * sizeof(_plnode_t*));
+	p.arena = _plArenaNew(ibuf->len);
+	if (p.syms == NULL || p.stack == NULL || p.arena == NULL) {
+		if (p.syms != NULL) { _plfree(p.syms); }
+		if (p.stack != NULL) { _plfree(p.stack); }
+		if (p.arena != NULL) { _plArenaDelete(p.arena); }
+		return NULL;
+	}
+
+	/* The first element inside of <plist> must be a dict */
+	while (_plNextTag(&p, &tag)) {
+		if (tag.closing || _plTagIs(&tag, "plist", 5)) { continue; }
+		if (_plTagIs(&tag, "dict", 4)) {
+			root = _plParseNode(&p, &tag, 0);
+		}
+		break;
+	}
+
+	_plfree(p.syms);
+	_plfree(p.stack);
+	if (root == NULL) {
+		_plArenaDelete(p.arena);
+		return NULL;
+	}
+	p.arena->root = root;
+	return root;
+}
+
+/*
+ * Binary cache of a document.
+ *
+ * Header (little endian): magic "bbPC", version, source length, source
+ * time, payload length, FNV-1a of payload. Payload is the tree in preorder,
+ * one kind byte per node followed by
+ *   array, dict: u32 count and the items
+ *   key: u32 length, bytes and the value node
+ *   bool: u8
+ *   integer: u64
+ *   data, date, string: u32 length and bytes (data is decoded)
+ * Source length and time are opaque here, caller compares them with the
+ * XML file the cache was made from.
+ */
+
+#define PL_BIN_VERSION 1
+#define PL_BIN_HDR_SIZE 28
+
+int
+_plBinPut(plbuf_t* obuf, void* src, unsigned int len) {
+	if (obuf->dat != NULL) {
+		if (obuf->len - obuf->pos < len) { return 0; }
+		if (len > 0) { _plmemcpy(obuf->dat + obuf->pos, src, len); }
+	}
+	obuf->pos += len;
+	return 1;
+}
+
+int
+_plBinPutU(plbuf_t* obuf, unsigned long long val, unsigned int nbytes) {
+	unsigned char tmp[8];
+	unsigned int i;
+
+	for (i = 0; i < nbytes; i++) {
+		tmp[i] = (unsigned char) (val >> (i * 8));
+	}
+	return _plBinPut(obuf, tmp, nbytes);
+}
+
+int
+_plBinPutNode(plbuf_t* obuf, _plnode_t* pn, unsigned int depth) {
+	unsigned int i;
+
+	if (pn == NULL || depth > PL_MAX_DEPTH || !_plBinPutU(obuf, pn->kind, 1)) { return 0; }
+	switch (pn->kind) {
+	case plKindArray:
+	case plKindDict:
+		if (!_plBinPutU(obuf, pn->count, 4)) { return 0; }
+		for (i = 0; i < pn->count; i++) {
+			if (!_plBinPutNode(obuf, pn->items[i], depth + 1)) { return 0; }
+		}
+		return 1;
+	case plKindKey:
+		if (!_plBinPutU(obuf, pn->datlen, 4) || !_plBinPut(obuf, pn->datval, pn->datlen)) { return 0; }
+		return _plBinPutNode(obuf, pn->keyval, depth + 1);
+	case plKindBool:
+		return _plBinPutU(obuf, pn->intval != 0, 1);
+	case plKindInteger:
+		return _plBinPutU(obuf, (unsigned long long) pn->intval, 8);
+	case plKindData:
+	case plKindDate:
+	case plKindString:
+		if (pn->datval == NULL) { return _plBinPutU(obuf, 0, 4); }
+		return _plBinPutU(obuf, pn->datlen, 4) && _plBinPut(obuf, pn->datval, pn->datlen);
+	default:
+		return 0;
+	}
+}
+
+int
+plNodeToBin(void* pl, unsigned int srclen, vlong srctime, plbuf_t* obuf) {
+	unsigned int hpos;
+	unsigned int plen;
+	plbuf_t hbuf;
+
+	if (plNodeGetKind(pl) != plKindDict || obuf == NULL) { return 0; }
+	hpos = obuf->pos;
+	if (!_plBinPut(obuf, "bbPC", 4)) { return 0; }
+	obuf->pos += PL_BIN_HDR_SIZE - 4;
+	if (obuf->dat != NULL && obuf->pos > obuf->len) { return 0; }
+	if (!_plBinPutNode(obuf, (_plnode_t*) pl, 0)) { return 0; }
+	if (obuf->dat == NULL) { return 1; }
+
+	plen = obuf->pos - hpos - PL_BIN_HDR_SIZE;
+	hbuf.dat = obuf->dat + hpos + 4;
+	hbuf.len = PL_BIN_HDR_SIZE - 4;
+	hbuf.pos = 0;
+	_plBinPutU(&hbuf, PL_BIN_VERSION, 4);
+	_plBinPutU(&hbuf, srclen, 4);
+	_plBinPutU(&hbuf, (unsigned long long) srctime, 8);
+	_plBinPutU(&hbuf, plen, 4);
+	_plBinPutU(&hbuf, _plHash(obuf->dat + hpos + PL_BIN_HDR_SIZE, plen), 4);
+	return 1;
+}
+
+typedef struct _plbinrd {
+	unsigned char* cur;
+	unsigned char* end;
+	_plarena_t* arena;
+} _plbinrd_t;
+
+int
+_plBinGetU(_plbinrd_t* rd, unsigned int nbytes, unsigned long long* val) {
+	unsigned int i;
+
+	if ((unsigned int) (rd->end - rd->cur) < nbytes) { return 0; }
+	*val = 0;
+	for (i = 0; i < nbytes; i++) {
+		*val |= (unsigned long long) rd->cur[i] << (i * 8);
+	}
+	rd->cur += nbytes;
+	return 1;
+}
+
+char*
+_plBinGetBytes(_plbinrd_t* rd, unsigned int* len) {
+	unsigned long long v;
+	char* dst;
+
+	if (!_plBinGetU(rd, 4, &v) || v > (unsigned long long) (rd->end - rd->cur)) { return NULL; }
+	*len = (unsigned int) v;
+	dst = _plArenaCopy(rd->arena, (char*) rd->cur, *len);
+	rd->cur += *len;
+	return dst;
+}
+
+_plnode_t*
+_plBinGetNode(_plbinrd_t* rd, unsigned int depth) {
+	_plnode_t* node;
+	unsigned long long v;
+	unsigned int i;
+
+	if (depth > PL_MAX_DEPTH || !_plBinGetU(rd, 1, &v)) { return NULL; }
+	if (v < plKindArray || v > plKindString) { return NULL; }
+	node = _plArenaNodeNew(rd->arena, (plkind_t) v);
+	if (node == NULL) { return NULL; }
+	switch (node->kind) {
+	case plKindArray:
+	case plKindDict:
+		/* Every item takes two bytes at least */
+		if (!_plBinGetU(rd, 4, &v) || v > (unsigned long long) (rd->end - rd->cur) / 2) { return NULL; }
+		node->count = node->capacity = (unsigned int) v;
+		if (node->count == 0) { return node; }
+		node->items = (_plnode_t**) _plArenaAlloc(rd->arena, node->count * sizeof(_plnode_t*));
+		if (node->items == NULL) { return NULL; }
+		for (i = 0; i < node->count; i++) {
+			node->items[i] = _plBinGetNode(rd, depth + 1);
+			if (node->items[i] == NULL) { return NULL; }
+			if ((node->kind == plKindDict) != (node->items[i]->kind == plKindKey)) { return NULL; }
+			node->items[i]->refcnt++;
 		}
-		PListXMLFreeTag(plist);
+		if (node->kind == plKindDict && node->count >= PL_DICT_INDEX_MIN && !_plDictIndex(node)) { return NULL; }
+		return node;
+	case plKindKey:
+		node->datval = _plBinGetBytes(rd, &node->datlen);
+		if (node->datval == NULL) { return NULL; }
+		node->hash = _plHash(node->datval, node->datlen);
+		node->keyval = _plBinGetNode(rd, depth + 1);
+		if (node->keyval == NULL || node->keyval->kind == plKindKey) { return NULL; }
+		node->keyval->refcnt++;
+		return node;
+	case plKindBool:
+		if (!_plBinGetU(rd, 1, &v)) { return NULL; }
+		node->intval = (v != 0);
+		return node;
+	case plKindInteger:
+		if (!_plBinGetU(rd, 8, &v)) { return NULL; }
+		node->intval = (vlong) v;
+		return node;
+	default:
+		node->datval = _plBinGetBytes(rd, &node->datlen);
+		return node->datval != NULL ? node : NULL;
+	}
+}
+
+int
+plBinStamp(plbuf_t* ibuf, unsigned int* srclen, vlong* srctime) {
+	_plbinrd_t rd;
+	unsigned long long v;
+	unsigned long long plen;
+
+	if (ibuf == NULL || ibuf->dat == NULL || ibuf->len < PL_BIN_HDR_SIZE) { return 0; }
+	if (_plmemcmp(ibuf->dat, "bbPC", 4) != 0) { return 0; }
+	rd.cur = (unsigned char*) ibuf->dat + 4;
+	rd.end = (unsigned char*) ibuf->dat + PL_BIN_HDR_SIZE;
+	_plBinGetU(&rd, 4, &v);
+	if (v != PL_BIN_VERSION) { return 0; }
+	_plBinGetU(&rd, 4, &v);
+	*srclen = (unsigned int) v;
+	_plBinGetU(&rd, 8, &v);
+	*srctime = (vlong) v;
+	_plBinGetU(&rd, 4, &plen);
+	if (plen != ibuf->len - PL_BIN_HDR_SIZE) { return 0; }
+	_plBinGetU(&rd, 4, &v);
+	return v == _plHash(ibuf->dat + PL_BIN_HDR_SIZE, (unsigned int) plen);
+}
+
+void*
+plBinToNode(plbuf_t* ibuf, unsigned int srclen, vlong srctime) {
+	_plbinrd_t rd;
+	_plnode_t* root;
+	unsigned int clen;
+	vlong ctime;
+
+	if (!plBinStamp(ibuf, &clen, &ctime) || clen != srclen || ctime != srctime) { return NULL; }
+	rd.cur = (unsigned char*) ibuf->dat + PL_BIN_HDR_SIZE;
+	rd.end = (unsigned char*) ibuf->dat + ibuf->len;
+	/* Nodes take more room than their encoding */
+	rd.arena = _plArenaNew(ibuf->len * 2);
+	if (rd.arena == NULL) { return NULL; }
+	root = _plBinGetNode(&rd, 0);
+	if (root == NULL || root->kind != plKindDict || rd.cur != rd.end) {
+		_plArenaDelete(rd.arena);
+		return NULL;
 	}
-	PListXMLCleanup();
-	return  rc == 0 ? NULL : pn;
+	rd.arena->root = root;
+	return root;
 }
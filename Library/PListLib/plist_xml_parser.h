@@ -1,82 +0,0 @@
-/*
- * Copyright (c) 2000 Apple Computer, Inc. All rights reserved.
- *
- * @APPLE_LICENSE_HEADER_START@
- *
- * The contents of this file constitute Original Code as defined in and
- * are subject to the Apple Public Source License Version 1.1 (the
- * "License").  You may not use this file except in compliance with the
- * License.  Please obtain a copy of the License at
- * http://www.apple.com/publicsource and read it before using this file.
- *
- * This Original Code and all software distributed under the License are
- * distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, EITHER
- * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
- * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE OR NON-INFRINGEMENT.  Please see the
- * License for the specific language governing rights and limitations
- * under the License.
- *
- * @APPLE_LICENSE_HEADER_END@
- */
-/*
- *  plist.c - plist parsing functions
- *
- *  Copyright (c) 2000-2005 Apple Computer, Inc.
- *
- *  DRI: Josh de Cesare
- *  code split out from drivers.c by Soren Spies, 2005
- */
-
-//Slice - rewrite for UEFI with more functions like Copyright (c) 2003 Apple Computer
-
-// nms -- made less environment dependent
-
-/* Interface to XML parser */
-
-typedef enum {
-  kTagTypeNone = 0,
-  kTagTypeDict,
-  kTagTypeKey,
-  kTagTypeString,
-  kTagTypeInteger,
-  kTagTypeData,
-  kTagTypeDate,
-  kTagTypeFalse,
-  kTagTypeTrue,
-  kTagTypeArray
-} PLIST_TAG_TYPE;
-
-typedef struct {
-  unsigned int   type;
-  char*          string;
-  unsigned char* data;
-  unsigned int   dataLen;
-  vlong           intval;
-  unsigned int   offset;
-  void*          tag;
-  void*          tagNext;
-} Tag, *TagPtr;
-
-int
-PListXMLParse (
-  const char* buffer,
-  unsigned int bSize,
-  TagPtr* dict
-);
-
-TagPtr
-PListXMLGetProperty (
-  TagPtr dict,
-  const char* key
-);
-
-void
-PListXMLFreeTag (
-  TagPtr tag
-);
-
-void
-PListXMLCleanup (
-  void
-);
@@ -43,8 +43,8 @@
 // functions
 
 static void fsw_blockcache_free(struct fsw_volume *vol);
-
-#define MAX_CACHE_LEVEL (5)
+static fsw_u32 fsw_blockcache_max(fsw_u32 phys_blocksize);
+static void fsw_dcache_free(struct fsw_volume *vol);
 
 
 /**
@@ -82,6 +82,7 @@ fsw_status_t fsw_mount(void *host_data,
     vol->host_table     = host_table;
     vol->fstype_table   = fstype_table;
     vol->host_string_type = host_table->native_string_type;
+    vol->bcache_max     = fsw_blockcache_max(vol->phys_blocksize);
 
     // let the fs driver mount the file system
     status = vol->fstype_table->volume_mount(vol);
@@ -108,6 +109,8 @@ errorexit:
 
 void fsw_unmount(struct fsw_volume *vol)
 {
+    // cached dnodes hold references up to the root
+    fsw_dcache_free(vol);
     if (vol->root)
         fsw_dnode_release(vol->root);
     // TODO: check that no other dnodes are still around
@@ -159,6 +162,94 @@ void fsw_set_blocksize(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32 l
 
     vol->phys_blocksize = phys_blocksize;
     vol->log_blocksize = log_blocksize;
+    vol->bcache_max = fsw_blockcache_max(phys_blocksize);
+}
+
+/**
+ * Number of block cache entries that fit into FSW_BCACHE_MAX_MEM for the given
+ * physical block size. A few entries are always allowed.
+ */
+
+static fsw_u32 fsw_blockcache_max(fsw_u32 phys_blocksize)
+{
+    fsw_u32 max_entries = FSW_BCACHE_MAX_MEM / phys_blocksize;
+
+    return (max_entries < 16) ? 16 : max_entries;
+}
+
+/**
+ * Hash bucket of a physical block number. Blocks are mostly accessed in runs, so
+ * the low bits spread them evenly over the table.
+ */
+
+#define FSW_BCACHE_HASH(phys_bno) ((phys_bno) & (FSW_BCACHE_HASH_SIZE - 1))
+
+/**
+ * Find the cache entry for a physical block number. Returns NULL if the block
+ * is not cached.
+ */
+
+static struct fsw_blockcache *fsw_blockcache_find(struct fsw_volume *vol, fsw_u32 phys_bno)
+{
+    struct fsw_blockcache *bc;
+
+    if (vol->bcache == NULL)
+        return NULL;
+    for (bc = vol->bcache[FSW_BCACHE_HASH(phys_bno)]; bc != NULL; bc = bc->hash_next) {
+        if (bc->phys_bno == phys_bno)
+            return bc;
+    }
+    return NULL;
+}
+
+/**
+ * Remove a cache entry from its hash bucket.
+ */
+
+static void fsw_blockcache_unhash(struct fsw_volume *vol, struct fsw_blockcache *bc)
+{
+    struct fsw_blockcache **link;
+
+    for (link = &vol->bcache[FSW_BCACHE_HASH(bc->phys_bno)]; *link != NULL; link = &(*link)->hash_next) {
+        if (*link == bc) {
+            *link = bc->hash_next;
+            break;
+        }
+    }
+    bc->hash_next = NULL;
+}
+
+/**
+ * Append an unreferenced cache entry to the LRU list of its cache level as the newest entry.
+ */
+
+static void fsw_blockcache_lru_add(struct fsw_volume *vol, struct fsw_blockcache *bc)
+{
+    bc->lru_next = NULL;
+    bc->lru_prev = vol->bcache_mru[bc->cache_level];
+    if (bc->lru_prev != NULL)
+        bc->lru_prev->lru_next = bc;
+    else
+        vol->bcache_lru[bc->cache_level] = bc;
+    vol->bcache_mru[bc->cache_level] = bc;
+}
+
+/**
+ * Take a cache entry off the LRU list of its cache level. Called when the entry
+ * gets referenced again or is evicted.
+ */
+
+static void fsw_blockcache_lru_remove(struct fsw_volume *vol, struct fsw_blockcache *bc)
+{
+    if (bc->lru_prev != NULL)
+        bc->lru_prev->lru_next = bc->lru_next;
+    else
+        vol->bcache_lru[bc->cache_level] = bc->lru_next;
+    if (bc->lru_next != NULL)
+        bc->lru_next->lru_prev = bc->lru_prev;
+    else
+        vol->bcache_mru[bc->cache_level] = bc->lru_prev;
+    bc->lru_prev = bc->lru_next = NULL;
 }
 
 /**
@@ -167,7 +258,8 @@ void fsw_set_blocksize(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32 l
  * Given a physical block number, it reads the block into memory (or fetches it from the
  * block cache) and returns the address of the memory buffer. The caller should provide
  * an indication of how important the block is in the cache_level parameter. Blocks with
- * a low level are purged first. Some suggestions for cache levels:
+ * a low level are purged first, least recently used first within a level. Some
+ * suggestions for cache levels:
  *
  *  - 0: File data
  *  - 1: Directory data, symlink data
@@ -181,106 +273,112 @@ void fsw_set_blocksize(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32 l
 fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 cache_level, void **buffer_out)
 {
     fsw_status_t    status;
-    fsw_u32         i, discard_level, new_bcache_size;
-    struct fsw_blockcache *new_bcache = NULL;
+    fsw_u32         discard_level;
+    struct fsw_blockcache *bc = NULL;
 
     // TODO: allow the host driver to do its own caching; just call through if
     //  the appropriate function pointers are set
 
-    if (cache_level > MAX_CACHE_LEVEL)
-        cache_level = MAX_CACHE_LEVEL;
+    if (cache_level > FSW_MAX_CACHE_LEVEL)
+        cache_level = FSW_MAX_CACHE_LEVEL;
 
-    // check block cache
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == phys_bno) {
-            // cache hit!
-            if (vol->bcache[i].cache_level < cache_level)
-                vol->bcache[i].cache_level = cache_level;  // promote the entry
-            vol->bcache[i].refcount++;
-            *buffer_out = vol->bcache[i].data;
-            return FSW_SUCCESS;
-        }
+    // create the hash table on first use
+    if (vol->bcache == NULL) {
+        status = fsw_alloc_zero(FSW_BCACHE_HASH_SIZE * sizeof(struct fsw_blockcache *), (void **)&vol->bcache);
+        if (status)
+            return status;
     }
 
-    // find a free entry in the cache table
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == FSW_INVALID_BNO)
-            break;
+    // check block cache
+    bc = fsw_blockcache_find(vol, phys_bno);
+    if (bc != NULL) {
+        // cache hit!
+        if (bc->refcount == 0)
+            fsw_blockcache_lru_remove(vol, bc);
+        if (bc->cache_level < cache_level)
+            bc->cache_level = cache_level;  // promote the entry
+        bc->refcount++;
+        vol->bcache_stat.hits++;
+        *buffer_out = bc->data;
+        return FSW_SUCCESS;
     }
-    if (i >= vol->bcache_size) {
-        for (discard_level = 0; discard_level <= MAX_CACHE_LEVEL; discard_level++) {
-            for (i = 0; i < vol->bcache_size; i++) {
-                if (vol->bcache[i].refcount == 0 && vol->bcache[i].cache_level <= discard_level)
-                    break;
-            }
-            if (i < vol->bcache_size)
+    vol->bcache_stat.misses++;
+
+    // at the limit, recycle the least recently used entry of the lowest level
+    if (vol->bcache_size >= vol->bcache_max) {
+        for (discard_level = 0; discard_level <= FSW_MAX_CACHE_LEVEL; discard_level++) {
+            bc = vol->bcache_lru[discard_level];
+            if (bc != NULL)
                 break;
         }
+        if (bc != NULL) {
+            fsw_blockcache_lru_remove(vol, bc);
+            fsw_blockcache_unhash(vol, bc);
+            vol->bcache_stat.evictions++;
+        }
     }
-    if (i >= vol->bcache_size) {
-        // enlarge / create the cache
-        if (vol->bcache_size < 16)
-            new_bcache_size = 16;
-        else
-            new_bcache_size = vol->bcache_size << 1;
-        status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
+
+    // everything referenced or below the limit: add a new entry
+    if (bc == NULL) {
+        status = fsw_alloc_zero(sizeof(struct fsw_blockcache), (void **)&bc);
+        if (status)
+            return status;
+        status = fsw_alloc(vol->phys_blocksize, &bc->data);
         if (status) {
-            if (new_bcache != NULL)
-              fsw_free(new_bcache);
+            fsw_free(bc);
             return status;
         }
-        if (vol->bcache_size > 0)
-            fsw_memcpy(new_bcache, vol->bcache, vol->bcache_size * sizeof(struct fsw_blockcache));
-        for (i = vol->bcache_size; i < new_bcache_size; i++) {
-            new_bcache[i].refcount = 0;
-            new_bcache[i].cache_level = 0;
-            new_bcache[i].phys_bno = FSW_INVALID_BNO;
-            new_bcache[i].data = NULL;
-        }
-        i = vol->bcache_size;
-
-        // switch caches
-        if (vol->bcache != NULL)
-            fsw_free(vol->bcache);
-        vol->bcache = new_bcache;
-        vol->bcache_size = new_bcache_size;
+        vol->bcache_size++;
     }
-    vol->bcache[i].phys_bno = FSW_INVALID_BNO;
 
     // read the data
-    if (vol->bcache[i].data == NULL) {
-        status = fsw_alloc(vol->phys_blocksize, &vol->bcache[i].data);
-        if (status)
-            return status;
-    }
-    status = vol->host_table->read_block(vol, phys_bno, vol->bcache[i].data);
-    if (status)
+    status = vol->host_table->read_block(vol, phys_bno, bc->data);
+    if (status) {
+        fsw_free(bc->data);
+        fsw_free(bc);
+        vol->bcache_size--;
         return status;
+    }
 
-    vol->bcache[i].phys_bno = phys_bno;
-    vol->bcache[i].cache_level = cache_level;
-    vol->bcache[i].refcount = 1;
-    *buffer_out = vol->bcache[i].data;
+    bc->phys_bno = phys_bno;
+    bc->cache_level = cache_level;
+    bc->refcount = 1;
+    bc->hash_next = vol->bcache[FSW_BCACHE_HASH(phys_bno)];
+    vol->bcache[FSW_BCACHE_HASH(phys_bno)] = bc;
+    *buffer_out = bc->data;
     return FSW_SUCCESS;
 }
 
 /**
  * Releases a disk block. This function must be called to release disk blocks returned
- * from fsw_block_get.
+ * from fsw_block_get. When the last reference goes away the block stays cached as the
+ * most recently used entry of its level, unless the cache is over its memory limit.
  */
 
 void fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffer)
 {
-    fsw_u32 i;
+    struct fsw_blockcache *bc;
 
     // TODO: allow the host driver to do its own caching; just call through if
     //  the appropriate function pointers are set
 
     // update block cache
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == phys_bno && vol->bcache[i].refcount > 0)
-            vol->bcache[i].refcount--;
+    bc = fsw_blockcache_find(vol, phys_bno);
+    if (bc == NULL || bc->refcount == 0)
+        return;
+    if (--bc->refcount > 0)
+        return;
+
+    if (vol->bcache_size > vol->bcache_max) {
+        // the cache grew past the limit while all entries were in use
+        fsw_blockcache_unhash(vol, bc);
+        fsw_free(bc->data);
+        fsw_free(bc);
+        vol->bcache_size--;
+        vol->bcache_stat.evictions++;
+        return;
     }
+    fsw_blockcache_lru_add(vol, bc);
 }
 
 /**
@@ -291,15 +389,23 @@ void fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffer
 static void fsw_blockcache_free(struct fsw_volume *vol)
 {
     fsw_u32 i;
+    struct fsw_blockcache *bc, *next;
 
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].data != NULL)
-            fsw_free(vol->bcache[i].data);
-    }
     if (vol->bcache != NULL) {
+        for (i = 0; i < FSW_BCACHE_HASH_SIZE; i++) {
+            for (bc = vol->bcache[i]; bc != NULL; bc = next) {
+                next = bc->hash_next;
+                fsw_free(bc->data);
+                fsw_free(bc);
+            }
+        }
         fsw_free(vol->bcache);
         vol->bcache = NULL;
     }
+    for (i = 0; i <= FSW_MAX_CACHE_LEVEL; i++) {
+        vol->bcache_lru[i] = NULL;
+        vol->bcache_mru[i] = NULL;
+    }
     vol->bcache_size = 0;
 }
 
@@ -433,8 +539,7 @@ void fsw_dnode_release(struct fsw_dnode *dno)
 
     dno->refcount--;
 
-    // numcslots always zero for non dir dnodes
-    if (dno->refcount != dno->numcslots)
+    if (dno->refcount > 0)
         return;
 
     parent_dno = dno->parent;
@@ -447,21 +552,6 @@ void fsw_dnode_release(struct fsw_dnode *dno)
     if (vol->dnode_head == dno)
         vol->dnode_head = dno->next;
 
-#if defined(FSW_DNODE_CACHE_SIZE) && FSW_DNODE_CACHE_SIZE > 0
-    if (dno->type == FSW_DNODE_TYPE_DIR) {
-        int i;
-
-        for (i = 0; i < FSW_DNODE_CACHE_SIZE; i++) {
-            struct fsw_dnode *cache_entry = dno->cache[i];
-
-            if (cache_entry == NULL)
-                continue;
-            // numcslots not decremented on purpose
-            fsw_dnode_release(cache_entry);
-        }
-    }
-#endif
-
     // run fstype-specific cleanup
     vol->fstype_table->dnode_free(vol, dno);
 
@@ -517,9 +607,188 @@ fsw_status_t fsw_dnode_stat(struct fsw_dnode *dno, struct fsw_dnode_stat *sb)
 }
 
 /**
- * Lookup a directory entry by name in directory cache.
+ * Hash a directory id and a name for the dentry cache. Characters are case folded,
+ * so all spellings of a name land in the same bucket.
+ */
+
+static fsw_u32 fsw_dcache_hash(fsw_u32 parent_id, struct fsw_string *name)
+{
+    fsw_u32 hash = 2166136261U ^ parent_id;
+    int i;
+
+    if (name->type == FSW_STRING_TYPE_ISO88591) {
+        for (i = 0; i < name->len; i++)
+            hash = (hash ^ fsw_to_lower(((fsw_u8 *)name->data)[i])) * 16777619U;
+    } else if (name->type == FSW_STRING_TYPE_UTF16) {
+        for (i = 0; i < name->len; i++)
+            hash = (hash ^ fsw_to_lower(((fsw_u16 *)name->data)[i])) * 16777619U;
+    } else {
+        for (i = 0; i < name->size; i++)
+            hash = (hash ^ ((fsw_u8 *)name->data)[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * Remove an entry from the LRU list of the dentry cache.
+ */
+
+static void fsw_dcache_lru_remove(struct fsw_volume *vol, struct fsw_dentry *de)
+{
+    if (de->lru_prev != NULL)
+        de->lru_prev->lru_next = de->lru_next;
+    else
+        vol->dcache_lru = de->lru_next;
+    if (de->lru_next != NULL)
+        de->lru_next->lru_prev = de->lru_prev;
+    else
+        vol->dcache_mru = de->lru_prev;
+    de->lru_prev = de->lru_next = NULL;
+}
+
+/**
+ * Append an entry to the LRU list of the dentry cache as the newest entry.
+ */
+
+static void fsw_dcache_lru_add(struct fsw_volume *vol, struct fsw_dentry *de)
+{
+    de->lru_next = NULL;
+    de->lru_prev = vol->dcache_mru;
+    if (vol->dcache_mru != NULL)
+        vol->dcache_mru->lru_next = de;
+    else
+        vol->dcache_lru = de;
+    vol->dcache_mru = de;
+}
+
+/**
+ * Unlink a dentry cache entry and free it. Releasing the child dnode may free it
+ * together with parents no longer referenced.
+ */
+
+static void fsw_dcache_remove(struct fsw_volume *vol, struct fsw_dentry *de)
+{
+    struct fsw_dentry **link;
+
+    for (link = &vol->dcache[de->hash & (FSW_DCACHE_HASH_SIZE - 1)]; *link != NULL; link = &(*link)->hash_next) {
+        if (*link == de) {
+            *link = de->hash_next;
+            break;
+        }
+    }
+    fsw_dcache_lru_remove(vol, de);
+    vol->dcache_size--;
+
+    if (de->dnode != NULL)
+        fsw_dnode_release(de->dnode);
+    fsw_strfree(&de->name);
+    fsw_free(de);
+}
+
+/**
+ * Find a name in a directory in the dentry cache. Only names in the host string type
+ * are cached. Names are compared exactly, since the core does not know the case rules
+ * of the file system; other spellings get their own entries. The hash is returned for
+ * a following fsw_dcache_insert. Returns NULL on a miss.
+ */
+
+static struct fsw_dentry *fsw_dcache_lookup(struct fsw_dnode *dno, struct fsw_string *name, fsw_u32 *hash_out)
+{
+    struct fsw_volume *vol = dno->vol;
+    struct fsw_dentry *de;
+    fsw_u32 hash;
+
+    if (name->type != vol->host_string_type)
+        return NULL;
+
+    hash = fsw_dcache_hash(dno->dnode_id, name);
+    if (hash_out != NULL)
+        *hash_out = hash;
+    if (vol->dcache == NULL)
+        return NULL;
+
+    for (de = vol->dcache[hash & (FSW_DCACHE_HASH_SIZE - 1)]; de != NULL; de = de->hash_next) {
+        if (de->hash == hash && de->parent_id == dno->dnode_id && fsw_streq(&de->name, name)) {
+            // move to the newest end of the LRU list
+            if (de != vol->dcache_mru) {
+                fsw_dcache_lru_remove(vol, de);
+                fsw_dcache_lru_add(vol, de);
+            }
+            if (de->dnode != NULL)
+                vol->dcache_stat.hits++;
+            else
+                vol->dcache_stat.negative_hits++;
+            return de;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Add the result of a directory lookup to the dentry cache. A NULL child_dno records
+ * a negative entry; the volumes are read-only, so those never become stale. The
+ * oldest entry is dropped when the cache is full. Failures are silently ignored,
+ * the cache is only an optimization.
+ */
+
+static void fsw_dcache_insert(struct fsw_dnode *dno, struct fsw_string *name, fsw_u32 hash,
+                              struct fsw_dnode *child_dno)
+{
+    struct fsw_volume *vol = dno->vol;
+    struct fsw_dentry *de;
+    fsw_u32 bucket;
+
+    if (name->type != vol->host_string_type)
+        return;
+
+    if (vol->dcache == NULL) {
+        if (fsw_alloc_zero(sizeof(struct fsw_dentry *) * FSW_DCACHE_HASH_SIZE, (void **)&vol->dcache))
+            return;
+    }
+
+    if (vol->dcache_size >= FSW_DCACHE_MAX_ENTRIES && vol->dcache_lru != NULL) {
+        fsw_dcache_remove(vol, vol->dcache_lru);
+        vol->dcache_stat.evictions++;
+    }
+
+    if (fsw_alloc_zero(sizeof(struct fsw_dentry), (void **)&de))
+        return;
+    if (fsw_strdup_coerce(&de->name, vol->host_string_type, name)) {
+        fsw_free(de);
+        return;
+    }
+    de->parent_id = dno->dnode_id;
+    de->hash = hash;
+    de->dnode = child_dno;
+    if (child_dno != NULL)
+        fsw_dnode_retain(child_dno);
+
+    bucket = hash & (FSW_DCACHE_HASH_SIZE - 1);
+    de->hash_next = vol->dcache[bucket];
+    vol->dcache[bucket] = de;
+    fsw_dcache_lru_add(vol, de);
+    vol->dcache_size++;
+}
+
+/**
+ * Release the dentry cache and the dnodes it holds. Called when unmounting the volume.
+ */
+
+static void fsw_dcache_free(struct fsw_volume *vol)
+{
+    while (vol->dcache_lru != NULL)
+        fsw_dcache_remove(vol, vol->dcache_lru);
+    if (vol->dcache != NULL) {
+        fsw_free(vol->dcache);
+        vol->dcache = NULL;
+    }
+}
+
+/**
+ * Lookup a directory entry by name in the dentry cache.
  * Given a directory dnode and a file name, it looks up the named entry in the
- * directory cache. If miss, the function calls fstype lookup and cache positive results.
+ * volume's dentry cache. If miss, the function calls fstype lookup and caches
+ * the result, including "not found".
  *
  * If the dnode is not a directory, the call will fail.
  *
@@ -533,9 +802,8 @@ fsw_status_t fsw_dnode_lookup_cache(struct fsw_dnode *dno,
     fsw_status_t    status;
     struct fsw_volume *vol = dno->vol;
     struct fsw_dnode *cache_dno = NULL;
-#if defined(FSW_DNODE_CACHE_SIZE) && FSW_DNODE_CACHE_SIZE > 0
-    int i;
-#endif
+    struct fsw_dentry *de;
+    fsw_u32         hash = 0;
 
     fsw_dnode_retain(dno);
 
@@ -550,53 +818,26 @@ fsw_status_t fsw_dnode_lookup_cache(struct fsw_dnode *dno,
         goto errorexit;
     }
 
-#if defined(FSW_DNODE_CACHE_SIZE) && FSW_DNODE_CACHE_SIZE > 0
-    for (i = 0; i < FSW_DNODE_CACHE_SIZE; i++) {
-        struct fsw_dnode *cache_entry = dno->cache[i];
-
-        if (cache_entry == NULL)
-            continue;
-        if (fsw_streq(&cache_entry->name, lookup_name)) {
-            cache_dno = cache_entry;
-            break;
-        }
-    }
-    if (cache_dno != NULL) {
-        // move found entry to first slot
-        while (i > 0) {
-            dno->cache[i] = dno->cache[i - 1];
-            i--;
+    de = fsw_dcache_lookup(dno, lookup_name, &hash);
+    if (de != NULL) {
+        if (de->dnode == NULL) {
+            status = FSW_NOT_FOUND;
+            goto errorexit;
         }
-        dno->cache[0] = cache_dno;
+        cache_dno = de->dnode;
         fsw_dnode_retain(cache_dno);
         goto goodexit;
     }
-#endif
 
-    // Cache miss (or no cache at all). Do real lookup
+    // Cache miss. Do real lookup
+    vol->dcache_stat.misses++;
     status = vol->fstype_table->dir_lookup(vol, dno, lookup_name, &cache_dno);
+    if (status == FSW_SUCCESS || status == FSW_NOT_FOUND)
+        fsw_dcache_insert(dno, lookup_name, hash, status ? NULL : cache_dno);
     if (status)
         goto errorexit;
 
-#if defined(FSW_DNODE_CACHE_SIZE) && FSW_DNODE_CACHE_SIZE > 0
-    // release dnode pushed out of cache
-    i = FSW_DNODE_CACHE_SIZE - 1;
-    if (dno->cache[i] != NULL) {
-        dno->numcslots--;
-        fsw_dnode_release(dno->cache[i]);
-    }
-    // cache found entry at first slot
-    while (i > 0) {
-        dno->cache[i] = dno->cache[i - 1];
-        i--;
-    }
-    dno->cache[0] = cache_dno;
-    dno->numcslots++;
-    fsw_dnode_retain(cache_dno);
-
 goodexit:
-#endif
-
     fsw_dnode_release(dno);
     *child_dno_out = cache_dno;
     return FSW_SUCCESS;
@@ -708,6 +949,7 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
     struct fsw_dnode *child_dno = NULL;
     struct fsw_string lookup_name;
     struct fsw_string remaining_path;
+    struct fsw_dentry *de;
     int             root_if_empty;
 
     remaining_path = *lookup_path;
@@ -726,10 +968,21 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
                 child_dno = dno;
             fsw_dnode_retain(child_dno);
         } else {
-            // do an actual directory lookup
-          status = fsw_dnode_lookup(dno, &lookup_name, &child_dno);
-          if (status)
-            goto errorexit;
+            // known names skip the fill and type checks of fsw_dnode_lookup
+            de = fsw_dcache_lookup(dno, &lookup_name, NULL);
+            if (de != NULL && de->dnode == NULL) {
+                status = FSW_NOT_FOUND;
+                goto errorexit;
+            }
+            if (de != NULL) {
+                child_dno = de->dnode;
+                fsw_dnode_retain(child_dno);
+            } else {
+                // do an actual directory lookup
+                status = fsw_dnode_lookup(dno, &lookup_name, &child_dno);
+                if (status)
+                    goto errorexit;
+            }
         }
 
         // child_dno becomes the new dno
@@ -953,6 +1206,12 @@ void fsw_shandle_close(struct fsw_shandle *shand)
 /**
  * Read data from a shandle (storage handle for a dnode). This function is called by the
  * host driver or internally when data is read from a file. TODO: more
+ *
+ * Whole physical blocks of file data are read with the host's read_blocks function
+ * (if available) directly into the caller's buffer, one request per contiguous run
+ * of the current extent. They bypass the block cache. Partial blocks at the start
+ * and end of the request as well as directory and symlink data go through
+ * fsw_block_get.
  */
 
 fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in)
@@ -963,7 +1222,7 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
     fsw_u8          *buffer, *block_buffer;
     fsw_u32         buflen, copylen, pos;
     fsw_u32         log_bno, pos_in_extent, phys_bno, pos_in_physblock;
-    fsw_u32         cache_level;
+    fsw_u32         cache_level, run_count;
 
     if (shand->pos >= dno->size) {   // already at EOF
         *buffer_size_inout = 0;
@@ -1005,18 +1264,37 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
             // convert to physical block number and offset
             phys_bno = shand->extent.phys_start + pos_in_extent / vol->phys_blocksize;
             pos_in_physblock = pos_in_extent & (vol->phys_blocksize - 1);
-            copylen = vol->phys_blocksize - pos_in_physblock;
-            if (copylen > buflen)
-                copylen = buflen;
 
-            // get one physical block
-            status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
-            if (status)
-                return status;
+            // number of whole blocks left in the extent that fit into the buffer
+            run_count = 0;
+            if (cache_level == 0 && pos_in_physblock == 0 && vol->host_table->read_blocks != NULL) {
+                run_count = shand->extent.log_count * (vol->log_blocksize / vol->phys_blocksize)
+                    - pos_in_extent / vol->phys_blocksize;
+                if (run_count > buflen / vol->phys_blocksize)
+                    run_count = buflen / vol->phys_blocksize;
+            }
 
-            // copy data from it
-            fsw_memcpy(buffer, block_buffer + pos_in_physblock, copylen);
-            fsw_block_release(vol, phys_bno, block_buffer);
+            if (run_count > 0) {
+                // read the run straight into the caller's buffer
+                copylen = run_count * vol->phys_blocksize;
+                status = vol->host_table->read_blocks(vol, phys_bno, run_count, buffer);
+                if (status)
+                    return status;
+
+            } else {
+                copylen = vol->phys_blocksize - pos_in_physblock;
+                if (copylen > buflen)
+                    copylen = buflen;
+
+                // get one physical block
+                status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
+                if (status)
+                    return status;
+
+                // copy data from it
+                fsw_memcpy(buffer, block_buffer + pos_in_physblock, copylen);
+                fsw_block_release(vol, phys_bno, block_buffer);
+            }
 
         } else if (shand->extent.type == FSW_EXTENT_TYPE_BUFFER) {
             copylen = shand->extent.log_count * vol->log_blocksize - pos_in_extent;
@@ -73,6 +73,29 @@
 /** Indicates that the block cache entry is empty. */
 #define FSW_INVALID_BNO (~0U)
 
+/** Highest cache level accepted by fsw_block_get. */
+#define FSW_MAX_CACHE_LEVEL (5)
+
+/** Number of hash buckets in the block cache, must be a power of 2. */
+#ifndef FSW_BCACHE_HASH_SIZE
+#define FSW_BCACHE_HASH_SIZE (1024)
+#endif
+
+/** Memory limit for the block cache data in bytes. Referenced blocks may exceed it temporarily. */
+#ifndef FSW_BCACHE_MAX_MEM
+#define FSW_BCACHE_MAX_MEM (4 * 1024 * 1024)
+#endif
+
+/** Number of hash buckets in the dentry cache, must be a power of 2. */
+#ifndef FSW_DCACHE_HASH_SIZE
+#define FSW_DCACHE_HASH_SIZE (512)
+#endif
+
+/** Maximum number of positive and negative entries in the dentry cache. */
+#ifndef FSW_DCACHE_MAX_ENTRIES
+#define FSW_DCACHE_MAX_ENTRIES (2048)
+#endif
+
 
 //
 // Byte-swapping macros
@@ -230,6 +253,47 @@ struct fsw_blockcache {
     fsw_u32     cache_level;        //!< Level of importance of this block
     fsw_u32     phys_bno;           //!< Physical block number
     void        *data;              //!< Block data buffer
+
+    struct fsw_blockcache *hash_next;   //!< Next entry in the same hash bucket
+    struct fsw_blockcache *lru_prev;    //!< LRU list of unreferenced entries: older entry
+    struct fsw_blockcache *lru_next;    //!< LRU list of unreferenced entries: newer entry
+};
+
+/**
+ * Core: Block cache statistics.
+ */
+
+struct fsw_blockcache_stat {
+    fsw_u32     hits;               //!< Lookups satisfied from the cache
+    fsw_u32     misses;             //!< Lookups that had to read from the disk
+    fsw_u32     evictions;          //!< Unreferenced entries dropped to stay within the memory limit
+};
+
+/**
+ * Core: Dentry cache entry. Maps a name in a directory to the child dnode, or
+ * records that the name does not exist when dnode is NULL.
+ */
+
+struct fsw_dentry {
+    struct fsw_dentry *hash_next;   //!< Next entry in the same hash bucket
+    struct fsw_dentry *lru_prev;    //!< LRU list: older entry
+    struct fsw_dentry *lru_next;    //!< LRU list: newer entry
+
+    fsw_u32     parent_id;          //!< dnode_id of the directory
+    fsw_u32     hash;               //!< Hash of parent_id and the case folded name
+    struct fsw_string name;         //!< Name in the host string type
+    struct fsw_dnode *dnode;        //!< Retained child dnode, NULL for a negative entry
+};
+
+/**
+ * Core: Dentry cache statistics.
+ */
+
+struct fsw_dentry_stat {
+    fsw_u32     hits;               //!< Lookups answered with a dnode from the cache
+    fsw_u32     negative_hits;      //!< Lookups answered with "not found" from the cache
+    fsw_u32     misses;             //!< Lookups passed on to the file system driver
+    fsw_u32     evictions;          //!< Entries dropped to stay within FSW_DCACHE_MAX_ENTRIES
 };
 
 /**
@@ -245,8 +309,18 @@ struct fsw_volume {
 
     struct fsw_dnode *dnode_head;   //!< List of all dnodes allocated for this volume
 
-    struct fsw_blockcache *bcache;  //!< Array of block cache entries
-    fsw_u32     bcache_size;        //!< Number of entries in the block cache array
+    struct fsw_blockcache **bcache; //!< Hash table of block cache entries, keyed by phys_bno
+    struct fsw_blockcache *bcache_lru[FSW_MAX_CACHE_LEVEL + 1];  //!< Oldest unreferenced entry per cache level
+    struct fsw_blockcache *bcache_mru[FSW_MAX_CACHE_LEVEL + 1];  //!< Newest unreferenced entry per cache level
+    fsw_u32     bcache_size;        //!< Number of entries in the block cache
+    fsw_u32     bcache_max;         //!< Number of entries allowed by FSW_BCACHE_MAX_MEM
+    struct fsw_blockcache_stat bcache_stat; //!< Block cache statistics
+
+    struct fsw_dentry **dcache;     //!< Hash table of dentry cache entries
+    struct fsw_dentry *dcache_lru;  //!< Oldest dentry cache entry
+    struct fsw_dentry *dcache_mru;  //!< Newest dentry cache entry
+    fsw_u32     dcache_size;        //!< Number of entries in the dentry cache
+    struct fsw_dentry_stat dcache_stat; //!< Dentry cache statistics
 
     void        *host_data;         //!< Hook for a host-specific data structure
     struct fsw_host_table *host_table;      //!< Dispatch table for host-specific functions
@@ -271,11 +345,6 @@ struct fsw_dnode {
 
     struct fsw_dnode *next;         //!< Doubly-linked list of all dnodes: previous dnode
     struct fsw_dnode *prev;         //!< Doubly-linked list of all dnodes: next dnode
-
-#if defined(FSW_DNODE_CACHE_SIZE) && FSW_DNODE_CACHE_SIZE > 0
-    fsw_u32    numcslots;                          //!< Number of slots occupied
-    struct fsw_dnode *cache[FSW_DNODE_CACHE_SIZE]; //!< Rudimentary cache for directory lookups
-#endif
 };
 
 /**
@@ -366,6 +435,7 @@ struct fsw_host_table
                                      fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                                      fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
     fsw_status_t (*read_block)(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
+    fsw_status_t (*read_blocks)(struct fsw_volume *vol, fsw_u32 phys_bno, fsw_u32 count, void *buffer);  //!< Optional, may be NULL
 };
 
 /**
@@ -0,0 +1,493 @@
+/* $Id: fsw_decompress.c $ */
+/** @file
+ * fsw_decompress.c - Decompressors for transparently compressed files.
+ *
+ * Both decoders work on caller supplied buffers and never allocate memory.
+ * Every input and output access is bounds checked, corrupted data results
+ * in FSW_VOLUME_CORRUPTED.
+ */
+
+#include "fsw_decompress.h"
+
+
+//
+// Inflate (RFC 1950 / RFC 1951)
+//
+
+/** Canonical Huffman code, stored as code counts per length and sorted symbols. */
+struct fsw_inflate_tree {
+    fsw_u16     counts[16];
+    fsw_u16     symbols[288];
+};
+
+/** Decoder state. */
+struct fsw_inflate_state {
+    const fsw_u8 *src;
+    const fsw_u8 *src_end;
+    fsw_u32     bitbuf;
+    fsw_u32     bitcount;
+    fsw_u8      *dst_start;
+    fsw_u8      *dst;
+    fsw_u8      *dst_end;
+    int         error;
+};
+
+static const fsw_u16 fsw_inflate_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const fsw_u8 fsw_inflate_length_bits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const fsw_u16 fsw_inflate_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const fsw_u8 fsw_inflate_dist_bits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const fsw_u8 fsw_inflate_clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/**
+ * Read count bits (at most 24) from the input, least significant bit first.
+ * Running out of input sets the error flag and returns zero bits.
+ */
+
+static fsw_u32 fsw_inflate_bits(struct fsw_inflate_state *st, fsw_u32 count)
+{
+    fsw_u32 value;
+
+    while (st->bitcount < count) {
+        if (st->src >= st->src_end) {
+            st->error = 1;
+            return 0;
+        }
+        st->bitbuf |= (fsw_u32)*st->src++ << st->bitcount;
+        st->bitcount += 8;
+    }
+    value = st->bitbuf & ((1U << count) - 1);
+    st->bitbuf >>= count;
+    st->bitcount -= count;
+    return value;
+}
+
+/**
+ * Build a canonical Huffman code from a list of code lengths.
+ */
+
+static void fsw_inflate_build(struct fsw_inflate_tree *tree, const fsw_u8 *lengths, fsw_u32 num)
+{
+    fsw_u16 offs[16];
+    fsw_u32 i, sum;
+
+    for (i = 0; i < 16; i++)
+        tree->counts[i] = 0;
+    for (i = 0; i < num; i++)
+        tree->counts[lengths[i]]++;
+    tree->counts[0] = 0;
+
+    for (sum = 0, i = 0; i < 16; i++) {
+        offs[i] = (fsw_u16)sum;
+        sum += tree->counts[i];
+    }
+    for (i = 0; i < num; i++) {
+        if (lengths[i])
+            tree->symbols[offs[lengths[i]]++] = (fsw_u16)i;
+    }
+}
+
+/**
+ * Decode one symbol. Codes are walked bit by bit against the per-length counts,
+ * so incomplete or oversubscribed codes can never index outside the tree.
+ */
+
+static fsw_u32 fsw_inflate_symbol(struct fsw_inflate_state *st, struct fsw_inflate_tree *tree)
+{
+    fsw_s32 cur = 0;
+    fsw_u32 sum = 0;
+    fsw_u32 len;
+
+    for (len = 1; len < 16; len++) {
+        cur = 2 * cur + (fsw_s32)fsw_inflate_bits(st, 1);
+        sum += tree->counts[len];
+        cur -= tree->counts[len];
+        if (cur < 0)
+            return tree->symbols[sum + cur];
+    }
+    st->error = 1;
+    return 0;
+}
+
+/**
+ * Set up the fixed literal/length and distance codes of block type 1.
+ */
+
+static void fsw_inflate_fixed(struct fsw_inflate_tree *lt, struct fsw_inflate_tree *dt)
+{
+    fsw_u8 lengths[288];
+    fsw_u32 i;
+
+    for (i = 0; i < 144; i++)
+        lengths[i] = 8;
+    for (; i < 256; i++)
+        lengths[i] = 9;
+    for (; i < 280; i++)
+        lengths[i] = 7;
+    for (; i < 288; i++)
+        lengths[i] = 8;
+    fsw_inflate_build(lt, lengths, 288);
+
+    for (i = 0; i < 30; i++)
+        lengths[i] = 5;
+    fsw_inflate_build(dt, lengths, 30);
+}
+
+/**
+ * Read the code length code and the literal/length and distance codes of block type 2.
+ */
+
+static void fsw_inflate_dynamic(struct fsw_inflate_state *st,
+                                struct fsw_inflate_tree *lt, struct fsw_inflate_tree *dt)
+{
+    fsw_u8 lengths[288 + 32];
+    fsw_u32 hlit, hdist, hclen;
+    fsw_u32 i, num, sym, rep;
+    fsw_u8 fill;
+
+    hlit = fsw_inflate_bits(st, 5) + 257;
+    hdist = fsw_inflate_bits(st, 5) + 1;
+    hclen = fsw_inflate_bits(st, 4) + 4;
+    if (hlit > 286 || hdist > 30) {
+        st->error = 1;
+        return;
+    }
+
+    for (i = 0; i < 19; i++)
+        lengths[i] = 0;
+    for (i = 0; i < hclen; i++)
+        lengths[fsw_inflate_clen_order[i]] = (fsw_u8)fsw_inflate_bits(st, 3);
+    fsw_inflate_build(lt, lengths, 19);
+
+    for (num = 0; num < hlit + hdist && !st->error; ) {
+        sym = fsw_inflate_symbol(st, lt);
+        if (sym < 16) {
+            lengths[num++] = (fsw_u8)sym;
+            continue;
+        }
+        if (sym == 16) {
+            if (num == 0) {
+                st->error = 1;
+                return;
+            }
+            fill = lengths[num - 1];
+            rep = 3 + fsw_inflate_bits(st, 2);
+        } else if (sym == 17) {
+            fill = 0;
+            rep = 3 + fsw_inflate_bits(st, 3);
+        } else {
+            fill = 0;
+            rep = 11 + fsw_inflate_bits(st, 7);
+        }
+        if (num + rep > hlit + hdist) {
+            st->error = 1;
+            return;
+        }
+        while (rep--)
+            lengths[num++] = fill;
+    }
+    if (st->error)
+        return;
+
+    // the end of block code must be present
+    if (lengths[256] == 0) {
+        st->error = 1;
+        return;
+    }
+
+    fsw_inflate_build(lt, lengths, hlit);
+    fsw_inflate_build(dt, lengths + hlit, hdist);
+}
+
+/**
+ * Decode the compressed data of one block up to its end of block code.
+ */
+
+static void fsw_inflate_codes(struct fsw_inflate_state *st,
+                              struct fsw_inflate_tree *lt, struct fsw_inflate_tree *dt)
+{
+    fsw_u32 sym, len, dist;
+
+    while (!st->error) {
+        sym = fsw_inflate_symbol(st, lt);
+        if (sym < 256) {
+            if (st->dst >= st->dst_end) {
+                st->error = 1;
+                return;
+            }
+            *st->dst++ = (fsw_u8)sym;
+            continue;
+        }
+        if (sym == 256)
+            return;
+
+        sym -= 257;
+        if (sym >= 29) {
+            st->error = 1;
+            return;
+        }
+        len = fsw_inflate_length_base[sym] + fsw_inflate_bits(st, fsw_inflate_length_bits[sym]);
+
+        sym = fsw_inflate_symbol(st, dt);
+        if (sym >= 30) {
+            st->error = 1;
+            return;
+        }
+        dist = fsw_inflate_dist_base[sym] + fsw_inflate_bits(st, fsw_inflate_dist_bits[sym]);
+
+        if (st->error || dist > (fsw_u32)(st->dst - st->dst_start) ||
+            len > (fsw_u32)(st->dst_end - st->dst)) {
+            st->error = 1;
+            return;
+        }
+        while (len--) {
+            *st->dst = st->dst[-(fsw_s32)dist];
+            st->dst++;
+        }
+    }
+}
+
+/**
+ * Copy a stored block (type 0).
+ */
+
+static void fsw_inflate_stored(struct fsw_inflate_state *st)
+{
+    fsw_u32 len, nlen;
+
+    // stored blocks start at a byte boundary
+    st->bitbuf = 0;
+    st->bitcount = 0;
+
+    if (st->src_end - st->src < 4) {
+        st->error = 1;
+        return;
+    }
+    len = st->src[0] | (st->src[1] << 8);
+    nlen = st->src[2] | (st->src[3] << 8);
+    st->src += 4;
+    if (len != (~nlen & 0xFFFF) ||
+        len > (fsw_u32)(st->src_end - st->src) ||
+        len > (fsw_u32)(st->dst_end - st->dst)) {
+        st->error = 1;
+        return;
+    }
+    fsw_memcpy(st->dst, (void *)st->src, len);
+    st->src += len;
+    st->dst += len;
+}
+
+/**
+ * Decompress a zlib stream into a buffer of dst_len bytes. The number of bytes
+ * produced is returned in *out_len. The Adler-32 checksum is verified.
+ */
+
+fsw_status_t fsw_zlib_decompress(const fsw_u8 *src, fsw_u32 src_len,
+                                 fsw_u8 *dst, fsw_u32 dst_len, fsw_u32 *out_len)
+{
+    struct fsw_inflate_state st;
+    struct fsw_inflate_tree lt, dt;
+    fsw_u32 final, type;
+    fsw_u32 a, b, i, adler;
+
+    // zlib header: deflate method, no preset dictionary, valid check bits
+    if (src_len < 6 || (src[0] & 0x0F) != 8 || (src[0] >> 4) > 7 ||
+        (src[1] & 0x20) != 0 || ((src[0] << 8) | src[1]) % 31 != 0)
+        return FSW_VOLUME_CORRUPTED;
+
+    st.src = src + 2;
+    st.src_end = src + src_len;
+    st.bitbuf = 0;
+    st.bitcount = 0;
+    st.dst_start = st.dst = dst;
+    st.dst_end = dst + dst_len;
+    st.error = 0;
+
+    do {
+        final = fsw_inflate_bits(&st, 1);
+        type = fsw_inflate_bits(&st, 2);
+        if (st.error)
+            break;
+
+        if (type == 0) {
+            fsw_inflate_stored(&st);
+        } else if (type == 1) {
+            fsw_inflate_fixed(&lt, &dt);
+            fsw_inflate_codes(&st, &lt, &dt);
+        } else if (type == 2) {
+            fsw_inflate_dynamic(&st, &lt, &dt);
+            if (!st.error)
+                fsw_inflate_codes(&st, &lt, &dt);
+        } else {
+            st.error = 1;
+        }
+    } while (!final && !st.error);
+
+    if (st.error)
+        return FSW_VOLUME_CORRUPTED;
+
+    // Adler-32 trailer follows at the next byte boundary
+    if (st.src_end - st.src < 4)
+        return FSW_VOLUME_CORRUPTED;
+    a = 1;
+    b = 0;
+    for (i = 0; i < (fsw_u32)(st.dst - dst); i++) {
+        a += dst[i];
+        if (a >= 65521)
+            a -= 65521;
+        b += a;
+        if (b >= 65521)
+            b -= 65521;
+    }
+    adler = ((fsw_u32)st.src[0] << 24) | ((fsw_u32)st.src[1] << 16) |
+            ((fsw_u32)st.src[2] << 8) | st.src[3];
+    if (adler != ((b << 16) | a))
+        return FSW_VOLUME_CORRUPTED;
+
+    *out_len = (fsw_u32)(st.dst - dst);
+    return FSW_SUCCESS;
+}
+
+
+//
+// LZVN
+//
+
+/**
+ * Decompress an LZVN stream into a buffer of dst_len bytes. The number of bytes
+ * produced is returned in *out_len.
+ *
+ * Every opcode carries up to L literal bytes (stored right after the opcode)
+ * followed by a match of M bytes at distance D. Opcodes without a distance
+ * reuse the previous one:
+ *
+ *   sml_d  LLMMMDDD DDDDDDDD                 D 11 bits, M 3..10
+ *   med_d  101LLMMM DDDDDDMM DDDDDDDD        D 14 bits, M 3..34
+ *   lrg_d  LLMMM111 DDDDDDDD DDDDDDDD        D 16 bits, M 3..10
+ *   pre_d  LLMMM110                          M 3..10
+ *   sml_m  1111MMMM                          M 1..15, no literals
+ *   lrg_m  11110000 MMMMMMMM                 M 16..271, no literals
+ *   sml_l  1110LLLL                          L 1..15, no match
+ *   lrg_l  11100000 LLLLLLLL                 L 16..271, no match
+ *
+ * 0x06 ends the stream, 0x0E and 0x16 are no-ops; 0x1E-0x3E (pre_d without
+ * literals), 0x70-0x7F and 0xD0-0xDF are undefined.
+ */
+
+fsw_status_t fsw_lzvn_decompress(const fsw_u8 *src, fsw_u32 src_len,
+                                 fsw_u8 *dst, fsw_u32 dst_len, fsw_u32 *out_len)
+{
+    const fsw_u8 *s = src;
+    const fsw_u8 *s_end = src + src_len;
+    fsw_u8 *d = dst;
+    fsw_u8 *d_end = dst + dst_len;
+    fsw_u32 dist = 0;
+    fsw_u32 lit, match;
+    fsw_u8 opc;
+
+    while (s < s_end) {
+        opc = *s;
+
+        if (opc == 0x06)
+            break;
+        if (opc == 0x0E || opc == 0x16) {
+            s++;
+            continue;
+        }
+
+        if (opc >= 0xF0) {
+            // match with the previous distance, no literals
+            lit = 0;
+            if (opc == 0xF0) {
+                if (s_end - s < 2)
+                    return FSW_VOLUME_CORRUPTED;
+                match = s[1] + 16;
+                s += 2;
+            } else {
+                match = opc & 0x0F;
+                s++;
+            }
+        } else if (opc >= 0xE0) {
+            // literals only
+            if (opc == 0xE0) {
+                if (s_end - s < 2)
+                    return FSW_VOLUME_CORRUPTED;
+                lit = s[1] + 16;
+                s += 2;
+            } else {
+                lit = opc & 0x0F;
+                s++;
+            }
+            if (lit > (fsw_u32)(s_end - s) || lit > (fsw_u32)(d_end - d))
+                return FSW_VOLUME_CORRUPTED;
+            fsw_memcpy(d, (void *)s, lit);
+            s += lit;
+            d += lit;
+            continue;
+        } else if ((opc & 0xF0) == 0x70 || (opc & 0xF0) == 0xD0) {
+            return FSW_VOLUME_CORRUPTED;
+        } else if ((opc & 0xE0) == 0xA0) {
+            // med_d
+            if (s_end - s < 3)
+                return FSW_VOLUME_CORRUPTED;
+            lit = (opc >> 3) & 3;
+            match = (((opc & 7) << 2) | (s[1] & 3)) + 3;
+            dist = (s[1] >> 2) | (s[2] << 6);
+            s += 3;
+        } else {
+            lit = opc >> 6;
+            match = ((opc >> 3) & 7) + 3;
+            if ((opc & 7) == 6) {
+                // pre_d
+                if (lit == 0)
+                    return FSW_VOLUME_CORRUPTED;
+                s++;
+            } else if ((opc & 7) == 7) {
+                // lrg_d
+                if (s_end - s < 3)
+                    return FSW_VOLUME_CORRUPTED;
+                dist = s[1] | (s[2] << 8);
+                s += 3;
+            } else {
+                // sml_d
+                if (s_end - s < 2)
+                    return FSW_VOLUME_CORRUPTED;
+                dist = ((opc & 7) << 8) | s[1];
+                s += 2;
+            }
+        }
+
+        if (lit > 0) {
+            if (lit > (fsw_u32)(s_end - s) || lit > (fsw_u32)(d_end - d))
+                return FSW_VOLUME_CORRUPTED;
+            fsw_memcpy(d, (void *)s, lit);
+            s += lit;
+            d += lit;
+        }
+
+        if (dist == 0 || dist > (fsw_u32)(d - dst) || match > (fsw_u32)(d_end - d))
+            return FSW_VOLUME_CORRUPTED;
+        while (match--) {
+            *d = d[-(fsw_s32)dist];
+            d++;
+        }
+    }
+
+    *out_len = (fsw_u32)(d - dst);
+    return FSW_SUCCESS;
+}
+
+// EOF
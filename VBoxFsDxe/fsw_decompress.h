@@ -0,0 +1,16 @@
+/* $Id: fsw_decompress.h $ */
+/** @file
+ * fsw_decompress.h - Decompressors for transparently compressed files.
+ */
+
+#ifndef _FSW_DECOMPRESS_H_
+#define _FSW_DECOMPRESS_H_
+
+#include "fsw_core.h"
+
+fsw_status_t fsw_zlib_decompress(const fsw_u8 *src, fsw_u32 src_len,
+                                 fsw_u8 *dst, fsw_u32 dst_len, fsw_u32 *out_len);
+fsw_status_t fsw_lzvn_decompress(const fsw_u8 *src, fsw_u32 src_len,
+                                 fsw_u8 *dst, fsw_u32 dst_len, fsw_u32 *out_len);
+
+#endif
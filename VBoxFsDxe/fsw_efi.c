@@ -52,6 +52,10 @@
 
 #include "fsw_efi.h"
 
+#ifdef FSW_CACHE_STATS
+#include <Library/MemLogLib.h>
+#endif
+
 #ifndef FSTYPE
 #ifdef VBOX
 #error FSTYPE must be defined!
@@ -115,6 +119,13 @@ fsw_status_t fsw_efi_read_block (
   void *buffer
 );
 
+fsw_status_t fsw_efi_read_blocks (
+  struct fsw_volume *vol,
+  fsw_u32 phys_bno,
+  fsw_u32 count,
+  void *buffer
+);
+
 EFI_STATUS fsw_efi_map_status (
   fsw_status_t fsw_status,
   FSW_VOLUME_DATA * Volume
@@ -221,7 +232,8 @@ struct fsw_host_table fsw_efi_host_table = {
   FSW_STRING_TYPE_UTF16,
 
   fsw_efi_change_blocksize,
-  fsw_efi_read_block
+  fsw_efi_read_block,
+  fsw_efi_read_blocks
 };
 
 extern struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME (
@@ -580,6 +592,37 @@ fsw_efi_read_block (
   return FSW_SUCCESS;
 }
 
+/**
+ * FSW interface function to read a run of consecutive data blocks. This function
+ * is called by the FSW core for bulk file reads, the data goes straight into the
+ * caller's buffer with a single Disk I/O request.
+ */
+
+fsw_status_t
+fsw_efi_read_blocks (
+  struct fsw_volume *vol,
+  fsw_u32 phys_bno,
+  fsw_u32 count,
+  void *buffer
+)
+{
+  EFI_STATUS Status;
+  FSW_VOLUME_DATA *Volume = (FSW_VOLUME_DATA *) vol->host_data;
+
+  // read from disk
+  Status =
+    Volume->DiskIo->ReadDisk (Volume->DiskIo, Volume->MediaId,
+                              (UINT64) phys_bno * vol->phys_blocksize,
+                              (UINTN) count * vol->phys_blocksize, buffer);
+  Volume->LastIOStatus = Status;
+  if (EFI_ERROR (Status)) {
+    FSW_MSG_DEBUG ((FSW_MSGSTR (__FUNCTION__ ": ReadDisk() returned %r\n"),
+                    Status));
+    return FSW_IO_ERROR;
+  }
+  return FSW_SUCCESS;
+}
+
 /**
  * Map FSW status codes to EFI status codes. The FSW_IO_ERROR code is only produced
  * by fsw_efi_read_block, so we map it back to the EFI status code remembered from
@@ -672,6 +715,25 @@ fsw_efi_FileHandle_Open (
   return Status;
 }
 
+#ifdef FSW_CACHE_STATS
+/**
+ * Dump the cache statistics of a volume to the memory log.
+ */
+
+VOID
+fsw_efi_log_cache_stats (
+  IN struct fsw_volume *vol
+)
+{
+  MemLog (TRUE, 1, "fsw_efi: bcache %d/%d entries, %d hits, %d misses, %d evictions\n",
+          vol->bcache_size, vol->bcache_max, vol->bcache_stat.hits,
+          vol->bcache_stat.misses, vol->bcache_stat.evictions);
+  MemLog (TRUE, 1, "fsw_efi: dcache %d entries, %d hits, %d negative hits, %d misses, %d evictions\n",
+          vol->dcache_size, vol->dcache_stat.hits, vol->dcache_stat.negative_hits,
+          vol->dcache_stat.misses, vol->dcache_stat.evictions);
+}
+#endif
+
 /**
  * File Handle EFI protocol, Close function. Closes the FSW shandle
  * and frees the memory used for the structure.
@@ -689,6 +751,11 @@ fsw_efi_FileHandle_Close (
 #endif
 
   File = FSW_FILE_FROM_FILE_HANDLE (This);
+#ifdef FSW_CACHE_STATS
+  // a consumer is done with the volume
+  if (File->shand.dnode == File->shand.dnode->vol->root)
+    fsw_efi_log_cache_stats (File->shand.dnode->vol);
+#endif
   fsw_shandle_close (&File->shand);
   FreePool (File);
 
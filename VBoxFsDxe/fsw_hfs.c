@@ -25,6 +25,7 @@
  */
 
 #include "fsw_hfs.h"
+#include "fsw_decompress.h"
 
 #ifdef HOST_POSIX
 #define DPRINT(x) printf(x)
@@ -100,6 +101,41 @@ static fsw_status_t fsw_hfs_readlink (
   struct fsw_string *link
 );
 
+static void fsw_hfs_btree_free (
+  struct fsw_hfs_btree *btree
+);
+
+static fsw_status_t fsw_hfs_extent_map_build (
+  struct fsw_hfs_volume *vol,
+  fsw_u32 file_id,
+  fsw_u8 fork_type,
+  HFSPlusExtentRecord * exts,
+  fsw_u64 size,
+  struct fsw_hfs_extent_run **map_out,
+  fsw_u32 * map_count_out
+);
+
+static struct fsw_hfs_extent_run *fsw_hfs_extent_map_find (
+  struct fsw_hfs_extent_run *map,
+  fsw_u32 map_count,
+  fsw_u32 lbno
+);
+
+static fsw_status_t fsw_hfs_decmpfs_open (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno
+);
+
+static void fsw_hfs_decmpfs_free (
+  struct fsw_hfs_dnode *dno
+);
+
+static fsw_status_t fsw_hfs_decmpfs_get_extent (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  struct fsw_extent *extent
+);
+
 //
 // Dispatch Table
 //
@@ -122,64 +158,45 @@ struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME (
   fsw_hfs_readlink
 };
 
+/* Read data from a fork described by a run map. */
 static fsw_s32
-fsw_hfs_read_block (
-  struct fsw_hfs_dnode *dno,
-  fsw_u32 log_bno,
-  fsw_u32 off,
-  fsw_s32 len,
-  fsw_u8 * buf
-)
-{
-  fsw_status_t status;
-  struct fsw_extent extent;
-  fsw_u32 phys_bno;
-  fsw_u8 *buffer;
-
-  extent.log_start = log_bno;
-  status = fsw_hfs_get_extent (dno->g.vol, dno, &extent);
-  if (status)
-    return status;
-
-  phys_bno = extent.phys_start;
-  status = fsw_block_get (dno->g.vol, phys_bno, 0, (void **) &buffer);
-  if (status)
-    return status;
-
-  fsw_memcpy (buf, buffer + off, len);
-
-  fsw_block_release (dno->g.vol, phys_bno, buffer);
-
-  return FSW_SUCCESS;
-}
-
-/* Read data from HFS file. */
-static fsw_s32
-fsw_hfs_read_file (
-  struct fsw_hfs_dnode *dno,
+fsw_hfs_read_fork (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_extent_run *map,
+  fsw_u32 map_count,
   fsw_u64 pos,
   fsw_s32 len,
   fsw_u8 * buf
 )
 {
   fsw_status_t status;
-  fsw_u32 log_bno;
-  fsw_u32 block_size_bits = dno->g.vol->block_size_shift;
+  fsw_u32 block_size_bits = vol->block_size_shift;
   fsw_u32 block_size = (1 << block_size_bits);
   fsw_u32 block_size_mask = block_size - 1;
   fsw_s32 read = 0;
 
   while (len > 0) {
+    struct fsw_hfs_extent_run *run;
+    fsw_u32 log_bno;
+    fsw_u32 phys_bno;
     fsw_u32 off = (fsw_u32) (pos & block_size_mask);
     fsw_s32 next_len = len;
+    fsw_u8 *buffer;
 
     log_bno = (fsw_u32) RShiftU64 (pos, block_size_bits);
+    run = fsw_hfs_extent_map_find (map, map_count, log_bno);
+    if (run == NULL)
+      return -1;
+    phys_bno = run->phys_start + (log_bno - run->log_start) + vol->emb_block_off;
 
-    if (next_len >= 0 && (fsw_u32) next_len > block_size)
-      next_len = block_size;
-    status = fsw_hfs_read_block (dno, log_bno, off, next_len, buf);
+    if ((fsw_u32) next_len > block_size - off)
+      next_len = block_size - off;
+    status = fsw_block_get (vol, phys_bno, 0, (void **) &buffer);
     if (status)
       return -1;
+    fsw_memcpy (buf, buffer + off, next_len);
+    fsw_block_release (vol, phys_bno, buffer);
+
     buf += next_len;
     pos += next_len;
     len -= next_len;
@@ -189,6 +206,26 @@ fsw_hfs_read_file (
   return read;
 }
 
+/* Read data from the data fork of HFS file. */
+static fsw_s32
+fsw_hfs_read_file (
+  struct fsw_hfs_dnode *dno,
+  fsw_u64 pos,
+  fsw_s32 len,
+  fsw_u8 * buf
+)
+{
+  struct fsw_hfs_volume *vol = (struct fsw_hfs_volume *) dno->g.vol;
+
+  if (dno->extent_map == NULL &&
+      fsw_hfs_extent_map_build (vol, dno->g.dnode_id, HFS_FORK_DATA, &dno->extents,
+                                dno->g.size, &dno->extent_map,
+                                &dno->extent_map_count) != FSW_SUCCESS)
+    return -1;
+
+  return fsw_hfs_read_fork (vol, dno->extent_map, dno->extent_map_count, pos, len, buf);
+}
+
 static fsw_s32
 fsw_hfs_compute_shift (
   fsw_u32 size
@@ -316,6 +353,18 @@ fsw_hfs_volume_mount (
     vol->extents_tree.file->g.size =
       be64_to_cpu (vol->primary_voldesc->extentsFile.logicalSize);
 
+    /* Read extents overflow file first, mapping the catalog file may need it */
+    r =
+      fsw_hfs_read_file (vol->extents_tree.file, sizeof (BTNodeDescriptor),
+                         sizeof (BTHeaderRec), (fsw_u8 *) & tree_header);
+    if (r != sizeof (BTHeaderRec)) {
+      rv = FSW_VOLUME_CORRUPTED;
+      break;
+    }
+
+    vol->extents_tree.root_node = be32_to_cpu (tree_header.rootNode);
+    vol->extents_tree.node_size = be16_to_cpu (tree_header.nodeSize);
+
     /* Setup the root dnode */
     status = fsw_dnode_create_root (vol, kHFSRootFolderID, &vol->g.root);
     CHECK (status);
@@ -336,6 +385,30 @@ fsw_hfs_volume_mount (
     vol->catalog_tree.root_node = be32_to_cpu (tree_header.rootNode);
     vol->catalog_tree.node_size = be16_to_cpu (tree_header.nodeSize);
 
+    /* Setup attributes file, needed for compressed files only */
+    if (vol->primary_voldesc->attributesFile.logicalSize != 0) {
+      BTHeaderRec attr_header;
+
+      status =
+        fsw_dnode_create_root (vol, kHFSAttributesFileID, &vol->attributes_tree.file);
+      CHECK (status);
+      fsw_memcpy (vol->attributes_tree.file->extents,
+                  vol->primary_voldesc->attributesFile.extents,
+                  sizeof vol->attributes_tree.file->extents);
+      vol->attributes_tree.file->g.size =
+        be64_to_cpu (vol->primary_voldesc->attributesFile.logicalSize);
+
+      r =
+        fsw_hfs_read_file (vol->attributes_tree.file, sizeof (BTNodeDescriptor),
+                           sizeof (BTHeaderRec), (fsw_u8 *) & attr_header);
+      if (r != sizeof (BTHeaderRec)) {
+        rv = FSW_VOLUME_CORRUPTED;
+        break;
+      }
+      vol->attributes_tree.root_node = be32_to_cpu (attr_header.rootNode);
+      vol->attributes_tree.node_size = be16_to_cpu (attr_header.nodeSize);
+    }
+
     /* Take Volume Name before tree_header overwritten */
     {
       fsw_u32 firstLeafNum;
@@ -371,18 +444,6 @@ fsw_hfs_volume_mount (
       }
     }
 
-    /* Read extents overflow file */
-    r =
-      fsw_hfs_read_file (vol->extents_tree.file, sizeof (BTNodeDescriptor),
-                         sizeof (BTHeaderRec), (fsw_u8 *) & tree_header);
-    if (r != sizeof (BTHeaderRec)) {
-      rv = FSW_VOLUME_CORRUPTED;
-      break;
-    }
-
-    vol->extents_tree.root_node = be32_to_cpu (tree_header.rootNode);
-    vol->extents_tree.node_size = be16_to_cpu (tree_header.nodeSize);
-
     rv = FSW_SUCCESS;
   } while (0);
 
@@ -405,10 +466,21 @@ fsw_hfs_volume_free (
   struct fsw_hfs_volume *vol
 )
 {
+  int i;
+
   if (vol->primary_voldesc) {
     fsw_free (vol->primary_voldesc);
     vol->primary_voldesc = NULL;
   }
+  fsw_hfs_btree_free (&vol->catalog_tree);
+  fsw_hfs_btree_free (&vol->extents_tree);
+  fsw_hfs_btree_free (&vol->attributes_tree);
+  for (i = 0; i < FSW_HFS_CHUNK_CACHE_SIZE; i++) {
+    if (vol->chunk_cache[i].data != NULL) {
+      fsw_free (vol->chunk_cache[i].data);
+      vol->chunk_cache[i].data = NULL;
+    }
+  }
   if (vol->catalog_tree.file) {
     fsw_dnode_release ((struct fsw_dnode *) (vol->catalog_tree.file));
     vol->catalog_tree.file = NULL;
@@ -417,6 +489,10 @@ fsw_hfs_volume_free (
     fsw_dnode_release ((struct fsw_dnode *) (vol->extents_tree.file));
     vol->extents_tree.file = NULL;
   }
+  if (vol->attributes_tree.file) {
+    fsw_dnode_release ((struct fsw_dnode *) (vol->attributes_tree.file));
+    vol->attributes_tree.file = NULL;
+  }
 }
 
 /**
@@ -457,6 +533,16 @@ fsw_hfs_dnode_fill (
   struct fsw_hfs_dnode *dno
 )
 {
+  fsw_status_t status;
+
+  /* Compressed files get their real size from the decmpfs attribute */
+  if (dno->compressed && dno->decmpfs == NULL) {
+    status = fsw_hfs_decmpfs_open (vol, dno);
+    if (status)
+      return status;
+    dno->compressed = 0;
+  }
+
   return FSW_SUCCESS;
 }
 
@@ -472,6 +558,11 @@ fsw_hfs_dnode_free (
   struct fsw_hfs_dnode *dno
 )
 {
+  if (dno->extent_map != NULL) {
+    fsw_free (dno->extent_map);
+    dno->extent_map = NULL;
+  }
+  fsw_hfs_decmpfs_free (dno);
 }
 
 static fsw_u32
@@ -506,33 +597,6 @@ fsw_hfs_dnode_stat (
   return FSW_SUCCESS;
 }
 
-static int
-fsw_hfs_find_block (
-  HFSPlusExtentRecord * exts,
-  fsw_u32 * lbno,
-  fsw_u32 * pbno
-)
-{
-  int i;
-  fsw_u32 cur_lbno = *lbno;
-
-  for (i = 0; i < 8; i++) {
-    fsw_u32 start = be32_to_cpu ((*exts)[i].startBlock);
-    fsw_u32 count = be32_to_cpu ((*exts)[i].blockCount);
-
-    if (cur_lbno < count) {
-      *pbno = start + cur_lbno;
-      return 1;
-    }
-
-    cur_lbno -= count;
-  }
-
-  *lbno = cur_lbno;
-
-  return 0;
-}
-
 /* Find record offset, numbering starts from the end */
 static fsw_u32
 fsw_hfs_btree_recoffset (
@@ -577,6 +641,140 @@ fsw_hfs_btree_next_node (
         return be32_to_cpu (*pointer);
 }
 
+/*
+ * Check the record offset table and key lengths of a node once when it is
+ * read, so that the searches never step outside of the node buffer.
+ */
+static int
+fsw_hfs_btree_node_valid (
+  struct fsw_hfs_btree *btree,
+  BTNodeDescriptor * node
+)
+{
+  fsw_u32 count;
+  fsw_u32 limit;
+  fsw_u32 offset;
+  fsw_u32 end;
+  fsw_u32 i;
+
+  if (node->kind != kBTLeafNode && node->kind != kBTIndexNode)
+    return 0;
+
+  count = be16_to_cpu (node->numRecords);
+  if (sizeof (BTNodeDescriptor) + (count + 1) * 2 > btree->node_size)
+    return 0;
+
+  /* Offset of the free space follows the last record offset */
+  limit = btree->node_size - (count + 1) * 2;
+  if (fsw_hfs_btree_recoffset (btree, node, count) > limit)
+    return 0;
+
+  offset = fsw_hfs_btree_recoffset (btree, node, 0);
+  if (offset != sizeof (BTNodeDescriptor))
+    return 0;
+
+  for (i = 0; i < count; i++) {
+    BTreeKey *key = (BTreeKey *) ((fsw_u8 *) node + offset);
+    fsw_u32 need;
+
+    end = fsw_hfs_btree_recoffset (btree, node, i + 1);
+    if (end > limit || end < offset + 2)
+      return 0;
+    need = 2 + be16_to_cpu (key->length16);
+    if (node->kind == kBTIndexNode)
+      need += sizeof (fsw_u32);
+    if (offset + need > end)
+      return 0;
+    offset = end;
+  }
+
+  return 1;
+}
+
+/*
+ * Get a node through the node cache of the tree. Index nodes are pinned while
+ * there is room for them, leaf nodes are recycled in LRU order. The returned
+ * node stays valid until the next lookup of an uncached node.
+ */
+static fsw_status_t
+fsw_hfs_btree_get_node (
+  struct fsw_hfs_btree *btree,
+  fsw_u32 node_num,
+  BTNodeDescriptor ** result
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_bnode *bnode;
+  struct fsw_hfs_bnode *victim = NULL;
+  fsw_u32 i;
+
+  /* Node 0 is the header node, it is never part of a search path */
+  if (node_num == 0 || btree->node_size < HFS_BLOCKSIZE)
+    return FSW_VOLUME_CORRUPTED;
+
+  for (i = 0; i < FSW_HFS_BNODE_CACHE_SIZE; i++) {
+    bnode = &btree->nodes[i];
+    if (bnode->node_num == node_num) {
+      bnode->stamp = ++btree->nodes_clock;
+      *result = (BTNodeDescriptor *) bnode->data;
+      return FSW_SUCCESS;
+    }
+    if (!bnode->pinned && (victim == NULL || bnode->stamp < victim->stamp))
+      victim = bnode;
+  }
+
+  /* Leaf slots are never pinned, so there always is a victim */
+  if (victim->data == NULL) {
+    status = fsw_alloc (btree->node_size, &victim->data);
+    if (status)
+      return status;
+  }
+  victim->node_num = 0;
+  victim->stamp = 0;
+
+  if ((fsw_u32) fsw_hfs_read_file
+      (btree->file, (fsw_u64) node_num * btree->node_size, btree->node_size,
+       victim->data) != btree->node_size) {
+    return FSW_VOLUME_CORRUPTED;
+  }
+
+  if (!fsw_hfs_btree_node_valid (btree, (BTNodeDescriptor *) victim->data))
+    return FSW_VOLUME_CORRUPTED;
+
+  victim->node_num = node_num;
+  victim->stamp = ++btree->nodes_clock;
+  if (((BTNodeDescriptor *) victim->data)->kind == kBTIndexNode &&
+      btree->nodes_pinned < FSW_HFS_BNODE_CACHE_SIZE - FSW_HFS_BNODE_LEAF_SLOTS) {
+    victim->pinned = 1;
+    btree->nodes_pinned++;
+  }
+
+  *result = (BTNodeDescriptor *) victim->data;
+  return FSW_SUCCESS;
+}
+
+/* Release the node cache of the tree */
+static void
+fsw_hfs_btree_free (
+  struct fsw_hfs_btree *btree
+)
+{
+  fsw_u32 i;
+
+  for (i = 0; i < FSW_HFS_BNODE_CACHE_SIZE; i++) {
+    if (btree->nodes[i].data != NULL)
+      fsw_free (btree->nodes[i].data);
+  }
+  fsw_memzero (btree->nodes, sizeof btree->nodes);
+  btree->nodes_pinned = 0;
+  btree->nodes_clock = 0;
+}
+
+/*
+ * Find the record with the given key. On success the leaf node and the record
+ * index inside it are returned. The node belongs to the node cache of the tree
+ * and must not be freed by the caller.
+ */
 static fsw_status_t
 fsw_hfs_btree_search (
   struct fsw_hfs_btree *btree,
@@ -588,135 +786,57 @@ fsw_hfs_btree_search (
 )
 {
   fsw_status_t status;
-  fsw_u8 *buffer = NULL;
   BTNodeDescriptor *node;
   fsw_u32 currnode;
-  fsw_u32 recnum;
-#ifdef VBOXHFS_BTREE_BINSEARCH
-  fsw_u32 lower, upper;
-#endif
+  fsw_u32 depth;
 
   currnode = btree->root_node;
-  status = fsw_alloc (btree->node_size, &buffer);
-  if (status) {
-    if (buffer != NULL)
-      fsw_free(buffer);
-    return status;
-  }
-  node = (BTNodeDescriptor *) buffer;
-
-  for (;;) {
-    fsw_s32 cmp = 0;
-    int match;
-    fsw_u32 count;
-    BTreeKey *currkey;
-
-    match = 0;
-    /* Read a node */
-    if ((fsw_u32) fsw_hfs_read_file
-        (btree->file, (fsw_u64) currnode * btree->node_size, btree->node_size,
-         buffer) != btree->node_size) {
-      status = FSW_VOLUME_CORRUPTED;
-      break;
-    }
-
-    if (be16_to_cpu (*(fsw_u16 *) (buffer + btree->node_size - 2)) !=
-        sizeof (BTNodeDescriptor)) {
-      status = FSW_VOLUME_CORRUPTED;
-      break;
-    }
-
-    count = be16_to_cpu (node->numRecords);
-
-#ifndef VBOXHFS_BTREE_BINSEARCH
-    for (recnum = 0; recnum < count; recnum++) {
-
-      currkey = fsw_hfs_btree_rec (btree, node, recnum);
-      cmp = compare_keys (currkey, key);
-#if 0
-      FSW_MSG_DEBUGV ((FSW_MSGSTR (__FUNCTION__ ": currnode %d recnum=%d/%d cmp=%d kind=%d\n"),
-            currnode, recnum, count, cmp, node->kind));
-#endif
 
-      /* Leaf node */
-      if (node->kind == kBTLeafNode) {
-        if (cmp == 0) {
-          /* Found! */
-          *result = node;
-          *key_offset = recnum;
+  for (depth = 0; depth < HFS_BTREE_MAX_DEPTH; depth++) {
+    fsw_u32 lower, upper, recnum;
+    int match = 0;
 
-          return FSW_SUCCESS;
-        }
-      }
-      else if (node->kind == kBTIndexNode) {
-        if (cmp > 0)
-          break;
-        currnode = fsw_hfs_btree_next_node (currkey);
-      }
-    }
+    status = fsw_hfs_btree_get_node (btree, currnode, &node);
+    if (status)
+      return status;
 
-    if (node->kind == kBTLeafNode) {
-      status = FSW_NOT_FOUND;
-      break;
-    }
-    if (cmp <= 0 && node->fLink) {
-      currnode = be32_to_cpu (node->fLink);
-    }
-#else
-    /* Perform binary search */
+    /* Binary search for the last record with a key not above the search key */
     lower = 0;
-    upper = count - 1;
-    currkey = NULL;
-
-    if (count == 0) {
-      status = FSW_NOT_FOUND;
-      goto done;
-    }
-
-    while (lower <= upper) {
-      recnum = (lower + upper) / 2;
+    upper = be16_to_cpu (node->numRecords);
+    while (lower < upper) {
+      fsw_s32 cmp;
 
-      currkey = fsw_hfs_btree_rec (btree, node, recnum);
-
-      cmp = compare_keys (currkey, key);
+      recnum = lower + (upper - lower) / 2;
+      cmp = compare_keys (fsw_hfs_btree_rec (btree, node, recnum), key);
       if (cmp > 0) {
-        upper = recnum - 1;
-      } else if (cmp < 0) {
+        upper = recnum;
+      }
+      else {
         lower = recnum + 1;
-      } else if (cmp == 0) {
-        if (node->kind == kBTLeafNode) {
-          // Found!
-          *result = node;
-          *key_offset = recnum;
-          return FSW_SUCCESS;
-
-        } else if (node->kind == kBTIndexNode) {
-          currnode = fsw_hfs_btree_next_node (currkey);
+        if (cmp == 0) {
+          match = 1;
           break;
         }
       }
     }
 
-    if (cmp > 0)
-      currkey = fsw_hfs_btree_rec (btree, node, upper);
+    /* Search key sorts before the first record */
+    if (lower == 0)
+      return FSW_NOT_FOUND;
+    recnum = lower - 1;
 
-    if (node->kind == kBTIndexNode && currkey != NULL) {
-      currnode = fsw_hfs_btree_next_node (currkey);
-    }
-    else {
-      status = FSW_NOT_FOUND;
-      break;
+    if (node->kind == kBTLeafNode) {
+      if (!match)
+        return FSW_NOT_FOUND;
+      *result = node;
+      *key_offset = recnum;
+      return FSW_SUCCESS;
     }
-#endif
-  }
 
-#ifdef VBOXHFS_BTREE_BINSEARCH
-done:
-#endif
-  if (buffer != NULL && status != FSW_SUCCESS)
-    fsw_free (buffer);
+    currnode = fsw_hfs_btree_next_node (fsw_hfs_btree_rec (btree, node, recnum));
+  }
 
-  return status;
+  return FSW_VOLUME_CORRUPTED;
 }
 
 typedef struct {
@@ -730,7 +850,10 @@ typedef struct {
   fsw_u64 used;
   fsw_u32 ctime;
   fsw_u32 mtime;
+  fsw_u32 bsd_flags;
   HFSPlusExtentRecord extents;
+  fsw_u64 rsrc_size;
+  HFSPlusExtentRecord rsrc_extents;
 } file_info_t;
 
 static void
@@ -788,6 +911,10 @@ fill_fileinfo (
       finfo->mtime = be32_to_cpu (info->contentModDate);
       fsw_memcpy (&finfo->extents, &info->dataFork.extents,
                   sizeof finfo->extents);
+      finfo->bsd_flags = info->bsdInfo.ownerFlags;
+      finfo->rsrc_size = be64_to_cpu (info->resourceFork.logicalSize);
+      fsw_memcpy (&finfo->rsrc_extents, &info->resourceFork.extents,
+                  sizeof finfo->rsrc_extents);
       break;
     }
   default:
@@ -867,17 +994,7 @@ fsw_hfs_btree_iterate_node (
 )
 {
   fsw_status_t status;
-
-  /* We modify node, so make a copy */
   BTNodeDescriptor *node = first_node;
-  fsw_u8 *buffer = NULL;
-
-  status = fsw_alloc (btree->node_size, &buffer);
-  if (status) {
-    if (buffer != NULL)
-      fsw_free(buffer);
-    return status;
-  }
 
   for (;;) {
     fsw_u32 i;
@@ -890,37 +1007,26 @@ fsw_hfs_btree_iterate_node (
 
       switch (rv) {
       case 1:
-        status = FSW_SUCCESS;
-        goto done;
+        return FSW_SUCCESS;
       case -1:
-        status = FSW_NOT_FOUND;
-        goto done;
+        return FSW_NOT_FOUND;
       }
       /* if callback returned 0 - continue */
     }
 
     next_node = be32_to_cpu (node->fLink);
 
-    if (!next_node) {
-      status = FSW_NOT_FOUND;
-      break;
-    }
+    if (!next_node)
+      return FSW_NOT_FOUND;
 
-    if ((fsw_u32) fsw_hfs_read_file
-        (btree->file, next_node * btree->node_size, btree->node_size,
-         buffer) != btree->node_size) {
-      status = FSW_VOLUME_CORRUPTED;
-      break;
-    }
+    status = fsw_hfs_btree_get_node (btree, next_node, &node);
+    if (status)
+      return status;
+    if (node->kind != kBTLeafNode)
+      return FSW_VOLUME_CORRUPTED;
 
-    node = (BTNodeDescriptor *) buffer;
     first_rec = 0;
   }
-done:
-  if (buffer)
-    fsw_free (buffer);
-
-  return status;
 }
 
 static int
@@ -1058,71 +1164,721 @@ fsw_hfs_cmpi_catkey (
 }
 
 /**
- * Retrieve file data mapping information. This function is called by the core when
- * fsw_shandle_read needs to know where on the disk the required piece of the file's
- * data can be found. The core makes sure that fsw_hfs_dnode_fill has been called
- * on the dnode before. Our task here is to get the physical disk block number for
- * the requested logical block number.
+ * Append the extents of one extent record to a run map.
+ * Returns the number of blocks added, zero means the record was empty.
  */
 
-static fsw_status_t
-fsw_hfs_get_extent (
-  struct fsw_hfs_volume *vol,
-  struct fsw_hfs_dnode *dno,
-  struct fsw_extent *extent
+static fsw_u32
+fsw_hfs_extent_map_add (
+  struct fsw_hfs_extent_run *map,
+  fsw_u32 * map_count,
+  HFSPlusExtentRecord * exts,
+  fsw_u32 log_start
 )
 {
-  fsw_status_t status;
-  fsw_u32 lbno;
-  HFSPlusExtentRecord *exts;
-  BTNodeDescriptor *node = NULL;
+  int i;
+  fsw_u32 added = 0;
 
-  extent->type = FSW_EXTENT_TYPE_PHYSBLOCK;
-  extent->log_count = 1;
-  lbno = extent->log_start;
+  for (i = 0; i < 8; i++) {
+    struct fsw_hfs_extent_run *run;
+    fsw_u32 count = be32_to_cpu ((*exts)[i].blockCount);
 
-  /* we only care about data forks atm, do we? */
-  exts = &dno->extents;
+    if (count == 0)
+      break;
 
-  for (;;) {
+    run = &map[(*map_count)++];
+    run->log_start = log_start + added;
+    run->phys_start = be32_to_cpu ((*exts)[i].startBlock);
+    run->count = count;
+    added += count;
+  }
+
+  return added;
+}
+
+/**
+ * Build the sorted in-memory run map of a fork. The 8 inline extents come
+ * from the catalog record, the rest is collected from the extents overflow
+ * tree, one B-tree search per overflow record. This is done once per fork,
+ * on first access.
+ */
+
+static fsw_status_t
+fsw_hfs_extent_map_build (
+  struct fsw_hfs_volume *vol,
+  fsw_u32 file_id,
+  fsw_u8 fork_type,
+  HFSPlusExtentRecord * exts,
+  fsw_u64 size,
+  struct fsw_hfs_extent_run **map_out,
+  fsw_u32 * map_count_out
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_extent_run *map;
+  fsw_u32 map_count = 0;
+  fsw_u32 capacity = 8;
+  fsw_u32 blocks;
+  fsw_u32 needed;
+  BTNodeDescriptor *node = NULL;
+
+  status = fsw_alloc (capacity * sizeof (struct fsw_hfs_extent_run), &map);
+  if (status)
+    return status;
+
+  blocks = fsw_hfs_extent_map_add (map, &map_count, exts, 0);
+  needed = (fsw_u32) FSW_U64_SHR (size + (1 << vol->block_size_shift) - 1,
+                                  vol->block_size_shift);
+
+  /* The extents overflow file never has overflow extents itself */
+  while (blocks < needed && file_id != kHFSExtentsFileID) {
     struct HFSPlusExtentKey *key;
     struct HFSPlusExtentKey overflowkey;
+    struct fsw_hfs_extent_run *new_map;
     fsw_u32 ptr;
-    fsw_u32 phys_bno;
+    fsw_u32 added;
 
-    if (fsw_hfs_find_block (exts, &lbno, &phys_bno)) {
-      extent->phys_start = phys_bno + vol->emb_block_off;
-      status = FSW_SUCCESS;
-      break;
-    }
-
-    /* Find appropriate overflow record */
-    overflowkey.forkType = 0; /* data fork */
-    overflowkey.fileID = dno->g.dnode_id;
-    overflowkey.startBlock = extent->log_start - lbno;
-
-    if (node != NULL) {
-      fsw_free (node);
-      node = NULL;
-    }
+    overflowkey.forkType = fork_type;
+    overflowkey.fileID = file_id;
+    overflowkey.startBlock = blocks;
 
     status =
       fsw_hfs_btree_search (&vol->extents_tree, (BTreeKey *) & overflowkey,
                             fsw_hfs_cmp_extkey, &node, &ptr);
+    if (status == FSW_NOT_FOUND) {
+      /* Map what we have, lookups beyond it fail */
+      status = FSW_SUCCESS;
+      break;
+    }
     if (status)
       break;
 
+    if (map_count + 8 > capacity) {
+      capacity *= 2;
+      status = fsw_alloc (capacity * sizeof (struct fsw_hfs_extent_run), &new_map);
+      if (status)
+        break;
+      fsw_memcpy (new_map, map, map_count * sizeof (struct fsw_hfs_extent_run));
+      fsw_free (map);
+      map = new_map;
+    }
+
     key = (struct HFSPlusExtentKey *)
       fsw_hfs_btree_rec (&vol->extents_tree, node, ptr);
-    exts = (HFSPlusExtentRecord *) (key + 1);
+    added = fsw_hfs_extent_map_add (map, &map_count, (HFSPlusExtentRecord *) (key + 1), blocks);
+    if (added == 0)
+      break;
+    blocks += added;
+  }
+
+  if (status) {
+    fsw_free (map);
+    return status;
+  }
+
+  *map_out = map;
+  *map_count_out = map_count;
+  return FSW_SUCCESS;
+}
+
+/* Binary search for the run holding logical block lbno, NULL if unmapped */
+static struct fsw_hfs_extent_run *
+fsw_hfs_extent_map_find (
+  struct fsw_hfs_extent_run *map,
+  fsw_u32 map_count,
+  fsw_u32 lbno
+)
+{
+  fsw_u32 lower, upper, middle;
+  struct fsw_hfs_extent_run *run;
+
+  /* Last run starting at or before lbno */
+  lower = 0;
+  upper = map_count;
+  while (lower < upper) {
+    middle = (lower + upper) / 2;
+    if (map[middle].log_start <= lbno)
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+  if (lower == 0)
+    return NULL;
+
+  run = &map[lower - 1];
+  if (lbno - run->log_start >= run->count)
+    return NULL;
+
+  return run;
+}
+
+/**
+ * Retrieve file data mapping information. This function is called by the core when
+ * fsw_shandle_read needs to know where on the disk the required piece of the file's
+ * data can be found. The core makes sure that fsw_hfs_dnode_fill has been called
+ * on the dnode before. Our task here is to get the physical disk block number for
+ * the requested logical block number, along with the number of blocks that follow
+ * it contiguously on disk. The answer comes from the dnode's extent map. For
+ * compressed files the answer is a buffer extent holding one decompressed chunk.
+ */
+
+static fsw_status_t
+fsw_hfs_get_extent (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  struct fsw_extent *extent
+)
+{
+  fsw_status_t status;
+  fsw_u32 lbno;
+  struct fsw_hfs_extent_run *run;
+
+  if (dno->decmpfs != NULL)
+    return fsw_hfs_decmpfs_get_extent (vol, dno, extent);
+
+  if (dno->extent_map == NULL) {
+    status = fsw_hfs_extent_map_build (vol, dno->g.dnode_id, HFS_FORK_DATA,
+                                       &dno->extents, dno->g.size,
+                                       &dno->extent_map, &dno->extent_map_count);
+    if (status)
+      return status;
+  }
+
+  lbno = extent->log_start;
+  run = fsw_hfs_extent_map_find (dno->extent_map, dno->extent_map_count, lbno);
+  if (run == NULL)
+    return FSW_NOT_FOUND;
+
+  extent->type = FSW_EXTENT_TYPE_PHYSBLOCK;
+  extent->phys_start = run->phys_start + (lbno - run->log_start) + vol->emb_block_off;
+  extent->log_count = run->count - (lbno - run->log_start);
+
+  return FSW_SUCCESS;
+}
+
+/* Attribute keys: file id, then name (binary Unicode order), then start block */
+static int
+fsw_hfs_cmp_attrkey (
+  BTreeKey * key1,
+  BTreeKey * key2
+)
+{
+  HFSPlusAttrKey *akey1 = (HFSPlusAttrKey *) key1;
+  HFSPlusAttrKey *akey2 = (HFSPlusAttrKey *) key2;
+  fsw_u32 id1, block1;
+  fsw_u32 len1, maxlen, i;
+
+  /* First key is read from the FS data, second is in-memory in CPU endianess */
+  id1 = be32_to_cpu (akey1->fileID);
+  if (id1 != akey2->fileID)
+    return id1 > akey2->fileID ? 1 : -1;
+
+  /* Name length is only trusted as far as the key reaches */
+  len1 = be16_to_cpu (akey1->attrNameLen);
+  maxlen = (be16_to_cpu (akey1->keyLength) - 12) / 2;
+  if (be16_to_cpu (akey1->keyLength) < 12)
+    maxlen = 0;
+  if (len1 > maxlen)
+    len1 = maxlen;
+
+  for (i = 0; i < len1 && i < akey2->attrNameLen; i++) {
+    fsw_u16 c1 = be16_to_cpu (akey1->attrName[i]);
+
+    if (c1 != akey2->attrName[i])
+      return c1 > akey2->attrName[i] ? 1 : -1;
+  }
+  if (len1 != akey2->attrNameLen)
+    return len1 > akey2->attrNameLen ? 1 : -1;
+
+  block1 = be32_to_cpu (akey1->startBlock);
+  if (block1 != akey2->startBlock)
+    return block1 > akey2->startBlock ? 1 : -1;
+  return 0;
+}
+
+/**
+ * Get the value of an inline extended attribute. On success *data_out points
+ * into the node cache of the attributes tree and stays valid until the next
+ * search in that tree.
+ */
+
+static fsw_status_t
+fsw_hfs_get_xattr (
+  struct fsw_hfs_volume *vol,
+  fsw_u32 file_id,
+  const char *name,
+  fsw_u8 ** data_out,
+  fsw_u32 * size_out
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_btree *btree = &vol->attributes_tree;
+  HFSPlusAttrKey attrkey;
+  BTNodeDescriptor *node;
+  HFSPlusAttrData *rec;
+  BTreeKey *key;
+  fsw_u8 *rec_end;
+  fsw_u32 ptr;
+  fsw_u32 i;
+
+  if (btree->file == NULL)
+    return FSW_NOT_FOUND;
+
+  attrkey.fileID = file_id;
+  attrkey.startBlock = 0;
+  for (i = 0; name[i] != 0 && i < kHFSMaxAttrNameLen; i++)
+    attrkey.attrName[i] = (fsw_u8) name[i];
+  attrkey.attrNameLen = (fsw_u16) i;
+
+  status = fsw_hfs_btree_search (btree, (BTreeKey *) & attrkey,
+                                 fsw_hfs_cmp_attrkey, &node, &ptr);
+  if (status)
+    return status;
+
+  /* Record ends where the next one starts, offsets were checked on load */
+  key = fsw_hfs_btree_rec (btree, node, ptr);
+  rec = (HFSPlusAttrData *) ((fsw_u8 *) key + be16_to_cpu (key->length16) + 2);
+  rec_end = (fsw_u8 *) node + fsw_hfs_btree_recoffset (btree, node, ptr + 1);
+
+  if ((fsw_u8 *) rec->attrData > rec_end)
+    return FSW_VOLUME_CORRUPTED;
+  /* Large values stored in extents are not used for decmpfs headers */
+  if (be32_to_cpu (rec->recordType) != kHFSPlusAttrInlineData)
+    return FSW_UNSUPPORTED;
+  if (be32_to_cpu (rec->attrSize) > (fsw_u32) (rec_end - rec->attrData))
+    return FSW_VOLUME_CORRUPTED;
+
+  *data_out = rec->attrData;
+  *size_out = be32_to_cpu (rec->attrSize);
+  return FSW_SUCCESS;
+}
+
+/* Read the chunk table at the start of an LZVN compressed resource fork */
+static fsw_status_t
+fsw_hfs_decmpfs_lzvn_table (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  struct fsw_hfs_decmpfs *cmp
+)
+{
+  fsw_status_t status;
+  fsw_u32 *offsets = NULL;
+  fsw_u32 first;
+  fsw_u32 i;
+
+  /* Table of chunk_count + 1 little endian offsets, the first one is its size */
+  if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count, 0, 4,
+                         (fsw_u8 *) & first) != 4)
+    return FSW_VOLUME_CORRUPTED;
+  first = fsw_u32_le_swap (first);
+  if (first != (cmp->chunk_count + 1) * 4 || first > dno->rsrc_size)
+    return FSW_VOLUME_CORRUPTED;
+
+  status = fsw_alloc (first, &offsets);
+  if (status)
+    return status;
+  if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count, 0, first,
+                         (fsw_u8 *) offsets) != (fsw_s32) first) {
+    fsw_free (offsets);
+    return FSW_VOLUME_CORRUPTED;
   }
 
-  if (node != NULL)
-    fsw_free (node);
+  for (i = 0; i < cmp->chunk_count; i++) {
+    fsw_u32 start = fsw_u32_le_swap (offsets[i]);
+    fsw_u32 end = fsw_u32_le_swap (offsets[i + 1]);
 
+    if (end < start || end > dno->rsrc_size) {
+      fsw_free (offsets);
+      return FSW_VOLUME_CORRUPTED;
+    }
+    cmp->chunks[i].offset = start;
+    cmp->chunks[i].size = end - start;
+  }
+
+  fsw_free (offsets);
+  return FSW_SUCCESS;
+}
+
+/* Read the chunk table of the 'cmpf' resource of a zlib compressed resource fork */
+static fsw_status_t
+fsw_hfs_decmpfs_zlib_table (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  struct fsw_hfs_decmpfs *cmp
+)
+{
+  fsw_status_t status;
+  fsw_u32 header[4];
+  fsw_u32 *table = NULL;
+  fsw_u32 data_off, count;
+  fsw_u32 i;
+
+  /* Resource fork header, big endian; the data area starts with the resource length */
+  if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count, 0, 16,
+                         (fsw_u8 *) header) != 16)
+    return FSW_VOLUME_CORRUPTED;
+  data_off = be32_to_cpu (header[0]) + 4;
+
+  /* Chunk count and table in the resource data are little endian */
+  if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count, data_off, 4,
+                         (fsw_u8 *) & count) != 4)
+    return FSW_VOLUME_CORRUPTED;
+  if (fsw_u32_le_swap (count) != cmp->chunk_count)
+    return FSW_VOLUME_CORRUPTED;
+
+  status = fsw_alloc (cmp->chunk_count * 8, &table);
+  if (status)
+    return status;
+  if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count, data_off + 4,
+                         cmp->chunk_count * 8, (fsw_u8 *) table) !=
+      (fsw_s32) (cmp->chunk_count * 8)) {
+    fsw_free (table);
+    return FSW_VOLUME_CORRUPTED;
+  }
+
+  for (i = 0; i < cmp->chunk_count; i++) {
+    fsw_u64 offset = (fsw_u64) data_off + fsw_u32_le_swap (table[2 * i]);
+    fsw_u32 size = fsw_u32_le_swap (table[2 * i + 1]);
+
+    if (offset + size > dno->rsrc_size) {
+      fsw_free (table);
+      return FSW_VOLUME_CORRUPTED;
+    }
+    cmp->chunks[i].offset = offset;
+    cmp->chunks[i].size = size;
+  }
+
+  fsw_free (table);
+  return FSW_SUCCESS;
+}
+
+/**
+ * Check that the inline payload of a decmpfs attribute can produce size bytes.
+ * Payloads stored uncompressed, raw or behind a one byte marker, must hold
+ * the whole file; compressed ones are bounded by the best possible ratio.
+ */
+
+static int
+fsw_hfs_decmpfs_inline_ok (
+  fsw_u32 type,
+  fsw_u64 size,
+  fsw_u8 * payload,
+  fsw_u32 payload_len
+)
+{
+  if (size > DECMPFS_INLINE_MAX_SIZE)
+    return 0;
+  if (type == DECMPFS_TYPE_RAW_INLINE)
+    return size <= payload_len;
+  if (payload_len == 0)
+    return size == 0;
+  if ((type == DECMPFS_TYPE_ZLIB_INLINE && (payload[0] & 0x0F) == 0x0F) ||
+      (type == DECMPFS_TYPE_LZVN_INLINE && payload[0] == 0x06))
+    return size <= payload_len - 1;
+  return size <= (fsw_u64) payload_len * DECMPFS_INLINE_MAX_RATIO;
+}
+
+/**
+ * Read the decmpfs attribute of a compressed file. Inline data is kept in
+ * memory, for the resource fork types the fork is mapped and the chunk table
+ * read. The dnode size becomes the uncompressed size.
+ *
+ * Files flagged compressed whose attribute is missing, stored in extents,
+ * malformed or of a type not decoded here (LZFSE and others) are read from
+ * their data fork as before. Only running out of memory fails the open.
+ */
+
+static fsw_status_t
+fsw_hfs_decmpfs_open (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_decmpfs *cmp = NULL;
+  fsw_u8 *data;
+  fsw_u32 size;
+  fsw_u32 header[4];
+  fsw_u32 type;
+  fsw_u64 file_size;
+
+  status = fsw_hfs_get_xattr (vol, dno->g.dnode_id, DECMPFS_XATTR_NAME, &data, &size);
+  if (status == FSW_OUT_OF_MEMORY)
+    return status;
+  if (status)
+    return FSW_SUCCESS;
+
+  if (size < DECMPFS_HEADER_SIZE)
+    return FSW_SUCCESS;
+  fsw_memcpy (header, data, DECMPFS_HEADER_SIZE);
+  if (fsw_u32_le_swap (header[0]) != DECMPFS_MAGIC)
+    return FSW_SUCCESS;
+  type = fsw_u32_le_swap (header[1]);
+  file_size = fsw_u64_le_swap (*(fsw_u64 *) & header[2]);
+
+  /* Chunk tables are kept in memory */
+  if (file_size > 0x7FFFFFFF)
+    return FSW_SUCCESS;
+
+  switch (type) {
+  case DECMPFS_TYPE_RAW_INLINE:
+  case DECMPFS_TYPE_ZLIB_INLINE:
+  case DECMPFS_TYPE_LZVN_INLINE:
+    if (!fsw_hfs_decmpfs_inline_ok (type, file_size, data + DECMPFS_HEADER_SIZE,
+                                    size - DECMPFS_HEADER_SIZE))
+      return FSW_SUCCESS;
+    break;
+
+  case DECMPFS_TYPE_ZLIB_RSRC:
+  case DECMPFS_TYPE_LZVN_RSRC:
+    break;
+
+  default:
+    return FSW_SUCCESS;
+  }
+
+  status = fsw_alloc_zero (sizeof (struct fsw_hfs_decmpfs), (void **) &cmp);
+  if (status)
+    return status;
+  cmp->type = type;
+  cmp->size = file_size;
+
+  if (type == DECMPFS_TYPE_ZLIB_RSRC || type == DECMPFS_TYPE_LZVN_RSRC) {
+    cmp->chunk_count = (fsw_u32) FSW_U64_SHR (cmp->size + DECMPFS_CHUNK_SIZE - 1, 16);
+    status = fsw_hfs_extent_map_build (vol, dno->g.dnode_id, HFS_FORK_RESOURCE,
+                                       &dno->rsrc_extents, dno->rsrc_size,
+                                       &cmp->rsrc_map, &cmp->rsrc_map_count);
+    if (!status)
+      status = fsw_alloc_zero ((cmp->chunk_count + 1) * sizeof (struct fsw_hfs_decmpfs_chunk),
+                               (void **) &cmp->chunks);
+    if (!status) {
+      if (type == DECMPFS_TYPE_ZLIB_RSRC)
+        status = fsw_hfs_decmpfs_zlib_table (vol, dno, cmp);
+      else
+        status = fsw_hfs_decmpfs_lzvn_table (vol, dno, cmp);
+    }
+  }
+  else {
+    cmp->inline_size = size - DECMPFS_HEADER_SIZE;
+    status = fsw_memdup ((void **) &cmp->inline_data, data + DECMPFS_HEADER_SIZE,
+                         cmp->inline_size);
+  }
+
+  dno->decmpfs = cmp;
+  if (status) {
+    fsw_hfs_decmpfs_free (dno);
+    return status == FSW_OUT_OF_MEMORY ? status : FSW_SUCCESS;
+  }
+
+  dno->g.size = cmp->size;
+  return FSW_SUCCESS;
+}
+
+static void
+fsw_hfs_decmpfs_free (
+  struct fsw_hfs_dnode *dno
+)
+{
+  struct fsw_hfs_decmpfs *cmp = dno->decmpfs;
+
+  if (cmp == NULL)
+    return;
+  if (cmp->inline_data != NULL)
+    fsw_free (cmp->inline_data);
+  if (cmp->chunks != NULL)
+    fsw_free (cmp->chunks);
+  if (cmp->rsrc_map != NULL)
+    fsw_free (cmp->rsrc_map);
+  fsw_free (cmp);
+  dno->decmpfs = NULL;
+}
+
+/**
+ * Decompress chunk number index of a file into out, which takes out_len bytes,
+ * the exact uncompressed size of the chunk.
+ */
+
+static fsw_status_t
+fsw_hfs_decmpfs_decode (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  fsw_u32 index,
+  fsw_u8 * out,
+  fsw_u32 out_len
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_decmpfs *cmp = dno->decmpfs;
+  fsw_u8 *src;
+  fsw_u8 *buffer = NULL;
+  fsw_u32 src_len;
+  fsw_u32 done = 0;
+
+  if (cmp->inline_data != NULL) {
+    src = cmp->inline_data;
+    src_len = cmp->inline_size;
+  }
+  else {
+    /* A chunk that does not compress is stored with a one byte marker */
+    src_len = cmp->chunks[index].size;
+    if (src_len == 0 || src_len > DECMPFS_CHUNK_SIZE * 2)
+      return FSW_VOLUME_CORRUPTED;
+    status = fsw_alloc (src_len, &buffer);
+    if (status)
+      return status;
+    if (fsw_hfs_read_fork (vol, cmp->rsrc_map, cmp->rsrc_map_count,
+                           cmp->chunks[index].offset, src_len, buffer) != (fsw_s32) src_len) {
+      fsw_free (buffer);
+      return FSW_VOLUME_CORRUPTED;
+    }
+    src = buffer;
+  }
+
+  status = FSW_VOLUME_CORRUPTED;
+  switch (cmp->type) {
+  case DECMPFS_TYPE_RAW_INLINE:
+    if (src_len >= out_len) {
+      fsw_memcpy (out, src, out_len);
+      status = FSW_SUCCESS;
+      done = out_len;
+    }
+    break;
+
+  case DECMPFS_TYPE_ZLIB_INLINE:
+  case DECMPFS_TYPE_ZLIB_RSRC:
+    if (src_len > 0 && (src[0] & 0x0F) == 0x0F) {
+      if (src_len - 1 >= out_len) {
+        fsw_memcpy (out, src + 1, out_len);
+        status = FSW_SUCCESS;
+        done = out_len;
+      }
+    }
+    else {
+      status = fsw_zlib_decompress (src, src_len, out, out_len, &done);
+    }
+    break;
+
+  case DECMPFS_TYPE_LZVN_INLINE:
+  case DECMPFS_TYPE_LZVN_RSRC:
+    if (src_len > 0 && src[0] == 0x06) {
+      if (src_len - 1 >= out_len) {
+        fsw_memcpy (out, src + 1, out_len);
+        status = FSW_SUCCESS;
+        done = out_len;
+      }
+    }
+    else {
+      status = fsw_lzvn_decompress (src, src_len, out, out_len, &done);
+    }
+    break;
+  }
+
+  if (buffer != NULL)
+    fsw_free (buffer);
+
+  if (status == FSW_SUCCESS && done != out_len)
+    status = FSW_VOLUME_CORRUPTED;
   return status;
 }
 
+/**
+ * Answer get_extent for a compressed file with a buffer holding the chunk that
+ * contains the requested block. Decoded chunks are kept in a small per-volume
+ * LRU cache, so reads that cross a chunk in several calls or reopen a file
+ * decompress it only once. The buffer handed to the core is a copy, the core
+ * frees it when it moves on.
+ */
+
+static fsw_status_t
+fsw_hfs_decmpfs_get_extent (
+  struct fsw_hfs_volume *vol,
+  struct fsw_hfs_dnode *dno,
+  struct fsw_extent *extent
+)
+{
+  fsw_status_t status;
+  struct fsw_hfs_decmpfs *cmp = dno->decmpfs;
+  struct fsw_hfs_chunk *chunk = NULL;
+  fsw_u32 block_size = 1 << vol->block_size_shift;
+  fsw_u64 chunk_start;
+  fsw_u32 chunk_len;
+  fsw_u32 index;
+  fsw_u32 i;
+  void *buffer;
+
+  if (cmp->inline_data == NULL && cmp->chunks == NULL)
+    return FSW_UNSUPPORTED;
+  if (block_size > DECMPFS_CHUNK_SIZE)
+    return FSW_UNSUPPORTED;
+
+  if (cmp->inline_data != NULL) {
+    /* The whole file is a single chunk */
+    index = 0;
+    chunk_start = 0;
+    chunk_len = (fsw_u32) cmp->size;
+  }
+  else {
+    index = (fsw_u32) FSW_U64_SHR ((fsw_u64) extent->log_start << vol->block_size_shift, 16);
+    if (index >= cmp->chunk_count)
+      return FSW_NOT_FOUND;
+    chunk_start = (fsw_u64) index * DECMPFS_CHUNK_SIZE;
+    chunk_len = DECMPFS_CHUNK_SIZE;
+    if (cmp->size - chunk_start < chunk_len)
+      chunk_len = (fsw_u32) (cmp->size - chunk_start);
+  }
+  if (chunk_len == 0)
+    return FSW_NOT_FOUND;
+
+  for (i = 0; i < FSW_HFS_CHUNK_CACHE_SIZE; i++) {
+    struct fsw_hfs_chunk *c = &vol->chunk_cache[i];
+
+    if (c->dnode_id == dno->g.dnode_id && c->index == index) {
+      chunk = c;
+      break;
+    }
+    if (chunk == NULL || c->stamp < chunk->stamp)
+      chunk = c;
+  }
+
+  if (chunk->dnode_id != dno->g.dnode_id || chunk->index != index) {
+    /* Replace the least recently used slot */
+    chunk->dnode_id = 0;
+    chunk->stamp = 0;
+    if (chunk->capacity < chunk_len) {
+      if (chunk->data != NULL)
+        fsw_free (chunk->data);
+      chunk->capacity = 0;
+      status = fsw_alloc (chunk_len, &chunk->data);
+      if (status) {
+        chunk->data = NULL;
+        return status;
+      }
+      chunk->capacity = chunk_len;
+    }
+    status = fsw_hfs_decmpfs_decode (vol, dno, index, chunk->data, chunk_len);
+    if (status)
+      return status;
+    chunk->dnode_id = dno->g.dnode_id;
+    chunk->index = index;
+    chunk->size = chunk_len;
+  }
+  chunk->stamp = ++vol->chunk_clock;
+
+  extent->type = FSW_EXTENT_TYPE_BUFFER;
+  extent->log_start = (fsw_u32) FSW_U64_SHR (chunk_start, vol->block_size_shift);
+  extent->log_count = (chunk_len + block_size - 1) >> vol->block_size_shift;
+
+  status = fsw_alloc (extent->log_count << vol->block_size_shift, &buffer);
+  if (status)
+    return status;
+  fsw_memcpy (buffer, chunk->data, chunk_len);
+  fsw_memzero ((fsw_u8 *) buffer + chunk_len,
+               (extent->log_count << vol->block_size_shift) - chunk_len);
+  extent->buffer = buffer;
+
+  return FSW_SUCCESS;
+}
+
 static fsw_status_t
 create_hfs_dnode (
   struct fsw_hfs_dnode *dno,
@@ -1139,7 +1895,9 @@ create_hfs_dnode (
   if (status)
     return status;
 
-  baby->g.size = file_info->size;
+  /* An already known compressed file keeps its uncompressed size */
+  if (baby->decmpfs == NULL)
+    baby->g.size = file_info->size;
   baby->used_bytes = file_info->used;
   baby->ctime = file_info->ctime;
   baby->mtime = file_info->mtime;
@@ -1147,6 +1905,11 @@ create_hfs_dnode (
   /* Fill-in extents info */
   if (file_info->type == FSW_DNODE_TYPE_FILE) {
     fsw_memcpy (baby->extents, &file_info->extents, sizeof file_info->extents);
+    fsw_memcpy (baby->rsrc_extents, &file_info->rsrc_extents,
+                sizeof file_info->rsrc_extents);
+    baby->rsrc_size = file_info->rsrc_size;
+    if (baby->decmpfs == NULL)
+      baby->compressed = (file_info->bsd_flags & HFS_UF_COMPRESSED) != 0;
   }
 
   /* Fill-in link file info */
@@ -1227,9 +1990,6 @@ fsw_hfs_dir_lookup (
 
 done:
 
-  if (node != NULL)
-    fsw_free (node);
-
   if (free_data)
     fsw_strfree (&rec_name);
 
@@ -1294,8 +2054,6 @@ fsw_hfs_dir_read (
   status = create_hfs_dnode (dno, &param.file_info, child_dno_out);
 
 done:
-  if (node)
-    fsw_free (node);
   fsw_strfree (&rec_name);
 
   return status;
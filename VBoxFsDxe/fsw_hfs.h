@@ -30,6 +30,39 @@
 //! Block number where the HFS superblock resides.
 #define HFS_SUPERBLOCK_BLOCKNO   2
 
+//! Depth limit for B-tree descents, guards against loops in corrupted trees.
+#define HFS_BTREE_MAX_DEPTH      16
+
+//! BSD owner flag of transparently compressed files.
+#define HFS_UF_COMPRESSED        0x20
+
+//! Fork types in extent overflow keys.
+#define HFS_FORK_DATA            0x00
+#define HFS_FORK_RESOURCE        0xFF
+
+//! decmpfs extended attribute, holding the header and inline compressed data.
+#define DECMPFS_XATTR_NAME       "com.apple.decmpfs"
+#define DECMPFS_MAGIC            0x636d7066   /* 'cmpf', little endian on disk */
+#define DECMPFS_HEADER_SIZE      16
+#define DECMPFS_CHUNK_SIZE       0x10000
+
+//! Inline files decode into one buffer. Deflate expands at most 1032:1 and
+//! an inline attribute holds a few KiB, so larger sizes are not trusted.
+#define DECMPFS_INLINE_MAX_RATIO 1032
+#define DECMPFS_INLINE_MAX_SIZE  (64 * DECMPFS_CHUNK_SIZE)
+
+//! decmpfs compression types
+#define DECMPFS_TYPE_RAW_INLINE  1
+#define DECMPFS_TYPE_ZLIB_INLINE 3
+#define DECMPFS_TYPE_ZLIB_RSRC   4
+#define DECMPFS_TYPE_LZVN_INLINE 7
+#define DECMPFS_TYPE_LZVN_RSRC   8
+
+//! Number of decoded chunks of compressed files kept per volume.
+#ifndef FSW_HFS_CHUNK_CACHE_SIZE
+#define FSW_HFS_CHUNK_CACHE_SIZE 4
+#endif
+
 /* Make world look Applish enough for the system header describing HFS layout  */
 #define __APPLE_API_PRIVATE
 #define __APPLE_API_UNSTABLE
@@ -88,6 +121,43 @@ typedef enum {
     FSW_HFS_PLUS_EMB
 } fsw_hfs_kind;
 
+/**
+ * HFS: One contiguous run of a fork, in allocation blocks.
+ */
+
+struct fsw_hfs_extent_run
+{
+  fsw_u32                   log_start;  //!< First logical block of the run
+  fsw_u32                   phys_start; //!< First allocation block on disk
+  fsw_u32                   count;      //!< Number of blocks in the run
+};
+
+/**
+ * HFS: Location of one compressed chunk in the resource fork.
+ */
+
+struct fsw_hfs_decmpfs_chunk
+{
+  fsw_u64                   offset;     //!< Byte offset in the resource fork
+  fsw_u32                   size;       //!< Compressed size in bytes
+};
+
+/**
+ * HFS: Decompression state of a file with the decmpfs attribute.
+ */
+
+struct fsw_hfs_decmpfs
+{
+  fsw_u32                   type;       //!< DECMPFS_TYPE_*
+  fsw_u64                   size;       //!< Uncompressed size
+  fsw_u8                    *inline_data;   //!< Compressed data stored in the attribute
+  fsw_u32                   inline_size;
+  struct fsw_hfs_decmpfs_chunk *chunks; //!< Chunk table of the resource fork types
+  fsw_u32                   chunk_count;
+  struct fsw_hfs_extent_run *rsrc_map;  //!< Sorted runs of the resource fork
+  fsw_u32                   rsrc_map_count;
+};
+
 /**
  * HFS: Dnode structure with HFS-specific data.
  */
@@ -96,6 +166,12 @@ struct fsw_hfs_dnode
 {
   struct fsw_dnode          g;          //!< Generic dnode structure
   HFSPlusExtentRecord       extents;
+  struct fsw_hfs_extent_run *extent_map;  //!< Sorted runs of the data fork, built on first access
+  fsw_u32                   extent_map_count;
+  HFSPlusExtentRecord       rsrc_extents;
+  fsw_u64                   rsrc_size;
+  int                       compressed;   //!< HFS_UF_COMPRESSED set, decmpfs not read yet
+  struct fsw_hfs_decmpfs    *decmpfs;     //!< Set by dnode_fill for compressed files
   fsw_u32                   ctime;
   fsw_u32                   mtime;
   fsw_u64                   used_bytes;
@@ -106,6 +182,26 @@ struct fsw_hfs_dnode
   fsw_u32 ilink;
 };
 
+/**
+ * HFS: Number of B-tree nodes kept in memory per tree. Index nodes are pinned
+ * as long as FSW_HFS_BNODE_LEAF_SLOTS entries stay free for leaf nodes.
+ */
+#ifndef FSW_HFS_BNODE_CACHE_SIZE
+#define FSW_HFS_BNODE_CACHE_SIZE   (64)
+#endif
+#define FSW_HFS_BNODE_LEAF_SLOTS   (8)
+
+/**
+ * HFS: Cached B-tree node.
+ */
+struct fsw_hfs_bnode
+{
+    fsw_u32                  node_num;    //!< Node number, 0 (header node) marks an empty slot
+    fsw_u32                  stamp;       //!< Last use, for LRU eviction of unpinned nodes
+    int                      pinned;      //!< Index node, never evicted
+    fsw_u8                   *data;       //!< Verified node contents, node_size bytes
+};
+
 /**
  * HFS: In-memory B-tree structure.
  */
@@ -114,9 +210,25 @@ struct fsw_hfs_btree
     fsw_u32                  root_node;
     fsw_u32                  node_size;
     struct fsw_hfs_dnode*    file;
+    struct fsw_hfs_bnode     nodes[FSW_HFS_BNODE_CACHE_SIZE];
+    fsw_u32                  nodes_pinned;
+    fsw_u32                  nodes_clock;
 };
 
 
+/**
+ * HFS: Decoded chunk of a compressed file, cached per volume.
+ */
+struct fsw_hfs_chunk
+{
+    fsw_u32                  dnode_id;    //!< File the chunk belongs to, 0 for an empty slot
+    fsw_u32                  index;       //!< Chunk number in the file
+    fsw_u32                  stamp;       //!< Last use, for LRU replacement
+    fsw_u32                  size;        //!< Valid bytes in data
+    fsw_u32                  capacity;    //!< Allocated bytes in data
+    fsw_u8                   *data;
+};
+
 /**
  * HFS: In-memory volume structure with HFS-specific data.
  */
@@ -128,6 +240,9 @@ struct fsw_hfs_volume
     struct HFSPlusVolumeHeader   *primary_voldesc;  //!< Volume Descriptor
     struct fsw_hfs_btree          catalog_tree;     // Catalog tree
     struct fsw_hfs_btree          extents_tree;     // Extents overflow tree
+    struct fsw_hfs_btree          attributes_tree;  // Extended attributes tree, file is NULL if absent
+    struct fsw_hfs_chunk          chunk_cache[FSW_HFS_CHUNK_CACHE_SIZE];
+    fsw_u32                       chunk_clock;
     struct fsw_hfs_dnode          root_file;
     int                           case_sensitive;
     fsw_u32                       block_size_shift;